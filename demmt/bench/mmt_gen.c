@@ -0,0 +1,393 @@
+/*
+ * Copyright (C) 2026 The envytools authors.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Writes a synthetic mmt binary trace of a blob driver client: a context with
+ * a device, a number of mapped buffers receiving CPU writes, and a FIFO IB
+ * channel with a 3D and a compute object submitting pushbuffers, some of them
+ * uploading and calling macros. Every buffer is created, mapped into the GPU
+ * virtual space and mmapped the way the blob does it, so the whole trace can
+ * be decoded by demmt and converted by mmt_bin2dedma.
+ *
+ * Usage: mmt_gen [-c chipset] [-o objects] [-b object KiB] [-w data writes]
+ *                [-p pushbuffers] [-m methods] [-M macro uploads]
+ *                [-P pushbuffer KiB] [-s seed] > trace.mmt
+ *
+ * The number of records and bytes written is printed on stderr.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "nvrm_create.h"
+#include "nvrm_ioctl.h"
+#include "nvrm_mthd.h"
+#include "nvrm_object.xml.h"
+#include "mmt_rec.h"
+
+#define FD 3
+#define CID 0xc1d00001
+#define DEVICE 0xbeef0080
+#define SUBDEVICE 0xbeef2080
+#define FIFO 0xbeef006f
+
+#define ARGS_PTR 0x7fff00001000ULL
+
+static void do_ioctl(uint32_t id, const void *data, uint32_t len, const void *arg, uint32_t arglen)
+{
+	ioctl_rec('i', FD, id, data, len, ARGS_PTR, arg, arglen);
+	ioctl_rec('j', FD, id, data, len, ARGS_PTR, arg, arglen);
+}
+
+static void create(uint32_t parent, uint32_t handle, uint32_t cls, const void *arg, uint32_t arglen)
+{
+	struct nvrm_ioctl_create c = { CID, parent, handle, cls, arg ? ARGS_PTR : 0, 0, 0 };
+
+	do_ioctl(NVRM_IOCTL_CREATE, &c, sizeof(c), arg, arglen);
+}
+
+struct buffer
+{
+	uint32_t handle;
+	uint32_t id;
+	uint64_t size;
+	uint64_t gpu_addr;
+};
+
+/*
+ * Creates a memory object, maps it in the GPU virtual space and mmaps it,
+ * assigning consecutive GPU addresses, file offsets and mmt mapping ids.
+ */
+static void buffer_new(struct buffer *b, uint64_t size)
+{
+	static uint32_t handle = 0xbeef1000, id = 1;
+	static uint64_t gpu_addr = 0x200100000ULL, foffset = 0x10000000, cpu_addr = 0x7f0000000000ULL;
+	struct nvrm_ioctl_memory mem;
+	struct nvrm_ioctl_vspace_map vmap;
+	struct nvrm_ioctl_host_map hmap;
+
+	size = (size + 0xfff) & ~0xfffULL;
+	b->handle = handle++;
+	b->id = id++;
+	b->size = size;
+	b->gpu_addr = gpu_addr;
+
+	memset(&mem, 0, sizeof(mem));
+	mem.cid = CID;
+	mem.parent = DEVICE;
+	mem.cls = NVRM_MEMORY_UNK0040;
+	mem.handle = b->handle;
+	mem.flags1 = NVRM_IOCTL_MEMORY_FLAGS1_USER_HANDLE;
+	mem.size = size;
+	do_ioctl(NVRM_IOCTL_MEMORY, &mem, sizeof(mem), NULL, 0);
+
+	memset(&vmap, 0, sizeof(vmap));
+	vmap.cid = CID;
+	vmap.dev = DEVICE;
+	vmap.vspace = 0xbeef0100;
+	vmap.handle = b->handle;
+	vmap.size = size;
+	vmap.addr = gpu_addr;
+	do_ioctl(NVRM_IOCTL_VSPACE_MAP, &vmap, sizeof(vmap), NULL, 0);
+
+	memset(&hmap, 0, sizeof(hmap));
+	hmap.cid = CID;
+	hmap.subdev = SUBDEVICE;
+	hmap.handle = b->handle;
+	hmap.limit = size - 1;
+	hmap.foffset = foffset;
+	do_ioctl(NVRM_IOCTL_HOST_MAP, &hmap, sizeof(hmap), NULL, 0);
+
+	put8('M');
+	put64(foffset);
+	put32(3);	/* PROT_READ | PROT_WRITE */
+	put32(1);	/* MAP_SHARED */
+	put32(FD);
+	put32(b->id);
+	put64(cpu_addr);
+	put64(size);
+	flush_rec();
+
+	gpu_addr += size + 0x100000;
+	foffset += size;
+	cpu_addr += size + 0x100000;
+}
+
+static void write_rec(const struct buffer *b, uint32_t offset, const void *data, uint8_t len)
+{
+	put8('w');
+	put32(b->id);
+	put32(offset);
+	put8(len);
+	put(data, len);
+	flush_rec();
+}
+
+/* writes words the way a memcpy to a mapping is seen: 32-byte stores, then single words */
+static void write_words(const struct buffer *b, uint32_t offset, const uint32_t *words, int cnt)
+{
+	while (cnt >= 8)
+	{
+		write_rec(b, offset, words, 32);
+		offset += 32;
+		words += 8;
+		cnt -= 8;
+	}
+	for (; cnt; --cnt, ++words, offset += 4)
+		write_rec(b, offset, words, 4);
+}
+
+#define PB_MAX_WORDS 0x10000
+
+static uint32_t pb[PB_MAX_WORDS];
+static int pb_len;
+
+static void pb_hdr(int mode, int subc, uint32_t mthd, int cnt)
+{
+	pb[pb_len++] = mode << 29 | cnt << 16 | subc << 13 | mthd >> 2;
+}
+
+static void pb_incr(int subc, uint32_t mthd, int cnt)
+{
+	int i;
+	pb_hdr(1, subc, mthd, cnt);
+	for (i = 0; i < cnt; ++i)
+		pb[pb_len++] = rnd();
+}
+
+/*
+ * A macro sending its first parameter to 0x0d78 and its second parameter
+ * to the next method:
+ *   maddr 0x135e (0x0d78, increment 1)
+ *   send $r1
+ *   parm $r2
+ *   exit send $r2
+ *   nop
+ */
+static const uint32_t macro_code[] = {
+	((1 << 12) | (0x0d78 >> 2)) << 14 | 0x21,
+	0x00000841,
+	0x00000201,
+	0x000010c1,
+	0x00000011,
+};
+
+#define MACRO_SLOTS 0x80
+
+static void pb_macro_upload(int idx)
+{
+	uint32_t pos = idx * 8;
+	int i;
+
+	pb_hdr(1, 0, 0x0114, 1);	/* MACRO_CODE_POS */
+	pb[pb_len++] = pos;
+	pb_hdr(3, 0, 0x0118, 5);	/* MACRO_CODE_DATA */
+	for (i = 0; i < 5; ++i)
+		pb[pb_len++] = macro_code[i];
+	pb_hdr(1, 0, 0x011c, 2);	/* MACRO_ENTRY_POS, MACRO_ENTRY_DATA */
+	pb[pb_len++] = idx;
+	pb[pb_len++] = pos;
+}
+
+static void pb_methods(int cnt, int macros)
+{
+	while (cnt > 0)
+	{
+		uint32_t r = rnd() % 100;
+		int n = 1 + rnd() % 16;
+
+		if (macros && r < 5)
+		{
+			/* MACRO[idx], MACRO_PARAM[idx] */
+			pb_incr(0, 0x3800 + (rnd() % macros) * 8, 2);
+			n = 2;
+		}
+		else if (r < 60)
+			pb_incr(0, 0x0200 + (rnd() % (0x1e00 / 4 - 16)) * 4, n);
+		else if (r < 75)
+		{
+			pb_hdr(4, 0, 0x0200 + (rnd() % (0x1e00 / 4)) * 4, rnd() & 0x1fff);
+			n = 1;
+		}
+		else if (r < 85)
+		{
+			int i;
+			pb_hdr(3, 0, 0x0200 + (rnd() % (0x1e00 / 4)) * 4, n);
+			for (i = 0; i < n; ++i)
+				pb[pb_len++] = rnd();
+		}
+		else
+			pb_incr(1, 0x0400 + (rnd() % (0x0400 / 4 - 16)) * 4, n);
+		cnt -= n;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	int c, chipset = 0xe4, objects = 64, methods = 256, macro_uploads = 16;
+	uint64_t object_kb = 1024, pb_kb = 4096;
+	long writes = 100000, pushbufs = 10000, i;
+	const char path[] = "/dev/nvidiactl";
+
+	while ((c = getopt(argc, argv, "c:o:b:w:p:m:M:P:s:")) != -1)
+		switch (c)
+		{
+			case 'c':
+				chipset = strtol(optarg, NULL, 16);
+				break;
+			case 'o':
+				objects = strtol(optarg, NULL, 0);
+				break;
+			case 'b':
+				object_kb = strtoull(optarg, NULL, 0);
+				break;
+			case 'w':
+				writes = strtol(optarg, NULL, 0);
+				break;
+			case 'p':
+				pushbufs = strtol(optarg, NULL, 0);
+				break;
+			case 'm':
+				methods = strtol(optarg, NULL, 0);
+				break;
+			case 'M':
+				macro_uploads = strtol(optarg, NULL, 0);
+				break;
+			case 'P':
+				pb_kb = strtoull(optarg, NULL, 0);
+				break;
+			case 's':
+				seed = strtoul(optarg, NULL, 0);
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-c chipset] [-o objects] [-b object KiB] [-w data writes] "
+						"[-p pushbuffers] [-m methods] [-M macro uploads] [-P pushbuffer KiB] [-s seed]\n", argv[0]);
+				return 1;
+		}
+
+	if (chipset < 0xc0)
+	{
+		fprintf(stderr, "only GF100+ pushbuffers are generated, chipset must be c0 or newer\n");
+		return 1;
+	}
+	/* a submit (with its share of macro uploads) must fit in PB_MAX_WORDS */
+	if (objects < 1 || object_kb < 1 || pushbufs < 1 || methods < 1 || methods > PB_MAX_WORDS / 4 ||
+			macro_uploads < 0 || macro_uploads > pushbufs * 256 || pb_kb * 1024 < PB_MAX_WORDS * 4)
+	{
+		fprintf(stderr, "invalid workload parameters\n");
+		return 1;
+	}
+	if (isatty(1))
+	{
+		fprintf(stderr, "refusing to write binary trace to a terminal\n");
+		return 1;
+	}
+
+	uint32_t fifo_cls = chipset >= 0xe0 ? NVRM_FIFO_IB_GK104 : NVRM_FIFO_IB_GF100;
+	uint32_t cls_3d = chipset >= 0xe0 ? 0xa097 : 0x9097;
+	uint32_t cls_compute = chipset >= 0xe0 ? 0xa0c0 : 0x90c0;
+
+	put8('o');
+	put32(2);
+	put32(0);
+	put32(FD);
+	put32(sizeof(path));
+	put(path, sizeof(path));
+	flush_rec();
+
+	uint32_t cid = CID;
+	create(0, 0, NVRM_CONTEXT, &cid, sizeof(cid));
+	create(CID, DEVICE, NVRM_DEVICE_0, NULL, 0);
+	create(DEVICE, SUBDEVICE, NVRM_SUBDEVICE_0, NULL, 0);
+
+	struct nvrm_mthd_subdevice_get_chipset chip = { chipset & 0xf0, chipset & 0x0f, 0xa1 };
+	struct nvrm_ioctl_call call = { CID, SUBDEVICE, NVRM_MTHD_SUBDEVICE_GET_CHIPSET, 0, ARGS_PTR, sizeof(chip), 0 };
+	do_ioctl(NVRM_IOCTL_CALL, &call, sizeof(call), &chip, sizeof(chip));
+
+	struct buffer pushbuf, ib, *bufs = calloc(objects, sizeof(*bufs));
+	uint32_t ib_entries = 0x200;
+
+	buffer_new(&pushbuf, pb_kb * 1024);
+	buffer_new(&ib, ib_entries * 8);
+
+	struct nvrm_create_fifo_ib fifo = { 0xbeef0fff, 0xbeef0ffe, ib.gpu_addr, ib_entries, 0, 0 };
+	create(DEVICE, FIFO, fifo_cls, &fifo, sizeof(fifo));
+	create(FIFO, cls_3d, cls_3d, NULL, 0);
+	create(FIFO, cls_compute, cls_compute, NULL, 0);
+
+	for (c = 0; c < objects; ++c)
+		buffer_new(&bufs[c], object_kb * 1024);
+
+	uint32_t pb_put = 0, ib_put = 0;
+	int macros = 0;
+	long writes_done = 0;
+
+	for (i = 0; i < pushbufs; ++i)
+	{
+		pb_len = 0;
+		if (i == 0)
+		{
+			pb_incr(0, 0, 1);
+			pb[pb_len - 1] = cls_3d;
+			pb_incr(1, 0, 1);
+			pb[pb_len - 1] = cls_compute;
+		}
+
+		/* spread macro uploads evenly over the submits */
+		while (macros < macro_uploads && macros * pushbufs <= i * macro_uploads)
+			pb_macro_upload(macros++ % MACRO_SLOTS);
+
+		pb_methods(methods, macros < MACRO_SLOTS ? macros : MACRO_SLOTS);
+
+		if (pb_put + pb_len * 4 > pushbuf.size)
+			pb_put = 0;
+		write_words(&pushbuf, pb_put, pb, pb_len);
+
+		uint64_t addr = pushbuf.gpu_addr + pb_put;
+		uint32_t entry[2] = { addr & 0xfffffffc, (addr >> 32 & 0xff) | pb_len << 10 };
+		write_rec(&ib, ib_put * 8, &entry[0], 4);
+		write_rec(&ib, ib_put * 8 + 4, &entry[1], 4);
+		ib_put = (ib_put + 1) % ib_entries;
+		pb_put += (pb_len * 4 + 0xff) & ~0xff;
+
+		/* data uploads between the submits */
+		for (; writes_done < writes * (i + 1) / pushbufs; ++writes_done)
+		{
+			const struct buffer *b = &bufs[rnd() % objects];
+			uint32_t words[8];
+
+			for (c = 0; c < 8; ++c)
+				words[c] = rnd();
+			write_rec(b, ((uint64_t)rnd() * 32) % b->size, words, 32);
+		}
+	}
+
+	fflush(stdout);
+	fprintf(stderr, "%" PRIu64 " records, %" PRIu64 " bytes\n", rec_cnt, rec_bytes);
+	free(bufs);
+	return 0;
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2026 The envytools authors.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/*
+ * Record writer and random numbers shared by the generators of mmt binary
+ * traces. Records are built up with put* and written out to stdout by
+ * flush_rec.
+ */
+
+#ifndef MMT_REC_H
+#define MMT_REC_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define EOR '\n'
+
+static uint8_t rec[8192];
+static int rec_len;
+static uint64_t rec_cnt, rec_bytes;
+
+static inline void put(const void *data, int len)
+{
+	memcpy(rec + rec_len, data, len);
+	rec_len += len;
+}
+
+static inline void put8(uint8_t v) { put(&v, 1); }
+static inline void put32(uint32_t v) { put(&v, 4); }
+static inline void put64(uint64_t v) { put(&v, 8); }
+
+static inline void flush_rec(void)
+{
+	put8(EOR);
+	fwrite(rec, 1, rec_len, stdout);
+	rec_cnt++;
+	rec_bytes += rec_len;
+	rec_len = 0;
+}
+
+static uint32_t seed = 1;
+
+static inline uint32_t rnd(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return seed >> 8;
+}
+
+/* an ioctl ('i' before, 'j' after), followed by its argument buffer, if any */
+static inline void ioctl_rec(char type, uint32_t fd, uint32_t id, const void *data, uint32_t len,
+		uint64_t ptr, const void *arg, uint32_t arglen)
+{
+	put8(type);
+	put32(fd);
+	put32(id);
+	if (type == 'j')
+	{
+		put64(0);
+		put64(0);
+	}
+	put32(len);
+	put(data, len);
+	flush_rec();
+
+	if (arg)
+	{
+		put8('y');
+		put64(ptr);
+		put32(arglen);
+		put(arg, arglen);
+		flush_rec();
+	}
+}
+
+#endif
@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2026 The envytools authors.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Writes an mmt binary trace replaying the NVRM ioctl mix of a blob driver
+ * startup (mostly NVRM_IOCTL_CALL with a spread of methods, some of them
+ * unknown to demmt) to exercise demmt's ioctl and method decoders. With -f,
+ * ioctls are spread over several /dev/nvidiactl fds, like in a trace of a
+ * multi-context application.
+ *
+ * Usage: nvrm_ioctl_mix [-n ioctls] [-f fds] [-s seed] > mix.mmt
+ *        time demmt -m e7 -l mix.mmt > /dev/null
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "nvrm_ioctl.h"
+#include "nvrm_mthd.h"
+#include "mmt_rec.h"
+
+struct mix_mthd
+{
+	uint32_t mthd;
+	uint32_t argsize;
+	int weight;
+};
+
+#define _(MTHD, STR, W) { MTHD, sizeof(STR), W }
+static const struct mix_mthd mthds[] =
+{
+	_(NVRM_MTHD_SUBDEVICE_GET_TIME, struct nvrm_mthd_subdevice_get_time, 30),
+	_(NVRM_MTHD_FIFO_IB_ACTIVATE, struct nvrm_mthd_fifo_ib_activate, 10),
+	_(NVRM_MTHD_SUBDEVICE_UNK200A, struct nvrm_mthd_subdevice_unk200a, 10),
+	_(NVRM_MTHD_SUBDEVICE_UNK0119, struct nvrm_mthd_subdevice_unk0119, 8),
+	_(NVRM_MTHD_CONTEXT_UNK0301, struct nvrm_mthd_context_unk0301, 6),
+	_(NVRM_MTHD_SUBDEVICE_GET_GPU_ID, struct nvrm_mthd_subdevice_get_gpu_id, 4),
+	_(NVRM_MTHD_SUBDEVICE_GET_COMPUTE_MODE, struct nvrm_mthd_subdevice_get_compute_mode, 4),
+	_(NVRM_MTHD_SUBDEVICE_GET_GPC_MASK, struct nvrm_mthd_subdevice_get_gpc_mask, 4),
+	_(NVRM_MTHD_SUBDEVICE_GET_BUS_ID, struct nvrm_mthd_subdevice_get_bus_id, 2),
+	_(NVRM_MTHD_SUBDEVICE_GET_NAME, struct nvrm_mthd_subdevice_get_name, 2),
+	_(NVRM_MTHD_SUBDEVICE_GET_UUID, struct nvrm_mthd_subdevice_get_uuid, 2),
+	_(NVRM_MTHD_DEVICE_GET_NUM_SUBDEVICES, struct nvrm_mthd_device_get_num_subdevices, 2),
+	_(NVRM_MTHD_CONTEXT_GET_CPU_INFO, struct nvrm_mthd_context_get_cpu_info, 1),
+	/* methods demmt doesn't know */
+	{ 0x20800999, 16, 8 },
+	{ 0x0080aa01, 40, 4 },
+};
+#undef _
+
+struct mix_ioctl
+{
+	uint32_t id;
+	uint32_t size;
+	int weight;
+};
+
+#define _(CTL, STR, W) { CTL, sizeof(STR), W }
+static const struct mix_ioctl ioctls[] =
+{
+	_(NVRM_IOCTL_CALL, struct nvrm_ioctl_call, 80),
+	_(NVRM_IOCTL_QUERY_DEVICE_INTR, struct nvrm_ioctl_query_device_intr, 6),
+	_(NVRM_IOCTL_STATUS_CODE, struct nvrm_ioctl_status_code, 4),
+	_(NVRM_IOCTL_GET_PARAM, struct nvrm_ioctl_get_param, 4),
+	_(NVRM_IOCTL_CARD_INFO, struct nvrm_ioctl_card_info, 1),
+	_(NVRM_IOCTL_ENV_INFO, struct nvrm_ioctl_env_info, 1),
+	_(NVRM_IOCTL_SYS_PARAMS, struct nvrm_ioctl_sys_params, 1),
+	/* ioctl demmt doesn't know */
+	{ _IOWR(NVRM_IOCTL_MAGIC, 0xee, uint64_t), 8, 3 },
+};
+#undef _
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+static void rnd_fill(uint8_t *d, int len)
+{
+	int i;
+	for (i = 0; i < len; ++i)
+		d[i] = rnd();
+}
+
+static int pick(const void *tbl, int cnt, size_t stride, size_t weight_off)
+{
+	int total = 0, i, r;
+
+	for (i = 0; i < cnt; ++i)
+		total += *(const int *)((const char *)tbl + i * stride + weight_off);
+	r = rnd() % total;
+	for (i = 0; i < cnt; ++i)
+	{
+		r -= *(const int *)((const char *)tbl + i * stride + weight_off);
+		if (r < 0)
+			break;
+	}
+	return i;
+}
+
+int main(int argc, char *argv[])
+{
+	long n = 1000000, i;
+	int c, fds = 1;
+	const char path[] = "/dev/nvidiactl";
+
+	while ((c = getopt(argc, argv, "n:f:s:")) != -1)
+		switch (c)
+		{
+			case 'n':
+				n = strtol(optarg, NULL, 0);
+				break;
+			case 'f':
+				fds = strtol(optarg, NULL, 0);
+				if (fds < 1)
+					fds = 1;
+				break;
+			case 's':
+				seed = strtoul(optarg, NULL, 0);
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-n ioctls] [-f fds] [-s seed]\n", argv[0]);
+				return 1;
+		}
+
+	if (isatty(1))
+	{
+		fprintf(stderr, "refusing to write binary trace to a terminal\n");
+		return 1;
+	}
+
+	for (c = 0; c < fds; ++c)
+	{
+		put8('o');
+		put32(2);
+		put32(0);
+		put32(3 + c);
+		put32(sizeof(path));
+		put(path, sizeof(path));
+		flush_rec();
+	}
+
+	for (i = 0; i < n; ++i)
+	{
+		const struct mix_ioctl *ctl = &ioctls[pick(ioctls, ARRAY_SIZE(ioctls),
+				sizeof(ioctls[0]), offsetof(struct mix_ioctl, weight))];
+		uint8_t data[2048], arg[256];
+		uint32_t arglen = 0;
+		uint64_t ptr = 0;
+		uint32_t fd = 3 + rnd() % fds;
+
+		rnd_fill(data, ctl->size);
+		if (ctl->id == NVRM_IOCTL_CALL)
+		{
+			const struct mix_mthd *m = &mthds[pick(mthds, ARRAY_SIZE(mthds),
+					sizeof(mthds[0]), offsetof(struct mix_mthd, weight))];
+			struct nvrm_ioctl_call *call = (void *)data;
+
+			arglen = m->argsize;
+			ptr = 0x7fff00000000ULL + (rnd() & ~0xfu);
+			call->cid = 0xc1d00001;
+			call->handle = 0x5c000001;
+			call->mthd = m->mthd;
+			call->_pad = 0;
+			call->ptr = ptr;
+			call->size = arglen;
+			call->status = 0;
+			rnd_fill(arg, arglen);
+		}
+
+		ioctl_rec('i', fd, ctl->id, data, ctl->size, ptr, arglen ? arg : NULL, arglen);
+		ioctl_rec('j', fd, ctl->id, data, ctl->size, ptr, arglen ? arg : NULL, arglen);
+	}
+
+	return 0;
+}
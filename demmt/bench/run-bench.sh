@@ -0,0 +1,60 @@
+#!/bin/bash
+#
+# Generates synthetic traces with mmt_gen and reports decoding throughput of
+# demmt and mmt_bin2dedma on each of them.
+#
+# Usage: run-bench.sh <demmt> <mmt_bin2dedma> <mmt_gen> [workdir]
+
+if [ $# -lt 3 ]; then
+	echo "usage: $0 <demmt> <mmt_bin2dedma> <mmt_gen> [workdir]"
+	exit 1
+fi
+
+demmt=$1
+bin2dedma=$2
+gen=$3
+dir=${4:-${TMPDIR:-/tmp}}
+
+# name and mmt_gen options of every workload
+workloads=(
+	"objects   -c e4 -o 1024 -b 64 -w 100000 -p 200 -m 64"
+	"bigbuf    -c e4 -o 8 -b 262144 -w 50000 -p 200 -m 64"
+	"gf100-pb  -c c0 -o 16 -w 10000 -p 20000 -m 512"
+	"gk104-pb  -c e4 -o 16 -w 10000 -p 20000 -m 512"
+	"macro     -c e4 -o 16 -w 10000 -p 10000 -m 128 -M 20000"
+)
+
+now() {
+	date +%s%N
+}
+
+# prints "records/s MB/s" for given record count, byte count and time in ns
+rate() {
+	awk -v r=$1 -v b=$2 -v t=$3 'BEGIN { s = t / 1e9; printf "%10.0f rec/s %8.1f MB/s %7.2f s", r / s, b / s / 1e6, s }'
+}
+
+for w in "${workloads[@]}"; do
+	set -- $w
+	name=$1
+	shift
+	trace=$dir/mmt_gen-$name.mmt
+
+	stats=$("$gen" "$@" 2>&1 > "$trace") || { echo "$name: mmt_gen failed: $stats"; exit 1; }
+	set -- $stats
+	records=$1
+	bytes=$3
+
+	start=$(now)
+	"$demmt" -l "$trace" > /dev/null 2>&1 || { echo "$name: demmt failed"; exit 1; }
+	t_demmt=$(( $(now) - start ))
+
+	start=$(now)
+	"$bin2dedma" < "$trace" > /dev/null 2>&1 || { echo "$name: mmt_bin2dedma failed"; exit 1; }
+	t_dedma=$(( $(now) - start ))
+
+	printf "%-9s %9d records %7.1f MB\n" $name $records $(awk -v b=$bytes 'BEGIN { print b / 1e6 }')
+	printf "  demmt          %s\n" "$(rate $records $bytes $t_demmt)"
+	printf "  mmt_bin2dedma  %s\n" "$(rate $records $bytes $t_dedma)"
+
+	rm -f "$trace"
+done
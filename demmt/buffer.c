@@ -69,6 +69,13 @@ struct cpu_mapping *get_cpu_mapping(uint32_t id)
 	return cpu_mappings[id];
 }
 
+int cpu_mapping_partition(struct cpu_mapping *mapping)
+{
+	if (mapping->object)
+		return demmt_fd_partition(mapping->object->fd);
+	return demmt_fd_partition(mapping->fd);
+}
+
 static void gpu_object_add_child(struct gpu_object *parent, struct gpu_object *child)
 {
 	int i;
@@ -177,13 +184,43 @@ struct gpu_mapping *gpu_mapping_find(uint64_t address, struct gpu_object *dev)
 	return NULL;
 }
 
+/*
+ * Returned pointer must be treated as read-only. Spans crossing page boundary
+ * are copied out, so the pointer is valid only until the next few calls.
+ */
 void *gpu_mapping_get_data(struct gpu_mapping *mapping, uint64_t address, uint64_t length)
 {
 	struct gpu_object *obj = mapping->object;
 	uint64_t offset = address - mapping->address + mapping->object_offset;
 	if (offset + length > obj->length)
 		return NULL;
-	return obj->data + offset;
+	return pagemap_get(&obj->data, offset, length);
+}
+
+struct region *gpu_mapping_find_written_region(struct gpu_mapping *mapping, uint64_t address)
+{
+	uint64_t offset = address - mapping->address;
+	struct region *reg;
+	for (reg = mapping->object->written_regions.head; reg != NULL; reg = reg->next)
+		if (reg->start == offset)
+			return reg;
+	return NULL;
+}
+
+void *cpu_mapping_get_data(struct cpu_mapping *mapping, uint64_t offset, uint64_t length)
+{
+	return pagemap_get(mapping->data, mapping->object_offset + offset, length);
+}
+
+void cpu_mapping_peek(struct cpu_mapping *mapping, uint64_t offset, void *dst, uint64_t length)
+{
+	pagemap_peek(mapping->data, mapping->object_offset + offset, dst, length);
+}
+
+void gpu_object_resize(struct gpu_object *obj, uint64_t length)
+{
+	pagemap_resize(&obj->data, length);
+	obj->length = length;
 }
 
 void disconnect_cpu_mapping_from_gpu_object(struct cpu_mapping *cpu_mapping)
@@ -274,7 +311,7 @@ void gpu_object_destroy(struct gpu_object *obj)
 				gpu_objects = obj->next;
 
 			obj->next = NULL;
-			free(obj->data);
+			pagemap_free(&obj->data);
 			free(obj);
 			//mmt_debug("object destroyed%s\n", "");
 
@@ -290,7 +327,7 @@ void buffer_mmap(uint32_t id, uint32_t fd, uint64_t cpu_start, uint64_t len, uin
 	mapping->fd = fd;
 	mapping->fdtype = demmt_get_fdtype(fd);
 	mapping->mmap_offset = mmap_offset;
-	mapping->data = calloc(len, 1);
+	mapping->data = pagemap_new(len);
 	mapping->length = len;
 	mapping->id = id;
 	mapping->cpu_addr = cpu_start;
@@ -306,7 +343,7 @@ void buffer_munmap(uint32_t id)
 		mmt_error("inconsistent mapping data%s\n", "");
 		demmt_abort();
 	}
-	free(mapping->data);
+	pagemap_del(mapping->data);
 	// catch use-after-free bugs ASAP
 	memset(mapping, 0xff, sizeof(*mapping));
 	free(mapping);
@@ -318,9 +355,16 @@ void buffer_mremap(struct mmt_mremap *mm)
 	struct cpu_mapping *mapping = get_cpu_mapping(mm->id);
 	if (mm->len != mapping->length)
 	{
-		mapping->data = realloc(mapping->data, mm->len);
-		if (mm->len > mapping->length)
-			memset(mapping->data + mapping->length, 0, mm->len - mapping->length);
+		if (mapping->object)
+		{
+			if (mapping->object_offset + mm->len > mapping->object->length)
+				gpu_object_resize(mapping->object, mapping->object_offset + mm->len);
+		}
+		else if (mapping->data)
+			pagemap_resize(mapping->data, mm->len);
+		else
+			/* lost its object's data, gets private data again */
+			mapping->data = pagemap_new(mm->len);
 	}
 
 	mapping->mmap_offset = mm->offset;
@@ -340,7 +384,7 @@ void gpu_mapping_register_write(struct gpu_mapping *mapping, uint64_t address, u
 		demmt_abort();
 	}
 
-	memcpy(obj->data + gpu_object_offset, data, len);
+	pagemap_write(&obj->data, gpu_object_offset, data, len);
 
 	if (!regions_add_range(&obj->written_regions, gpu_object_offset, len))
 		demmt_abort();
@@ -376,11 +420,15 @@ void buffer_register_mmt_write(struct mmt_write *w)
 		mmt_error("buffer %d does not have data(?)\n", id);
 		demmt_abort();
 	}
-	memcpy(mapping->data + w->offset, w->data, w->len);
+	pagemap_write(mapping->data, mapping->object_offset + w->offset, w->data, w->len);
 
 	if (mapping->object)
 		if (!regions_add_range(&mapping->object->written_regions, w->offset + mapping->object_offset, w->len))
 			demmt_abort();
 
+	/* contents are kept for the owner of the mapping, but nothing more */
+	if (mmt_muted)
+		return;
+
 	buffer_decode_register_write(mapping, w->offset, w->len);
 }
@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include "demmt.h"
 #include "mmt_bin_decode.h"
+#include "pagemap.h"
 #include "pushbuf.h"
 #include "region.h"
 
@@ -21,7 +22,8 @@ struct cpu_mapping
 	uint64_t object_offset;
 	uint64_t length;
 	uint64_t map_id;
-	uint8_t *data;
+	/* object's data (at object_offset) or private data when not bound to object */
+	struct pagemap *data;
 
 	struct cpu_mapping *next; // in gpu_object
 
@@ -73,7 +75,7 @@ struct gpu_object
 	uint32_t class_;
 
 	uint64_t length;
-	uint8_t *data;
+	struct pagemap data;
 	struct regions written_regions;
 
 	struct cpu_mapping *cpu_mappings;
@@ -95,6 +97,7 @@ struct gpu_object
 extern struct gpu_object *gpu_objects;
 void set_cpu_mapping(uint32_t id, struct cpu_mapping *mapping);
 struct cpu_mapping *get_cpu_mapping(uint32_t id);
+int cpu_mapping_partition(struct cpu_mapping *mapping);
 extern uint32_t max_id;
 
 void buffer_mmap(uint32_t id, uint32_t fd, uint64_t cpu_start, uint64_t len, uint64_t mmap_offset);
@@ -108,11 +111,16 @@ void gpu_object_destroy(struct gpu_object *obj);
 
 struct gpu_mapping *gpu_mapping_find(uint64_t address, struct gpu_object *dev);
 void *gpu_mapping_get_data(struct gpu_mapping *mapping, uint64_t address, uint64_t length);
+struct region *gpu_mapping_find_written_region(struct gpu_mapping *mapping, uint64_t address);
 void gpu_mapping_destroy(struct gpu_mapping *gpu_mapping);
 
 struct cpu_mapping *gpu_addr_to_cpu_mapping(struct gpu_mapping *gpu_mapping, uint64_t gpu_address);
 uint64_t cpu_mapping_to_gpu_addr(struct cpu_mapping *mapping, uint64_t offset);
 void disconnect_cpu_mapping_from_gpu_object(struct cpu_mapping *cpu_mapping);
+void *cpu_mapping_get_data(struct cpu_mapping *mapping, uint64_t offset, uint64_t length);
+void cpu_mapping_peek(struct cpu_mapping *mapping, uint64_t offset, void *dst, uint64_t length);
+
+void gpu_object_resize(struct gpu_object *obj, uint64_t length);
 
 void gpu_mapping_register_write(struct gpu_mapping *mapping, uint64_t address, uint32_t len, const void *data);
 void gpu_mapping_register_copy(struct gpu_mapping *dst_mapping, uint64_t dst_address,
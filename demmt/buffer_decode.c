@@ -30,6 +30,25 @@
 #include "config.h"
 #include "log.h"
 
+/* "w id:0xaddr, 0xval  desc" */
+static void print_write(struct cpu_mapping *mapping, uint32_t addr, const char *comment,
+		uint32_t val, int digits, const char *desc)
+{
+	out_str("w ");
+	out_dec((int32_t)mapping->id);
+	out_str(":0x");
+	out_hex(addr, 4);
+	out_str(comment);
+	out_str(", 0x");
+	out_hex(val, digits);
+	if (desc)
+	{
+		out_str("  ");
+		out_str(desc);
+	}
+	mmt_log_cont_nl();
+}
+
 void buffer_decode_register_write(struct cpu_mapping *mapping, uint32_t start, uint32_t len)
 {
 	char pushbuf_desc[1024];
@@ -37,7 +56,6 @@ void buffer_decode_register_write(struct cpu_mapping *mapping, uint32_t start, u
 	comment[0] = 0;
 	pushbuf_desc[0] = 0;
 
-	unsigned char *data = mapping->data;
 	uint32_t addr = start;
 	uint32_t left = len;
 
@@ -55,8 +73,10 @@ void buffer_decode_register_write(struct cpu_mapping *mapping, uint32_t start, u
 		if (ib_supported && !pb_pointer_found)
 		{
 			uint32_t idx = start / 4;
-			uint32_t *data = (uint32_t *)mapping->data;
-			if ((idx & 1) == 1 && data[idx - 1] && data[idx] && !(data[idx - 1] & 0x3))
+			uint32_t data[2] = { 0, 0 };
+			if ((idx & 1) == 1)
+				cpu_mapping_peek(mapping, (idx - 1) * 4, data, sizeof(data));
+			if (data[0] && data[1] && !(data[0] & 0x3))
 			{
 				if (gpu_addr)
 				{
@@ -70,7 +90,7 @@ void buffer_decode_register_write(struct cpu_mapping *mapping, uint32_t start, u
 
 				if (!nvrm_get_pb_pointer_found(dev))
 				{
-					uint64_t pb_gpu_addr = (((uint64_t)(data[idx] & 0xff)) << 32) | (data[idx - 1] & 0xfffffffc);
+					uint64_t pb_gpu_addr = (((uint64_t)(data[1] & 0xff)) << 32) | (data[0] & 0xfffffffc);
 					struct gpu_object *obj;
 					for (obj = gpu_objects; obj != NULL; obj = obj->next)
 					{
@@ -78,7 +98,7 @@ void buffer_decode_register_write(struct cpu_mapping *mapping, uint32_t start, u
 						for (gpu_mapping = obj->gpu_mappings; gpu_mapping != NULL; gpu_mapping = gpu_mapping->next)
 						{
 							if (gpu_mapping->address == pb_gpu_addr &&
-								gpu_mapping->length >=  4 * ((data[idx] & 0x7fffffff) >> 10))
+								gpu_mapping->length >=  4 * ((data[1] & 0x7fffffff) >> 10))
 							{
 								nvrm_device_set_pb_pointer_found(dev, true);
 								break;
@@ -104,7 +124,8 @@ void buffer_decode_register_write(struct cpu_mapping *mapping, uint32_t start, u
 		{
 			if (start == 0x40)
 			{
-				uint32_t pb_gpu_addr = *(uint32_t *)&(mapping->data[0x40]);
+				uint32_t pb_gpu_addr;
+				cpu_mapping_peek(mapping, 0x40, &pb_gpu_addr, 4);
 				if (pb_gpu_addr)
 				{
 					struct gpu_object *fifo = nvrm_get_fifo(mapping->object, gpu_addr + addr, 1);
@@ -145,6 +166,9 @@ void buffer_decode_register_write(struct cpu_mapping *mapping, uint32_t start, u
 
 		if (left >= 4)
 		{
+			uint32_t val;
+			cpu_mapping_peek(mapping, addr, &val, 4);
+
 			if (mapping->ib.is &&
 					addr >= mapping->ib.offset &&
 					addr < mapping->length &&
@@ -152,29 +176,31 @@ void buffer_decode_register_write(struct cpu_mapping *mapping, uint32_t start, u
 			{
 				if ((addr & 4) == 4)
 				{
-					ib_decode(&mapping->ib.state, *(uint32_t *)(data + addr - 4), pushbuf_desc);
-					ib_decode(&mapping->ib.state, *(uint32_t *)(data + addr), pushbuf_desc);
+					uint32_t prev;
+					cpu_mapping_peek(mapping, addr - 4, &prev, 4);
+					ib_decode(&mapping->ib.state, prev, pushbuf_desc);
+					ib_decode(&mapping->ib.state, val, pushbuf_desc);
 				}
 
 				if (dump_memory_writes)
-					mmt_printf("w %d:0x%04x%s, 0x%08x  %s\n", mapping->id, addr, comment, *(uint32_t *)(data + addr), pushbuf_desc);
+					print_write(mapping, addr, comment, val, 8, pushbuf_desc);
 
 				if ((addr & 4) == 4)
 					ib_decode_end(&mapping->ib.state);
 			}
 			else if (mapping->user.is)
 			{
-				user_decode(&mapping->user.state, addr, *(uint32_t *)(data + addr), pushbuf_desc);
+				user_decode(&mapping->user.state, addr, val, pushbuf_desc);
 
 				if (dump_memory_writes)
-					mmt_printf("w %d:0x%04x%s, 0x%08x  %s\n", mapping->id, addr, comment, *(uint32_t *)(data + addr), pushbuf_desc);
+					print_write(mapping, addr, comment, val, 8, pushbuf_desc);
 
 				user_decode_end(&mapping->user.state);
 			}
 			else
 			{
 				if (dump_memory_writes)
-					mmt_printf("w %d:0x%04x%s, 0x%08x\n", mapping->id, addr, comment, *(uint32_t *)(data + addr));
+					print_write(mapping, addr, comment, val, 8, NULL);
 			}
 
 			addr += 4;
@@ -183,14 +209,22 @@ void buffer_decode_register_write(struct cpu_mapping *mapping, uint32_t start, u
 		else if (left >= 2)
 		{
 			if (dump_memory_writes)
-				mmt_printf("w %d:0x%04x%s, 0x%04x\n", mapping->id, addr, comment, *(uint16_t *)(data + addr));
+			{
+				uint16_t val;
+				cpu_mapping_peek(mapping, addr, &val, 2);
+				print_write(mapping, addr, comment, val, 4, NULL);
+			}
 			addr += 2;
 			left -= 2;
 		}
 		else
 		{
 			if (dump_memory_writes)
-				mmt_printf("w %d:0x%04x%s, 0x%02x\n", mapping->id, addr, comment, *(uint8_t *)(data + addr));
+			{
+				uint8_t val;
+				cpu_mapping_peek(mapping, addr, &val, 1);
+				print_write(mapping, addr, comment, val, 2, NULL);
+			}
 			++addr;
 			--left;
 		}
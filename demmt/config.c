@@ -32,9 +32,11 @@
 #include <unistd.h>
 
 #include "config.h"
+#include "demmt.h"
 #include "object_state.h"
 #include "macro.h"
 #include "nvrm.h"
+#include "pagemap.h"
 
 int dump_raw_ioctl_data = 0;
 int dump_decoded_ioctl_data = 1;
@@ -95,6 +97,11 @@ static void usage()
 			"         \tscripts/mmiotrace/mmt-app-demmt-mmiotrace.sh)\n"
 			"  -x 0/1/2\tdisable/enable loose/enable strict sandboxing (default: 2\n"
 			"          \tif libseccomp is available)\n"
+			"  -M size\tlimit memory used for buffer contents to \"size\" MiB by\n"
+			"         \tdropping pages which were written, but never read back\n"
+			"         \t(default: no limit)\n"
+			"  -j n\t\tsplit decoding of independent device fds between \"n\"\n"
+			"      \t\tprocesses, output is grouped by process (requires -l)\n"
 			"\n"
 			"  -d msg_type1[,msg_type2[,msg_type3....]] - disable messages\n"
 			"  -e msg_type1[,msg_type2[,msg_type3....]] - enable messages\n"
@@ -201,11 +208,11 @@ static void _filter_all_classes(int en)
 static void _filter_nvrm_mthd(const char *token, int en)
 {
 	uint32_t mthd = strtoul(token, NULL, 16);
-	int i;
+	int i, cnt;
+	struct nvrm_mthd **mthds = nvrm_mthd_find(mthd, &cnt);
 
-	for (i = 0; i < nvrm_mthds_cnt; ++i)
-		if (nvrm_mthds[i].mthd == mthd)
-			nvrm_mthds[i].disabled = !en;
+	for (i = 0; i < cnt; ++i)
+		mthds[i]->disabled = !en;
 }
 
 static void _filter_all_nvrm_mthds(int en)
@@ -442,7 +449,7 @@ char *read_opts(int argc, char *argv[])
 		colors = &envy_null_colors;
 
 	int c;
-	while ((c = getopt (argc, argv, "m:o:g:qac:l:i:r:he:d:p:s:x:")) != -1)
+	while ((c = getopt (argc, argv, "m:o:g:qac:l:i:r:he:d:p:s:x:M:j:")) != -1)
 	{
 		switch (c)
 		{
@@ -574,8 +581,25 @@ char *read_opts(int argc, char *argv[])
 			case 's':
 				mmt_sync_fd = open(optarg, O_WRONLY);
 				break;
+			case 'M':
+				pagemap_limit = strtoull(optarg, NULL, 0) << 20;
+				break;
+			case 'j':
+				demmt_workers = strtol(optarg, NULL, 0);
+				if (demmt_workers < 1)
+				{
+					fprintf(stderr, "-j needs a positive number\n");
+					exit(1);
+				}
+				break;
 		}
 	}
 
+	if (demmt_workers > 1 && (filename == NULL || mmt_sync_fd != -1))
+	{
+		fprintf(stderr, "-j needs -l and can't be used with -s\n");
+		exit(1);
+	}
+
 	return filename;
 }
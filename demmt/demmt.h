@@ -5,11 +5,23 @@
 #include "rnndec.h"
 #include <stdnoreturn.h>
 
+#include "output.h"
+
 #define MAX_USAGES 32
 
 enum mmt_fd_type { FDUNK, FDNVIDIA, FDDRM, FDFGLRX };
 enum mmt_fd_type demmt_get_fdtype(int fd);
 
+/*
+ * With -j, every worker process replays all bookkeeping, but prints and
+ * decodes only records of partitions it owns. A partition starts at each
+ * open of a device control node, fds not belonging to any partition (-1)
+ * are handled by the first worker.
+ */
+extern int demmt_workers;
+int demmt_fd_partition(int fd);
+void demmt_select_partition(int partition);
+
 extern struct rnndomain *domain;
 extern struct rnndb *rnndb;
 extern struct rnndb *rnndb_nvrm_object;
@@ -33,6 +45,6 @@ void decode_bitfield(uint32_t data, struct bitfield_desc *bfdesc);
 
 void decode_mmap_prot(uint32_t prot);
 void decode_mmap_flags(uint32_t flags);
-static inline noreturn void demmt_abort() { exit(1); }
+static inline noreturn void demmt_abort() { out_flush(); exit(1); }
 
 #endif
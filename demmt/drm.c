@@ -182,6 +182,7 @@ static void demmt_nouveau_decode_gem_pushbuf_data(
 void demmt_nouveau_gem_pushbuf_data(struct mmt_nouveau_pushbuf_data *data, void *state)
 {
 	// compat code, mmt does not generate mmt_nouveau_pushbuf_data message anymore
+	demmt_select_partition(-1);
 
 	int minlen = sizeof(struct mmt_buf *);
 	if (data->data.len < minlen)
@@ -526,9 +527,7 @@ static const char *ret_err(uint64_t ret, uint64_t err)
 static void drm_nouveau_gem_new(uint32_t fd, uint32_t cid, uint32_t parent, struct drm_nouveau_gem_info *info)
 {
 	struct gpu_object *obj = gpu_object_add(fd, cid, parent, info->handle, 0);
-	obj->length = info->size;
-	obj->data = realloc(obj->data, obj->length);
-	memset(obj->data, 0, obj->length);
+	gpu_object_resize(obj, info->size);
 
 	struct gpu_mapping *gmapping = calloc(sizeof(struct gpu_mapping), 1);
 	gmapping->fd = fd;
@@ -543,7 +542,7 @@ static void drm_nouveau_gem_new(uint32_t fd, uint32_t cid, uint32_t parent, stru
 	cmapping->fdtype = FDDRM;
 	cmapping->mmap_offset = info->map_handle;
 	cmapping->length = info->size;
-	cmapping->data = obj->data;
+	cmapping->data = &obj->data;
 	cmapping->object = obj;
 	cmapping->next = obj->cpu_mappings;
 	obj->cpu_mappings = cmapping;
@@ -385,46 +385,80 @@ static struct fglrx_ioctl fglrx_ioctls[] =
 #undef _a
 static int fglrx_ioctls_cnt = ARRAY_SIZE(fglrx_ioctls);
 
+/* fglrx_ioctls sorted by id, entries sharing an id keep table order */
+static struct fglrx_ioctl *fglrx_ioctls_sorted[ARRAY_SIZE(fglrx_ioctls)];
+
+static int fglrx_ioctl_cmp(const void *a, const void *b)
+{
+	const struct fglrx_ioctl *i1 = *(const struct fglrx_ioctl **)a;
+	const struct fglrx_ioctl *i2 = *(const struct fglrx_ioctl **)b;
+
+	if (i1->id != i2->id)
+		return i1->id < i2->id ? -1 : 1;
+	if (i1 != i2)
+		return i1 < i2 ? -1 : 1;
+	return 0;
+}
+
+void fglrx_ioctls_init(void)
+{
+	int k;
+
+	for (k = 0; k < fglrx_ioctls_cnt; ++k)
+		fglrx_ioctls_sorted[k] = &fglrx_ioctls[k];
+	qsort(fglrx_ioctls_sorted, fglrx_ioctls_cnt, sizeof(fglrx_ioctls_sorted[0]), fglrx_ioctl_cmp);
+}
+
+static struct fglrx_ioctl *fglrx_ioctl_find(uint32_t id)
+{
+	int lo = 0, hi = fglrx_ioctls_cnt;
+
+	while (lo < hi)
+	{
+		int mid = (lo + hi) / 2;
+		if (fglrx_ioctls_sorted[mid]->id < id)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo < fglrx_ioctls_cnt && fglrx_ioctls_sorted[lo]->id == id)
+		return fglrx_ioctls_sorted[lo];
+	return NULL;
+}
+
 static int decode_fglrx_ioctl(uint32_t fd, uint32_t id, uint8_t dir, uint8_t nr,
 		uint16_t size, struct mmt_buf *buf, uint64_t ret, uint64_t err,
 		void *state, struct mmt_memory_dump *args, int argc, const char *name)
 {
-	int k, found = 0;
+	int found = 0;
 	int args_used = 0;
 	void (*fun)(void *) = NULL;
 	void (*fun_with_args)(void *, struct mmt_memory_dump *, int argc) = NULL;
 
-	struct fglrx_ioctl *ioctl;
-	for (k = 0; k < fglrx_ioctls_cnt; ++k)
+	struct fglrx_ioctl *ioctl = fglrx_ioctl_find(id);
+	if (ioctl && ioctl->size == buf->len)
 	{
-		ioctl = &fglrx_ioctls[k];
-		if (ioctl->id == id)
+		if (dump_decoded_ioctl_data && !ioctl->disabled)
 		{
-			if (ioctl->size == buf->len)
+			mmt_log("%-26s %-5s fd: %d, ", ioctl->name, name, fd);
+			if (ret)
+				mmt_log_cont("ret: %" PRId64 ", ", ret);
+			if (err)
+				mmt_log_cont("%serr: %" PRId64 "%s, ", colors->err, err, colors->reset);
+
+			fglrx_reset_pfx();
+			fun = ioctl->fun;
+			if (fun)
+				fun(buf->data);
+			fun_with_args = ioctl->fun_with_args;
+			if (fun_with_args)
 			{
-				if (dump_decoded_ioctl_data && !ioctl->disabled)
-				{
-					mmt_log("%-26s %-5s fd: %d, ", ioctl->name, name, fd);
-					if (ret)
-						mmt_log_cont("ret: %" PRId64 ", ", ret);
-					if (err)
-						mmt_log_cont("%serr: %" PRId64 "%s, ", colors->err, err, colors->reset);
-
-					fglrx_reset_pfx();
-					fun = ioctl->fun;
-					if (fun)
-						fun(buf->data);
-					fun_with_args = ioctl->fun_with_args;
-					if (fun_with_args)
-					{
-						fun_with_args(buf->data, args, argc);
-						args_used = 1;
-					}
-				}
-				found = 1;
+				fun_with_args(buf->data, args, argc);
+				args_used = 1;
 			}
-			break;
 		}
+		found = 1;
 	}
 
 	if (!found)
@@ -5,6 +5,8 @@
 
 #include "mmt_bin_decode.h"
 
+void fglrx_ioctls_init(void);
+
 int fglrx_ioctl_pre(uint32_t fd, uint32_t id, uint8_t dir, uint8_t nr, uint16_t size,
 		struct mmt_buf *buf, void *state, struct mmt_memory_dump *args, int argc);
 int fglrx_ioctl_post(uint32_t fd, uint32_t id, uint8_t dir, uint8_t nr, uint16_t size,
@@ -7,32 +7,37 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "output.h"
+
 extern int indent_logs;
 extern int mmt_sync_fd;
 
-#define fflush_stdout(fmt)         do { if (mmt_sync_fd != -1 && fmt[strlen(fmt) - 1] == '\n') fflush(stdout); } while (0)
-#define mmt_debug(fmt, ...)        do { if (MMT_DEBUG) { fprintf(stdout, "DBG: " fmt, __VA_ARGS__); fflush_stdout(fmt); } } while (0)
-#define mmt_debug_cont(fmt, ...)   do { if (MMT_DEBUG) { fprintf(stdout, fmt, __VA_ARGS__); fflush_stdout(fmt); } } while (0)
-#define mmt_printf(fmt, ...)       do { fprintf(stdout, fmt, __VA_ARGS__); fflush_stdout(fmt); } while (0)
-#define mmt_log(fmt, ...)          do { if (indent_logs) fprintf(stdout, "%64s" fmt, " ", __VA_ARGS__); else fprintf(stdout, "LOG: " fmt, __VA_ARGS__); fflush_stdout(fmt); } while (0)
-#define mmt_log_cont(fmt, ...)     do { fprintf(stdout, fmt, __VA_ARGS__); fflush_stdout(fmt); } while (0)
-#define mmt_log_cont_nl()          do { fprintf(stdout, "\n"); fflush_stdout("\n"); } while (0)
-#define mmt_error(fmt, ...)        do { fprintf(stdout, "ERROR: " fmt, __VA_ARGS__); fflush_stdout(fmt); } while (0)
-
-#define _print_x64(pfx, strct, field)	mmt_log_cont("%s" #field ": 0x%016" PRIx64, pfx, (strct)->field)
-#define _print_x32(pfx, strct, field)	mmt_log_cont("%s" #field ": 0x%08"  PRIx32, pfx, (strct)->field)
-#define _print_x16(pfx, strct, field)	mmt_log_cont("%s" #field ": 0x%04"  PRIx16, pfx, (strct)->field)
-#define _print_x8( pfx, strct, field)	mmt_log_cont("%s" #field ": 0x%02"  PRIx8,  pfx, (strct)->field)
+#define fflush_stdout(fmt)         do { if (mmt_sync_fd != -1 && fmt[strlen(fmt) - 1] == '\n') out_flush(); } while (0)
+#define mmt_debug(fmt, ...)        do { if (MMT_DEBUG) { out_printf("DBG: " fmt, __VA_ARGS__); fflush_stdout(fmt); } } while (0)
+#define mmt_debug_cont(fmt, ...)   do { if (MMT_DEBUG) { out_printf(fmt, __VA_ARGS__); fflush_stdout(fmt); } } while (0)
+#define mmt_printf(fmt, ...)       do { out_printf(fmt, __VA_ARGS__); fflush_stdout(fmt); } while (0)
+#define mmt_log(fmt, ...)          do { if (mmt_muted) break; if (indent_logs) out_spaces(64); else out_str("LOG: "); out_printf(fmt, __VA_ARGS__); fflush_stdout(fmt); } while (0)
+#define mmt_log_cont(fmt, ...)     do { out_printf(fmt, __VA_ARGS__); fflush_stdout(fmt); } while (0)
+#define mmt_log_cont_nl()          do { out_char('\n'); fflush_stdout("\n"); } while (0)
+#define mmt_error(fmt, ...)        do { if (mmt_muted) break; out_str("ERROR: "); out_printf(fmt, __VA_ARGS__); fflush_stdout(fmt); } while (0)
+
+/* the casts mirror integer promotions done for the printf formats */
+#define _print_xn(pfx, strct, field, type, n)	do { out_str(pfx); out_str(#field ": 0x"); out_hex((type)(strct)->field, n); } while (0)
+#define _print_x64(pfx, strct, field)	_print_xn(pfx, strct, field, uint64_t, 16)
+#define _print_x32(pfx, strct, field)	_print_xn(pfx, strct, field, uint32_t, 8)
+#define _print_x16(pfx, strct, field)	_print_xn(pfx, strct, field, unsigned int, 4)
+#define _print_x8( pfx, strct, field)	_print_xn(pfx, strct, field, unsigned int, 2)
 
 #define _print_d64_align(pfx, strct, field, algn)	mmt_log_cont("%s" #field ": %" algn PRId64, pfx, (strct)->field)
 #define _print_d32_align(pfx, strct, field, algn)	mmt_log_cont("%s" #field ": %" algn PRId32, pfx, (strct)->field)
 #define _print_d16_align(pfx, strct, field, algn)	mmt_log_cont("%s" #field ": %" algn PRId16, pfx, (strct)->field)
 #define _print_d8_align( pfx, strct, field, algn)	mmt_log_cont("%s" #field ": %" algn PRId8,  pfx, (strct)->field)
 
-#define _print_d64(pfx, strct, field)	_print_d64_align(pfx, strct, field, "")
-#define _print_d32(pfx, strct, field)	_print_d32_align(pfx, strct, field, "")
-#define _print_d16(pfx, strct, field)	_print_d16_align(pfx, strct, field, "")
-#define _print_d8( pfx, strct, field)	_print_d8_align (pfx, strct, field, "")
+#define _print_dn(pfx, strct, field, type)	do { out_str(pfx); out_str(#field ": "); out_dec((type)(strct)->field); } while (0)
+#define _print_d64(pfx, strct, field)	_print_dn(pfx, strct, field, int64_t)
+#define _print_d32(pfx, strct, field)	_print_dn(pfx, strct, field, int32_t)
+#define _print_d16(pfx, strct, field)	_print_dn(pfx, strct, field, int)
+#define _print_d8( pfx, strct, field)	_print_dn(pfx, strct, field, int)
 
 #define _print_str(pfx, strct, field)	mmt_log_cont("%s" #field ": \"%s\"", pfx, (strct)->field)
 
@@ -1323,7 +1323,7 @@ int decode_macro(struct pushbuf_decode_state *pstate, struct macro_state *macro)
 				{
 					struct varinfo *var = varinfo_new(isa_macro->vardata);
 
-					envydis(isa_macro, stdout, (void *)(macro->code + macro->last_code_pos / 4), 0,
+					envydis(isa_macro, out_stdio(), (void *)(macro->code + macro->last_code_pos / 4), 0,
 							(macro->cur_code_pos - macro->last_code_pos) / 4,
 							var, 0, NULL, 0, colors);
 					varinfo_del(var);
@@ -1373,7 +1373,7 @@ int decode_macro(struct pushbuf_decode_state *pstate, struct macro_state *macro)
 			{
 				struct varinfo *var = varinfo_new(isa_macro->vardata);
 
-				envydis(isa_macro, stdout, (uint8_t *)macro->istate.code, 0,
+				envydis(isa_macro, out_stdio(), (uint8_t *)macro->istate.code, 0,
 						macro->istate.words, var, 0, NULL, 0, colors);
 				varinfo_del(var);
 
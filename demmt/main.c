@@ -27,6 +27,7 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <sys/mman.h>
+#include <sys/wait.h>
 
 #ifdef LIBSECCOMP_AVAILABLE
 #include <seccomp.h>
@@ -58,6 +59,8 @@ struct rnndomain *gk104_cp_header_domain;
 
 const struct envy_colors *colors = NULL;
 int mmt_sync_fd = -1;
+int demmt_workers = 1;
+static int demmt_worker = 0;
 
 static void demmt_memread(struct mmt_read *w, void *state)
 {
@@ -69,6 +72,7 @@ static void demmt_memread(struct mmt_read *w, void *state)
 		mmt_error("invalid buffer id: %d\n", w->id);
 		demmt_abort();
 	}
+	demmt_select_partition(cpu_mapping_partition(mapping));
 
 	uint64_t gpu_addr = cpu_mapping_to_gpu_addr(mapping, w->offset);
 	if (print_gpu_addresses && gpu_addr)
@@ -101,6 +105,10 @@ static void demmt_memread(struct mmt_read *w, void *state)
 
 static void demmt_memwrite(struct mmt_write *w, void *state)
 {
+	struct cpu_mapping *mapping = get_cpu_mapping(w->id);
+	if (mapping)
+		demmt_select_partition(cpu_mapping_partition(mapping));
+
 	buffer_register_mmt_write(w);
 }
 
@@ -128,6 +136,8 @@ void demmt_memread2(struct mmt_read2 *r2, void *state)
 		memcpy(r1->data, r2->data, r1->len);
 		demmt_memread(r1, state);
 	}
+	else
+		demmt_select_partition(-1);
 
 	if (dump_memory_reads)
 	{
@@ -175,6 +185,8 @@ void demmt_memwrite2(struct mmt_write2 *w2, void *state)
 		memcpy(w1->data, w2->data, w1->len);
 		demmt_memwrite(w1, state);
 	}
+	else
+		demmt_select_partition(-1);
 
 	if (dump_memory_writes)
 	{
@@ -263,11 +275,13 @@ static void demmt_mmap2(struct mmt_mmap2 *mm, void *state)
 
 static void demmt_munmap(struct mmt_unmap *mm, void *state)
 {
-	if (get_cpu_mapping(mm->id) == NULL)
+	struct cpu_mapping *mapping = get_cpu_mapping(mm->id);
+	if (mapping == NULL)
 	{
 		mmt_error("invalid buffer id: %d\n", mm->id);
 		demmt_abort();
 	}
+	demmt_select_partition(cpu_mapping_partition(mapping));
 
 	if (dump_sys_munmap)
 		mmt_log("munmap: address: 0x%" PRIx64 ", length: 0x%08" PRIx64 ", id: %d, offset: 0x%08" PRIx64 "",
@@ -278,11 +292,13 @@ static void demmt_munmap(struct mmt_unmap *mm, void *state)
 
 static void demmt_mremap(struct mmt_mremap *mm, void *state)
 {
-	if (get_cpu_mapping(mm->id) == NULL)
+	struct cpu_mapping *mapping = get_cpu_mapping(mm->id);
+	if (mapping == NULL)
 	{
 		mmt_error("invalid buffer id: %d\n", mm->id);
 		demmt_abort();
 	}
+	demmt_select_partition(cpu_mapping_partition(mapping));
 
 	if (dump_sys_mremap)
 		mmt_log("mremap: old_address: 0x%" PRIx64 ", new_address: 0x%" PRIx64 ", old_length: 0x%08" PRIx64 ", new_length: 0x%08" PRIx64 ", id: %d, offset: 0x%08" PRIx64 "\n",
@@ -297,9 +313,12 @@ static struct open_file
 {
 	const char *path;
 	enum mmt_fd_type type;
+	int partition;
 }
 open_files[MAX_FD];
 
+static int partitions_cnt;
+
 static enum mmt_fd_type undetected_fdtype = FDUNK;
 
 enum mmt_fd_type demmt_get_fdtype(int fd)
@@ -315,6 +334,22 @@ enum mmt_fd_type demmt_get_fdtype(int fd)
 	return undetected_fdtype;
 }
 
+int demmt_fd_partition(int fd)
+{
+	if (fd >= 0 && fd < MAX_FD && open_files[fd].path)
+		return open_files[fd].partition;
+	return -1;
+}
+
+void demmt_select_partition(int partition)
+{
+	if (demmt_workers <= 1)
+		return;
+	if (partition < 0)
+		partition = 0;
+	mmt_muted = partition % demmt_workers != demmt_worker;
+}
+
 static void demmt_open(struct mmt_open *o, void *state)
 {
 	if (o->ret < MAX_FD)
@@ -331,26 +366,41 @@ static void demmt_open(struct mmt_open *o, void *state)
 			f->type = FDDRM;
 		else
 			f->type = FDUNK;
+
+		/*
+		 * blob clients live on /dev/nvidiactl fds, /dev/nvidiaN fds
+		 * are only used to map memory of objects created there
+		 */
+		if (f->type == FDFGLRX || f->type == FDDRM || strstr(f->path, "/dev/nvidiactl"))
+			f->partition = partitions_cnt++;
+		else
+			f->partition = -1;
 	}
 
+	demmt_select_partition(demmt_fd_partition(o->ret));
+
 	if (dump_sys_open)
 		mmt_log("sys_open: %s, flags: 0x%x, mode: 0x%x, ret: %d\n", o->path.data, o->flags, o->mode, o->ret);
 }
 
 static void demmt_msg(uint8_t *data, unsigned int len, void *state)
 {
-	if (dump_msg)
+	demmt_select_partition(-1);
+
+	if (dump_msg && !mmt_muted)
 	{
 		mmt_log("MSG: %s", "");
-		fwrite(data, 1, len, stdout);
+		out_write(data, len);
 		mmt_log_cont_nl();
 	}
 }
 
 static void demmt_write_syscall(struct mmt_write_syscall *o, void *state)
 {
-	if (dump_sys_write)
-		fwrite(o->data.data, 1, o->data.len, stdout);
+	demmt_select_partition(-1);
+
+	if (dump_sys_write && !mmt_muted)
+		out_write(o->data.data, o->data.len);
 }
 
 static void demmt_dup_syscall(struct mmt_dup_syscall *o, void *state)
@@ -359,8 +409,11 @@ static void demmt_dup_syscall(struct mmt_dup_syscall *o, void *state)
 	{
 		open_files[o->newfd].path = open_files[o->oldfd].path;
 		open_files[o->newfd].type = open_files[o->oldfd].type;
+		open_files[o->newfd].partition = open_files[o->oldfd].partition;
 	}
 
+	demmt_select_partition(demmt_fd_partition(o->oldfd));
+
 	if (dump_sys_open)
 		mmt_log("sys_dup: old: %d, new: %d\n", o->oldfd, o->newfd);
 }
@@ -370,7 +423,7 @@ static void demmt_sync(struct mmt_sync *o, void *state)
 	if (mmt_sync_fd == -1)
 		return;
 
-	fflush(stdout);
+	out_flush();
 	fdatasync(1);
 	int cnt = 4;
 	while (cnt)
@@ -410,6 +463,7 @@ static void __demmt_ioctl_pre(uint32_t fd, uint32_t id, struct mmt_buf *data, vo
 	uint8_t dir, type, nr;
 	uint16_t size;
 	decode_ioctl_id(id, &dir, &type, &nr, &size);
+	demmt_select_partition(demmt_fd_partition(fd));
 	int print_raw = 1;
 
 	enum mmt_fd_type fdtype = demmt_get_fdtype(fd);
@@ -451,6 +505,7 @@ static void __demmt_ioctl_post(uint32_t fd, uint32_t id, struct mmt_buf *data,
 	uint8_t dir, type, nr;
 	uint16_t size;
 	decode_ioctl_id(id, &dir, &type, &nr, &size);
+	demmt_select_partition(demmt_fd_partition(fd));
 	int print_raw = 0;
 
 	enum mmt_fd_type fdtype = demmt_get_fdtype(fd);
@@ -533,6 +588,73 @@ const struct mmt_nvidia_decode_funcs demmt_funcs =
 	demmt_nouveau_gem_pushbuf_data
 };
 
+/*
+ * Forks -j workers, each one decoding the whole input with its own output
+ * file. Returns only in workers, the parent waits for all of them, prints
+ * their output in worker order and exits.
+ */
+static void start_workers(const char *filename)
+{
+	FILE **outputs = calloc(demmt_workers, sizeof(*outputs));
+	pid_t *pids = calloc(demmt_workers, sizeof(*pids));
+	int i, ret = 0;
+
+	out_flush();
+	for (i = 0; i < demmt_workers; ++i)
+	{
+		outputs[i] = tmpfile();
+		if (!outputs[i])
+		{
+			perror("tmpfile");
+			demmt_abort();
+		}
+
+		pids[i] = fork();
+		if (pids[i] < 0)
+		{
+			perror("fork");
+			demmt_abort();
+		}
+
+		if (pids[i] == 0)
+		{
+			demmt_worker = i;
+			dup2(fileno(outputs[i]), 1);
+			out_open_null();
+			close(0);
+			if (open_input(filename) == NULL)
+			{
+				perror("open");
+				exit(1);
+			}
+			free(outputs);
+			free(pids);
+			return;
+		}
+	}
+
+	for (i = 0; i < demmt_workers; ++i)
+	{
+		char buf[65536];
+		size_t len;
+		int status;
+
+		if (waitpid(pids[i], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		{
+			fprintf(stderr, "demmt worker %d failed\n", i);
+			ret = 1;
+		}
+
+		rewind(outputs[i]);
+		while ((len = fread(buf, 1, sizeof(buf), outputs[i])) > 0)
+			fwrite(buf, 1, len, stdout);
+		fclose(outputs[i]);
+	}
+
+	fflush(stdout);
+	exit(ret);
+}
+
 uint64_t roundup_to_pagesize(uint64_t sz)
 {
 	static uint64_t pg = 0;
@@ -543,6 +665,11 @@ uint64_t roundup_to_pagesize(uint64_t sz)
 
 int main(int argc, char *argv[])
 {
+	nvrm_ioctls_init();
+	nvrm_mthds_init();
+	fglrx_ioctls_init();
+	atexit(out_flush);
+
 	char *filename = read_opts(argc, argv);
 
 	/* set up an rnn context */
@@ -597,7 +724,7 @@ int main(int argc, char *argv[])
 	if (!gk104_cp_header_domain)
 		demmt_abort();
 
-	if (filename)
+	if (filename && demmt_workers == 1)
 	{
 		close(0);
 		if (open_input(filename) == NULL)
@@ -645,6 +772,12 @@ int main(int argc, char *argv[])
 		close(pipe_fds[1]);
 	}
 
+	if (demmt_workers > 1)
+	{
+		start_workers(filename);
+		free(filename);
+	}
+
 #ifdef LIBSECCOMP_AVAILABLE
 	if (seccomp_level)
 	{
@@ -719,7 +852,11 @@ int main(int argc, char *argv[])
 #endif
 
 	mmt_decode(&demmt_funcs.base, NULL);
-	fflush(stdout);
+	out_flush();
+
+	if (pagemap_evicted)
+		fprintf(stderr, "dropped %" PRIu64 " pages of buffer contents to stay within %" PRIu64 " MiB limit\n",
+				pagemap_evicted, pagemap_limit >> 20);
 
 	fini_macrodis();
 	demmt_cleanup_isas();
@@ -170,285 +170,290 @@ static unsigned int load_memory_dump_v2(unsigned int pfx, struct mmt_memory_dump
 	return size1 + size2;
 }
 
-void mmt_decode(const struct mmt_decode_funcs *funcs, void *state)
+/* decodes one message, returns 0 at the end of input */
+int mmt_decode_next(const struct mmt_decode_funcs *funcs, void *state)
 {
 	unsigned int size;
-	while (1)
+	struct mmt_message *msg = mmt_load_initial_data();
+	if (msg == NULL)
+		return 0;
+
+	if (msg->type == '=' || msg->type == '-')
 	{
-		struct mmt_message *msg = mmt_load_initial_data();
-		if (msg == NULL)
-			return;
+		unsigned int len = 0;
+		while (mmt_buf[mmt_idx + len] != 10)
+			if (mmt_load_data(++len) == NULL)
+				return 0;
 
-		if (msg->type == '=' || msg->type == '-')
-		{
-			unsigned int len = 0;
-			while (mmt_buf[mmt_idx + len] != 10)
-				if (mmt_load_data(++len) == NULL)
-					return;
+		if (funcs->msg)
+			funcs->msg(&mmt_buf[mmt_idx], len, state);
 
-			if (funcs->msg)
-				funcs->msg(&mmt_buf[mmt_idx], len, state);
+		mmt_idx += len + 1;
+	}
+	else if (msg->type == 'r') // read
+	{
+		struct mmt_read *w;
+		size = sizeof(struct mmt_read) + 1;
+		w = mmt_load_data(size);
+		size += w->len;
+		w = mmt_load_data(size);
 
-			mmt_idx += len + 1;
-		}
-		else if (msg->type == 'r') // read
-		{
-			struct mmt_read *w;
-			size = sizeof(struct mmt_read) + 1;
-			w = mmt_load_data(size);
-			size += w->len;
-			w = mmt_load_data(size);
+		mmt_check_eor(size);
 
-			mmt_check_eor(size);
+		if (funcs->memread)
+			funcs->memread(w, state);
 
-			if (funcs->memread)
-				funcs->memread(w, state);
+		mmt_idx += size;
+	}
+	else if (msg->type == 'R') // read2
+	{
+		struct mmt_read2 *w;
+		size = sizeof(struct mmt_read2) + 1;
+		w = mmt_load_data(size);
+		size += w->len;
+		w = mmt_load_data(size);
 
-			mmt_idx += size;
-		}
-		else if (msg->type == 'R') // read2
-		{
-			struct mmt_read2 *w;
-			size = sizeof(struct mmt_read2) + 1;
-			w = mmt_load_data(size);
-			size += w->len;
-			w = mmt_load_data(size);
+		mmt_check_eor(size);
 
-			mmt_check_eor(size);
+		if (funcs->memread2)
+			funcs->memread2(w, state);
 
-			if (funcs->memread2)
-				funcs->memread2(w, state);
+		mmt_idx += size;
+	}
+	else if (msg->type == 'w') // write
+	{
+		struct mmt_write *w;
+		size = sizeof(struct mmt_write) + 1;
+		w = mmt_load_data(size);
+		size += w->len;
+		w = mmt_load_data(size);
 
-			mmt_idx += size;
-		}
-		else if (msg->type == 'w') // write
-		{
-			struct mmt_write *w;
-			size = sizeof(struct mmt_write) + 1;
-			w = mmt_load_data(size);
-			size += w->len;
-			w = mmt_load_data(size);
+		mmt_check_eor(size);
 
-			mmt_check_eor(size);
+		if (funcs->memwrite)
+			funcs->memwrite(w, state);
 
-			if (funcs->memwrite)
-				funcs->memwrite(w, state);
+		mmt_idx += size;
+	}
+	else if (msg->type == 'W') // write2
+	{
+		struct mmt_write2 *w;
+		size = sizeof(struct mmt_write2) + 1;
+		w = mmt_load_data(size);
+		size += w->len;
+		w = mmt_load_data(size);
 
-			mmt_idx += size;
-		}
-		else if (msg->type == 'W') // write2
-		{
-			struct mmt_write2 *w;
-			size = sizeof(struct mmt_write2) + 1;
-			w = mmt_load_data(size);
-			size += w->len;
-			w = mmt_load_data(size);
+		mmt_check_eor(size);
 
-			mmt_check_eor(size);
+		if (funcs->memwrite2)
+			funcs->memwrite2(w, state);
 
-			if (funcs->memwrite2)
-				funcs->memwrite2(w, state);
+		mmt_idx += size;
+	}
+	else if (msg->type == 'M') // mmap v2
+	{
+		size = sizeof(struct mmt_mmap2) + 1;
+		struct mmt_mmap2 *mm = mmt_load_data(size);
 
-			mmt_idx += size;
-		}
-		else if (msg->type == 'M') // mmap v2
-		{
-			size = sizeof(struct mmt_mmap2) + 1;
-			struct mmt_mmap2 *mm = mmt_load_data(size);
+		mmt_check_eor(size);
 
-			mmt_check_eor(size);
+		if (funcs->mmap2)
+			funcs->mmap2(mm, state);
 
-			if (funcs->mmap2)
-				funcs->mmap2(mm, state);
+		mmt_idx += size;
+	}
+	else if (msg->type == 'm') // mmap
+	{
+		size = sizeof(struct mmt_mmap) + 1;
+		struct mmt_mmap *mm = mmt_load_data(size);
 
-			mmt_idx += size;
-		}
-		else if (msg->type == 'm') // mmap
-		{
-			size = sizeof(struct mmt_mmap) + 1;
-			struct mmt_mmap *mm = mmt_load_data(size);
+		mmt_check_eor(size);
 
-			mmt_check_eor(size);
+		if (funcs->mmap)
+			funcs->mmap(mm, state);
 
-			if (funcs->mmap)
-				funcs->mmap(mm, state);
+		mmt_idx += size;
+	}
+	else if (msg->type == 'u') // unmap
+	{
+		size = sizeof(struct mmt_unmap) + 1;
+		struct mmt_unmap *mm = mmt_load_data(size);
 
-			mmt_idx += size;
-		}
-		else if (msg->type == 'u') // unmap
-		{
-			size = sizeof(struct mmt_unmap) + 1;
-			struct mmt_unmap *mm = mmt_load_data(size);
+		mmt_check_eor(size);
 
-			mmt_check_eor(size);
+		if (funcs->munmap)
+			funcs->munmap(mm, state);
 
-			if (funcs->munmap)
-				funcs->munmap(mm, state);
+		mmt_idx += size;
+	}
+	else if (msg->type == 'e') // mremap
+	{
+		size = sizeof(struct mmt_mremap) + 1;
+		struct mmt_mremap *mm = mmt_load_data(size);
 
-			mmt_idx += size;
-		}
-		else if (msg->type == 'e') // mremap
-		{
-			size = sizeof(struct mmt_mremap) + 1;
-			struct mmt_mremap *mm = mmt_load_data(size);
+		mmt_check_eor(size);
 
-			mmt_check_eor(size);
+		if (funcs->mremap)
+			funcs->mremap(mm, state);
 
-			if (funcs->mremap)
-				funcs->mremap(mm, state);
+		mmt_idx += size;
+	}
+	else if (msg->type == 'o') // open
+	{
+		size = sizeof(struct mmt_open) + 1;
+		struct mmt_open *o;
+		o = mmt_load_data(size);
+		mmt_buf_check_sanity(&o->path);
+		size += o->path.len;
+		o = mmt_load_data(size);
 
-			mmt_idx += size;
-		}
-		else if (msg->type == 'o') // open
-		{
-			size = sizeof(struct mmt_open) + 1;
-			struct mmt_open *o;
-			o = mmt_load_data(size);
-			mmt_buf_check_sanity(&o->path);
-			size += o->path.len;
-			o = mmt_load_data(size);
+		mmt_check_eor(size);
 
-			mmt_check_eor(size);
+		if (funcs->open)
+			funcs->open(o, state);
 
-			if (funcs->open)
-				funcs->open(o, state);
+		mmt_idx += size;
+	}
+	else if (msg->type == 'n') // nvidia / nouveau
+		mmt_decode_nvidia((struct mmt_nvidia_decode_funcs *)funcs, state);
+	else if (msg->type == 't') // write syscall
+	{
+		struct mmt_write_syscall *w;
+		size = sizeof(struct mmt_write_syscall) + 1;
+		w = mmt_load_data(size);
+		mmt_buf_check_sanity(&w->data);
+		size += w->data.len;
+		w = mmt_load_data(size);
 
-			mmt_idx += size;
-		}
-		else if (msg->type == 'n') // nvidia / nouveau
-			mmt_decode_nvidia((struct mmt_nvidia_decode_funcs *)funcs, state);
-		else if (msg->type == 't') // write syscall
-		{
-			struct mmt_write_syscall *w;
-			size = sizeof(struct mmt_write_syscall) + 1;
-			w = mmt_load_data(size);
-			mmt_buf_check_sanity(&w->data);
-			size += w->data.len;
-			w = mmt_load_data(size);
+		mmt_check_eor(size);
 
-			mmt_check_eor(size);
+		if (funcs->write_syscall)
+			funcs->write_syscall(w, state);
 
-			if (funcs->write_syscall)
-				funcs->write_syscall(w, state);
+		mmt_idx += size;
+	}
+	else if (msg->type == 'S') // sync
+	{
+		size = sizeof(struct mmt_sync) + 1;
+		struct mmt_sync *mm = mmt_load_data(size);
 
-			mmt_idx += size;
-		}
-		else if (msg->type == 'S') // sync
-		{
-			size = sizeof(struct mmt_sync) + 1;
-			struct mmt_sync *mm = mmt_load_data(size);
+		mmt_check_eor(size);
 
-			mmt_check_eor(size);
+		if (funcs->sync)
+			funcs->sync(mm, state);
+
+		mmt_idx += size;
+	}
+	else if (msg->type == 'd') // dup syscall
+	{
+		size = sizeof(struct mmt_dup_syscall) + 1;
+		struct mmt_dup_syscall *mm = mmt_load_data(size);
 
-			if (funcs->sync)
-				funcs->sync(mm, state);
+		mmt_check_eor(size);
 
-			mmt_idx += size;
-		}
-		else if (msg->type == 'd') // dup syscall
+		if (funcs->dup_syscall)
+			funcs->dup_syscall(mm, state);
+
+		mmt_idx += size;
+	}
+	else if (msg->type == 'i') // ioctl pre
+	{
+#define MAX_ARGS 20
+		unsigned int size2, pfx;
+		struct mmt_memory_dump args[MAX_ARGS];
+		struct mmt_ioctl_pre_v2 *ctl;
+		int argc;
+
+		do
 		{
-			size = sizeof(struct mmt_dup_syscall) + 1;
-			struct mmt_dup_syscall *mm = mmt_load_data(size);
+			size = sizeof(struct mmt_ioctl_pre_v2) + 1;
+			ctl = mmt_load_data(size);
+			mmt_buf_check_sanity(&ctl->data);
+			size += ctl->data.len;
+			ctl = mmt_load_data(size);
 
 			mmt_check_eor(size);
 
-			if (funcs->dup_syscall)
-				funcs->dup_syscall(mm, state);
+			argc = 0;
 
-			mmt_idx += size;
-		}
-		else if (msg->type == 'i') // ioctl pre
-		{
-#define MAX_ARGS 20
-			unsigned int size2, pfx;
-			struct mmt_memory_dump args[MAX_ARGS];
-			struct mmt_ioctl_pre_v2 *ctl;
-			int argc;
+			struct mmt_memory_dump_v2_prefix *d;
+			struct mmt_buf *b;
+			pfx = size;
 
-			do
+			while ((size2 = load_memory_dump_v2(pfx, &d, &b)))
 			{
-				size = sizeof(struct mmt_ioctl_pre_v2) + 1;
-				ctl = mmt_load_data(size);
-				mmt_buf_check_sanity(&ctl->data);
-				size += ctl->data.len;
-				ctl = mmt_load_data(size);
-
-				mmt_check_eor(size);
-
-				argc = 0;
-
-				struct mmt_memory_dump_v2_prefix *d;
-				struct mmt_buf *b;
-				pfx = size;
-
-				while ((size2 = load_memory_dump_v2(pfx, &d, &b)))
-				{
-					args[argc].addr = d->addr;
-					args[argc].data = b;
-					args[argc].str = NULL;
-					argc++;
-					pfx += size2;
-					if (argc == MAX_ARGS)
-						break;
-				}
+				args[argc].addr = d->addr;
+				args[argc].data = b;
+				args[argc].str = NULL;
+				argc++;
+				pfx += size2;
+				if (argc == MAX_ARGS)
+					break;
 			}
-			while (ctl != mmt_load_data(size));
+		}
+		while (ctl != mmt_load_data(size));
 
-			if (funcs->ioctl_pre)
-				funcs->ioctl_pre(ctl, state, args, argc);
+		if (funcs->ioctl_pre)
+			funcs->ioctl_pre(ctl, state, args, argc);
 
-			mmt_idx += pfx;
-		}
-		else if (msg->type == 'j')
+		mmt_idx += pfx;
+	}
+	else if (msg->type == 'j')
+	{
+		unsigned int size2, pfx;
+		struct mmt_memory_dump args[MAX_ARGS];
+		struct mmt_ioctl_post_v2 *ctl;
+		int argc;
+
+		do
 		{
-			unsigned int size2, pfx;
-			struct mmt_memory_dump args[MAX_ARGS];
-			struct mmt_ioctl_post_v2 *ctl;
-			int argc;
+			size = sizeof(struct mmt_ioctl_post_v2) + 1;
+			ctl = mmt_load_data(size);
+			mmt_buf_check_sanity(&ctl->data);
+			size += ctl->data.len;
+			ctl = mmt_load_data(size);
+
+			mmt_check_eor(size);
 
-			do
+			argc = 0;
+
+			struct mmt_memory_dump_v2_prefix *d;
+			struct mmt_buf *b;
+			pfx = size;
+
+			while ((size2 = load_memory_dump_v2(pfx, &d, &b)))
 			{
-				size = sizeof(struct mmt_ioctl_post_v2) + 1;
-				ctl = mmt_load_data(size);
-				mmt_buf_check_sanity(&ctl->data);
-				size += ctl->data.len;
-				ctl = mmt_load_data(size);
-
-				mmt_check_eor(size);
-
-				argc = 0;
-
-				struct mmt_memory_dump_v2_prefix *d;
-				struct mmt_buf *b;
-				pfx = size;
-
-				while ((size2 = load_memory_dump_v2(pfx, &d, &b)))
-				{
-					args[argc].addr = d->addr;
-					args[argc].data = b;
-					args[argc].str = NULL;
-					argc++;
-					pfx += size2;
-					if (argc == MAX_ARGS)
-						break;
-				}
+				args[argc].addr = d->addr;
+				args[argc].data = b;
+				args[argc].str = NULL;
+				argc++;
+				pfx += size2;
+				if (argc == MAX_ARGS)
+					break;
 			}
-			while (ctl != mmt_load_data(size));
+		}
+		while (ctl != mmt_load_data(size));
 
-			if (funcs->ioctl_post)
-				funcs->ioctl_post(ctl, state, args, argc);
+		if (funcs->ioctl_post)
+			funcs->ioctl_post(ctl, state, args, argc);
 
-			mmt_idx += pfx;
+		mmt_idx += pfx;
 #undef MAX_ARGS
-		}
-		else
-		{
-			fflush(stdout);
-			fprintf(stderr, "unknown type: 0x%x\n", msg->type);
-			fprintf(stderr, "%c\n", msg->type);
-			mmt_dump_next();
-			exit(1);
-		}
 	}
+	else
+	{
+		fflush(stdout);
+		fprintf(stderr, "unknown type: 0x%x\n", msg->type);
+		fprintf(stderr, "%c\n", msg->type);
+		mmt_dump_next();
+		exit(1);
+	}
+
+	return 1;
 }
 
+void mmt_decode(const struct mmt_decode_funcs *funcs, void *state)
+{
+	while (mmt_decode_next(funcs, state))
+		;
+}
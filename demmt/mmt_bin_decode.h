@@ -189,5 +189,6 @@ struct mmt_decode_funcs
 };
 
 void mmt_decode(const struct mmt_decode_funcs *funcs, void *state);
+int mmt_decode_next(const struct mmt_decode_funcs *funcs, void *state);
 
 #endif
@@ -496,12 +496,8 @@ static void host_map(struct gpu_object *obj, uint32_t fd, uint64_t mmap_offset,
 	mapping->map_id = map_id;
 	uint64_t min_obj_len = object_offset + mapping->length;
 	if (min_obj_len > obj->length)
-	{
-		obj->data = realloc(obj->data, min_obj_len);
-		memset(obj->data + obj->length, 0, min_obj_len - obj->length);
-		obj->length = min_obj_len;
-	}
-	mapping->data = obj->data + object_offset;
+		gpu_object_resize(obj, min_obj_len);
+	mapping->data = &obj->data;
 	mapping->object = obj;
 	mapping->next = obj->cpu_mappings;
 	obj->cpu_mappings = mapping;
@@ -655,11 +651,7 @@ static void handle_nvrm_ioctl_vspace_map(uint32_t fd, struct nvrm_ioctl_vspace_m
 	mapping->object_offset = s->base;
 	mapping->length = s->size;
 	if (s->size > obj->length)
-	{
-		obj->data = realloc(obj->data, s->size);
-		memset(obj->data + obj->length, 0, s->size - obj->length);
-		obj->length = s->size;
-	}
+		gpu_object_resize(obj, s->size);
 	mapping->object = obj;
 	mapping->next = obj->gpu_mappings;
 	obj->gpu_mappings = mapping;
@@ -866,6 +858,7 @@ void demmt_memory_dump(struct mmt_memory_dump_prefix *d, struct mmt_buf *b, void
 {
 	// dead code, because memory dumps are passed to ioctl_pre / ioctl_post handlers
 	int i;
+	demmt_select_partition(-1);
 	mmt_log("memory dump, addr: 0x%016" PRIx64 ", txt: \"%s\", data.len: %d, data:", d->addr, d->str.data, b->len);
 
 	for (i = 0; i < b->len / 4; ++i)
@@ -875,6 +868,8 @@ void demmt_memory_dump(struct mmt_memory_dump_prefix *d, struct mmt_buf *b, void
 
 void __demmt_mmap(uint64_t start, uint64_t len, uint32_t id, uint64_t offset, void *state)
 {
+	demmt_select_partition(-1);
+
 	if (dump_sys_mmap)
 		mmt_log("mmap: address: 0x%" PRIx64 ", length: 0x%08" PRIx64 ", id: %d, offset: 0x%08" PRIx64 "",
 				start, len, id, offset);
@@ -890,6 +885,8 @@ void demmt_nv_mmap(struct mmt_nvidia_mmap *mm, void *state)
 void __demmt_mmap2(uint64_t start, uint64_t len, uint32_t id, uint64_t offset,
 		uint32_t fd, uint32_t prot, uint32_t flags, void *state)
 {
+	demmt_select_partition(demmt_fd_partition(fd));
+
 	if (dump_sys_mmap)
 	{
 		mmt_log("mmap: address: 0x%" PRIx64 ", length: 0x%08" PRIx64 ", id: %d, offset: 0x%08" PRIx64 ", fd: %d",
@@ -922,6 +919,7 @@ void demmt_nv_call_method_data(struct mmt_nvidia_call_method_data *call, void *s
 
 void demmt_nv_ioctl_4d(struct mmt_nvidia_ioctl_4d *ctl, void *state)
 {
+	demmt_select_partition(-1);
 	mmt_log("ioctl4d: %s\n", ctl->str.data);
 }
 
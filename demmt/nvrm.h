@@ -49,6 +49,7 @@ struct nvrm_ioctl
 };
 extern struct nvrm_ioctl nvrm_ioctls[];
 extern int nvrm_ioctls_cnt;
+void nvrm_ioctls_init(void);
 
 struct nvrm_mthd
 {
@@ -61,5 +62,7 @@ struct nvrm_mthd
 };
 extern struct nvrm_mthd nvrm_mthds[];
 extern int nvrm_mthds_cnt;
+void nvrm_mthds_init(void);
+struct nvrm_mthd **nvrm_mthd_find(uint32_t mthd, int *cnt);
 
 #endif
@@ -940,46 +940,80 @@ struct nvrm_ioctl nvrm_ioctls[] =
 #undef _a
 int nvrm_ioctls_cnt = ARRAY_SIZE(nvrm_ioctls);
 
+/* nvrm_ioctls sorted by id, entries sharing an id keep table order */
+static struct nvrm_ioctl *nvrm_ioctls_sorted[ARRAY_SIZE(nvrm_ioctls)];
+
+static int nvrm_ioctl_cmp(const void *a, const void *b)
+{
+	const struct nvrm_ioctl *i1 = *(const struct nvrm_ioctl **)a;
+	const struct nvrm_ioctl *i2 = *(const struct nvrm_ioctl **)b;
+
+	if (i1->id != i2->id)
+		return i1->id < i2->id ? -1 : 1;
+	if (i1 != i2)
+		return i1 < i2 ? -1 : 1;
+	return 0;
+}
+
+void nvrm_ioctls_init(void)
+{
+	int k;
+
+	for (k = 0; k < nvrm_ioctls_cnt; ++k)
+		nvrm_ioctls_sorted[k] = &nvrm_ioctls[k];
+	qsort(nvrm_ioctls_sorted, nvrm_ioctls_cnt, sizeof(nvrm_ioctls_sorted[0]), nvrm_ioctl_cmp);
+}
+
+static struct nvrm_ioctl *nvrm_ioctl_find(uint32_t id)
+{
+	int lo = 0, hi = nvrm_ioctls_cnt;
+
+	while (lo < hi)
+	{
+		int mid = (lo + hi) / 2;
+		if (nvrm_ioctls_sorted[mid]->id < id)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo < nvrm_ioctls_cnt && nvrm_ioctls_sorted[lo]->id == id)
+		return nvrm_ioctls_sorted[lo];
+	return NULL;
+}
+
 static int decode_nvrm_ioctl(uint32_t fd, uint32_t id, uint8_t dir, uint8_t nr,
 		uint16_t size, struct mmt_buf *buf, uint64_t ret, uint64_t err,
 		void *state, struct mmt_memory_dump *args, int argc, const char *name)
 {
-	int k, found = 0;
+	int found = 0;
 	int args_used = 0;
 	void (*fun)(void *) = NULL;
 	void (*fun_with_args)(void *, struct mmt_memory_dump *, int argc) = NULL;
 
-	struct nvrm_ioctl *ioctl;
-	for (k = 0; k < nvrm_ioctls_cnt; ++k)
+	struct nvrm_ioctl *ioctl = nvrm_ioctl_find(id);
+	if (ioctl && ioctl->size == buf->len)
 	{
-		ioctl = &nvrm_ioctls[k];
-		if (ioctl->id == id)
+		if (dump_decoded_ioctl_data && !ioctl->disabled)
 		{
-			if (ioctl->size == buf->len)
-			{
-				if (dump_decoded_ioctl_data && !ioctl->disabled)
-				{
-					mmt_log("%-26s %-5s fd: %d, ", ioctl->name, name, fd);
-					if (ret)
-						mmt_log_cont("ret: %" PRId64 ", ", ret);
-					if (err)
-						mmt_log_cont("%serr: %" PRId64 "%s, ", colors->err, err, colors->reset);
+			mmt_log("%-26s %-5s fd: %d, ", ioctl->name, name, fd);
+			if (ret)
+				mmt_log_cont("ret: %" PRId64 ", ", ret);
+			if (err)
+				mmt_log_cont("%serr: %" PRId64 "%s, ", colors->err, err, colors->reset);
 
-					nvrm_reset_pfx();
-					fun = ioctl->fun;
-					if (fun)
-						fun(buf->data);
-					fun_with_args = ioctl->fun_with_args;
-					if (fun_with_args)
-					{
-						fun_with_args(buf->data, args, argc);
-						args_used = 1;
-					}
-				}
-				found = 1;
+			nvrm_reset_pfx();
+			fun = ioctl->fun;
+			if (fun)
+				fun(buf->data);
+			fun_with_args = ioctl->fun_with_args;
+			if (fun_with_args)
+			{
+				fun_with_args(buf->data, args, argc);
+				args_used = 1;
 			}
-			break;
 		}
+		found = 1;
 	}
 
 	if (!found)
@@ -22,6 +22,8 @@
  * OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <stdlib.h>
+
 #include "decode_utils.h"
 #include "log.h"
 #include "nvrm.h"
@@ -602,6 +604,50 @@ struct nvrm_mthd nvrm_mthds[] =
 #undef _a
 int nvrm_mthds_cnt = ARRAY_SIZE(nvrm_mthds);
 
+/* nvrm_mthds sorted by method, entries sharing a method keep table order */
+static struct nvrm_mthd *nvrm_mthds_sorted[ARRAY_SIZE(nvrm_mthds)];
+
+static int nvrm_mthd_cmp(const void *a, const void *b)
+{
+	const struct nvrm_mthd *m1 = *(const struct nvrm_mthd **)a;
+	const struct nvrm_mthd *m2 = *(const struct nvrm_mthd **)b;
+
+	if (m1->mthd != m2->mthd)
+		return m1->mthd < m2->mthd ? -1 : 1;
+	if (m1 != m2)
+		return m1 < m2 ? -1 : 1;
+	return 0;
+}
+
+void nvrm_mthds_init(void)
+{
+	int k;
+
+	for (k = 0; k < nvrm_mthds_cnt; ++k)
+		nvrm_mthds_sorted[k] = &nvrm_mthds[k];
+	qsort(nvrm_mthds_sorted, nvrm_mthds_cnt, sizeof(nvrm_mthds_sorted[0]), nvrm_mthd_cmp);
+}
+
+struct nvrm_mthd **nvrm_mthd_find(uint32_t mthd, int *cnt)
+{
+	int lo = 0, hi = nvrm_mthds_cnt, end;
+
+	while (lo < hi)
+	{
+		int mid = (lo + hi) / 2;
+		if (nvrm_mthds_sorted[mid]->mthd < mthd)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	for (end = lo; end < nvrm_mthds_cnt && nvrm_mthds_sorted[end]->mthd == mthd; ++end)
+		;
+
+	*cnt = end - lo;
+	return &nvrm_mthds_sorted[lo];
+}
+
 void decode_nvrm_ioctl_call(struct nvrm_ioctl_call *s, struct mmt_memory_dump *args, int argc)
 {
 	nvrm_print_cid(s, cid);
@@ -621,16 +667,17 @@ void decode_nvrm_ioctl_call(struct nvrm_ioctl_call *s, struct mmt_memory_dump *a
 		return;
 	}
 
-	int k, found = 0;
+	int k, cnt, found = 0;
 	void (*fun)(void *) = NULL;
 	void (*fun_with_args)(void *, struct mmt_memory_dump *, int argc) = NULL;
 
-	struct nvrm_mthd *mthd;
-	for (k = 0; k < nvrm_mthds_cnt; ++k)
+	struct nvrm_mthd **mthds = nvrm_mthd_find(s->mthd, &cnt);
+	struct nvrm_mthd *mthd = NULL;
+	for (k = 0; k < cnt; ++k)
 	{
-		mthd = &nvrm_mthds[k];
-		if (mthd->mthd == s->mthd && mthd->argsize == data->len)
+		if (mthds[k]->argsize == data->len)
 		{
+			mthd = mthds[k];
 			if (dump_decoded_ioctl_data && !mthd->disabled)
 			{
 				mmt_log("    %s: ", mthd->name);
@@ -645,8 +692,6 @@ void decode_nvrm_ioctl_call(struct nvrm_ioctl_call *s, struct mmt_memory_dump *a
 			found = 1;
 		}
 	}
-	if (!found)
-		mthd = NULL;
 
 	if (!dump_raw_ioctl_data && dump_decoded_ioctl_data && (mthd == NULL || !mthd->disabled))
 	{
@@ -41,8 +41,8 @@ void decode_gf100_2d_terse(struct gpu_object *, struct pushbuf_decode_state *pst
 void decode_gf100_3d_init(struct gpu_object *);
 void decode_gf100_3d_terse(struct gpu_object *, struct pushbuf_decode_state *pstate);
 void decode_gf100_3d_verbose(struct gpu_object *, struct pushbuf_decode_state *pstate);
-void gf100_3d_disassemble(uint8_t *data, struct region *reg,
-		uint32_t start_id, const struct disisa *isa, struct varinfo *var);
+void gf100_3d_disassemble(struct gpu_mapping *m, uint32_t start_id,
+		const struct disisa *isa, struct varinfo *var);
 void decode_gf100_p_header(int idx, uint32_t *data, struct rnndomain *header_domain);
 
 void decode_gf100_compute_init(struct gpu_object *);
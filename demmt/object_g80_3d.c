@@ -52,46 +52,37 @@ struct gf80_3d_data
 	struct mthd2addr *addresses;
 };
 
-static void __g80_3d_disassemble(uint8_t *data, struct region *reg,
+static void __g80_3d_disassemble(struct gpu_mapping *m,
 		const char *mode, int32_t offset, uint32_t start_id,
 		struct varinfo *var)
 {
 	mmt_debug("%s_start id 0x%08x\n", mode, start_id);
-	for ( ; reg != NULL; reg = reg->next)
-	{
-		if (reg->start != start_id + offset)
-			continue;
+	struct region *reg = gpu_mapping_find_written_region(m, m->address + start_id + offset);
+	if (!reg)
+		return;
 
-		if (MMT_DEBUG)
-		{
-			uint32_t x;
-			mmt_debug("CODE: %s", "");
-			for (x = reg->start; x < reg->end; x += 4)
-				mmt_debug_cont("0x%08x ", *(uint32_t *)(data + x));
-			mmt_debug_cont("%s\n", "");
-		}
+	uint8_t *data = gpu_mapping_get_data(m, m->address + reg->start, reg->end - reg->start);
+	if (!data)
+		return;
 
-		envydis(isa_g80, stdout, data + reg->start, start_id,
-				reg->end - reg->start, var, 0, NULL, 0, colors);
-		break;
+	if (MMT_DEBUG)
+	{
+		uint32_t x;
+		mmt_debug("CODE: %s", "");
+		for (x = 0; x < reg->end - reg->start; x += 4)
+			mmt_debug_cont("0x%08x ", *(uint32_t *)(data + x));
+		mmt_debug_cont("%s\n", "");
 	}
+
+	envydis(isa_g80, out_stdio(), data, start_id,
+			reg->end - reg->start, var, 0, NULL, 0, colors);
 }
 
 void g80_3d_disassemble(struct pushbuf_decode_state *pstate,
 		struct addr_n_buf *anb, const char *mode, uint32_t start_id)
 {
-	uint8_t *data = NULL;
-	struct region *reg;
-	int32_t offset = 0;
-
 	struct gpu_mapping *m = anb->gpu_mapping;
 	if (m)
-	{
-		data = gpu_mapping_get_data(m, m->address, 0);
-		reg = m->object->written_regions.head;
-		offset = anb->address - m->address;
-	}
-	if (data)
 	{
 		if (!isa_g80)
 			isa_g80 = ed_getisa("g80");
@@ -112,7 +103,7 @@ void g80_3d_disassemble(struct pushbuf_decode_state *pstate,
 
 		varinfo_set_mode(var, mode);
 
-		__g80_3d_disassemble(data, reg, mode, offset, start_id, var);
+		__g80_3d_disassemble(m, mode, anb->address - m->address, start_id, var);
 
 		varinfo_del(var);
 	}
@@ -163,45 +163,45 @@ void decode_gf100_3d_terse(struct gpu_object *obj, struct pushbuf_decode_state *
 	{ }
 }
 
-void gf100_3d_disassemble(uint8_t *data, struct region *reg,
-		uint32_t start_id, const struct disisa *isa, struct varinfo *var)
+void gf100_3d_disassemble(struct gpu_mapping *m, uint32_t start_id,
+		const struct disisa *isa, struct varinfo *var)
 {
-	for (; reg != NULL; reg = reg->next)
-	{
-		if (reg->start != start_id)
-			continue;
+	struct region *reg = gpu_mapping_find_written_region(m, m->address + start_id);
+	if (!reg || reg->end - reg->start < 20 * 4)
+		return;
+
+	uint8_t *data = gpu_mapping_get_data(m, m->address + reg->start, reg->end - reg->start);
+	if (!data)
+		return;
+
+	uint32_t x;
+	x = *(uint32_t *)data;
+	int program = (x >> 10) & 0x7;
+	if (!gf100_p_dump(program))
+		return;
+
+	struct rnndomain *header_domain = gf100_p_header_domain(program);
+	gf100_set_kind_variant(program);
+	mmt_printf("HEADER:%s\n", "");
+	if (header_domain)
+		for (x = 0; x < 20; ++x)
+			decode_gf100_p_header(x, (uint32_t *)data, header_domain);
+	else
+		for (x = 0; x < 20 * 4; x += 4)
+			mmt_printf("0x%08x\n", *(uint32_t *)(data + x));
 
+	mmt_printf("CODE:%s\n", "");
+	if (MMT_DEBUG)
+	{
 		uint32_t x;
-		x = *(uint32_t *)(data + reg->start);
-		int program = (x >> 10) & 0x7;
-		if (!gf100_p_dump(program))
-			break;
-
-		struct rnndomain *header_domain = gf100_p_header_domain(program);
-		gf100_set_kind_variant(program);
-		mmt_printf("HEADER:%s\n", "");
-		if (header_domain)
-			for (x = 0; x < 20; ++x)
-				decode_gf100_p_header(x, (uint32_t *)(data + reg->start), header_domain);
-		else
-			for (x = reg->start; x < reg->start + 20 * 4; x += 4)
-				mmt_printf("0x%08x\n", *(uint32_t *)(data + x));
-
-		mmt_printf("CODE:%s\n", "");
-		if (MMT_DEBUG)
-		{
-			uint32_t x;
-			mmt_debug("%s", "");
-			for (x = reg->start + 20 * 4; x < reg->end; x += 4)
-				mmt_debug_cont("0x%08x ", *(uint32_t *)(data + x));
-			mmt_debug_cont("%s\n", "");
-		}
-
-		envydis(isa, stdout, data + reg->start + 20 * 4, 0,
-				reg->end - reg->start - 20 * 4, var, 0, NULL, 0, colors);
-
-		break;
+		mmt_debug("%s", "");
+		for (x = 20 * 4; x < reg->end - reg->start; x += 4)
+			mmt_debug_cont("0x%08x ", *(uint32_t *)(data + x));
+		mmt_debug_cont("%s\n", "");
 	}
+
+	envydis(isa, out_stdio(), data + 20 * 4, 0,
+			reg->end - reg->start - 20 * 4, var, 0, NULL, 0, colors);
 }
 
 void decode_gf100_3d_verbose(struct gpu_object *obj, struct pushbuf_decode_state *pstate)
@@ -233,15 +233,10 @@ void decode_gf100_3d_verbose(struct gpu_object *obj, struct pushbuf_decode_state
 			mmt_debug("start id[%d]: 0x%08x\n", i, data);
 			if (objdata->code.gpu_mapping)
 			{
-				uint64_t addr = objdata->code.address;
 				struct gpu_mapping *m = objdata->code.gpu_mapping;
-				uint8_t *code = gpu_mapping_get_data(m, addr, 0);
-				if (addr != m->address)
-					code = NULL;// FIXME
-
-				if (code)
-					gf100_3d_disassemble(code, m->object->written_regions.head,
-							data, isa_gf100, var);
+				// FIXME
+				if (objdata->code.address == m->address)
+					gf100_3d_disassemble(m, data, isa_gf100, var);
 			}
 
 			break;
@@ -119,7 +119,6 @@ void decode_gf100_compute_verbose(struct gpu_object *obj, struct pushbuf_decode_
 		var = varinfo_new(isa_gf100->vardata);
 		varinfo_set_variant(var, "gf100");
 
-		uint8_t *code = NULL;
 		uint64_t code_addr = objdata->code.address;
 		uint32_t start_id = data;
 		struct gpu_mapping *m = objdata->code.gpu_mapping;
@@ -133,25 +132,18 @@ void decode_gf100_compute_verbose(struct gpu_object *obj, struct pushbuf_decode_
 		{
 			code_addr = m->address;
 			start_id -= m->address - objdata->code.address;
-			code = gpu_mapping_get_data(m, code_addr, 0);
-
-			if (code_addr != m->address)
-				code = NULL; // FIXME
 		}
 
 		mmt_printf("CODE:%s\n", "");
-		if (code)
+		struct region *reg = NULL;
+		if (m)
+			reg = gpu_mapping_find_written_region(m, code_addr + start_id);
+		if (reg)
 		{
-			struct region *reg;
-			for (reg = m->object->written_regions.head; reg != NULL; reg = reg->next)
-			{
-				if (reg->start != start_id + code_addr - m->address)
-					continue;
-
-				envydis(isa_gf100, stdout, code + reg->start, 0,
+			uint8_t *code = gpu_mapping_get_data(m, m->address + reg->start, reg->end - reg->start);
+			if (code)
+				envydis(isa_gf100, out_stdio(), code, 0,
 						reg->end - reg->start, var, 0, NULL, 0, colors);
-				break;
-			}
 		}
 
 		if (var)
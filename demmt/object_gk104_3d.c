@@ -248,15 +248,10 @@ void decode_gk104_3d_verbose(struct gpu_object *obj, struct pushbuf_decode_state
 			mmt_debug("start id[%d]: 0x%08x\n", i, data);
 			if (objdata->code.gpu_mapping)
 			{
-				uint64_t addr = objdata->code.address;
 				struct gpu_mapping *m = objdata->code.gpu_mapping;
-				uint8_t *code = gpu_mapping_get_data(m, addr, 0);
-				if (addr != m->address)
-					code = NULL;// FIXME
-
-				if (code)
-					gf100_3d_disassemble(code, m->object->written_regions.head,
-							data, isa, var);
+				// FIXME
+				if (objdata->code.address == m->address)
+					gf100_3d_disassemble(m, data, isa, var);
 			}
 
 			break;
@@ -152,9 +152,8 @@ void decode_gk104_compute_verbose(struct gpu_object *obj, struct pushbuf_decode_
 				varinfo_set_variant(var, "gk104");
 			}
 
-			struct region *reg;
+			struct region *reg = NULL;
 
-			uint8_t *code = NULL;
 			uint64_t code_addr = objdata->code.address;
 			uint32_t *header = gpu_mapping_get_data(objdata->launch_desc.gpu_mapping, objdata->launch_desc.address, 0x100);
 			uint32_t start_id = header[8];
@@ -168,13 +167,9 @@ void decode_gk104_compute_verbose(struct gpu_object *obj, struct pushbuf_decode_
 				code_addr = m->address;
 				start_id -= m->address - objdata->code.address;
 			}
-			if (m)
-			{
-				code = gpu_mapping_get_data(m, code_addr, 0);
-
-				if (code_addr != m->address)
-					code = NULL;// FIXME
-			}
+			// FIXME
+			if (m && code_addr == m->address)
+				reg = gpu_mapping_find_written_region(m, code_addr + start_id);
 
 			mmt_printf("HEADER:%s\n", "");
 			int x;
@@ -182,16 +177,13 @@ void decode_gk104_compute_verbose(struct gpu_object *obj, struct pushbuf_decode_
 				decode_gf100_p_header(x, header, gk104_cp_header_domain);
 
 			mmt_printf("CODE:%s\n", "");
-			if (code)
-				for (reg = m->object->written_regions.head; reg != NULL; reg = reg->next)
-				{
-					if (reg->start != start_id + code_addr - m->address)
-						continue;
-
-					envydis(isa, stdout, code + reg->start, 0,
+			if (reg)
+			{
+				uint8_t *code = gpu_mapping_get_data(m, m->address + reg->start, reg->end - reg->start);
+				if (code)
+					envydis(isa, out_stdio(), code, 0,
 							reg->end - reg->start, var, 0, NULL, 0, colors);
-					break;
-				}
+			}
 
 			if (var)
 				varinfo_del(var);
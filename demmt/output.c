@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2026 The envytools authors.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "output.h"
+
+char out_buf[OUT_BUF_SIZE];
+size_t out_len;
+int mmt_muted;
+
+void out_flush(void)
+{
+	size_t done = 0;
+
+	/* whatever went through stdio was printed before our buffer */
+	fflush(stdout);
+
+	while (done < out_len)
+	{
+		ssize_t r = write(1, out_buf + done, out_len - done);
+		if (r > 0)
+			done += r;
+		else if (r < 0 && errno != EINTR)
+			break;
+	}
+	out_len = 0;
+}
+
+static FILE *out_null;
+
+void out_open_null(void)
+{
+	if (!out_null)
+		out_null = fopen("/dev/null", "w");
+}
+
+FILE *out_stdio(void)
+{
+	if (mmt_muted && out_null)
+		return out_null;
+
+	out_flush();
+	return stdout;
+}
+
+void out_write(const void *data, size_t len)
+{
+	if (mmt_muted)
+		return;
+
+	while (len > OUT_BUF_SIZE - out_len)
+	{
+		size_t part = OUT_BUF_SIZE - out_len;
+		memcpy(out_buf + out_len, data, part);
+		out_len += part;
+		data = (const char *)data + part;
+		len -= part;
+		out_flush();
+	}
+
+	memcpy(out_buf + out_len, data, len);
+	out_len += len;
+}
+
+void out_vprintf(const char *fmt, va_list ap)
+{
+	va_list ap2;
+	int len;
+
+	if (mmt_muted)
+		return;
+
+	va_copy(ap2, ap);
+	len = vsnprintf(out_buf + out_len, OUT_BUF_SIZE - out_len, fmt, ap2);
+	va_end(ap2);
+	if (len < 0)
+		return;
+
+	if ((size_t)len < OUT_BUF_SIZE - out_len)
+	{
+		out_len += len;
+		return;
+	}
+
+	out_flush();
+	if (len < OUT_BUF_SIZE)
+	{
+		out_len = vsnprintf(out_buf, OUT_BUF_SIZE, fmt, ap);
+		return;
+	}
+
+	char *tmp = malloc(len + 1);
+	vsnprintf(tmp, len + 1, fmt, ap);
+	out_write(tmp, len);
+	free(tmp);
+}
+
+void out_printf(const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	out_vprintf(fmt, ap);
+	va_end(ap);
+}
+
+void out_hex(uint64_t val, int digits)
+{
+	static const char hex[] = "0123456789abcdef";
+	char tmp[16];
+	int i = 16;
+
+	do
+	{
+		tmp[--i] = hex[val & 0xf];
+		val >>= 4;
+	}
+	while (val);
+
+	while (16 - i < digits && i > 0)
+		tmp[--i] = '0';
+
+	out_write(tmp + i, 16 - i);
+}
+
+void out_dec(int64_t val)
+{
+	char tmp[20];
+	int i = 20;
+	uint64_t v = val < 0 ? -(uint64_t)val : (uint64_t)val;
+
+	do
+	{
+		tmp[--i] = '0' + v % 10;
+		v /= 10;
+	}
+	while (v);
+
+	if (val < 0)
+		tmp[--i] = '-';
+
+	out_write(tmp + i, 20 - i);
+}
+
+void out_spaces(int cnt)
+{
+	static const char spaces[] = "                                                                ";
+
+	while (cnt > 0)
+	{
+		int part = cnt < (int)sizeof(spaces) - 1 ? cnt : (int)sizeof(spaces) - 1;
+		out_write(spaces, part);
+		cnt -= part;
+	}
+}
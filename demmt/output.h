@@ -0,0 +1,50 @@
+#ifndef DEMMT_OUTPUT_H
+#define DEMMT_OUTPUT_H
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Buffered writer for everything demmt prints. Output is collected in one
+ * big buffer and written to fd 1 when it fills up, on sync markers, on exit
+ * and on abort.
+ */
+
+#define OUT_BUF_SIZE (1 << 20)
+
+extern char out_buf[OUT_BUF_SIZE];
+extern size_t out_len;
+/* set while processing records owned by another partition worker */
+extern int mmt_muted;
+
+void out_flush(void);
+/* flushes buffered output and returns stdout for code which needs a FILE */
+FILE *out_stdio(void);
+/* makes out_stdio return /dev/null while muted, must be called before sandboxing */
+void out_open_null(void);
+
+void out_write(const void *data, size_t len);
+void out_printf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+void out_vprintf(const char *fmt, va_list ap);
+/* lowercase hex, zero-padded to at least "digits" digits */
+void out_hex(uint64_t val, int digits);
+void out_dec(int64_t val);
+void out_spaces(int cnt);
+
+static inline void out_char(char c)
+{
+	if (mmt_muted)
+		return;
+	if (out_len == OUT_BUF_SIZE)
+		out_flush();
+	out_buf[out_len++] = c;
+}
+
+static inline void out_str(const char *str)
+{
+	out_write(str, strlen(str));
+}
+
+#endif
@@ -0,0 +1,306 @@
+/*
+ * Copyright (C) 2026 The envytools authors.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "pagemap.h"
+
+struct pagemap_page
+{
+	/* position on the list of pages which were never read */
+	struct pagemap_page *prev;
+	struct pagemap_page *next;
+
+	struct pagemap_page **slot;
+	int read;
+
+	uint8_t data[PAGEMAP_PAGE_SIZE];
+};
+
+uint64_t pagemap_limit = 0;
+uint64_t pagemap_resident = 0;
+uint64_t pagemap_resident_peak = 0;
+uint64_t pagemap_evicted = 0;
+
+/* most recently written pages are at the head */
+static struct pagemap_page *lru_head = NULL;
+static struct pagemap_page *lru_tail = NULL;
+
+static uint8_t zero_page[PAGEMAP_PAGE_SIZE];
+
+/*
+ * Spans crossing page boundary are linearized into one of these buffers.
+ * Returned pointer stays valid until SCRATCH_CNT more such spans are requested.
+ */
+#define SCRATCH_CNT 8
+static struct
+{
+	uint8_t *data;
+	uint64_t size;
+}
+scratch[SCRATCH_CNT];
+static int scratch_idx = 0;
+
+static void lru_unlink(struct pagemap_page *p)
+{
+	if (p->prev)
+		p->prev->next = p->next;
+	else
+		lru_head = p->next;
+
+	if (p->next)
+		p->next->prev = p->prev;
+	else
+		lru_tail = p->prev;
+
+	p->prev = p->next = NULL;
+}
+
+static void lru_push(struct pagemap_page *p)
+{
+	p->prev = NULL;
+	p->next = lru_head;
+	if (lru_head)
+		lru_head->prev = p;
+	else
+		lru_tail = p;
+	lru_head = p;
+}
+
+static void free_page(struct pagemap_page *p)
+{
+	if (!p->read)
+		lru_unlink(p);
+	*p->slot = NULL;
+	pagemap_resident -= PAGEMAP_PAGE_SIZE;
+	free(p);
+}
+
+static void evict_pages(void)
+{
+	while (pagemap_limit && lru_tail &&
+			pagemap_resident + PAGEMAP_PAGE_SIZE > pagemap_limit)
+	{
+		free_page(lru_tail);
+		pagemap_evicted++;
+	}
+}
+
+static struct pagemap_page **page_slot(struct pagemap *pm, uint64_t pgidx, int alloc)
+{
+	uint64_t dir = pgidx >> PAGEMAP_DIR_SHIFT;
+	if (dir >= pm->dirs_cnt)
+		return NULL;
+
+	if (!pm->dirs[dir])
+	{
+		if (!alloc)
+			return NULL;
+		pm->dirs[dir] = calloc(PAGEMAP_DIR_SIZE, sizeof(pm->dirs[dir][0]));
+	}
+
+	return &pm->dirs[dir][pgidx & (PAGEMAP_DIR_SIZE - 1)];
+}
+
+static struct pagemap_page *find_page(struct pagemap *pm, uint64_t pgidx)
+{
+	struct pagemap_page **slot = page_slot(pm, pgidx, 0);
+	return slot ? *slot : NULL;
+}
+
+struct pagemap *pagemap_new(uint64_t length)
+{
+	struct pagemap *pm = calloc(1, sizeof(*pm));
+	pagemap_resize(pm, length);
+	return pm;
+}
+
+void pagemap_free(struct pagemap *pm)
+{
+	pagemap_resize(pm, 0);
+	free(pm->dirs);
+	pm->dirs = NULL;
+}
+
+void pagemap_del(struct pagemap *pm)
+{
+	if (!pm)
+		return;
+	pagemap_free(pm);
+	free(pm);
+}
+
+void pagemap_resize(struct pagemap *pm, uint64_t length)
+{
+	uint64_t pages = (length + PAGEMAP_PAGE_SIZE - 1) >> PAGEMAP_PAGE_SHIFT;
+	uint64_t dirs_cnt = (pages + PAGEMAP_DIR_SIZE - 1) >> PAGEMAP_DIR_SHIFT;
+	uint64_t i, j;
+
+	if (length < pm->length)
+	{
+		/* clear the tail of the last page, so growing back shows zeroes */
+		struct pagemap_page *p = find_page(pm, length >> PAGEMAP_PAGE_SHIFT);
+		if (p && (length & (PAGEMAP_PAGE_SIZE - 1)))
+			memset(p->data + (length & (PAGEMAP_PAGE_SIZE - 1)), 0,
+					PAGEMAP_PAGE_SIZE - (length & (PAGEMAP_PAGE_SIZE - 1)));
+
+		for (i = pages >> PAGEMAP_DIR_SHIFT; i < pm->dirs_cnt; ++i)
+		{
+			if (!pm->dirs[i])
+				continue;
+
+			for (j = 0; j < PAGEMAP_DIR_SIZE; ++j)
+				if (pm->dirs[i][j] && (i << PAGEMAP_DIR_SHIFT) + j >= pages)
+					free_page(pm->dirs[i][j]);
+
+			if (i >= dirs_cnt)
+			{
+				free(pm->dirs[i]);
+				pm->dirs[i] = NULL;
+			}
+		}
+	}
+
+	if (dirs_cnt > pm->dirs_cnt)
+	{
+		pm->dirs = realloc(pm->dirs, dirs_cnt * sizeof(pm->dirs[0]));
+		memset(pm->dirs + pm->dirs_cnt, 0, (dirs_cnt - pm->dirs_cnt) * sizeof(pm->dirs[0]));
+		pm->dirs_cnt = dirs_cnt;
+	}
+	else if (length < pm->length)
+		pm->dirs_cnt = dirs_cnt;
+
+	pm->length = length;
+}
+
+void pagemap_write(struct pagemap *pm, uint64_t offset, const void *data, uint64_t len)
+{
+	const uint8_t *src = data;
+
+	while (len)
+	{
+		uint64_t pgoff = offset & (PAGEMAP_PAGE_SIZE - 1);
+		uint64_t chunk = PAGEMAP_PAGE_SIZE - pgoff;
+		if (chunk > len)
+			chunk = len;
+
+		struct pagemap_page **slot = page_slot(pm, offset >> PAGEMAP_PAGE_SHIFT, 1);
+		struct pagemap_page *p = *slot;
+		if (!p)
+		{
+			evict_pages();
+
+			p = malloc(sizeof(*p));
+			if (chunk != PAGEMAP_PAGE_SIZE)
+				memset(p->data, 0, PAGEMAP_PAGE_SIZE);
+			p->slot = slot;
+			p->read = 0;
+			lru_push(p);
+			*slot = p;
+
+			pagemap_resident += PAGEMAP_PAGE_SIZE;
+			if (pagemap_resident > pagemap_resident_peak)
+				pagemap_resident_peak = pagemap_resident;
+		}
+		else if (!p->read && p != lru_head)
+		{
+			lru_unlink(p);
+			lru_push(p);
+		}
+
+		memcpy(p->data + pgoff, src, chunk);
+
+		src += chunk;
+		offset += chunk;
+		len -= chunk;
+	}
+}
+
+static void copy_out(struct pagemap *pm, uint64_t offset, uint8_t *dst, uint64_t len, int mark)
+{
+	while (len)
+	{
+		uint64_t pgoff = offset & (PAGEMAP_PAGE_SIZE - 1);
+		uint64_t chunk = PAGEMAP_PAGE_SIZE - pgoff;
+		if (chunk > len)
+			chunk = len;
+
+		struct pagemap_page *p = find_page(pm, offset >> PAGEMAP_PAGE_SHIFT);
+		if (p)
+		{
+			if (mark && !p->read)
+			{
+				lru_unlink(p);
+				p->read = 1;
+			}
+			memcpy(dst, p->data + pgoff, chunk);
+		}
+		else
+			memset(dst, 0, chunk);
+
+		dst += chunk;
+		offset += chunk;
+		len -= chunk;
+	}
+}
+
+void pagemap_peek(struct pagemap *pm, uint64_t offset, void *dst, uint64_t len)
+{
+	copy_out(pm, offset, dst, len, 0);
+}
+
+void *pagemap_get(struct pagemap *pm, uint64_t offset, uint64_t len)
+{
+	if (offset + len > pm->length)
+		return NULL;
+
+	uint64_t pgidx = offset >> PAGEMAP_PAGE_SHIFT;
+	uint64_t pgoff = offset & (PAGEMAP_PAGE_SIZE - 1);
+
+	if (pgoff + len <= PAGEMAP_PAGE_SIZE)
+	{
+		struct pagemap_page *p = find_page(pm, pgidx);
+		if (!p)
+			return zero_page + pgoff;
+
+		if (!p->read)
+		{
+			lru_unlink(p);
+			p->read = 1;
+		}
+		return p->data + pgoff;
+	}
+
+	scratch_idx = (scratch_idx + 1) % SCRATCH_CNT;
+	if (scratch[scratch_idx].size < len)
+	{
+		free(scratch[scratch_idx].data);
+		scratch[scratch_idx].data = malloc(len);
+		scratch[scratch_idx].size = len;
+	}
+
+	copy_out(pm, offset, scratch[scratch_idx].data, len, 1);
+
+	return scratch[scratch_idx].data;
+}
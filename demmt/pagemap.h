@@ -0,0 +1,40 @@
+#ifndef DEMMT_PAGEMAP_H
+#define DEMMT_PAGEMAP_H
+
+#include <stdint.h>
+
+/*
+ * Sparse storage for buffer contents. Pages are allocated on first write,
+ * reads of never written pages see zeroes.
+ */
+
+#define PAGEMAP_PAGE_SHIFT 12
+#define PAGEMAP_PAGE_SIZE (1 << PAGEMAP_PAGE_SHIFT)
+#define PAGEMAP_DIR_SHIFT 9
+#define PAGEMAP_DIR_SIZE (1 << PAGEMAP_DIR_SHIFT)
+
+struct pagemap_page;
+
+struct pagemap
+{
+	uint64_t length;
+	struct pagemap_page ***dirs;
+	uint64_t dirs_cnt;
+};
+
+struct pagemap *pagemap_new(uint64_t length);
+void pagemap_del(struct pagemap *pm);
+void pagemap_free(struct pagemap *pm);
+void pagemap_resize(struct pagemap *pm, uint64_t length);
+
+void pagemap_write(struct pagemap *pm, uint64_t offset, const void *data, uint64_t len);
+void pagemap_peek(struct pagemap *pm, uint64_t offset, void *dst, uint64_t len);
+void *pagemap_get(struct pagemap *pm, uint64_t offset, uint64_t len);
+
+/* limit (in bytes) of resident page data, 0 means no limit */
+extern uint64_t pagemap_limit;
+extern uint64_t pagemap_resident;
+extern uint64_t pagemap_resident_peak;
+extern uint64_t pagemap_evicted;
+
+#endif
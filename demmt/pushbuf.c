@@ -234,7 +234,7 @@ void decode_method_raw(int mthd, uint32_t data, struct obj *obj, char *dec_obj,
 {
 	/* get an object name */
 	if (obj && obj->desc)
-		sprintf(dec_obj, "%s%s%s", colors->rname, obj->desc, colors->reset);
+		strcpy(stpcpy(stpcpy(dec_obj, colors->rname), obj->desc), colors->reset);
 	else
 		sprintf(dec_obj, "%sOBJ%X%s", colors->err, obj ? obj->class : 0, colors->reset);
 
@@ -294,7 +294,11 @@ static void decode_method(struct pushbuf_decode_state *state, char *output)
 	if (state->mthd == 0)
 		sprintf(output, "  %s mapped to subchannel %d", dec_obj, state->subchan);
 	else
-		sprintf(output, "  %s.%s = %s", dec_obj, dec_mthd, dec_val);
+	{
+		char *out = stpcpy(stpcpy(output, "  "), dec_obj);
+		out = stpcpy(stpcpy(out, "."), dec_mthd);
+		strcpy(stpcpy(out, " = "), dec_val);
+	}
 }
 
 /* returns 0 when decoding should continue, anything else: next command gpu address */
@@ -577,7 +581,12 @@ static uint64_t __pushbuf_print(struct pushbuf_decode_state *pstate, uint32_t *c
 			return nextaddr;
 		}
 		if (decode_pb)
-			mmt_printf("PB: 0x%08x %s", cmd, cmdoutput);
+		{
+			out_str("PB: 0x");
+			out_hex(cmd, 8);
+			out_char(' ');
+			out_str(cmdoutput);
+		}
 
 		struct obj *obj = current_subchan_object(pstate);
 
@@ -599,7 +608,7 @@ static uint64_t __pushbuf_print(struct pushbuf_decode_state *pstate, uint32_t *c
 		}
 
 		if (decode_pb)
-			mmt_printf("%s\n", "");
+			mmt_log_cont_nl();
 
 		if (pstate->mthd_data_available && obj && obj->decoder && obj->decoder->decode_verbose)
 			obj->decoder->decode_verbose(obj->gpu_object, pstate);
@@ -622,12 +631,10 @@ static void ib_flush(struct ib_decode_state *state)
 	struct gpu_mapping *m = state->gpu_mapping;
 	if (m)
 	{
-		uint8_t *data = &m->object->data[m->object_offset];
-
-		uint64_t cur = state->address - m->address;
-		uint64_t end = cur + state->size * 4;
+		uint32_t *data = gpu_mapping_get_data(m, state->address, state->size * 4);
 
-		__pushbuf_print(&state->pstate, (uint32_t *)&data[cur], (uint32_t *)&data[end], state->address, state->size);
+		if (data)
+			__pushbuf_print(&state->pstate, data, data + state->size, state->address, state->size);
 
 		state->gpu_mapping = NULL;
 	}
@@ -25,53 +25,85 @@
 #include "easm.h"
 #include <stdlib.h>
 
-struct easm_expr *easm_expr_bin(enum easm_expr_type type, struct easm_expr *e1, struct easm_expr *e2) {
-	struct easm_expr *res = calloc(sizeof *res, 1);
+static struct easm_expr *new_expr(struct arena *arena, enum easm_expr_type type) {
+	struct easm_expr *res;
+	if (arena) {
+		res = arena_alloc(arena, sizeof *res);
+		res->inarena = 1;
+	} else {
+		res = calloc(sizeof *res, 1);
+	}
 	res->type = type;
+	return res;
+}
+
+struct easm_expr *easm_arena_expr_bin(struct arena *arena, enum easm_expr_type type, struct easm_expr *e1, struct easm_expr *e2) {
+	struct easm_expr *res = new_expr(arena, type);
 	res->e1 = e1;
 	res->e2 = e2;
 	return res;
 }
 
-struct easm_expr *easm_expr_un(enum easm_expr_type type, struct easm_expr *e1) {
-	struct easm_expr *res = calloc(sizeof *res, 1);
-	res->type = type;
+struct easm_expr *easm_arena_expr_un(struct arena *arena, enum easm_expr_type type, struct easm_expr *e1) {
+	struct easm_expr *res = new_expr(arena, type);
 	res->e1 = e1;
 	return res;
 }
 
-struct easm_expr *easm_expr_num(enum easm_expr_type type, uint64_t num) {
-	struct easm_expr *res = calloc(sizeof *res, 1);
-	res->type = type;
+struct easm_expr *easm_arena_expr_num(struct arena *arena, enum easm_expr_type type, uint64_t num) {
+	struct easm_expr *res = new_expr(arena, type);
 	res->num = num;
 	return res;
 }
 
-struct easm_expr *easm_expr_str(enum easm_expr_type type, char *str) {
-	struct easm_expr *res = calloc(sizeof *res, 1);
-	res->type = type;
+struct easm_expr *easm_arena_expr_str(struct arena *arena, enum easm_expr_type type, char *str) {
+	struct easm_expr *res = new_expr(arena, type);
 	res->str = str;
 	return res;
 }
 
-struct easm_expr *easm_expr_astr(struct astr astr) {
-	struct easm_expr *res = calloc(sizeof *res, 1);
-	res->type = EASM_EXPR_STR;
+struct easm_expr *easm_arena_expr_astr(struct arena *arena, struct astr astr) {
+	struct easm_expr *res = new_expr(arena, EASM_EXPR_STR);
 	res->astr = astr;
 	return res;
 }
 
-struct easm_expr *easm_expr_sinsn(struct easm_sinsn *sinsn) {
-	struct easm_expr *res = calloc(sizeof *res, 1);
-	res->type = EASM_EXPR_SINSN;
+struct easm_expr *easm_arena_expr_sinsn(struct arena *arena, struct easm_sinsn *sinsn) {
+	struct easm_expr *res = new_expr(arena, EASM_EXPR_SINSN);
 	res->sinsn = sinsn;
 	return res;
 }
 
+struct easm_expr *easm_arena_expr_simple(struct arena *arena, enum easm_expr_type type) {
+	return new_expr(arena, type);
+}
+
+struct easm_expr *easm_expr_bin(enum easm_expr_type type, struct easm_expr *e1, struct easm_expr *e2) {
+	return easm_arena_expr_bin(0, type, e1, e2);
+}
+
+struct easm_expr *easm_expr_un(enum easm_expr_type type, struct easm_expr *e1) {
+	return easm_arena_expr_un(0, type, e1);
+}
+
+struct easm_expr *easm_expr_num(enum easm_expr_type type, uint64_t num) {
+	return easm_arena_expr_num(0, type, num);
+}
+
+struct easm_expr *easm_expr_str(enum easm_expr_type type, char *str) {
+	return easm_arena_expr_str(0, type, str);
+}
+
+struct easm_expr *easm_expr_astr(struct astr astr) {
+	return easm_arena_expr_astr(0, astr);
+}
+
+struct easm_expr *easm_expr_sinsn(struct easm_sinsn *sinsn) {
+	return easm_arena_expr_sinsn(0, sinsn);
+}
+
 struct easm_expr *easm_expr_simple(enum easm_expr_type type) {
-	struct easm_expr *res = calloc(sizeof *res, 1);
-	res->type = type;
-	return res;
+	return easm_arena_expr_simple(0, type);
 }
 
 void easm_del_mod(struct easm_mod *mod) {
@@ -101,7 +133,7 @@ void easm_del_operand(struct easm_operand *operand) {
 }
 
 void easm_del_expr(struct easm_expr *expr) {
-	if (!expr) return;
+	if (!expr || expr->inarena) return;
 	int i;
 	for (i = 0; i < expr->swizzlesnum; i++)
 		free(expr->swizzles[i].str);
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2026 The envytools authors.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * What the envydis and envyas benchmarks have in common: random numbers,
+ * timing, the ISAs they go over, and isa:file arguments.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "dis-intern.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+static uint32_t seed = 1;
+
+static inline uint32_t rnd(void) {
+	seed = seed * 1103515245 + 12345;
+	return seed >> 8;
+}
+
+static inline double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static const char *const isas[] = {
+	"g80", "gf100", "gk110", "gm107", "ctx", "falcon", "hwsq", "xtensa", "vuc", "macro", "vp1", "vcomp",
+};
+
+/* the first variant with a known code byte size, if it needs one */
+static inline struct varinfo *pick_variant(const struct disisa *isa) {
+	struct varinfo *var = varinfo_new(isa->vardata);
+	int i;
+	for (i = 0; i < isa->vardata->variantsnum && !ed_getcbsz(isa, var); i++) {
+		varinfo_del(var);
+		var = varinfo_new(isa->vardata);
+		varinfo_set_variant(var, isa->vardata->variants[i].name);
+	}
+	return var;
+}
+
+/* an isa:file argument, read whole, with the variant pick_variant picks */
+struct bench_file {
+	char *isaname;
+	const char *name;
+	const struct disisa *isa;
+	struct varinfo *var;
+	uint8_t *data;
+	long len;
+};
+
+/* exits if the argument is bad or the file can't be read */
+static inline void bench_file_read(struct bench_file *bf, const char *arg) {
+	char *file;
+	FILE *f;
+	bf->isaname = strdup(arg);
+	if (!(file = strchr(bf->isaname, ':')) || !(bf->isa = ed_getisa((*file = 0, bf->isaname)))) {
+		fprintf(stderr, "%s: expected isa:file\n", arg);
+		exit(1);
+	}
+	bf->name = ++file;
+	if (!(f = fopen(file, "rb")) || fseek(f, 0, SEEK_END) || (bf->len = ftell(f)) < 0) {
+		perror(file);
+		exit(1);
+	}
+	rewind(f);
+	bf->data = malloc(bf->len + 1);
+	bf->len = fread(bf->data, 1, bf->len, f);
+	fclose(f);
+	bf->var = pick_variant(bf->isa);
+}
+
+static inline void bench_file_free(struct bench_file *bf) {
+	varinfo_del(bf->var);
+	free(bf->data);
+	free(bf->isaname);
+}
+
+/*
+ * The disassembler and the assembler complain on stderr about all sorts of
+ * garbage. quiet_stderr sends it to /dev/null until restore_stderr gets
+ * what it returned.
+ */
+static inline int quiet_stderr(void) {
+	int err = dup(2), null = open("/dev/null", O_WRONLY);
+	fflush(stderr);
+	dup2(null, 2);
+	close(null);
+	return err;
+}
+
+static inline void restore_stderr(int err) {
+	fflush(stderr);
+	dup2(err, 2);
+	close(err);
+}
+
+#endif
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2026 The envytools authors.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/*
+ * Assembling throughput of each ISA, matching instructions against every
+ * table entry (ed_linear_as) and through the table index, which have to
+ * find the same matches. The source for each ISA is generated by
+ * disassembling random code, keeping what decoded cleanly. Real sources
+ * can be added as isa:file arguments.
+ *
+ * Usage: envyas_bench [-s size] [-r rounds] [isa:file...]
+ */
+
+#include "envyas.h"
+#include "bench.h"
+
+static int parses(char *line, size_t len) {
+	FILE *f = fmemopen(line, len, "r");
+	struct easm_file *file;
+	int r = easm_read_file(f, "line", &file);
+	fclose(f);
+	if (!r)
+		easm_del_file(file);
+	return !r;
+}
+
+/*
+ * A line for each instruction of random code that decodes without
+ * complaints. Some of what the disassembler prints doesn't parse, that's
+ * quietly left out.
+ */
+static char *gen_source(const struct disisa *isa, struct varinfo *var, int size, size_t *len) {
+	int stride = ed_getcstride(isa, var), num = size / stride, i, err;
+	uint8_t *code = malloc(num * stride);
+	const struct ed_item *item;
+	struct ed_dis *dis;
+	char *buf, *line;
+	size_t linelen;
+	FILE *out = open_memstream(&buf, len);
+	for (i = 0; i < num * stride; i++)
+		code[i] = rnd();
+	err = quiet_stderr();
+	dis = ed_dis_new(isa, var, code, 0, num, 0, 0);
+	while ((item = ed_dis_next(dis))) {
+		FILE *lf;
+		if (item->type != ED_ITEM_INSN || item->status)
+			continue;
+		lf = open_memstream(&line, &linelen);
+		ed_print_item(lf, isa, var, item, 2, &envy_null_colors);
+		fclose(lf);
+		if (parses(line, linelen))
+			fwrite(line, 1, linelen, out);
+		free(line);
+	}
+	ed_dis_del(dis);
+	restore_stderr(err);
+	fclose(out);
+	free(code);
+	return buf;
+}
+
+static int same_expr(const struct easm_expr *a, const struct easm_expr *b) {
+	if (!a || !b)
+		return a == b;
+	return a->type == b->type && a->num == b->num && a->special == b->special &&
+		(a->str == b->str || (a->str && b->str && !strcmp(a->str, b->str))) &&
+		same_expr(a->e1, b->e1) && same_expr(a->e2, b->e2);
+}
+
+static int same_matches(const struct matches *a, const struct matches *b) {
+	int i, j;
+	if (a->mnum != b->mnum)
+		return 0;
+	for (i = 0; i < a->mnum; i++) {
+		const struct match *x = &a->m[i], *y = &b->m[i];
+		if (x->oplen != y->oplen || x->lpos != y->lpos || x->nrelocs != y->nrelocs)
+			return 0;
+		for (j = 0; j < MAXOPLEN; j++)
+			if (x->a[j] != y->a[j] || x->m[j] != y->m[j])
+				return 0;
+		/* the expressions may be made up anew by each match */
+		for (j = 0; j < x->nrelocs; j++)
+			if (x->relocs[j].bf != y->relocs[j].bf || !same_expr(x->relocs[j].expr, y->relocs[j].expr))
+				return 0;
+	}
+	return 1;
+}
+
+static void free_matches(struct matches *m) {
+	free(m->m);
+	free(m);
+}
+
+static int bench(const char *name, const char *kind, const struct disisa *isa, struct varinfo *var,
+		char *src, size_t len, int rounds) {
+	struct easm_file *file;
+	struct matches **res[2];
+	double t[2];
+	int insns = 0, matched = 0, r, mode, i, bad = 0;
+	FILE *f = fmemopen(src, len, "r");
+	if (easm_read_file(f, kind, &file)) {
+		fclose(f);
+		return 1;
+	}
+	fclose(f);
+	for (mode = 0; mode < 2; mode++) {
+		res[mode] = calloc(file->linesnum, sizeof *res[mode]);
+		ed_linear_as = !mode;
+		t[mode] = now();
+		for (r = 0; r < rounds; r++) {
+			for (i = 0; i < file->linesnum; i++) {
+				if (file->lines[i]->type != EASM_LINE_INSN)
+					continue;
+				if (res[mode][i])
+					free_matches(res[mode][i]);
+				res[mode][i] = do_as(isa, var, file->lines[i]->insn);
+			}
+		}
+		t[mode] = now() - t[mode];
+	}
+	ed_linear_as = 0;
+	for (i = 0; i < file->linesnum; i++) {
+		if (file->lines[i]->type != EASM_LINE_INSN)
+			continue;
+		insns++;
+		if (res[0][i]->mnum)
+			matched++;
+		if (!same_matches(res[0][i], res[1][i]) && !bad++)
+			fprintf(stderr, "%s %s: indexed matches differ at line %d\n", name, kind, i + 1);
+		free_matches(res[0][i]);
+		free_matches(res[1][i]);
+	}
+	printf("%-7s %-10s %7d insns %7d matched %9.0f insns/s linear %9.0f insns/s indexed %6.2fx\n", name, kind,
+			insns, matched, insns * rounds / t[0], insns * rounds / t[1], t[0] / t[1]);
+	fflush(stdout);
+	free(res[0]);
+	free(res[1]);
+	easm_del_file(file);
+	return bad != 0;
+}
+
+int main(int argc, char **argv) {
+	int size = 0x10000, rounds = 1, c, i, res = 0;
+	while ((c = getopt(argc, argv, "s:r:")) != -1)
+		switch (c) {
+			case 's':
+				size = strtol(optarg, NULL, 0);
+				break;
+			case 'r':
+				rounds = strtol(optarg, NULL, 0);
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-s size] [-r rounds] [isa:file...]\n", argv[0]);
+				return 1;
+		}
+	for (i = 0; i < ARRAY_SIZE(isas); i++) {
+		const struct disisa *isa = ed_getisa(isas[i]);
+		struct varinfo *var = pick_variant(isa);
+		size_t len;
+		char *src = gen_source(isa, var, size, &len);
+		res |= bench(isas[i], "generated", isa, var, src, len, rounds);
+		free(src);
+		varinfo_del(var);
+	}
+	for (i = optind; i < argc; i++) {
+		struct bench_file bf;
+		bench_file_read(&bf, argv[i]);
+		res |= bench(bf.isaname, bf.name, bf.isa, bf.var, (char *)bf.data, bf.len, rounds);
+		bench_file_free(&bf);
+	}
+	return res;
+}
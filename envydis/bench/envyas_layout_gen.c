@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2026 The envytools authors.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Writes a large branch-heavy source for envyas, to time the layout: lots
+ * of labels, with branches and calls to nearby ones and now and then to far
+ * ones. For falcon, whether a branch fits in its short form depends on
+ * the size of everything in between. For g80, short and long instructions
+ * are mixed, so that long ones keep ending up misaligned and the short
+ * ones before them have to be made long. Both take envyas many passes.
+ *
+ * Usage: envyas_layout_gen [-m falcon|g80] [-n insns] [-s seed] > src.s
+ *        envyas -m falcon -V fuc3 src.s, envyas -m g80 src.s
+ */
+
+#include "bench.h"
+
+/* mostly close by, sometimes further, rarely anywhere */
+static long target(long cur, long labels) {
+	uint32_t r = rnd() % 100;
+	long t;
+	if (r < 70)
+		t = cur + (long)(rnd() % 33) - 16;
+	else if (r < 95)
+		t = cur + (long)(rnd() % 1025) - 512;
+	else
+		t = rnd() % labels;
+	if (t < 0)
+		t = 0;
+	if (t >= labels)
+		t = labels - 1;
+	return t;
+}
+
+static void falcon_insn(long cur, long labels) {
+	static const char *const conds[] = { "", "e ", "ne ", "$p1 ", "not $p2 " };
+	int r = rnd() % 10, a = rnd() % 16, b = rnd() % 16, c = rnd() % 16;
+	switch (r) {
+		case 0:
+		case 1:
+		case 2:
+			printf("bra %s#l%ld\n", conds[rnd() % 5], target(cur, labels));
+			break;
+		case 3:
+			printf("call #l%ld\n", target(cur, labels));
+			break;
+		case 4:
+			printf("add b32 $r%d $r%d $r%d\n", a, b, c);
+			break;
+		case 5:
+			printf("mov $r%d 0x%x\n", a, rnd() % 0x100 + 1);
+			break;
+		case 6:
+			printf("mov $r%d 0x%x\n", a, rnd() % 0x7000 + 0x100);
+			break;
+		case 7:
+			printf("ld b32 $r%d D[$r%d + 0x%x]\n", a, b, (rnd() % 0x40) * 4);
+			break;
+		case 8:
+			printf("cmpu b32 $r%d 0x%x\n", a, rnd() % 0x80);
+			break;
+		default:
+			printf("shl b32 $r%d 0x%x\n", a, rnd() % 32);
+			break;
+	}
+}
+
+static void g80_insn(long cur, long labels) {
+	static const char *const conds[] = { "", "(e $c0) ", "(lg $c1) " };
+	int r = rnd() % 12, a = rnd() % 32, b = rnd() % 32, c = rnd() % 32;
+	switch (r) {
+		case 0:
+		case 1:
+			printf("%sbra #l%ld\n", conds[rnd() % 3], target(cur, labels));
+			break;
+		case 2:
+			printf("call #l%ld\n", target(cur, labels));
+			break;
+		case 3:
+			printf("joinat #l%ld\n", target(cur, labels));
+			break;
+		/* short */
+		case 4:
+		case 5:
+			printf("mov b32 $r%d $r%d\n", a, b);
+			break;
+		case 6:
+		case 7:
+			printf("add b32 $r%d $r%d $r%d\n", a, b, c);
+			break;
+		case 8:
+			printf("mul $r%d u16 $r%dl u16 $r%dl\n", a, b, c);
+			break;
+		/* long */
+		case 9:
+			printf("add b32 $r%d $r%d 0x%x\n", a, b, rnd() % 0x10000);
+			break;
+		case 10:
+			printf("shl b32 $r%d $r%d 0x%x\n", a, b, rnd() % 32);
+			break;
+		default:
+			printf("and b32 $r%d $r%d $r%d\n", a, b, c);
+			break;
+	}
+}
+
+int main(int argc, char **argv) {
+	long n = 100000, i, labels, cur = 0;
+	const char *isa = "falcon";
+	void (*insn)(long, long);
+	int c;
+
+	while ((c = getopt(argc, argv, "m:n:s:")) != -1)
+		switch (c) {
+			case 'm':
+				isa = optarg;
+				break;
+			case 'n':
+				n = strtol(optarg, NULL, 0);
+				break;
+			case 's':
+				seed = strtoul(optarg, NULL, 0);
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-m falcon|g80] [-n insns] [-s seed]\n", argv[0]);
+				return 1;
+		}
+
+	if (!strcmp(isa, "falcon")) {
+		insn = falcon_insn;
+	} else if (!strcmp(isa, "g80")) {
+		insn = g80_insn;
+	} else {
+		fprintf(stderr, "unknown ISA %s\n", isa);
+		return 1;
+	}
+
+	/* a label every 4 instructions on average */
+	labels = n / 4 + 1;
+	printf("l0:\n");
+	for (i = 0; i < n; i++) {
+		if (cur + 1 < labels && rnd() % 4 == 0)
+			printf("l%ld:\n", ++cur);
+		insn(cur, labels);
+	}
+	while (++cur < labels)
+		printf("l%ld:\n", cur);
+	return 0;
+}
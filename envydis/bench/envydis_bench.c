@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2026 The envytools authors.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/*
+ * Disassembly throughput of each ISA, decoding through the compiled
+ * dispatch trees and by walking the tables (ed_linear_dispatch), which
+ * have to produce the same output. Each ISA gets a blob of random bytes
+ * and, for fixed-length ISAs, a blob of random instructions that decode to
+ * something known, which goes deeper in the tables. Real code can be added
+ * as isa:file arguments (binary, like envydis -i).
+ *
+ * Usage: envydis_bench [-s size] [-r rounds] [isa:file...]
+ */
+
+#include "bench.h"
+
+static char *dis(const struct disisa *isa, struct varinfo *var, uint8_t *code, int num, size_t *len) {
+	char *buf;
+	FILE *out = open_memstream(&buf, len);
+	envydis(isa, out, code, 0, num, var, 0, 0, 0, &envy_null_colors);
+	fclose(out);
+	return buf;
+}
+
+/* replaces instructions that don't decode with new random ones, a few times over */
+static void make_decodable(const struct disisa *isa, struct varinfo *var, uint8_t *code, int num) {
+	int stride = ed_getcstride(isa, var), round;
+	for (round = 0; round < 16; round++) {
+		size_t len;
+		char *buf = dis(isa, var, code, num, &len), *line, *save;
+		for (line = strtok_r(buf, "\n", &save); line; line = strtok_r(0, "\n", &save)) {
+			unsigned pos;
+			int i;
+			if (sscanf(line, "%x:", &pos) != 1 || (!strstr(line, "???") && !strstr(line, "[unknown")))
+				continue;
+			for (i = 0; i < isa->opunit * stride && pos * stride + i < num * stride; i++)
+				code[pos * stride + i] = rnd();
+		}
+		free(buf);
+	}
+}
+
+static int bench(const char *name, const char *kind, const struct disisa *isa, struct varinfo *var,
+		uint8_t *code, int num, int rounds) {
+	size_t len[2];
+	char *out[2] = { 0, 0 };
+	double t[2];
+	int lines = 0, r, mode;
+	for (mode = 0; mode < 2; mode++) {
+		ed_linear_dispatch = !mode;
+		t[mode] = now();
+		for (r = 0; r < rounds; r++) {
+			free(out[mode]);
+			out[mode] = dis(isa, var, code, num, &len[mode]);
+		}
+		t[mode] = now() - t[mode];
+	}
+	ed_linear_dispatch = 0;
+	for (r = 0; r < len[0]; r++)
+		if (out[0][r] == '\n')
+			lines++;
+	printf("%-7s %-10s %8d insns %10.0f insns/s linear %10.0f insns/s compiled %6.2fx\n", name, kind,
+			lines, lines * rounds / t[0], lines * rounds / t[1], t[0] / t[1]);
+	r = len[0] != len[1] || memcmp(out[0], out[1], len[0]);
+	if (r)
+		fprintf(stderr, "%s %s: compiled dispatch output differs\n", name, kind);
+	free(out[0]);
+	free(out[1]);
+	return r;
+}
+
+int main(int argc, char **argv) {
+	int size = 0x40000, rounds = 3, c, i, res = 0;
+	while ((c = getopt(argc, argv, "s:r:")) != -1)
+		switch (c) {
+			case 's':
+				size = strtol(optarg, NULL, 0);
+				break;
+			case 'r':
+				rounds = strtol(optarg, NULL, 0);
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-s size] [-r rounds] [isa:file...]\n", argv[0]);
+				return 1;
+		}
+	for (i = 0; i < ARRAY_SIZE(isas); i++) {
+		const struct disisa *isa = ed_getisa(isas[i]);
+		struct varinfo *var = pick_variant(isa);
+		int stride = ed_getcstride(isa, var), num = size / stride, j;
+		uint8_t *code = malloc(num * stride);
+		for (j = 0; j < num * stride; j++)
+			code[j] = rnd();
+		res |= bench(isas[i], "random", isa, var, code, num, rounds);
+		if (isa->opunit == isa->maxoplen) {
+			make_decodable(isa, var, code, num);
+			res |= bench(isas[i], "decodable", isa, var, code, num, rounds);
+		}
+		free(code);
+		varinfo_del(var);
+	}
+	for (i = optind; i < argc; i++) {
+		struct bench_file bf;
+		bench_file_read(&bf, argv[i]);
+		res |= bench(bf.isaname, bf.name, bf.isa, bf.var, bf.data, bf.len / ed_getcstride(bf.isa, bf.var), rounds);
+		bench_file_free(&bf);
+	}
+	return res;
+}
@@ -0,0 +1,396 @@
+/*
+ * Copyright (C) 2026 The envytools authors.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Round trip through the disassembler and the assembler, for each ISA and
+ * each of its variants: every instruction that decodes cleanly is printed,
+ * parsed back, matched with do_as and encoded at the same address. It's
+ * exact if some match gives back the same bits, equivalent if the first
+ * match (the one envyas would take) decodes to the same text, and bad
+ * otherwise. Printed text that doesn't parse or that nothing matches is
+ * counted separately. The code is random bytes, then the instructions that
+ * decoded cleanly with a bit flipped in each, then any isa:file arguments
+ * (binary, like envydis -i, with the first usable variant). Decoding and
+ * matching are timed on the way. The random bytes are seeded from the ISA
+ * and variant name, so each variant sees the same code whatever else runs.
+ *
+ * Usage: envydis_roundtrip [-s size] [-v] [-b] [isa:file...]
+ *
+ * Exits with 1 if anything came back bad, or, at the baseline size, if
+ * there's more unparsed or unmatched text than the baseline below allows.
+ * -b prints the counts of this run as baseline entries instead.
+ */
+
+#include "envyas.h"
+#include "bench.h"
+
+static int verbose, dump;
+
+/*
+ * Unparsed and unmatched counts at BASELINE_SIZE, the size the roundtrip
+ * test runs at - some ISAs still print text envyas can't read back, and
+ * those may only get better. Entries not listed are 0, so any unmatched
+ * text in an ISA that has none is a failure. The counts don't scale with
+ * the size (bigger runs find gaps this one misses, e.g. in gm107 and
+ * macro), so other sizes aren't checked against them. After fixing some,
+ * regenerate with -s 0x1000 -b.
+ */
+#define BASELINE_SIZE 0x1000
+
+static const struct baseline {
+	const char *isa, *variant, *kind;
+	int unparsed, unmatched;
+} baselines[] = {
+	{ "g80", "g80", "random", 0, 2 },
+	{ "g80", "g80", "mutated", 0, 1 },
+	{ "g80", "g84", "random", 0, 1 },
+	{ "g80", "g200", "random", 0, 3 },
+	{ "g80", "g200", "mutated", 0, 2 },
+	{ "g80", "mcp77", "random", 0, 3 },
+	{ "g80", "mcp77", "mutated", 0, 3 },
+	{ "g80", "gt215", "random", 0, 2 },
+	{ "g80", "gt215", "mutated", 0, 1 },
+	{ "gf100", "gk104", "random", 0, 1 },
+	{ "gk110", "-", "random", 0, 1 },
+	{ "falcon", "fuc0", "random", 1, 0 },
+	{ "falcon", "fuc3", "mutated", 1, 0 },
+	{ "falcon", "fuc5", "random", 1, 0 },
+	{ "falcon", "fuc6", "random", 1, 0 },
+	{ "xtensa", "-", "random", 539, 14 },
+	{ "xtensa", "-", "mutated", 471, 12 },
+	{ "vuc", "vp2", "random", 158, 0 },
+	{ "vuc", "vp2", "mutated", 144, 0 },
+	{ "vp1", "-", "random", 0, 24 },
+	{ "vp1", "-", "mutated", 0, 15 },
+};
+
+static const struct baseline *find_baseline(const char *isa, const char *variant, const char *kind) {
+	int i;
+	for (i = 0; i < ARRAY_SIZE(baselines); i++)
+		if (!strcmp(baselines[i].isa, isa) && !strcmp(baselines[i].variant, variant) && !strcmp(baselines[i].kind, kind))
+			return &baselines[i];
+	return 0;
+}
+
+
+struct rt {
+	const struct ed_item *item;
+	char *text;
+	struct easm_file *file;
+	struct matches *m;
+};
+
+struct stats {
+	int clean, exact, equiv, bad, unparsed, unmatched;
+	double tdis, tas;
+	int disnum, asnum;
+};
+
+static char *print_insn(const struct disisa *isa, struct varinfo *var, const struct ed_item *item) {
+	char *text;
+	size_t len;
+	FILE *out = open_memstream(&text, &len);
+	ed_print_item(out, isa, var, item, 2, &envy_null_colors);
+	fclose(out);
+	return text;
+}
+
+/* the relocations can only be numbers here, there are no labels */
+static int calc(struct easm_expr *expr, void *arg, ull *res) {
+	ull a, b = 0;
+	if (expr->type == EASM_EXPR_NUM) {
+		*res = expr->num;
+		return 1;
+	}
+	if (!expr->e1 || !calc(expr->e1, arg, &a) || (expr->e2 && !calc(expr->e2, arg, &b)))
+		return 0;
+	switch (expr->type) {
+		case EASM_EXPR_NEG: *res = -a; return 1;
+		case EASM_EXPR_NOT: *res = ~a; return 1;
+		case EASM_EXPR_ADD: *res = a + b; return 1;
+		case EASM_EXPR_SUB: *res = a - b; return 1;
+		case EASM_EXPR_MUL: *res = a * b; return 1;
+		case EASM_EXPR_SHL: *res = a << b; return 1;
+		case EASM_EXPR_SHR: *res = a >> b; return 1;
+		case EASM_EXPR_AND: *res = a & b; return 1;
+		case EASM_EXPR_OR: *res = a | b; return 1;
+		case EASM_EXPR_XOR: *res = a ^ b; return 1;
+		default: return 0;
+	}
+}
+
+static void tobytes(const ull *val, int bytes, uint8_t *out) {
+	int j;
+	for (j = 0; j < bytes; j++)
+		out[j] = val[j >> 3] >> (8 * (j & 7));
+}
+
+static void report(const char *what, const struct rt *r, const char *text2) {
+	int j;
+	fprintf(stderr, "  %s at %#x: %s", what, r->item->pos, r->text);
+	if (text2) {
+		fprintf(stderr, "    from");
+		for (j = 0; j < r->item->len; j++)
+			fprintf(stderr, " %02x", r->item->code[j]);
+		fprintf(stderr, "\n    back %s", text2);
+	}
+}
+
+static void check(const struct disisa *isa, struct varinfo *var, struct rt *r, struct stats *st) {
+	int stride = ed_getcstride(isa, var), bytes = r->item->len * stride, i, first = -1;
+	uint8_t buf[MAXOPLEN * 8];
+	ull val[MAXOPLEN];
+	const struct ed_item *item;
+	struct ed_dis *dis;
+	char *text2;
+	for (i = 0; i < r->m->mnum; i++) {
+		if (!reloc_as(&r->m->m[i], r->item->pos, calc, 0, val))
+			continue;
+		if (first < 0)
+			first = i;
+		tobytes(val, bytes, buf);
+		if (r->m->m[i].oplen * stride == bytes && !memcmp(buf, r->item->code, bytes)) {
+			st->exact++;
+			return;
+		}
+	}
+	if (first < 0) {
+		st->unmatched++;
+		if (verbose)
+			report("unmatched", r, 0);
+		return;
+	}
+	reloc_as(&r->m->m[first], r->item->pos, calc, 0, val);
+	bytes = r->m->m[first].oplen * stride;
+	tobytes(val, bytes, buf);
+	dis = ed_dis_new(isa, var, buf, r->item->pos, r->m->m[first].oplen, 0, 0);
+	item = ed_dis_next(dis);
+	text2 = item && item->type == ED_ITEM_INSN && !item->status ? print_insn(isa, var, item) : strdup("(not clean)\n");
+	if (!strcmp(text2, r->text)) {
+		st->equiv++;
+	} else {
+		st->bad++;
+		if (verbose)
+			report("bad", r, text2);
+	}
+	free(text2);
+	ed_dis_del(dis);
+}
+
+static void roundtrip(const struct disisa *isa, struct varinfo *var, uint8_t *code, int num, struct stats *st) {
+	const struct ed_item *item;
+	struct ed_dis *dis;
+	struct rt *rts = 0;
+	int rtsnum = 0, rtsmax = 0, i, err;
+	double t;
+
+	err = quiet_stderr();
+	t = now();
+	dis = ed_dis_new(isa, var, code, 0, num, 0, 0);
+	while ((item = ed_dis_next(dis)))
+		st->disnum += item->type == ED_ITEM_INSN;
+	st->tdis += now() - t;
+	ed_dis_del(dis);
+
+	dis = ed_dis_new(isa, var, code, 0, num, 0, 0);
+	while ((item = ed_dis_next(dis))) {
+		struct rt r = { 0 };
+		FILE *f;
+		if (item->type != ED_ITEM_INSN || item->status)
+			continue;
+		st->clean++;
+		/* items get overwritten, keep a copy */
+		r.item = memcpy(malloc(sizeof *item), item, sizeof *item);
+		r.text = print_insn(isa, var, item);
+		f = fmemopen(r.text, strlen(r.text), "r");
+		if (easm_read_file(f, "roundtrip", &r.file)) {
+			r.file = 0;
+		} else if (r.file->linesnum != 1 || r.file->lines[0]->type != EASM_LINE_INSN) {
+			easm_del_file(r.file);
+			r.file = 0;
+		}
+		if (!r.file) {
+			st->unparsed++;
+			if (verbose) {
+				restore_stderr(err);
+				report("unparsed", &r, 0);
+				err = quiet_stderr();
+			}
+			fclose(f);
+			free((void *)r.item);
+			free(r.text);
+			continue;
+		}
+		fclose(f);
+		ADDARRAY(rts, r);
+	}
+
+	t = now();
+	for (i = 0; i < rtsnum; i++)
+		rts[i].m = do_as(isa, var, rts[i].file->lines[0]->insn);
+	st->tas += now() - t;
+	st->asnum += rtsnum;
+
+	restore_stderr(err);
+	for (i = 0; i < rtsnum; i++) {
+		check(isa, var, &rts[i], st);
+		free(rts[i].m->m);
+		free(rts[i].m);
+		easm_del_file(rts[i].file);
+		free((void *)rts[i].item);
+		free(rts[i].text);
+	}
+	ed_dis_del(dis);
+	free(rts);
+}
+
+/* what decoded cleanly, one bit flipped in each instruction */
+static uint8_t *mutate(const struct disisa *isa, struct varinfo *var, uint8_t *code, int num, int *mnum) {
+	int stride = ed_getcstride(isa, var), err;
+	uint8_t *res = malloc(num * stride);
+	const struct ed_item *item;
+	struct ed_dis *dis;
+	*mnum = 0;
+	err = quiet_stderr();
+	dis = ed_dis_new(isa, var, code, 0, num, 0, 0);
+	while ((item = ed_dis_next(dis))) {
+		uint8_t *op = res + *mnum * stride;
+		int bits = item->len * stride * 8, bit;
+		if (item->type != ED_ITEM_INSN || item->status)
+			continue;
+		memcpy(op, item->code, item->len * stride);
+		bit = rnd() % bits;
+		op[bit >> 3] ^= 1 << (bit & 7);
+		*mnum += item->len;
+	}
+	ed_dis_del(dis);
+	restore_stderr(err);
+	return res;
+}
+
+/* checks the counts against the baseline too if they're from BASELINE_SIZE */
+static int print_stats(const char *isa, const char *variant, const char *kind, const struct stats *st, int size) {
+	const struct baseline *bl = find_baseline(isa, variant, kind);
+	int res = st->bad != 0;
+	if (dump) {
+		if (st->unparsed || st->unmatched)
+			printf("\t{ \"%s\", \"%s\", \"%s\", %d, %d },\n", isa, variant, kind, st->unparsed, st->unmatched);
+		return res;
+	}
+	printf("%-7s %-10s %-9s %6d clean %6d exact %6d equiv %5d bad %5d unparsed %5d unmatched %9.0f dis/s %9.0f as/s\n",
+			isa, variant, kind, st->clean, st->exact, st->equiv, st->bad, st->unparsed, st->unmatched,
+			st->disnum / st->tdis, st->asnum / st->tas);
+	fflush(stdout);
+	if (size == BASELINE_SIZE && (st->unparsed > (bl ? bl->unparsed : 0) || st->unmatched > (bl ? bl->unmatched : 0))) {
+		fprintf(stderr, "%s %s %s: %d unparsed %d unmatched, baseline is %d and %d\n", isa, variant, kind,
+				st->unparsed, st->unmatched, bl ? bl->unparsed : 0, bl ? bl->unmatched : 0);
+		res = 1;
+	}
+	return res;
+}
+
+/* FNV-1a of the ISA and variant names */
+static uint32_t name_seed(const char *isa, const char *variant) {
+	uint32_t h = 2166136261u;
+	for (; *isa; isa++)
+		h = (h ^ (uint8_t)*isa) * 16777619;
+	h = (h ^ ':') * 16777619;
+	for (; *variant; variant++)
+		h = (h ^ (uint8_t)*variant) * 16777619;
+	return h;
+}
+
+static int run_variant(const char *name, const struct disisa *isa, const char *variant, int size) {
+	struct varinfo *var = varinfo_new(isa->vardata);
+	struct stats st;
+	uint8_t *code, *mcode;
+	int stride, num, mnum, i, res = 0;
+	if (variant)
+		varinfo_set_variant(var, variant);
+	else
+		variant = "-";
+	if (!ed_getcbsz(isa, var)) {
+		/* needs a feature to know its code unit size */
+		varinfo_del(var);
+		return 0;
+	}
+	stride = ed_getcstride(isa, var);
+	num = size / stride;
+	seed = name_seed(name, variant);
+	code = malloc(num * stride);
+	for (i = 0; i < num * stride; i++)
+		code[i] = rnd();
+	memset(&st, 0, sizeof st);
+	roundtrip(isa, var, code, num, &st);
+	res |= print_stats(name, variant, "random", &st, size);
+	mcode = mutate(isa, var, code, num, &mnum);
+	memset(&st, 0, sizeof st);
+	roundtrip(isa, var, mcode, mnum, &st);
+	res |= print_stats(name, variant, "mutated", &st, size);
+	free(mcode);
+	free(code);
+	varinfo_del(var);
+	return res;
+}
+
+static int run_file(const char *arg) {
+	struct bench_file bf;
+	struct stats st;
+	int res;
+	bench_file_read(&bf, arg);
+	memset(&st, 0, sizeof st);
+	roundtrip(bf.isa, bf.var, bf.data, bf.len / ed_getcstride(bf.isa, bf.var), &st);
+	res = print_stats(bf.isaname, "-", bf.name, &st, 0);
+	bench_file_free(&bf);
+	return res;
+}
+
+int main(int argc, char **argv) {
+	int size = 0x4000, c, i, j, res = 0;
+	while ((c = getopt(argc, argv, "s:vb")) != -1)
+		switch (c) {
+			case 's':
+				size = strtol(optarg, NULL, 0);
+				break;
+			case 'v':
+				verbose = 1;
+				break;
+			case 'b':
+				dump = 1;
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-s size] [-v] [-b] [isa:file...]\n", argv[0]);
+				return 1;
+		}
+	for (i = 0; i < ARRAY_SIZE(isas); i++) {
+		const struct disisa *isa = ed_getisa(isas[i]);
+		if (!isa->vardata->variantsnum)
+			res |= run_variant(isas[i], isa, 0, size);
+		for (j = 0; j < isa->vardata->variantsnum; j++)
+			res |= run_variant(isas[i], isa, isa->vardata->variants[j].name, size);
+	}
+	for (i = optind; i < argc; i++)
+		res |= run_file(argv[i]);
+	return res;
+}
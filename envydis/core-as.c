@@ -32,6 +32,7 @@ struct iasctx {
 	struct litem **atoms;
 	int atomsnum;
 	int atomsmax;
+	struct ed_asindex *index;
 };
 
 struct matches *emptymatches() {
@@ -48,6 +49,13 @@ struct matches *alwaysmatches(int lpos) {
 
 struct matches *catmatches(struct matches *a, struct matches *b) {
 	int i;
+	if (!a->mnum) {
+		/* nothing to append to, just take b's array */
+		free(a->m);
+		*a = *b;
+		free(b);
+		return a;
+	}
 	for (i = 0; i < b->mnum; i++)
 		ADDARRAY(a->m, b->m[i]);
 	free(b->m);
@@ -55,9 +63,9 @@ struct matches *catmatches(struct matches *a, struct matches *b) {
 	return a;
 }
 
+/* keeps the matches of b that agree with a, merged with it, in place */
 struct matches *mergematches(struct match a, struct matches *b) {
-	struct matches *res = emptymatches();
-	int i, j;
+	int i, j, k = 0;
 	for (i = 0; i < b->mnum; i++) {
 		for (j = 0; j < MAXOPLEN; j++) {
 			ull cmask = a.m[j] & b->m[i].m[j];
@@ -77,12 +85,11 @@ struct matches *mergematches(struct match a, struct matches *b) {
 			for (j = 0; j < a.nrelocs; j++)
 				nm.relocs[nm.nrelocs + j] = a.relocs[j];
 			nm.nrelocs += a.nrelocs;
-			ADDARRAY(res->m, nm);
+			b->m[k++] = nm;
 		}
 	}
-	free(b->m);
-	free(b);
-	return res;
+	b->mnum = k;
+	return b;
 }
 
 static inline ull bf_(int s, int l, ull *a, ull *m) {
@@ -211,6 +218,32 @@ static int setrbf (struct match *res, const struct rbitfield *bf, struct easm_ex
 	return (getrbf_as(bf, res->a, res->m, 0) & mask) == (expr->num & mask);
 }
 
+int reloc_as(const struct match *match, ull pos, int (*calc)(struct easm_expr *expr, void *arg, ull *res), void *arg, ull *val) {
+	struct match m = *match;
+	int i;
+	for (i = 0; i < m.nrelocs; i++) {
+		const struct rbitfield *bf = m.relocs[i].bf;
+		ull v, num, mask = ~0ull;
+		ull totalsz = bf->shr + bf->sbf[0].len + bf->sbf[1].len;
+		if (!calc(m.relocs[i].expr, arg, &v))
+			return 0;
+		num = v - bf->addend;
+		if (bf->pcrel)
+			num -= (pos + bf->pospreadd) & -(1ull << bf->shr);
+		num >>= bf->shr;
+		setsbf(&m, bf->sbf[0].pos, bf->sbf[0].len, num);
+		num >>= bf->sbf[0].len;
+		setsbf(&m, bf->sbf[1].pos, bf->sbf[1].len, num);
+		if (bf->wrapok && totalsz < 64)
+			mask = (1ull << totalsz) - 1;
+		if ((getrbf_as(bf, m.a, m.m, pos) & mask) != (v & mask))
+			return 0;
+	}
+	for (i = 0; i < MAXOPLEN; i++)
+		val[i] = m.a[i];
+	return 1;
+}
+
 static int setbf (struct match *res, const struct bitfield *bf, ull num) {
 	ull onum = num;
 	num = (num - bf->addend) ^ bf->xorend;
@@ -257,17 +290,28 @@ struct matches *tabdesc (struct iasctx *ctx, struct match m, const struct atom *
 	return res;
 }
 
+static void tabent_a(struct iasctx *ctx, const struct insn *e, int spos, struct matches *res) {
+	if (var_ok(e->fmask, e->ptype, ctx->varinfo)) {
+		struct match sm = { 0, .a = {e->val}, .m = {e->mask}, .lpos = spos };
+		struct matches *subm = tabdesc(ctx, sm, e->atoms);
+		if (subm)
+			catmatches(res, subm);
+	}
+}
+
 struct matches *atomtab_a APROTO {
 	const struct insn *tab = v;
 	struct matches *res = emptymatches();
 	int i;
+	if (ctx->index) {
+		int num;
+		const int *ents = ed_asindex_ents(ctx->index, tab, ctx->atoms, ctx->atomsnum, spos, &num);
+		for (i = 0; i < num; i++)
+			tabent_a(ctx, &tab[ents[i]], spos, res);
+		return res;
+	}
 	for (i = 0; ; i++) {
-		if (var_ok(tab[i].fmask, tab[i].ptype, ctx->varinfo)) {
-			struct match sm = { 0, .a = {tab[i].val}, .m = {tab[i].mask}, .lpos = spos };
-			struct matches *subm = tabdesc(ctx, sm, tab[i].atoms);
-			if (subm)
-				res = catmatches(res, subm);
-		}
+		tabent_a(ctx, &tab[i], spos, res);
 		if (!tab[i].mask && !tab[i].fmask && !tab[i].ptype) break;
 	}
 	return res;
@@ -506,10 +550,12 @@ struct matches *atommem_a APROTO {
 	if (!ismem && mem->name)
 		return 0;
 	if (ismem) {
-		if (strncmp(expr->str, mem->name, strlen(mem->name)))
+		/* a memory reference without a space name has no str */
+		const char *name = expr->str ? expr->str : "";
+		if (strncmp(name, mem->name, strlen(mem->name)))
 			return 0;
 		if (mem->idx) {
-			const char *str = expr->str + strlen(mem->name);
+			const char *str = name + strlen(mem->name);
 			if (!*str)
 				return 0;
 			char *end;
@@ -519,7 +565,7 @@ struct matches *atommem_a APROTO {
 			if (!setbf(&res, mem->idx, num))
 				return 0;
 		} else {
-			if (strlen(expr->str) != strlen(mem->name))
+			if (strlen(name) != strlen(mem->name))
 				return 0;
 		}
 		if (expr->type == EASM_EXPR_MEMPP)
@@ -740,6 +786,8 @@ struct matches *do_as(const struct disisa *isa, struct varinfo *varinfo, struct
 	struct matches *res = calloc(sizeof *res, 1);
 	struct iasctx c = { isa, varinfo };
 	struct iasctx *ctx = &c;
+	if (!ed_linear_as)
+		ctx->index = ed_get_asindex(isa);
 	convert_insn(ctx, insn);
 	const struct insn *root = isa->trootas ? isa->trootas : isa->troot;
 	struct matches *m = atomtab_a(ctx, root, 0);
@@ -748,5 +796,7 @@ struct matches *do_as(const struct disisa *isa, struct varinfo *varinfo, struct
 		if (m->m[i].lpos == ctx->atomsnum) {
 			ADDARRAY(res->m, m->m[i]);
 		}
+	free(m->m);
+	free(m);
 	return res;
 }
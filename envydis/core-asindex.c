@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) 2026 The envytools authors.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/*
+ * Assembling matches an instruction against the tables by trying every
+ * entry of every table it gets to, which is slow for big tables, when all
+ * but a few of the entries start with a different mnemonic.
+ *
+ * So for each table, what its entries can start with is worked out once:
+ * a given name (N), an expression (C and the operand atoms), the start or
+ * end of a sub-instruction. Entries that can match without taking anything
+ * (empty, or starting with a table that can), or start with something not
+ * known here, can start with anything. Then matching at a position only
+ * tries the entries that can start with what's there, in table order, so
+ * the matches come out just like they did from trying them all.
+ */
+
+#include "dis-intern.h"
+
+int ed_linear_as;
+
+enum {
+	AF_EXPR = 1,
+	AF_SESTART = 2,
+	AF_SEEND = 4,
+	AF_EMPTY = 8,	/* can match without taking anything */
+	AF_ANY = 0x10,	/* can't tell */
+};
+
+/* what an entry or table can start with */
+struct ed_afirst {
+	int flags;
+	const char **names;
+	int namesnum;
+	int namesmax;
+};
+
+struct ed_alist {
+	int *ents;
+	int entsnum;
+	int entsmax;
+};
+
+struct ed_aname {
+	const char *name;
+	struct ed_alist list;
+};
+
+struct ed_atab {
+	/* the first set isn't known while the table is being indexed */
+	int busy;
+	struct ed_afirst first;
+	/* entries to try, by what's at the position */
+	struct ed_aname *names;
+	int namessize;
+	struct ed_alist expr;
+	struct ed_alist sestart;
+	struct ed_alist seend;
+	/* a name that no entry starts with, or the end */
+	struct ed_alist other;
+};
+
+struct ed_amap {
+	const struct insn *tab;
+	struct ed_atab *atab;
+};
+
+struct ed_asindex {
+	struct ed_amap *map;
+	size_t mapsize;
+	size_t mapused;
+};
+
+static struct ed_amap *map_slot(struct ed_asindex *x, const struct insn *tab) {
+	size_t i = ((uintptr_t)tab >> 4) * 0x9e3779b97f4a7c15ull >> 20 & (x->mapsize - 1);
+	while (x->map[i].tab && x->map[i].tab != tab)
+		i = (i + 1) & (x->mapsize - 1);
+	return &x->map[i];
+}
+
+static void map_add(struct ed_asindex *x, const struct insn *tab, struct ed_atab *atab) {
+	struct ed_amap *slot;
+	if (x->mapused * 2 >= x->mapsize) {
+		struct ed_amap *old = x->map;
+		size_t oldsize = x->mapsize, i;
+		x->mapsize = oldsize ? oldsize * 2 : 256;
+		x->map = calloc(x->mapsize, sizeof *x->map);
+		for (i = 0; i < oldsize; i++)
+			if (old[i].tab)
+				*map_slot(x, old[i].tab) = old[i];
+		free(old);
+	}
+	slot = map_slot(x, tab);
+	slot->tab = tab;
+	slot->atab = atab;
+	x->mapused++;
+}
+
+static struct ed_aname *name_slot(const struct ed_atab *t, const char *name) {
+	int i = elf_hash(name) & (t->namessize - 1);
+	while (t->names[i].name && strcmp(t->names[i].name, name))
+		i = (i + 1) & (t->namessize - 1);
+	return &t->names[i];
+}
+
+static void add_first(struct ed_afirst *f, int flags, const char *const *names, int namesnum) {
+	int i;
+	f->flags |= flags;
+	for (i = 0; i < namesnum; i++)
+		ADDARRAY(f->names, names[i]);
+}
+
+static struct ed_atab *get_atab(struct ed_asindex *x, const struct insn *tab);
+
+static void entry_first(struct ed_asindex *x, const struct insn *e, struct ed_afirst *f) {
+	int i;
+	for (i = 0; i < ARRAY_SIZE(e->atoms) && e->atoms[i].fun_as; i++) {
+		afun fun = e->atoms[i].fun_as;
+		const char *name = e->atoms[i].arg;
+		int flags;
+		if (fun == atomtab_a) {
+			struct ed_atab *sub = get_atab(x, e->atoms[i].arg);
+			if (sub->busy) {
+				f->flags |= AF_ANY;
+				return;
+			}
+			flags = sub->first.flags;
+			add_first(f, flags & ~AF_EMPTY, sub->first.names, sub->first.namesnum);
+		} else if (fun == atomname_a) {
+			flags = 0;
+			add_first(f, 0, &name, 1);
+		} else if (fun == atomopl_a || fun == atomnop_a) {
+			flags = AF_EMPTY;
+		} else if (fun == atomunk_a) {
+			/* never matches */
+			return;
+		} else if (fun == atomsestart_a) {
+			flags = AF_SESTART;
+		} else if (fun == atomseend_a) {
+			flags = AF_SEEND;
+		} else if (fun == atomcmd_a || fun == atomimm_a || fun == atomrimm_a || fun == atomreg_a ||
+				fun == atommem_a || fun == atomvec_a || fun == atombf_a || fun == atomdiscard_a) {
+			flags = AF_EXPR;
+		} else {
+			flags = AF_ANY;
+		}
+		f->flags |= flags & ~AF_EMPTY;
+		if (!(flags & AF_EMPTY))
+			return;
+	}
+	f->flags |= AF_EMPTY;
+}
+
+static void add_ent(struct ed_alist *l, int i) {
+	if (!l->entsnum || l->ents[l->entsnum - 1] != i)
+		ADDARRAY(l->ents, i);
+}
+
+static struct ed_atab *get_atab(struct ed_asindex *x, const struct insn *tab) {
+	struct ed_afirst *firsts;
+	struct ed_atab *t;
+	int n, i, j, k;
+	if (x->mapsize && map_slot(x, tab)->tab)
+		return map_slot(x, tab)->atab;
+	t = calloc(sizeof *t, 1);
+	t->busy = 1;
+	map_add(x, tab, t);
+	for (n = 0; tab[n].mask || tab[n].fmask || tab[n].ptype; n++);
+	n++;
+	firsts = calloc(n, sizeof *firsts);
+	for (i = 0; i < n; i++) {
+		entry_first(x, &tab[i], &firsts[i]);
+		add_first(&t->first, firsts[i].flags, firsts[i].names, firsts[i].namesnum);
+	}
+	/* the names, each once */
+	for (t->namessize = 16; t->namessize < t->first.namesnum * 2; t->namessize *= 2);
+	t->names = calloc(t->namessize, sizeof *t->names);
+	for (i = j = 0; i < t->first.namesnum; i++) {
+		struct ed_aname *an = name_slot(t, t->first.names[i]);
+		if (!an->name)
+			an->name = t->first.names[j++] = t->first.names[i];
+	}
+	t->first.namesnum = j;
+	for (i = 0; i < n; i++) {
+		int flags = firsts[i].flags;
+		if (flags & (AF_EMPTY | AF_ANY)) {
+			for (k = 0; k < t->namessize; k++)
+				if (t->names[k].name)
+					add_ent(&t->names[k].list, i);
+			add_ent(&t->other, i);
+			flags |= AF_EXPR | AF_SESTART | AF_SEEND;
+		}
+		for (k = 0; k < firsts[i].namesnum; k++)
+			add_ent(&name_slot(t, firsts[i].names[k])->list, i);
+		if (flags & AF_EXPR)
+			add_ent(&t->expr, i);
+		if (flags & AF_SESTART)
+			add_ent(&t->sestart, i);
+		if (flags & AF_SEEND)
+			add_ent(&t->seend, i);
+		free(firsts[i].names);
+	}
+	free(firsts);
+	t->busy = 0;
+	return t;
+}
+
+struct ed_asindex *ed_get_asindex(const struct disisa *isa) {
+	struct disisa *misa = (struct disisa *)isa;
+	if (!isa->asindex) {
+		misa->asindex = calloc(sizeof *isa->asindex, 1);
+		get_atab(misa->asindex, isa->trootas ? isa->trootas : isa->troot);
+	}
+	return isa->asindex;
+}
+
+const int *ed_asindex_ents(struct ed_asindex *x, const struct insn *tab, struct litem **atoms, int atomsnum, int spos, int *num) {
+	struct ed_atab *t = get_atab(x, tab);
+	const struct ed_alist *l = &t->other;
+	if (spos < atomsnum) {
+		switch (atoms[spos]->type) {
+			case LITEM_NAME:
+				{
+					struct ed_aname *an = name_slot(t, atoms[spos]->str);
+					if (an->name)
+						l = &an->list;
+				}
+				break;
+			case LITEM_EXPR:
+				l = &t->expr;
+				break;
+			case LITEM_SESTART:
+				l = &t->sestart;
+				break;
+			case LITEM_SEEND:
+				l = &t->seend;
+				break;
+		}
+	}
+	*num = l->entsnum;
+	return l->ents;
+}
+
+void ed_free_asindex(struct disisa *isa) {
+	struct ed_asindex *x = isa->asindex;
+	size_t i;
+	int k;
+	if (!x)
+		return;
+	for (i = 0; i < x->mapsize; i++) {
+		struct ed_atab *t = x->map[i].atab;
+		if (!t)
+			continue;
+		for (k = 0; k < t->namessize; k++)
+			free(t->names[k].list.ents);
+		free(t->names);
+		free(t->first.names);
+		free(t->expr.ents);
+		free(t->sestart.ents);
+		free(t->seend.ents);
+		free(t->other.ents);
+		free(t);
+	}
+	free(x->map);
+	free(x);
+	isa->asindex = 0;
+}
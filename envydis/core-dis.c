@@ -25,6 +25,7 @@
 #include "dis-intern.h"
 #include "easm.h"
 #include <stdlib.h>
+#include <pthread.h>
 
 struct disctx {
 	const struct disisa *isa;
@@ -34,6 +35,8 @@ struct disctx {
 	int atomsnum;
 	int atomsmax;
 	int endmark;
+	/* where the decoded instruction goes */
+	struct arena *arena;
 };
 
 static inline ull bf_(int s, int l, ull *a, ull *m) {
@@ -83,7 +86,7 @@ ull getbf(const struct bitfield *bf, ull *a, ull *m) {
 	return res;
 }
 
-struct easm_expr *getrbf(const struct rbitfield *bf, ull *a, ull *m) {
+struct easm_expr *getrbf(const struct rbitfield *bf, ull *a, ull *m, struct arena *arena) {
 	ull res = 0;
 	int pos = bf->shr;
 	int i;
@@ -107,26 +110,26 @@ struct easm_expr *getrbf(const struct rbitfield *bf, ull *a, ull *m) {
 			break;
 	}
 	if (bf->pcrel) {
-		struct easm_expr *expr = easm_expr_simple(EASM_EXPR_POS);
+		struct easm_expr *expr = easm_arena_expr_simple(arena, EASM_EXPR_POS);
 		if (bf->pospreadd)
-			expr = easm_expr_bin(EASM_EXPR_ADD, expr, easm_expr_num(EASM_EXPR_NUM, bf->pospreadd));
+			expr = easm_arena_expr_bin(arena, EASM_EXPR_ADD, expr, easm_arena_expr_num(arena, EASM_EXPR_NUM, bf->pospreadd));
 		if (bf->shr)
-			expr = easm_expr_bin(EASM_EXPR_AND, expr, easm_expr_num(EASM_EXPR_NUM, -(1ull << bf->shr)));
-		expr = easm_expr_bin(EASM_EXPR_ADD, expr, easm_expr_num(EASM_EXPR_NUM, res));
+			expr = easm_arena_expr_bin(arena, EASM_EXPR_AND, expr, easm_arena_expr_num(arena, EASM_EXPR_NUM, -(1ull << bf->shr)));
+		expr = easm_arena_expr_bin(arena, EASM_EXPR_ADD, expr, easm_arena_expr_num(arena, EASM_EXPR_NUM, res));
 		if (bf->addend)
-			expr = easm_expr_bin(EASM_EXPR_ADD, expr, easm_expr_num(EASM_EXPR_NUM, bf->addend));
+			expr = easm_arena_expr_bin(arena, EASM_EXPR_ADD, expr, easm_arena_expr_num(arena, EASM_EXPR_NUM, bf->addend));
 		return expr;
 	} else {
 		res += bf->addend;
-		return easm_expr_num(EASM_EXPR_NUM, res);
+		return easm_arena_expr_num(arena, EASM_EXPR_NUM, res);
 	}
 }
 
 #define GETBF(bf) getbf(bf, a, m)
-#define GETRBF(bf) getrbf(bf, a, m)
+#define GETRBF(bf) getrbf(bf, a, m, ctx->arena)
 
-static inline struct litem *makeli(struct easm_expr *e) {
-	struct litem *li = calloc(sizeof *li, 1);
+static inline struct litem *makeli(struct disctx *ctx, struct easm_expr *e) {
+	struct litem *li = arena_alloc(ctx->arena, sizeof *li);
 	li->type = LITEM_EXPR;
 	li->expr = e;
 	return li;
@@ -152,61 +155,61 @@ void atomendmark_d DPROTO {
 }
 
 void atomsestart_d DPROTO {
-	struct litem *li = calloc(sizeof *li, 1);
+	struct litem *li = arena_alloc(ctx->arena, sizeof *li);
 	li->type = LITEM_SESTART;
-	ADDARRAY(ctx->atoms, li);
+	ARENA_ADDARRAY(ctx->arena, ctx->atoms, li);
 }
 
 void atomseend_d DPROTO {
-	struct litem *li = calloc(sizeof *li, 1);
+	struct litem *li = arena_alloc(ctx->arena, sizeof *li);
 	li->type = LITEM_SEEND;
-	ADDARRAY(ctx->atoms, li);
+	ARENA_ADDARRAY(ctx->arena, ctx->atoms, li);
 }
 
 void atomname_d DPROTO {
-	struct litem *li = calloc(sizeof *li, 1);
+	struct litem *li = arena_alloc(ctx->arena, sizeof *li);
 	li->type = LITEM_NAME;
-	li->str = strdup(v);
-	ADDARRAY(ctx->atoms, li);
+	li->str = arena_strdup(ctx->arena, v);
+	ARENA_ADDARRAY(ctx->arena, ctx->atoms, li);
 }
 
 void atomcmd_d DPROTO {
-	struct litem *li = makeli(easm_expr_str(EASM_EXPR_LABEL, strdup(v)));
-	ADDARRAY(ctx->atoms, li);
+	struct litem *li = makeli(ctx, easm_arena_expr_str(ctx->arena, EASM_EXPR_LABEL, arena_strdup(ctx->arena, v)));
+	ARENA_ADDARRAY(ctx->arena, ctx->atoms, li);
 }
 
 void atomunk_d DPROTO {
-	struct litem *li = calloc(sizeof *li, 1);
+	struct litem *li = arena_alloc(ctx->arena, sizeof *li);
 	li->type = LITEM_NAME;
-	li->str = strdup(v);
+	li->str = arena_strdup(ctx->arena, v);
 	li->isunk = 1;
-	ADDARRAY(ctx->atoms, li);
+	ARENA_ADDARRAY(ctx->arena, ctx->atoms, li);
 }
 
 void atomimm_d DPROTO {
 	const struct bitfield *bf = v;
-	struct easm_expr *expr = easm_expr_num(EASM_EXPR_NUM, GETBF(bf));
-	ADDARRAY(ctx->atoms, makeli(expr));
+	struct easm_expr *expr = easm_arena_expr_num(ctx->arena, EASM_EXPR_NUM, GETBF(bf));
+	ARENA_ADDARRAY(ctx->arena, ctx->atoms, makeli(ctx, expr));
 }
 
 void atomrimm_d DPROTO {
 	const struct rbitfield *bf = v;
 	struct easm_expr *expr = GETRBF(bf);
-	ADDARRAY(ctx->atoms, makeli(expr));
+	ARENA_ADDARRAY(ctx->arena, ctx->atoms, makeli(ctx, expr));
 }
 
 void atomctarg_d DPROTO {
 	const struct rbitfield *bf = v;
 	struct easm_expr *expr = GETRBF(bf);
 	expr->special = EASM_SPEC_CTARG;
-	ADDARRAY(ctx->atoms, makeli(expr));
+	ARENA_ADDARRAY(ctx->arena, ctx->atoms, makeli(ctx, expr));
 }
 
 void atombtarg_d DPROTO {
 	const struct rbitfield *bf = v;
 	struct easm_expr *expr = GETRBF(bf);
 	expr->special = EASM_SPEC_BTARG;
-	ADDARRAY(ctx->atoms, makeli(expr));
+	ARENA_ADDARRAY(ctx->arena, ctx->atoms, makeli(ctx, expr));
 }
 
 void atomign_d DPROTO {
@@ -228,15 +231,15 @@ static struct easm_expr *printreg (struct disctx *ctx, ull *a, ull *m, const str
 			if (num == reg->specials[i].num) {
 				switch (reg->specials[i].mode) {
 					case SR_NAMED:
-						expr = easm_expr_str(EASM_EXPR_REG, strdup(reg->specials[i].name));
+						expr = easm_arena_expr_str(ctx->arena, EASM_EXPR_REG, arena_strdup(ctx->arena, reg->specials[i].name));
 						expr->special = EASM_SPEC_REGSP;
 						return expr;
 					case SR_ZERO:
 						return 0;
 					case SR_ONE:
-						return easm_expr_num(EASM_EXPR_NUM, 1);
+						return easm_arena_expr_num(ctx->arena, EASM_EXPR_NUM, 1);
 					case SR_DISCARD:
-						return easm_expr_simple(EASM_EXPR_DISCARD);
+						return easm_arena_expr_simple(ctx->arena, EASM_EXPR_DISCARD);
 				}
 			}
 		}
@@ -253,10 +256,10 @@ static struct easm_expr *printreg (struct disctx *ctx, ull *a, ull *m, const str
 	}
 	char *str;
 	if (reg->bf)
-		str = aprintf("%s%lld%s", reg->name, num, suf);
+		str = arena_printf(ctx->arena, "%s%lld%s", reg->name, num, suf);
 	else
-		str = aprintf("%s%s", reg->name, suf);
-	expr = easm_expr_str(EASM_EXPR_REG, str);
+		str = arena_printf(ctx->arena, "%s%s", reg->name, suf);
+	expr = easm_arena_expr_str(ctx->arena, EASM_EXPR_REG, str);
 	if (reg->cool)
 		expr->special = EASM_SPEC_REGSP;
 	if (reg->always_special)
@@ -267,13 +270,13 @@ static struct easm_expr *printreg (struct disctx *ctx, ull *a, ull *m, const str
 void atomreg_d DPROTO {
 	const struct reg *reg = v;
 	struct easm_expr *expr = printreg(ctx, a, m, reg);
-	if (!expr) expr = easm_expr_num(EASM_EXPR_NUM, 0);
-	ADDARRAY(ctx->atoms, makeli(expr));
+	if (!expr) expr = easm_arena_expr_num(ctx->arena, EASM_EXPR_NUM, 0);
+	ARENA_ADDARRAY(ctx->arena, ctx->atoms, makeli(ctx, expr));
 }
 
 void atomdiscard_d DPROTO {
-	struct easm_expr *expr = easm_expr_simple(EASM_EXPR_DISCARD);
-	ADDARRAY(ctx->atoms, makeli(expr));
+	struct easm_expr *expr = easm_arena_expr_simple(ctx->arena, EASM_EXPR_DISCARD);
+	ARENA_ADDARRAY(ctx->arena, ctx->atoms, makeli(ctx, expr));
 }
 
 void atommem_d DPROTO {
@@ -290,7 +293,7 @@ void atommem_d DPROTO {
 			pexpr = imm;
 		} else {
 			if (expr) {
-				expr = easm_expr_bin(EASM_EXPR_ADD, expr, imm);
+				expr = easm_arena_expr_bin(ctx->arena, EASM_EXPR_ADD, expr, imm);
 			} else {
 				expr = imm;
 			}
@@ -301,34 +304,34 @@ void atommem_d DPROTO {
 		if (sexpr) {
 			if (mem->reg2shr) {
 				uint64_t num = 1ull << mem->reg2shr;
-				struct easm_expr *ssexpr = easm_expr_num(EASM_EXPR_NUM, num);
-				sexpr = easm_expr_bin(EASM_EXPR_MUL, sexpr, ssexpr);
+				struct easm_expr *ssexpr = easm_arena_expr_num(ctx->arena, EASM_EXPR_NUM, num);
+				sexpr = easm_arena_expr_bin(ctx->arena, EASM_EXPR_MUL, sexpr, ssexpr);
 			}
 			if (expr)
-				expr = easm_expr_bin(EASM_EXPR_ADD, expr, sexpr);
+				expr = easm_arena_expr_bin(ctx->arena, EASM_EXPR_ADD, expr, sexpr);
 			else
 				expr = sexpr;
 		}
 	}
-	if (!expr) expr = easm_expr_num(EASM_EXPR_NUM, 0);
+	if (!expr) expr = easm_arena_expr_num(ctx->arena, EASM_EXPR_NUM, 0);
 	if (mem->name) {
 		struct easm_expr *nex;
 		if (pexpr)
-			nex = easm_expr_bin(type, expr, pexpr);
+			nex = easm_arena_expr_bin(ctx->arena, type, expr, pexpr);
 		else
-			nex = easm_expr_un(type, expr);
+			nex = easm_arena_expr_un(ctx->arena, type, expr);
 		if (mem->idx)
-			nex->str = aprintf("%s%lld", mem->name, GETBF(mem->idx));
+			nex->str = arena_printf(ctx->arena, "%s%lld", mem->name, GETBF(mem->idx));
 		else
-			nex->str = strdup(mem->name);
-		nex->mods = calloc(sizeof *nex->mods, 1);
+			nex->str = arena_strdup(ctx->arena, mem->name);
+		nex->mods = arena_alloc(ctx->arena, sizeof *nex->mods);
 		expr = nex;
 	} else if (type != EASM_EXPR_MEM) {
 		abort();
 	}
 	if (mem->literal && expr->type == EASM_EXPR_MEM)
 		expr->special = EASM_SPEC_LITERAL;
-	ADDARRAY(ctx->atoms, makeli(expr));
+	ARENA_ADDARRAY(ctx->arena, ctx->atoms, makeli(ctx, expr));
 }
 
 void atomvec_d DPROTO {
@@ -343,31 +346,31 @@ void atomvec_d DPROTO {
 	for (i = 0; i < cnt; i++) {
 		struct easm_expr *sexpr;
 		if (mask & 1ull<<i) {
-			char *name = aprintf("%s%lld", vec->name,  base + k++);
-			sexpr = easm_expr_str(EASM_EXPR_REG, name);
+			char *name = arena_printf(ctx->arena, "%s%lld", vec->name,  base + k++);
+			sexpr = easm_arena_expr_str(ctx->arena, EASM_EXPR_REG, name);
 			if (vec->cool)
 				sexpr->special = EASM_SPEC_REGSP;
 		} else {
-			sexpr = easm_expr_simple(EASM_EXPR_DISCARD);
+			sexpr = easm_arena_expr_simple(ctx->arena, EASM_EXPR_DISCARD);
 		}
 		if (expr)
-			expr = easm_expr_bin(EASM_EXPR_VEC, expr, sexpr);
+			expr = easm_arena_expr_bin(ctx->arena, EASM_EXPR_VEC, expr, sexpr);
 		else
 			expr = sexpr;
 	}
 	if (!expr)
-		expr = easm_expr_simple(EASM_EXPR_ZVEC);
-	ADDARRAY(ctx->atoms, makeli(expr));
+		expr = easm_arena_expr_simple(ctx->arena, EASM_EXPR_ZVEC);
+	ARENA_ADDARRAY(ctx->arena, ctx->atoms, makeli(ctx, expr));
 }
 
 void atombf_d DPROTO {
 	const struct bitfield *bf = v;
 	uint64_t num1 = GETBF(&bf[0]);
 	uint64_t num2 = num1 + GETBF(&bf[1]);
-	struct easm_expr *expr = easm_expr_bin(EASM_EXPR_VEC,
-			easm_expr_num(EASM_EXPR_NUM, num1),
-			easm_expr_num(EASM_EXPR_NUM, num2));
-	ADDARRAY(ctx->atoms, makeli(expr));
+	struct easm_expr *expr = easm_arena_expr_bin(ctx->arena, EASM_EXPR_VEC,
+			easm_arena_expr_num(ctx->arena, EASM_EXPR_NUM, num1),
+			easm_arena_expr_num(ctx->arena, EASM_EXPR_NUM, num2));
+	ARENA_ADDARRAY(ctx->arena, ctx->atoms, makeli(ctx, expr));
 }
 
 struct dis_op_chunk {
@@ -375,15 +378,13 @@ struct dis_op_chunk {
 	int isbe;
 };
 
+struct dis_mark {
+	uint64_t ptr;
+	int m;
+};
+
 struct dis_res {
-	enum dis_status {
-		DIS_STATUS_OK = 0,
-		DIS_STATUS_EOF = 0x1,		/* EOF in the middle of an opcode */
-		DIS_STATUS_UNK_FORM = 0x2,	/* failed to determine instruction format - opcode length uncertain */
-		DIS_STATUS_UNK_INSN = 0x4,	/* failed to determine instruction name - unknown opcode or due to one of the above errors */
-		DIS_STATUS_UNK_OPERAND = 0x8,	/* failed to determine instruction operands */
-		DIS_STATUS_UNUSED_BITS = 0x10,	/* instruction decoded, but unused bitfields have non-default values */
-	} status;
+	enum ed_dis_status status;
 	uint32_t oplen;
 	struct dis_op_chunk *chunks;
 	int chunksnum;
@@ -393,82 +394,89 @@ struct dis_res {
 	ull a[MAXOPLEN], m[MAXOPLEN];
 	struct easm_insn *insn;
 	int endmark;
+	struct ed_target *targets;
+	int targetsnum;
+	int targetsmax;
+	/* marks to be put on the code once the instruction is known to be reached */
+	struct dis_mark *dmarks;
+	int dmarksnum;
+	int dmarksmax;
+	int marked;
+	/* mnemonic id + 1, 0 if not assigned yet */
+	int mnemid;
 //	uint32_t *umask;
 };
 
-static void dis_del_res(struct dis_res *dres)
-{
-	easm_del_insn(dres->insn);
-
-	free(dres);
-}
-
-static struct easm_sinsn *dis_parse_sinsn(struct disctx *ctx, enum dis_status *status, int *spos);
+static struct easm_sinsn *dis_parse_sinsn(struct disctx *ctx, enum ed_dis_status *status, int *spos);
 
-static struct easm_expr *dis_parse_expr(struct disctx *ctx, enum dis_status *status, int *spos) {
+static struct easm_expr *dis_parse_expr(struct disctx *ctx, enum ed_dis_status *status, int *spos) {
 	if (*spos >= ctx->atomsnum)
 		abort();
 	if (ctx->atoms[*spos]->type == LITEM_EXPR)
 		return ctx->atoms[(*spos)++]->expr;
 	if (ctx->atoms[(*spos)++]->type != LITEM_SESTART)
 		abort();
-	struct easm_expr *res = easm_expr_sinsn(dis_parse_sinsn(ctx, status, spos));
+	struct easm_expr *res = easm_arena_expr_sinsn(ctx->arena, dis_parse_sinsn(ctx, status, spos));
 	if (ctx->atoms[(*spos)++]->type != LITEM_SEEND)
 		abort();
 	return res;
 }
 
-static struct easm_sinsn *dis_parse_sinsn(struct disctx *ctx, enum dis_status *status, int *spos) {
-	struct easm_sinsn *res = calloc(sizeof *res, 1);
+static struct easm_sinsn *dis_parse_sinsn(struct disctx *ctx, enum ed_dis_status *status, int *spos) {
+	struct easm_sinsn *res = arena_alloc(ctx->arena, sizeof *res);
 	res->str = ctx->atoms[*spos]->str;
 	res->isunk = ctx->atoms[*spos]->isunk;
 	if (res->isunk)
-		*status |= DIS_STATUS_UNK_INSN;
+		*status |= ED_DIS_UNK_INSN;
 	if (ctx->atoms[(*spos)++]->type != LITEM_NAME)
 		abort();
-	struct easm_mods *mods = calloc (sizeof *mods, 1);
+	struct easm_mods *mods = arena_alloc(ctx->arena, sizeof *mods);
 	while (*spos < ctx->atomsnum && ctx->atoms[*spos]->type != LITEM_SEEND) {
 		if (ctx->atoms[*spos]->type == LITEM_NAME) {
-			struct easm_mod *mod = calloc(sizeof *mod, 1);
+			struct easm_mod *mod = arena_alloc(ctx->arena, sizeof *mod);
 			mod->str = ctx->atoms[*spos]->str;
 			mod->isunk = ctx->atoms[*spos]->isunk;
 			if (mod->isunk)
-				*status |= DIS_STATUS_UNK_OPERAND;
-			ADDARRAY(mods->mods, mod);
+				*status |= ED_DIS_UNK_OPERAND;
+			ARENA_ADDARRAY(ctx->arena, mods->mods, mod);
 			(*spos)++;
 		} else {
-			struct easm_operand *op = calloc (sizeof *op, 1);
+			struct easm_operand *op = arena_alloc(ctx->arena, sizeof *op);
 			op->mods = mods;
-			mods = calloc (sizeof *mods, 1);
-			ADDARRAY(op->exprs, dis_parse_expr(ctx, status, spos));
-			ADDARRAY(res->operands, op);
+			mods = arena_alloc(ctx->arena, sizeof *mods);
+			ARENA_ADDARRAY(ctx->arena, op->exprs, dis_parse_expr(ctx, status, spos));
+			ARENA_ADDARRAY(ctx->arena, res->operands, op);
 		}
 	}
 	res->mods = mods;
 	return res;
 }
 
-static struct easm_subinsn *dis_parse_subinsn(struct disctx *ctx, enum dis_status *status, int *spos) {
-	struct easm_subinsn *res = calloc(sizeof *res, 1);
+static struct easm_subinsn *dis_parse_subinsn(struct disctx *ctx, enum ed_dis_status *status, int *spos) {
+	struct easm_subinsn *res = arena_alloc(ctx->arena, sizeof *res);
 	while (ctx->atoms[*spos]->type != LITEM_NAME)
-		ADDARRAY(res->prefs, dis_parse_expr(ctx, status, spos));
+		ARENA_ADDARRAY(ctx->arena, res->prefs, dis_parse_expr(ctx, status, spos));
 	res->sinsn = dis_parse_sinsn(ctx, status, spos);
 	return res;
 }
 
-static struct easm_insn *dis_parse_insn(struct disctx *ctx, enum dis_status *status) {
+static struct easm_insn *dis_parse_insn(struct disctx *ctx, enum ed_dis_status *status) {
 	int spos = 0;
-	struct easm_insn *res = calloc(sizeof *res, 1);
-	ADDARRAY(res->subinsns, dis_parse_subinsn(ctx, status, &spos));
+	struct easm_insn *res = arena_alloc(ctx->arena, sizeof *res);
+	ARENA_ADDARRAY(ctx->arena, res->subinsns, dis_parse_subinsn(ctx, status, &spos));
 	if (spos != ctx->atomsnum)
 		abort();
 	return res;
 }
 
+/* on top of enum ed_mark: the code from here on has been followed */
+#define DIS_MARK_TRACED 0x8
+
 struct decoctx {
 	const struct disisa *isa;
 	struct varinfo *varinfo;
 	uint8_t *code;
+	/* enum ed_mark and DIS_MARK_TRACED, by position */
 	int *marks;
 	const char **names;
 	uint32_t codebase;
@@ -476,12 +484,30 @@ struct decoctx {
 	struct label *labels;
 	int labelsnum;
 	int labelsmax;
+	const struct ed_dispatch *dispatch;
+	/*
+	 * decoded and post-processed instructions by position from resbase on,
+	 * NULL if not decoded yet - the whole code with labels, a window of it
+	 * while ed_dis_new marks code without labels, nothing after that
+	 */
+	struct dis_res **res;
+	uint32_t resbase;
+	uint32_t ressz;
+	/* label mode: positions that became branch/call targets, still to be traced */
+	uint32_t *todo;
+	int todonum;
+	int todomax;
+	/*
+	 * everything decoded is allocated from here - with labels it lives as
+	 * long as the decoctx, without it's reset once it's not needed
+	 */
+	struct arena *arena;
 };
 
 struct dis_res *do_dis(struct decoctx *deco, uint32_t cur) {
 	struct disctx c = { 0 };
 	struct disctx *ctx = &c;
-	struct dis_res *res = calloc(sizeof *res, 1);
+	struct dis_res *res = arena_alloc(deco->arena, sizeof *res);
 	int i;
 	int stride = ed_getcstride(deco->isa, deco->varinfo);
 	for (i = 0; i < MAXOPLEN*8 && cur + i/stride < deco->codesz; i++) {
@@ -489,45 +515,54 @@ struct dis_res *do_dis(struct decoctx *deco, uint32_t cur) {
 	}
 	ctx->isa = deco->isa;
 	ctx->varinfo = deco->varinfo;
-	if (deco->isa->tsched && (cur % deco->isa->schedpos) == 0)
+	ctx->arena = deco->arena;
+	int sched = deco->isa->tsched && (cur % deco->isa->schedpos) == 0;
+	if (deco->dispatch)
+		ed_dispatch_d (ctx, res->a, res->m, ed_dispatch_root(deco->dispatch, sched));
+	else if (sched)
 		atomtab_d (ctx, res->a, res->m, deco->isa->tsched);
 	else
 		atomtab_d (ctx, res->a, res->m, deco->isa->troot);
 	res->oplen = ctx->oplen;
 	if (res->oplen + cur > deco->codesz)
-		res->status |= DIS_STATUS_EOF;
+		res->status |= ED_DIS_EOF;
 	if (res->oplen == 0) {
-		res->status |= DIS_STATUS_UNK_FORM;
+		res->status |= ED_DIS_UNK_FORM;
 		res->oplen = ctx->isa->opunit;
 	}
 	res->endmark = ctx->endmark;
 	/* XXX unused status */
 	res->insn = dis_parse_insn(ctx, &res->status);
 
-	for (i = 0; i < ctx->atomsnum; ++i)
-		free(ctx->atoms[i]);
-	free(ctx->atoms);
-
 	return res;
 }
 
 static void mark(struct decoctx *ctx, uint32_t ptr, int m) {
+	int *mp;
 	if (ptr < ctx->codebase || ptr >= ctx->codebase + ctx->codesz)
 		return;
-	ctx->marks[ptr - ctx->codebase] |= m;
+	mp = &ctx->marks[ptr - ctx->codebase];
+	if (ctx->labels && m & (ED_MARK_BTARG | ED_MARK_CTARG) && !(*mp & (ED_MARK_BTARG | ED_MARK_CTARG | DIS_MARK_TRACED)))
+		ADDARRAY(ctx->todo, ptr - ctx->codebase);
+	*mp |= m;
+}
+
+static void note_mark(struct decoctx *ctx, struct dis_res *dres, uint64_t ptr, int m) {
+	struct dis_mark dm = { ptr, m };
+	ARENA_ADDARRAY(ctx->arena, dres->dmarks, dm);
 }
 
 static int is_nr_mark(struct decoctx *ctx, uint32_t ptr) {
 	if (ptr < ctx->codebase || ptr >= ctx->codebase + ctx->codesz)
 		return 0;
-	return ctx->marks[ptr - ctx->codebase] & 0x40;
+	return ctx->marks[ptr - ctx->codebase] & ED_MARK_NORET;
 }
 
 char *deco_label(struct decoctx *ctx, uint64_t val) {
 	int i;
 	for (i = 0; i < ctx->labelsnum; i++)
 		if (ctx->labels[i].val == val && ctx->labels[i].name)
-			return strdup(ctx->labels[i].name);
+			return arena_strdup(ctx->arena, ctx->labels[i].name);
 	return 0;
 }
 
@@ -542,32 +577,30 @@ static void dis_pp_expr(struct decoctx *deco, struct dis_res *dres, struct easm_
 		dis_pp_sinsn(deco, dres, expr->sinsn, pos);
 	easm_substpos_expr(expr, pos);
 	if (easm_cfold_expr(expr)) {
+		if (expr->special == EASM_SPEC_CTARG || expr->special == EASM_SPEC_BTARG) {
+			struct ed_target t = { expr->num, expr->special == EASM_SPEC_CTARG ? ED_MARK_CTARG : ED_MARK_BTARG };
+			ARENA_ADDARRAY(deco->arena, dres->targets, t);
+		}
 		if (expr->special == EASM_SPEC_CTARG) {
-			mark(deco, expr->num, 2);
+			note_mark(deco, dres, expr->num, ED_MARK_CTARG);
 			expr->alabel = deco_label(deco, expr->num);
 			if (is_nr_mark(deco, expr->num))
 				dres->endmark = 1;
 		} else if (expr->special == EASM_SPEC_BTARG) {
-			mark(deco, expr->num, 1);
+			note_mark(deco, dres, expr->num, ED_MARK_BTARG);
 			expr->alabel = deco_label(deco, expr->num);
 		}
 		if (expr->num & 1ull << 63 && !expr->special) {
 			expr->type = EASM_EXPR_NEG;
-			expr->e1 = easm_expr_num(EASM_EXPR_NUM, -expr->num);
+			expr->e1 = easm_arena_expr_num(deco->arena, EASM_EXPR_NUM, -expr->num);
 			expr->num = 0;
 		}
 	}
 	if (expr->type == EASM_EXPR_ADD && expr->e1->type == EASM_EXPR_NUM && expr->e1->num == 0) {
-		struct easm_expr *oe2 = expr->e2;
-		free(expr->e1);
-		*expr = *oe2;
-		free(oe2);
+		*expr = *expr->e2;
 	}
 	if ((expr->type == EASM_EXPR_ADD || expr->type == EASM_EXPR_SUB) && expr->e2->type == EASM_EXPR_NUM && expr->e2->num == 0) {
-		struct easm_expr *oe1 = expr->e1;
-		free(expr->e2);
-		*expr = *oe1;
-		free(oe1);
+		*expr = *expr->e1;
 	}
 	if (expr->type == EASM_EXPR_ADD && expr->e2->type == EASM_EXPR_NUM && expr->e2->num & 1ull << 63) {
 		expr->e2->num = -expr->e2->num;
@@ -578,7 +611,7 @@ static void dis_pp_expr(struct decoctx *deco, struct dis_res *dres, struct easm_
 			expr->special = EASM_SPEC_NONE;
 		} else {
 			ull ptr = expr->e1->num;
-			mark(deco, ptr, 0x10);
+			note_mark(deco, dres, ptr, ED_MARK_DWORD);
 			if (ptr < deco->codebase || ptr > deco->codebase + deco->codesz) {
 				expr->special = EASM_SPEC_NONE;
 			} else {
@@ -618,30 +651,173 @@ void dis_dopp(struct decoctx *deco, struct dis_res *dres, uint64_t pos) {
 	dis_pp_insn(deco, dres, dres->insn, pos);
 }
 
+/*
+ * The instruction at cur, decoded the first time it's asked for - or every
+ * time, if cur is outside of what's cached. What it marks is only marked then, so that instructions can be decoded ahead of
+ * time without knowing whether they're reached.
+ */
+static struct dis_res *dis_get_res(struct decoctx *ctx, uint32_t cur) {
+	struct dis_res **slot = cur - ctx->resbase < ctx->ressz ? &ctx->res[cur - ctx->resbase] : 0;
+	struct dis_res *dres = slot ? *slot : 0;
+	int i;
+	if (!dres) {
+		dres = do_dis(ctx, cur);
+		dis_dopp(ctx, dres, cur + ctx->codebase);
+		if (slot)
+			*slot = dres;
+	}
+	if (!dres->marked) {
+		for (i = 0; i < dres->dmarksnum; i++)
+			mark(ctx, dres->dmarks[i].ptr, dres->dmarks[i].m);
+		dres->marked = 1;
+	}
+	return dres;
+}
+
+/*
+ * Follows the code from a branch/call target until something ends it, or
+ * until it gets to code that's been followed already - what comes after
+ * only depends on the position, so there's nothing new there.
+ */
+static void dis_trace(struct decoctx *ctx, uint32_t cur) {
+	uint32_t start = cur;
+	ctx->marks[cur] |= DIS_MARK_TRACED;
+	while (cur < ctx->codesz) {
+		struct dis_res *dres;
+		if (cur != start && ctx->res[cur])
+			break;
+		dres = dis_get_res(ctx, cur);
+		if (!dres->oplen || dres->endmark || ctx->marks[cur] & ED_MARK_END)
+			break;
+		cur += dres->oplen;
+	}
+}
+
 /*
  * Disassembler driver
  *
- * You pass a block of memory to this function, disassembly goes out to given
- * FILE*.
+ * ed_dis_new finds out what's code and what it marks, ed_dis_next walks the
+ * code the way it's printed, and envydis prints the items to a FILE*.
  */
 
-void envydis (const struct disisa *isa, FILE *out, uint8_t *code, uint32_t start, int num, struct varinfo *varinfo, int quiet, struct label *labels, int labelsnum, const struct envy_colors *cols)
-{
-	struct decoctx c = { 0 };
-	struct decoctx *ctx = &c;
-	int cur = 0, i, j;
+/*
+ * Without labels, everything gets decoded once just for the marks - a branch
+ * can go back to code that's printed already - and again when it's printed.
+ * The marking pass goes over the code a window at a time, and forgets what
+ * it decoded after each window. With several threads, the window is cut into
+ * chunks, and each thread decodes its chunk from start to end into its own
+ * arena, not marking anything yet. A chunk is decoded as if an instruction
+ * started right at its beginning - which holds for fixed-length code, but not
+ * always for variable-length code: the pass over the window afterwards
+ * decodes whatever the threads guessed wrong, and marks what's really
+ * reached.
+ */
+#define DECODE_CHUNK 0x10000
+
+int ed_dis_threads = 1;
+
+struct decode_thread {
+	struct decoctx deco;
+	uint32_t chunk;
+	pthread_t thread;
+};
+
+static void *decode_chunk(void *arg) {
+	struct decode_thread *dt = arg;
+	struct decoctx *ctx = &dt->deco;
+	struct dis_res *dres;
+	uint32_t cur;
+	for (cur = dt->chunk; cur < dt->chunk + DECODE_CHUNK && cur < ctx->codesz; cur += dres->oplen) {
+		dres = ctx->res[cur - ctx->resbase] = do_dis(ctx, cur);
+		dis_dopp(ctx, dres, cur + ctx->codebase);
+	}
+	return 0;
+}
+
+struct ed_dis {
+	struct decoctx deco;
+	/* arenas of the decoding threads */
+	struct arena **arenas;
+	int arenasnum;
+	int arenasmax;
+	int stride;
+	/* the walk: where it's at, whether it's in code, what's been skipped */
+	uint32_t cur;
+	int active;
+	int labeldone;
+	uint32_t skip;
+	int nonzero;
+	struct ed_item item;
+	/* mnemonics by id, and a hash of them */
+	const char **mnems;
+	int mnemsnum;
+	int mnemsmax;
+	int *mnemhash;
+	int mnemhashsize;
+};
+
+static void dis_mark_all(struct ed_dis *dis) {
+	struct decoctx *ctx = &dis->deco;
+	int threads = ctx->codesz > DECODE_CHUNK ? ed_dis_threads : 1;
+	struct decode_thread *dts = calloc(threads, sizeof *dts);
+	uint32_t window = threads * DECODE_CHUNK;
+	uint32_t cur = 0;
+	int i;
+	ctx->res = calloc(window, sizeof *ctx->res);
+	ctx->ressz = window;
+	if (threads > 1)
+		for (i = 0; i < threads; i++)
+			ADDARRAY(dis->arenas, arena_new());
+	for (ctx->resbase = 0; ctx->resbase < ctx->codesz; ctx->resbase += window) {
+		if (threads > 1) {
+			for (i = 0; i < threads; i++) {
+				dts[i].deco = *ctx;
+				dts[i].deco.arena = dis->arenas[i];
+				dts[i].chunk = ctx->resbase + i * DECODE_CHUNK;
+				pthread_create(&dts[i].thread, 0, decode_chunk, &dts[i]);
+			}
+			for (i = 0; i < threads; i++)
+				pthread_join(dts[i].thread, 0);
+		}
+		while (cur < ctx->resbase + window && cur < ctx->codesz) {
+			struct dis_res *dres = dis_get_res(ctx, cur);
+			if (dres->oplen)
+				cur += dres->oplen;
+			else
+				cur++;
+		}
+		memset(ctx->res, 0, window * sizeof *ctx->res);
+		arena_reset(ctx->arena);
+		for (i = 0; i < dis->arenasnum; i++)
+			arena_reset(dis->arenas[i]);
+	}
+	free(ctx->res);
+	ctx->res = 0;
+	ctx->resbase = 0;
+	ctx->ressz = 0;
+	free(dts);
+}
+
+struct ed_dis *ed_dis_new(const struct disisa *isa, struct varinfo *varinfo, uint8_t *code, uint32_t start, int num, struct label *labels, int labelsnum) {
+	struct ed_dis *dis = calloc(sizeof *dis, 1);
+	struct decoctx *ctx = &dis->deco;
+	int i, j;
 	ctx->code = code;
 	ctx->codesz = num;
 	ctx->marks = calloc(num, sizeof *ctx->marks);
 	ctx->names = calloc(num, sizeof *ctx->names);
+	ctx->arena = arena_new();
 	ctx->codebase = start;
 	ctx->varinfo = varinfo;
 	ctx->isa = isa;
 	ctx->labels = labels;
 	ctx->labelsnum = labelsnum;
-	int stride = ed_getcstride(ctx->isa, ctx->varinfo);
-	int cbsz = ed_getcbsz(ctx->isa, ctx->varinfo);
+	if (!ed_linear_dispatch)
+		ctx->dispatch = ed_get_dispatch(isa, varinfo);
+	dis->stride = ed_getcstride(isa, varinfo);
 	if (labels) {
+		ctx->res = calloc(num, sizeof *ctx->res);
+		ctx->ressz = num;
 		for (i = 0; i < labelsnum; i++) {
 			mark(ctx, labels[i].val, labels[i].type);
 			if (labels[i].val >= ctx->codebase && labels[i].val < ctx->codebase + ctx->codesz) {
@@ -653,228 +829,482 @@ void envydis (const struct disisa *isa, FILE *out, uint8_t *code, uint32_t start
 					mark(ctx, labels[i].val + j, labels[i].type);
 			}
 		}
-		int done;
-		do {
-			done = 1;
-			cur = 0;
-			int active = 0;
-			while (cur < num) {
-				if (!active && (ctx->marks[cur] & 3) && !(ctx->marks[cur] & 8)) {
-					done = 0;
-					active = 1;
-					ctx->marks[cur] |= 8;
-				}
-				if (active) {
-					struct dis_res *dres = do_dis(ctx, cur);
-					dis_dopp(ctx, dres, cur + start);
-					if (dres->oplen && !dres->endmark && !(ctx->marks[cur] & 4))
-						cur += dres->oplen;
-					else
-						active = 0;
-					dis_del_res(dres);
-				} else {
-					cur++;
-				}
-			}
-		} while (!done);
+		/* marking the targets found queues them up, until there's nothing new */
+		while (ctx->todonum) {
+			uint32_t pos = ctx->todo[--ctx->todonum];
+			if (!(ctx->marks[pos] & DIS_MARK_TRACED))
+				dis_trace(ctx, pos);
+		}
 	} else {
-		while (cur < num) {
-			struct dis_res *dres = do_dis(ctx, cur);
-			dis_dopp(ctx, dres, cur + start);
-			if (dres->oplen)
-				cur += dres->oplen;
-			else
-				cur++;
-			dis_del_res(dres);
+		dis_mark_all(dis);
+	}
+	return dis;
+}
+
+void ed_dis_del(struct ed_dis *dis) {
+	int i;
+	if (!dis)
+		return;
+	arena_del(dis->deco.arena);
+	for (i = 0; i < dis->arenasnum; i++)
+		arena_del(dis->arenas[i]);
+	free(dis->arenas);
+	free(dis->deco.res);
+	free(dis->deco.todo);
+	free(dis->deco.marks);
+	free(dis->deco.names);
+	for (i = 0; i < dis->mnemsnum; i++)
+		free((char *)dis->mnems[i]);
+	free(dis->mnems);
+	free(dis->mnemhash);
+	free(dis);
+}
+
+void ed_dis_release(struct ed_dis *dis) {
+	/* with labels, the cache is in there */
+	if (!dis->deco.ressz)
+		arena_reset(dis->deco.arena);
+}
+
+const char *ed_dis_mnemonic(struct ed_dis *dis, int id) {
+	if (id < 0 || id >= dis->mnemsnum)
+		return 0;
+	return dis->mnems[id];
+}
+
+static int mnemonic_id(struct ed_dis *dis, const char *str) {
+	int i;
+	if (dis->mnemsnum * 2 >= dis->mnemhashsize) {
+		free(dis->mnemhash);
+		dis->mnemhashsize = dis->mnemhashsize ? dis->mnemhashsize * 2 : 256;
+		dis->mnemhash = malloc(dis->mnemhashsize * sizeof *dis->mnemhash);
+		for (i = 0; i < dis->mnemhashsize; i++)
+			dis->mnemhash[i] = -1;
+		for (i = 0; i < dis->mnemsnum; i++) {
+			int h = elf_hash(dis->mnems[i]) & (dis->mnemhashsize - 1);
+			while (dis->mnemhash[h] != -1)
+				h = (h + 1) & (dis->mnemhashsize - 1);
+			dis->mnemhash[h] = i;
 		}
 	}
-	cur = 0;
-	int active = 0;
-	int skip = 0, nonzero = 0;
-	while (cur < num) {
+	i = elf_hash(str) & (dis->mnemhashsize - 1);
+	while (dis->mnemhash[i] != -1) {
+		if (!strcmp(dis->mnems[dis->mnemhash[i]], str))
+			return dis->mnemhash[i];
+		i = (i + 1) & (dis->mnemhashsize - 1);
+	}
+	dis->mnemhash[i] = dis->mnemsnum;
+	/* the decoded one goes away with the arena */
+	ADDARRAY(dis->mnems, strdup(str));
+	return dis->mnemsnum - 1;
+}
+
+static const struct ed_item *item_skip(struct ed_dis *dis) {
+	struct ed_item *item = &dis->item;
+	memset(item, 0, sizeof *item);
+	item->type = ED_ITEM_SKIP;
+	item->pos = dis->cur - dis->skip + dis->deco.codebase;
+	item->len = dis->skip;
+	item->val = dis->nonzero;
+	dis->skip = 0;
+	dis->nonzero = 0;
+	return item;
+}
+
+static const struct ed_item *item_data(struct ed_dis *dis, int mark) {
+	struct decoctx *ctx = &dis->deco;
+	struct ed_item *item = &dis->item;
+	uint32_t cur = dis->cur;
+	int i;
+	if (ed_getcbsz(ctx->isa, ctx->varinfo) != 8)
+		abort();
+	item->type = ED_ITEM_DATA;
+	if (mark & ED_MARK_BYTE) {
+		item->mark = ED_MARK_BYTE;
+		item->len = 1;
+	} else if (mark & ED_MARK_WORD) {
+		item->mark = ED_MARK_WORD;
+		item->len = 2;
+	} else if (mark & ED_MARK_DWORD) {
+		item->mark = ED_MARK_DWORD;
+		item->len = 4;
+	} else {
+		item->mark = ED_MARK_STRING;
+		for (i = cur; i < ctx->codesz && ctx->code[i]; i++);
+		item->len = i - cur + 1;
+	}
+	if (item->mark != ED_MARK_STRING)
+		for (i = 0; i < item->len && cur + i < ctx->codesz; i++)
+			item->val |= (uint64_t)ctx->code[cur + i] << i * 8;
+	return item;
+}
+
+static const struct ed_item *item_insn(struct ed_dis *dis, int mark) {
+	struct decoctx *ctx = &dis->deco;
+	struct ed_item *item = &dis->item;
+	struct dis_res *dres = dis_get_res(ctx, dis->cur);
+	struct easm_sinsn *sinsn = dres->insn->subinsns[0]->sinsn;
+	int i;
+	item->type = ED_ITEM_INSN;
+	item->len = dres->oplen;
+	item->mark = mark;
+	item->status = dres->status;
+	item->insn = dres->insn;
+	item->mnemonic_id = mnemonic_id(dis, sinsn->str);
+	item->mnemonic = dis->mnems[item->mnemonic_id];
+	item->targets = dres->targets;
+	item->targetsnum = dres->targetsnum;
+	item->endmark = dres->endmark;
+	if (!(dres->status & ED_DIS_UNK_FORM)) {
+		for (i = 0; i < MAXOPLEN; i++)
+			item->unknown[i] = dres->a[i] & ~dres->m[i];
+		/* oplen is in code units, unknown[] in bytes */
+		for (i = dres->oplen * dis->stride; i < MAXOPLEN * 8; i++)
+			item->unknown[i/8] &= ~(0xffull << (i & 7) * 8);
+		for (i = 0; i < MAXOPLEN; i++)
+			if (item->unknown[i])
+				item->status |= ED_DIS_UNUSED_BITS;
+	}
+	return item;
+}
+
+const struct ed_item *ed_dis_next(struct ed_dis *dis) {
+	struct decoctx *ctx = &dis->deco;
+	struct ed_item *item = &dis->item;
+	while (dis->cur < ctx->codesz) {
+		uint32_t cur = dis->cur;
 		int mark = ctx->marks[cur];
-		if (ctx->names[cur]) {
-			if (skip) {
-				if (nonzero)
-					fprintf(out, "%s[%x bytes skipped]\n", cols->err, skip);
-				else
-					fprintf(out, "%s[%x zero bytes skipped]\n", cols->reset, skip);
-				skip = 0;
-				nonzero = 0;
-			}
-			if (mark & 0x1b0)
-				fprintf (out, "%s%s:\n", cols->reset, ctx->names[cur]);
-			else if (mark & 2)
-				fprintf (out, "\n%s%s:\n", cols->ctarg, ctx->names[cur]);
-			else if (mark & 1)
-				fprintf (out, "%s%s:\n", cols->btarg, ctx->names[cur]);
-			else
-				fprintf (out, "%s%s:\n", cols->reset, ctx->names[cur]);
+		if (ctx->names[cur] && !dis->labeldone) {
+			if (dis->skip)
+				return item_skip(dis);
+			dis->labeldone = 1;
+			memset(item, 0, sizeof *item);
+			item->type = ED_ITEM_LABEL;
+			item->pos = cur + ctx->codebase;
+			item->mark = mark;
+			item->label = ctx->names[cur];
+			return item;
 		}
-		if (mark & 0x1b0 && !active) {
-			if (skip) {
-				if (nonzero)
-					fprintf(out, "%s[%x bytes skipped]\n", cols->err, skip);
-				else
-					fprintf(out, "%s[%x zero bytes skipped]\n", cols->reset, skip);
-				skip = 0;
-				nonzero = 0;
-			}
-			if (cbsz != 8)
-				abort();
-			fprintf (out, "%s%08x:%s", cols->mem, cur + start, cols->reset);
-			if (mark & 0x80) {
-				uint8_t val = code[cur];
-				fprintf (out, " %s%02x\n", cols->num, val);
-				cur += 1;
-			} else if (mark & 0x100) {
-				uint16_t val = 0;
-				for (i = 0; i < 2 && cur + i < num; i++) {
-					val |= code[cur + i] << i*8;
-				}
-				fprintf (out, " %s%04x\n", cols->num, val);
-				cur += 2;
-			} else if (mark & 0x10) {
-				uint32_t val = 0;
-				for (i = 0; i < 4 && cur + i < num; i++) {
-					val |= code[cur + i] << i*8;
-				}
-				fprintf (out, " %s%08x\n", cols->num, val);
-				cur += 4;
-			} else {
-				fprintf (out, " %s\"", cols->num);
-				while (code[cur]) {
-					switch (code[cur]) {
-						case '\n':
-							fprintf (out, "\\n");
-							break;
-						case '\\':
-							fprintf (out, "\\\\");
-							break;
-						case '\"':
-							fprintf (out, "\\\"");
-							break;
-						default:
-							fprintf (out, "%c", code[cur]);
-							break;
-					}
-					cur++;
-				}
-				cur++;
-				fprintf (out, "\"\n");
+		if (mark & ED_MARK_DATA && !dis->active) {
+			if (dis->skip)
+				return item_skip(dis);
+			memset(item, 0, sizeof *item);
+		} else {
+			int i;
+			if (!dis->active && mark & (ED_MARK_BTARG | ED_MARK_CTARG | ED_MARK_END))
+				dis->active = 1;
+			if (!dis->active && ctx->labels) {
+				for (i = 0; i < dis->stride; i++)
+					if (ctx->code[cur*dis->stride+i])
+						dis->nonzero = 1;
+				dis->cur++;
+				dis->skip++;
+				dis->labeldone = 0;
+				continue;
 			}
-			continue;
-		}
-		if (!active && mark & 7)
-			active = 1;
-		if (!active && labels) {
-			for (i = 0; i < stride; i++)
-				if (code[cur*stride+i])
-					nonzero = 1;
-			cur++;
-			skip++;
-			continue;
+			if (dis->skip)
+				return item_skip(dis);
+			memset(item, 0, sizeof *item);
 		}
-		if (skip) {
-			if (nonzero)
-				fprintf(out, "%s[%x bytes skipped]\n", cols->err, skip);
-			else
-				fprintf(out, "%s[%x zero bytes skipped]\n", cols->reset, skip);
-			skip = 0;
-			nonzero = 0;
+		item->pos = cur + ctx->codebase;
+		item->label = ctx->names[cur];
+		item->code = ctx->code + cur * dis->stride;
+		item->left = ctx->codesz - cur;
+		if (mark & ED_MARK_DATA && !dis->active) {
+			item_data(dis, mark);
+		} else {
+			item_insn(dis, mark);
+			if (item->endmark || mark & ED_MARK_END)
+				dis->active = 0;
 		}
-		struct dis_res *dres = do_dis(ctx, cur);
-		dis_dopp(ctx, dres, cur + start);
-
-		if (dres->endmark || mark & 4)
-			active = 0;
+		dis->cur += item->len;
+		dis->labeldone = 0;
+		return item;
+	}
+	return 0;
+}
 
-		if (mark & 2 && !ctx->names[cur])
-			fprintf (out, "\n");
-		switch (mark & 3) {
-			case 0:
-				if (!quiet)
-					fprintf (out, "%s%08x:%s", cols->reset, cur + start, cols->reset);
-				break;
-			case 1:
-				fprintf (out, "%s%08x:%s", cols->btarg, cur + start, cols->reset);
-				break;
-			case 2:
-				fprintf (out, "%s%08x:%s", cols->ctarg, cur + start, cols->reset);
-				break;
-			case 3:
-				fprintf (out, "%s%08x:%s", cols->bctarg, cur + start, cols->reset);
-				break;
-		}
+static void print_skip(FILE *out, const struct ed_item *item, const struct envy_colors *cols) {
+	if (item->val)
+		fprintf(out, "%s[%x bytes skipped]\n", cols->err, item->len);
+	else
+		fprintf(out, "%s[%x zero bytes skipped]\n", cols->reset, item->len);
+}
 
-		if (!quiet) {
-			for (i = 0; i < isa->maxoplen; i += isa->opunit) {
-				fprintf (out, " ");
-				for (j = isa->opunit*stride - 1; j >= 0; j--)
-					if (i+j/stride && i+j/stride >= dres->oplen) {
-						fprintf (out, "  ");
-					} else if (cur+i+j/stride >= num) {
-						fprintf (out, "%s??", cols->err);
-					} else {
-						fprintf (out, "%s%02x", cols->reset, code[(cur + i)*stride + j]);
-					}
+static void print_data(FILE *out, const struct ed_item *item, const struct envy_colors *cols) {
+	int i;
+	fprintf (out, "%s%08x:%s", cols->mem, item->pos, cols->reset);
+	switch (item->mark) {
+		case ED_MARK_BYTE:
+			fprintf (out, " %s%02"PRIx64"\n", cols->num, item->val);
+			break;
+		case ED_MARK_WORD:
+			fprintf (out, " %s%04"PRIx64"\n", cols->num, item->val);
+			break;
+		case ED_MARK_DWORD:
+			fprintf (out, " %s%08"PRIx64"\n", cols->num, item->val);
+			break;
+		default:
+			fprintf (out, " %s\"", cols->num);
+			for (i = 0; i < item->len - 1; i++) {
+				switch (item->code[i]) {
+					case '\n':
+						fprintf (out, "\\n");
+						break;
+					case '\\':
+						fprintf (out, "\\\\");
+						break;
+					case '\"':
+						fprintf (out, "\\\"");
+						break;
+					default:
+						fprintf (out, "%c", item->code[i]);
+						break;
+				}
 			}
-			fprintf (out, "  ");
+			fprintf (out, "\"\n");
+			break;
+	}
+}
 
-			if (mark & 2)
-				fprintf (out, "%sC", cols->ctarg);
-			else
-				fprintf (out, " ");
-			if (mark & 1)
-				fprintf (out, "%sB", cols->btarg);
-			else
-				fprintf (out, " ");
-			fprintf(out, " ");
-		} else if (quiet == 1) {
-			if (mark)
-				fprintf (out, "\n");
-		}
+static void print_insn(FILE *out, const struct disisa *isa, int stride, const struct ed_item *item, int quiet, const struct envy_colors *cols) {
+	int mark = item->mark;
+	int i, j;
 
-		easm_print_insn(out, cols, dres->insn);
+	if (mark & ED_MARK_CTARG && !item->label)
+		fprintf (out, "\n");
+	switch (mark & (ED_MARK_BTARG | ED_MARK_CTARG)) {
+		case 0:
+			if (!quiet)
+				fprintf (out, "%s%08x:%s", cols->reset, item->pos, cols->reset);
+			break;
+		case ED_MARK_BTARG:
+			fprintf (out, "%s%08x:%s", cols->btarg, item->pos, cols->reset);
+			break;
+		case ED_MARK_CTARG:
+			fprintf (out, "%s%08x:%s", cols->ctarg, item->pos, cols->reset);
+			break;
+		case ED_MARK_BTARG | ED_MARK_CTARG:
+			fprintf (out, "%s%08x:%s", cols->bctarg, item->pos, cols->reset);
+			break;
+	}
 
-		if (dres->status & DIS_STATUS_UNK_FORM) {
-			fprintf (out, " %s[unknown op length]%s", cols->err, cols->reset);
-		} else {
-			int fl = 0;
-			for (i = dres->oplen; i < MAXOPLEN * 8; i++)
-				dres->a[i/8] &= ~(0xffull << (i & 7) * 8);
-			for (i = 0; i < MAXOPLEN; i++) {
-				dres->a[i] &= ~dres->m[i];
-				if (dres->a[i])
-					fl = 1;
-			}
-			if (fl) {
-				fprintf (out, " %s[unknown:", cols->err);
-				for (i = 0; i < dres->oplen || i == 0; i += isa->opunit) {
-					fprintf (out, " ");
-					for (j = isa->opunit*stride - 1; j >= 0; j--)
-						if (cur+i+j >= num)
-							fprintf (out, "??");
-						else
-							fprintf (out, "%02llx", (dres->a[(i+j)/8] >> ((i + j)&7) * 8) & 0xff);
+	if (!quiet) {
+		for (i = 0; i < isa->maxoplen; i += isa->opunit) {
+			fprintf (out, " ");
+			for (j = isa->opunit*stride - 1; j >= 0; j--)
+				if (i+j/stride && i+j/stride >= item->len) {
+					fprintf (out, "  ");
+				} else if (i+j/stride >= item->left) {
+					fprintf (out, "%s??", cols->err);
+				} else {
+					fprintf (out, "%s%02x", cols->reset, item->code[i*stride + j]);
 				}
-				fprintf (out, "]");
-			}
 		}
-		if (dres->status & DIS_STATUS_EOF) {
-			fprintf (out, " %s[incomplete]%s", cols->err, cols->reset);
-		}
-		if (dres->status & DIS_STATUS_UNK_INSN) {
-			fprintf (out, " %s[unknown instruction]%s", cols->err, cols->reset);
+		fprintf (out, "  ");
+
+		if (mark & ED_MARK_CTARG)
+			fprintf (out, "%sC", cols->ctarg);
+		else
+			fprintf (out, " ");
+		if (mark & ED_MARK_BTARG)
+			fprintf (out, "%sB", cols->btarg);
+		else
+			fprintf (out, " ");
+		fprintf(out, " ");
+	} else if (quiet == 1) {
+		if (mark)
+			fprintf (out, "\n");
+	}
+
+	easm_print_insn(out, cols, item->insn);
+
+	if (item->status & ED_DIS_UNK_FORM) {
+		fprintf (out, " %s[unknown op length]%s", cols->err, cols->reset);
+	} else if (item->status & ED_DIS_UNUSED_BITS) {
+		fprintf (out, " %s[unknown:", cols->err);
+		for (i = 0; i < item->len || i == 0; i += isa->opunit) {
+			fprintf (out, " ");
+			for (j = isa->opunit*stride - 1; j >= 0; j--)
+				if (i+j/stride >= item->left)
+					fprintf (out, "??");
+				else
+					fprintf (out, "%02"PRIx64, (item->unknown[(i*stride + j)/8] >> ((i*stride + j)&7) * 8) & 0xff);
 		}
-		if (dres->status & DIS_STATUS_UNK_OPERAND) {
-			fprintf (out, " %s[unknown operand]%s", cols->err, cols->reset);
+		fprintf (out, "]");
+	}
+	if (item->status & ED_DIS_EOF) {
+		fprintf (out, " %s[incomplete]%s", cols->err, cols->reset);
+	}
+	if (item->status & ED_DIS_UNK_INSN) {
+		fprintf (out, " %s[unknown instruction]%s", cols->err, cols->reset);
+	}
+	if (item->status & ED_DIS_UNK_OPERAND) {
+		fprintf (out, " %s[unknown operand]%s", cols->err, cols->reset);
+	}
+	fprintf (out, "%s\n", cols->reset);
+}
+
+void ed_print_item(FILE *out, const struct disisa *isa, struct varinfo *varinfo, const struct ed_item *item, int quiet, const struct envy_colors *cols) {
+	switch (item->type) {
+		case ED_ITEM_SKIP:
+			print_skip(out, item, cols);
+			break;
+		case ED_ITEM_LABEL:
+			if (item->mark & ED_MARK_DATA)
+				fprintf (out, "%s%s:\n", cols->reset, item->label);
+			else if (item->mark & ED_MARK_CTARG)
+				fprintf (out, "\n%s%s:\n", cols->ctarg, item->label);
+			else if (item->mark & ED_MARK_BTARG)
+				fprintf (out, "%s%s:\n", cols->btarg, item->label);
+			else
+				fprintf (out, "%s%s:\n", cols->reset, item->label);
+			break;
+		case ED_ITEM_DATA:
+			print_data(out, item, cols);
+			break;
+		case ED_ITEM_INSN:
+			print_insn(out, isa, ed_getcstride(isa, varinfo), item, quiet, cols);
+			break;
+	}
+}
+
+/*
+ * Printing takes longer than decoding, so with several threads that's done
+ * in parallel too: the items are collected in batches, each thread prints
+ * every ed_dis_threads-th batch to memory, and the batches are written out
+ * in order as they're done. Once all the batches there's room for are
+ * written, what they point to is released.
+ */
+#define PRINT_BATCH 0x1000
+#define PRINT_BATCHES(threads) ((threads) * 2)
+
+struct print_batch {
+	struct ed_item items[PRINT_BATCH];
+	int itemsnum;
+	char *buf;
+	size_t len;
+	int done;
+};
+
+struct print_pool {
+	const struct disisa *isa;
+	struct varinfo *varinfo;
+	int quiet;
+	const struct envy_colors *cols;
+	struct print_batch *batches;
+	/* sequence numbers of batches: written <= submitted */
+	uint64_t submitted;
+	uint64_t written;
+	int quit;
+	pthread_mutex_t lock;
+	pthread_cond_t batch_submitted;
+	pthread_cond_t batch_done;
+};
+
+struct print_thread {
+	struct print_pool *pool;
+	int idx;
+	pthread_t thread;
+};
+
+static void *print_batches(void *arg) {
+	struct print_thread *pt = arg;
+	struct print_pool *pool = pt->pool;
+	uint64_t seq;
+	for (seq = pt->idx; ; seq += ed_dis_threads) {
+		struct print_batch *b = &pool->batches[seq % PRINT_BATCHES(ed_dis_threads)];
+		FILE *f;
+		int i, quit;
+		pthread_mutex_lock(&pool->lock);
+		while (seq >= pool->submitted && !pool->quit)
+			pthread_cond_wait(&pool->batch_submitted, &pool->lock);
+		quit = seq >= pool->submitted;
+		pthread_mutex_unlock(&pool->lock);
+		if (quit)
+			return 0;
+		f = open_memstream(&b->buf, &b->len);
+		for (i = 0; i < b->itemsnum; i++)
+			ed_print_item(f, pool->isa, pool->varinfo, &b->items[i], pool->quiet, pool->cols);
+		fclose(f);
+		pthread_mutex_lock(&pool->lock);
+		b->done = 1;
+		pthread_cond_broadcast(&pool->batch_done);
+		pthread_mutex_unlock(&pool->lock);
+	}
+}
+
+static void write_batch(struct print_pool *pool, FILE *out) {
+	struct print_batch *b = &pool->batches[pool->written % PRINT_BATCHES(ed_dis_threads)];
+	pthread_mutex_lock(&pool->lock);
+	while (!b->done)
+		pthread_cond_wait(&pool->batch_done, &pool->lock);
+	pthread_mutex_unlock(&pool->lock);
+	fwrite(b->buf, 1, b->len, out);
+	free(b->buf);
+	b->buf = 0;
+	pool->written++;
+}
+
+static void print_threaded(struct ed_dis *dis, FILE *out, struct print_pool *pool) {
+	struct print_thread *pts = calloc(ed_dis_threads, sizeof *pts);
+	struct print_batch *b;
+	const struct ed_item *item;
+	int i;
+	pool->batches = calloc(PRINT_BATCHES(ed_dis_threads), sizeof *pool->batches);
+	pthread_mutex_init(&pool->lock, 0);
+	pthread_cond_init(&pool->batch_submitted, 0);
+	pthread_cond_init(&pool->batch_done, 0);
+	for (i = 0; i < ed_dis_threads; i++) {
+		pts[i].pool = pool;
+		pts[i].idx = i;
+		pthread_create(&pts[i].thread, 0, print_batches, &pts[i]);
+	}
+	do {
+		if (pool->submitted - pool->written == PRINT_BATCHES(ed_dis_threads)) {
+			while (pool->written < pool->submitted)
+				write_batch(pool, out);
+			ed_dis_release(dis);
 		}
-		fprintf (out, "%s\n", cols->reset);
-		cur += dres->oplen;
+		b = &pool->batches[pool->submitted % PRINT_BATCHES(ed_dis_threads)];
+		b->itemsnum = 0;
+		b->done = 0;
+		while (b->itemsnum < PRINT_BATCH && (item = ed_dis_next(dis)))
+			b->items[b->itemsnum++] = *item;
+		pthread_mutex_lock(&pool->lock);
+		pool->submitted++;
+		pthread_cond_broadcast(&pool->batch_submitted);
+		pthread_mutex_unlock(&pool->lock);
+	} while (b->itemsnum == PRINT_BATCH);
+	while (pool->written < pool->submitted)
+		write_batch(pool, out);
+	pthread_mutex_lock(&pool->lock);
+	pool->quit = 1;
+	pthread_cond_broadcast(&pool->batch_submitted);
+	pthread_mutex_unlock(&pool->lock);
+	for (i = 0; i < ed_dis_threads; i++)
+		pthread_join(pts[i].thread, 0);
+	pthread_cond_destroy(&pool->batch_done);
+	pthread_cond_destroy(&pool->batch_submitted);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool->batches);
+	free(pts);
+}
 
-		dis_del_res(dres);
+void envydis (const struct disisa *isa, FILE *out, uint8_t *code, uint32_t start, int num, struct varinfo *varinfo, int quiet, struct label *labels, int labelsnum, const struct envy_colors *cols)
+{
+	struct ed_dis *dis = ed_dis_new(isa, varinfo, code, start, num, labels, labelsnum);
+	const struct ed_item *item;
+	int i = 0;
+	if (ed_dis_threads > 1) {
+		struct print_pool pool = { isa, varinfo, quiet, cols };
+		print_threaded(dis, out, &pool);
+	} else {
+		while ((item = ed_dis_next(dis))) {
+			ed_print_item(out, isa, varinfo, item, quiet, cols);
+			if (++i % PRINT_BATCH == 0)
+				ed_dis_release(dis);
+		}
 	}
-	free(ctx->marks);
-	free(ctx->names);
+	ed_dis_del(dis);
 }
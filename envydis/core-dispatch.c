@@ -0,0 +1,371 @@
+/*
+ * Copyright (C) 2026 The envytools authors.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "dis-intern.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Compiled opcode dispatch
+ *
+ * atomtab_d finds the matching entry by walking a table from the start,
+ * which for the big shader ISA tables means hundreds of mask compares per
+ * level. Since which entries can match at all only depends on the variant
+ * and mode, each table is compiled, once per variant/mode combination, into
+ * a decision tree: a node picks up to DT_MAXBITS opcode bits that tell the
+ * entries apart and indexes its children with them, and a leaf is a short
+ * list of the entries still possible there, checked in table order like
+ * before. An entry goes into every child its own mask and value allow, and
+ * a child's list is cut after the first entry its bits fully determine, so
+ * the first match is the same one the linear walk would find.
+ *
+ * Tables aren't terminated by anything but an entry matching everything
+ * that's left, so a table ends at the first entry with an empty mask, or
+ * once its entries cover all opcodes. A table that doesn't end within
+ * DT_MAXENTS entries isn't compiled and keeps being walked.
+ */
+
+#define DT_MAXBITS 8
+#define DT_LEAF 4
+#define DT_MAXDEPTH 6
+#define DT_MAXENTS 4096
+#define DT_COVER_BUDGET 20000
+
+int ed_linear_dispatch;
+
+/* the atoms an entry actually has, with atomtab_d ones compiled too */
+struct ed_datom {
+	dfun fun;
+	const void *arg;
+	struct ed_dtab *sub;
+};
+
+struct ed_dent {
+	/* copied from the insn, so that matching doesn't touch it */
+	ull val;
+	ull mask;
+	const struct insn *insn;
+	struct ed_datom *atoms;
+	int atomsnum;
+};
+
+struct ed_dtab {
+	/* the table this was compiled from */
+	const struct insn *tab;
+	/* couldn't be compiled, use atomtab_d */
+	int linear;
+	int nbits;
+	uint8_t bits[DT_MAXBITS];
+	/* inner nodes: 1 << nbits children */
+	struct ed_dtab **next;
+	/* leaves: candidates, in table order */
+	struct ed_dent **ents;
+	int entsnum;
+};
+
+struct ed_dmap {
+	const struct insn *tab;
+	struct ed_dtab *dtab;
+};
+
+struct ed_dispatch {
+	struct ed_dispatch *next;
+	uint32_t fmask;
+	int mode;
+	struct ed_dtab *root;
+	struct ed_dtab *sched;
+	/* compiled tables by source table */
+	struct ed_dmap *map;
+	size_t mapsize;
+	size_t mapused;
+	/* everything allocated, for freeing */
+	struct ed_dtab **nodes;
+	int nodesnum;
+	int nodesmax;
+	struct ed_dent **dents;
+	int dentsnum;
+	int dentsmax;
+};
+
+static struct ed_dmap *map_slot(struct ed_dispatch *d, const struct insn *tab) {
+	size_t i = ((uintptr_t)tab >> 4) * 0x9e3779b97f4a7c15ull >> 20 & (d->mapsize - 1);
+	while (d->map[i].tab && d->map[i].tab != tab)
+		i = (i + 1) & (d->mapsize - 1);
+	return &d->map[i];
+}
+
+static void map_add(struct ed_dispatch *d, const struct insn *tab, struct ed_dtab *dtab) {
+	struct ed_dmap *slot;
+	if (d->mapused * 2 >= d->mapsize) {
+		struct ed_dmap *old = d->map;
+		size_t oldsize = d->mapsize, i;
+		d->mapsize = oldsize ? oldsize * 2 : 256;
+		d->map = calloc(d->mapsize, sizeof *d->map);
+		for (i = 0; i < oldsize; i++)
+			if (old[i].tab)
+				*map_slot(d, old[i].tab) = old[i];
+		free(old);
+	}
+	slot = map_slot(d, tab);
+	slot->tab = tab;
+	slot->dtab = dtab;
+	d->mapused++;
+}
+
+static struct ed_dtab *new_node(struct ed_dispatch *d, const struct insn *tab) {
+	struct ed_dtab *n = calloc(sizeof *n, 1);
+	n->tab = tab;
+	ADDARRAY(d->nodes, n);
+	return n;
+}
+
+static int consistent(const struct insn *e, ull fixm, ull fixv) {
+	return !((e->val ^ fixv) & e->mask & fixm);
+}
+
+/* whether the entries match every opcode with the given bits fixed */
+static int covers(struct ed_dent **ents, int num, ull fixm, ull fixv, int *budget) {
+	ull bit = 0;
+	int i;
+	if (--*budget < 0)
+		return 0;
+	for (i = 0; i < num; i++) {
+		const struct insn *e = ents[i]->insn;
+		if (!consistent(e, fixm, fixv))
+			continue;
+		if (!(e->mask & ~fixm))
+			return 1;
+		if (!bit)
+			bit = (e->mask & ~fixm) & -(e->mask & ~fixm);
+	}
+	if (!bit)
+		return 0;
+	return covers(ents, num, fixm | bit, fixv, budget) && covers(ents, num, fixm | bit, fixv | bit, budget);
+}
+
+static struct ed_dtab *compile_tab(struct ed_dispatch *d, const struct insn *tab, struct varinfo *varinfo);
+
+static void build(struct ed_dispatch *d, struct ed_dtab *n, struct ed_dent **ents, int num, ull used, int depth) {
+	int cnt[2][64] = { 0 };
+	int bits[64], nbits = 0, total, i, j, k;
+	struct ed_dent ***lists = 0;
+	int *lens = 0;
+	if (num <= DT_LEAF || depth >= DT_MAXDEPTH)
+		goto leaf;
+	for (i = 0; i < num; i++)
+		for (j = 0; j < 64; j++)
+			if (ents[i]->insn->mask >> j & 1)
+				cnt[ents[i]->insn->val >> j & 1][j]++;
+	/* bits the entries disagree on, most often constrained first */
+	for (j = 0; j < 64; j++)
+		if (cnt[0][j] && cnt[1][j] && !(used >> j & 1))
+			bits[nbits++] = j;
+	for (i = 1; i < nbits; i++)
+		for (j = i; j > 0 && cnt[0][bits[j]] + cnt[1][bits[j]] > cnt[0][bits[j-1]] + cnt[1][bits[j-1]]; j--) {
+			int t = bits[j];
+			bits[j] = bits[j-1];
+			bits[j-1] = t;
+		}
+	if (nbits > DT_MAXBITS)
+		nbits = DT_MAXBITS;
+	for (; nbits > 0; nbits--) {
+		ull sel = 0;
+		for (j = 0; j < nbits; j++)
+			sel |= 1ull << bits[j];
+		lists = calloc(1 << nbits, sizeof *lists);
+		lens = calloc(1 << nbits, sizeof *lens);
+		total = 0;
+		for (k = 0; k < 1 << nbits; k++) {
+			ull fixv = 0;
+			for (j = 0; j < nbits; j++)
+				if (k >> j & 1)
+					fixv |= 1ull << bits[j];
+			lists[k] = malloc(num * sizeof **lists);
+			for (i = 0; i < num; i++) {
+				const struct insn *e = ents[i]->insn;
+				if (!consistent(e, sel, fixv))
+					continue;
+				lists[k][lens[k]++] = ents[i];
+				/* always matches here, nothing after it can */
+				if (!(e->mask & ~(used | sel)))
+					break;
+			}
+			total += lens[k];
+		}
+		/* don't let entries that ignore the chosen bits multiply too much */
+		if (total <= 4 * num + (2 << nbits) || nbits == 1)
+			break;
+		for (k = 0; k < 1 << nbits; k++)
+			free(lists[k]);
+		free(lists);
+		free(lens);
+		lists = 0;
+	}
+	if (!lists)
+		goto leaf;
+	n->nbits = nbits;
+	for (j = 0; j < nbits; j++) {
+		n->bits[j] = bits[j];
+		used |= 1ull << bits[j];
+	}
+	n->next = calloc(1 << nbits, sizeof *n->next);
+	for (k = 0; k < 1 << nbits; k++) {
+		struct ed_dtab *c = new_node(d, n->tab);
+		build(d, c, lists[k], lens[k], used, lens[k] < num ? depth + 1 : DT_MAXDEPTH);
+		n->next[k] = c;
+		free(lists[k]);
+	}
+	free(lists);
+	free(lens);
+	return;
+leaf:
+	n->ents = malloc((num ? num : 1) * sizeof *n->ents);
+	memcpy(n->ents, ents, num * sizeof *n->ents);
+	n->entsnum = num;
+}
+
+static struct ed_dtab *compile_tab(struct ed_dispatch *d, const struct insn *tab, struct varinfo *varinfo) {
+	struct ed_dmap *slot = d->mapsize ? map_slot(d, tab) : 0;
+	struct ed_dent **ents = 0;
+	int entsnum = 0, entsmax = 0, i, j, ended = 0;
+	struct ed_dtab *n;
+	if (slot && slot->tab)
+		return slot->dtab;
+	n = new_node(d, tab);
+	/* before the subtables, in case some table contains itself */
+	map_add(d, tab, n);
+	for (i = 0; i < DT_MAXENTS && !ended; i++) {
+		const struct insn *e = &tab[i];
+		struct ed_dent *de;
+		int budget = DT_COVER_BUDGET;
+		if (!var_ok(e->fmask, e->ptype, varinfo) || e->val & ~e->mask)
+			continue;
+		de = calloc(sizeof *de, 1);
+		de->val = e->val;
+		de->mask = e->mask;
+		de->insn = e;
+		ADDARRAY(d->dents, de);
+		ADDARRAY(ents, de);
+		ended = !e->mask || covers(ents, entsnum, 0, 0, &budget);
+	}
+	if (!ended) {
+		n->linear = 1;
+		free(ents);
+		return n;
+	}
+	for (i = 0; i < entsnum; i++) {
+		struct ed_dent *de = ents[i];
+		for (j = 0; j < ARRAY_SIZE(de->insn->atoms); j++)
+			if (de->insn->atoms[j].fun_dis)
+				de->atomsnum++;
+		de->atoms = calloc(de->atomsnum ? de->atomsnum : 1, sizeof *de->atoms);
+		de->atomsnum = 0;
+		for (j = 0; j < ARRAY_SIZE(de->insn->atoms); j++) {
+			const struct atom *atom = &de->insn->atoms[j];
+			if (!atom->fun_dis)
+				continue;
+			de->atoms[de->atomsnum].fun = atom->fun_dis;
+			de->atoms[de->atomsnum].arg = atom->arg;
+			if (atom->fun_dis == atomtab_d)
+				de->atoms[de->atomsnum].sub = compile_tab(d, atom->arg, varinfo);
+			de->atomsnum++;
+		}
+	}
+	build(d, n, ents, entsnum, 0, 0);
+	free(ents);
+	return n;
+}
+
+const struct ed_dispatch *ed_get_dispatch(const struct disisa *isa, struct varinfo *varinfo) {
+	struct disisa *misa = (struct disisa *)isa;
+	struct ed_dispatch *d;
+	/* ISAs without features or modes have nothing to look at in varinfo */
+	uint32_t fmask = varinfo->data->featuresnum ? varinfo->fmask[0] : 0;
+	int mode = varinfo->data->modesetsnum ? varinfo->modes[0] : 0;
+	for (d = isa->dispatch; d; d = d->next)
+		if (d->fmask == fmask && d->mode == mode)
+			return d;
+	d = calloc(sizeof *d, 1);
+	d->fmask = fmask;
+	d->mode = mode;
+	d->root = compile_tab(d, isa->troot, varinfo);
+	if (isa->tsched)
+		d->sched = compile_tab(d, isa->tsched, varinfo);
+	d->next = misa->dispatch;
+	misa->dispatch = d;
+	return d;
+}
+
+const struct ed_dtab *ed_dispatch_root(const struct ed_dispatch *d, int sched) {
+	return sched ? d->sched : d->root;
+}
+
+void ed_free_dispatch(struct disisa *isa) {
+	while (isa->dispatch) {
+		struct ed_dispatch *d = isa->dispatch;
+		int i;
+		isa->dispatch = d->next;
+		for (i = 0; i < d->nodesnum; i++) {
+			free(d->nodes[i]->next);
+			free(d->nodes[i]->ents);
+			free(d->nodes[i]);
+		}
+		for (i = 0; i < d->dentsnum; i++) {
+			free(d->dents[i]->atoms);
+			free(d->dents[i]);
+		}
+		free(d->nodes);
+		free(d->dents);
+		free(d->map);
+		free(d);
+	}
+}
+
+void ed_dispatch_d(struct disctx *ctx, ull *a, ull *m, const struct ed_dtab *n) {
+	const struct ed_dtab *tab = n;
+	const struct ed_dent *e = 0;
+	int i;
+	while (n->nbits) {
+		int idx = 0;
+		for (i = 0; i < n->nbits; i++)
+			idx |= (a[0] >> n->bits[i] & 1) << i;
+		n = n->next[idx];
+	}
+	for (i = 0; i < n->entsnum; i++)
+		if ((a[0] & n->ents[i]->mask) == n->ents[i]->val) {
+			e = n->ents[i];
+			break;
+		}
+	if (tab->linear || !e) {
+		atomtab_d(ctx, a, m, tab->tab);
+		return;
+	}
+	m[0] |= e->mask;
+	for (i = 0; i < e->atomsnum; i++) {
+		if (e->atoms[i].sub)
+			ed_dispatch_d(ctx, a, m, e->atoms[i].sub);
+		else
+			e->atoms[i].fun(ctx, a, m, e->atoms[i].arg);
+	}
+}
@@ -79,6 +79,8 @@ const struct disisa *ed_getisa(const char *name) {
 void ed_freeisa(const struct disisa *isa) {
 	if (!isa->prepdone)
 		return;
+	ed_free_dispatch((struct disisa *)isa);
+	ed_free_asindex((struct disisa *)isa);
 	vardata_del(isa->vardata);
 	((struct disisa *)isa)->prepdone = 0;
 }
@@ -80,7 +80,7 @@
 
 typedef unsigned long long ull;
 
-#define MAXOPLEN (128/64)
+#define MAXOPLEN ED_MAXOPLEN
 
 struct iasctx;
 struct disctx;
@@ -222,6 +222,30 @@ struct litem {
 struct matches *atomtab_a APROTO;
 void atomtab_d DPROTO;
 
+/*
+ * Tables compiled into decision trees for decoding, once per variant and
+ * mode. See core-dispatch.c.
+ */
+struct ed_dispatch;
+struct ed_dtab;
+const struct ed_dispatch *ed_get_dispatch(const struct disisa *isa, struct varinfo *varinfo);
+const struct ed_dtab *ed_dispatch_root(const struct ed_dispatch *d, int sched);
+void ed_dispatch_d(struct disctx *ctx, ull *a, ull *m, const struct ed_dtab *dtab);
+void ed_free_dispatch(struct disisa *isa);
+/* set to decode by walking the tables, for comparison */
+extern int ed_linear_dispatch;
+
+/*
+ * Table entries by what they can start with, for assembling. See
+ * core-asindex.c.
+ */
+struct ed_asindex;
+struct ed_asindex *ed_get_asindex(const struct disisa *isa);
+const int *ed_asindex_ents(struct ed_asindex *x, const struct insn *tab, struct litem **atoms, int atomsnum, int spos, int *num);
+void ed_free_asindex(struct disisa *isa);
+/* set to assemble by trying every entry, for comparison */
+extern int ed_linear_as;
+
 #define OP1B atomopl_a, atomopl_d, op1blen
 #define OP2B atomopl_a, atomopl_d, op2blen
 #define OP3B atomopl_a, atomopl_d, op3blen
@@ -50,6 +50,26 @@
  * Refer to docs/envydis/index.rst for ISA details
  */
 
+/* what the layout keeps of a line between passes */
+struct ldep {
+	int label;
+	ull val;
+};
+
+struct lstate {
+	int sect;	/* .section */
+	int label;	/* labels and .equ */
+	/* instructions: where they were last resolved, if they fit, and the labels used */
+	int resolved;
+	ull rpos;
+	struct ldep *deps;
+	int depsnum;
+	int depsmax;
+	/* whether they resolve the same when moved along with all their labels */
+	int shiftok;
+	ull shiftmask;
+};
+
 struct asctx {
 	const struct disisa *isa;
 	struct varinfo *varinfo;
@@ -58,11 +78,13 @@ struct asctx {
 	int labelsmax;
 	struct symtab *symtab;
 	const char *cur_global_label;
-	uint32_t pos;
 	struct section *sections;
 	int sectionsnum;
 	int sectionsmax;
 	struct matches *im;
+	struct lstate *lstate;
+	/* where calc notes the labels it uses, if set */
+	struct lstate *deps;
 };
 
 enum envyas_ofmt {
@@ -100,6 +122,10 @@ ull calc (struct easm_expr *expr, struct asctx *ctx) {
 				expr->str = full_label;
 			}
 			if (symtab_get(ctx->symtab, expr->str, 0, &res) != -1) {
+				if (ctx->deps) {
+					struct ldep dep = { res, ctx->labels[res].val };
+					ADDARRAY(ctx->deps->deps, dep);
+				}
 				return ctx->labels[res].val;
 			}
 			fprintf (stderr, LOC_FORMAT(expr->loc, "Undefined label \"%s\"\n"), expr->str);
@@ -151,28 +177,9 @@ ull calc (struct easm_expr *expr, struct asctx *ctx) {
 	}
 }
 
-int resolve (struct asctx *ctx, ull *val, struct match m, ull pos) {
-	int i;
-	for (i = 0; i < m.nrelocs; i++) {
-		ull val = calc(m.relocs[i].expr, ctx);
-		const struct rbitfield *bf = m.relocs[i].bf;
-		ull num = val - bf->addend;
-		if (bf->pcrel)
-			num -= (pos + bf->pospreadd) & -(1ull << bf->shr);
-		num >>= bf->shr;
-		setsbf(&m, bf->sbf[0].pos, bf->sbf[0].len, num);
-		num >>= bf->sbf[0].len;
-		setsbf(&m, bf->sbf[1].pos, bf->sbf[1].len, num);
-		ctx->pos = pos;
-		ull mask = ~0ull;
-		ull totalsz = bf->shr + bf->sbf[0].len + bf->sbf[1].len;
-		if (bf->wrapok && totalsz < 64)
-			mask = (1ull << totalsz) - 1;
-		if ((getrbf_as(bf, m.a, m.m, ctx->pos) & mask) != (val & mask))
-			return 0;
-	}
-	for (i = 0; i < MAXOPLEN; i++)
-		val[i] = m.a[i];
+/* for reloc_as - calc exits by itself on what it can't compute */
+static int calc_reloc (struct easm_expr *expr, void *ctx, ull *res) {
+	*res = calc(expr, ctx);
 	return 1;
 }
 
@@ -259,55 +266,112 @@ int envyas_process(struct asctx *ctx, struct easm_file *file) {
 	return 0;
 }
 
-int envyas_layout(struct asctx *ctx, struct easm_file *file) {
+/*
+ * The layout takes passes over the source: one placing the labels, then
+ * one resolving the instructions, where those that don't fit get their
+ * next, longer form, which moves the labels after them, and so on until
+ * everything fits. Only the first placing pass builds the symbol table and
+ * the sections, later ones just move the labels. And an instruction is only
+ * resolved again when it changed, when a label it uses moved, or when it
+ * moved itself - unless it's position independent, like a relative branch
+ * moving along with its target. Once everything fits, a last pass resolves
+ * everything and writes out the code.
+ */
+
+static int uses_labels(const struct easm_expr *expr) {
+	if (!expr)
+		return 0;
+	return expr->type == EASM_EXPR_LABEL || uses_labels(expr->e1) || uses_labels(expr->e2);
+}
+
+/* resolves an instruction, noting the labels it uses */
+static int resolve_noted(struct asctx *ctx, struct lstate *ls, ull *val, struct match *m, ull pos) {
+	int i;
+	ls->depsnum = 0;
+	ctx->deps = ls;
+	ls->resolved = reloc_as(m, pos, calc_reloc, ctx, val);
+	ctx->deps = 0;
+	ls->rpos = pos;
+	ls->shiftok = 1;
+	ls->shiftmask = 0;
+	for (i = 0; i < m->nrelocs; i++) {
+		const struct rbitfield *bf = m->relocs[i].bf;
+		if (bf->pcrel && m->relocs[i].expr->type == EASM_EXPR_LABEL)
+			ls->shiftmask |= (1ull << bf->shr) - 1;
+		else if (bf->pcrel || uses_labels(m->relocs[i].expr))
+			ls->shiftok = 0;
+	}
+	return ls->resolved;
+}
+
+/* whether an instruction resolved before would resolve the same at pos */
+static int unchanged(struct asctx *ctx, struct lstate *ls, ull pos) {
+	ull d = pos - ls->rpos;
+	int i;
+	if (!ls->resolved)
+		return 0;
+	if (d && (!ls->shiftok || d & ls->shiftmask))
+		return 0;
+	for (i = 0; i < ls->depsnum; i++)
+		if (ctx->labels[ls->deps[i].label].val - ls->deps[i].val != d)
+			return 0;
+	ls->rpos = pos;
+	for (i = 0; i < ls->depsnum; i++)
+		ls->deps[i].val += d;
+	return 1;
+}
+
+/* places the labels, the first time also making the symbol table and sections */
+static int layout_labels(struct asctx *ctx, struct easm_file *file, int stride, int first) {
 	int i, j;
-	int allok = 1;
-	int stride = ed_getcstride(ctx->isa, ctx->varinfo);
-	ctx->symtab = symtab_new();
-	do {
-		symtab_del(ctx->symtab);
-		ctx->symtab = symtab_new();
-		allok = 1;
-		ctx->labelsnum = 0;
-		ctx->cur_global_label = NULL;
-		for (i = 0; i < ctx->sectionsnum; i++)
-			free(ctx->sections[i].code);
-		ctx->sectionsnum = 0;
-		int cursect = 0;
+	int cursect = 0;
+	ctx->cur_global_label = NULL;
+	if (first) {
 		struct section def = { "default" };
 		def.first_label = -1;
 		ADDARRAY(ctx->sections, def);
-		for (i = 0; i < file->linesnum; i++) {
-			struct easm_directive *direct = file->lines[i]->directive;
-			switch (file->lines[i]->type) {
-				case EASM_LINE_INSN:
-					if (ctx->isa->i_need_g80as_hack) {
-						if (ctx->im[i].m[0].oplen == 8 && (ctx->sections[cursect].pos & 7))
-							ctx->sections[cursect].pos &= ~7ull, ctx->sections[cursect].pos += 8;
-					}
-					ctx->sections[cursect].pos += ctx->im[i].m[0].oplen * stride;
+	} else {
+		for (j = 0; j < ctx->sectionsnum; j++)
+			ctx->sections[j].pos = 0;
+	}
+	for (i = 0; i < file->linesnum; i++) {
+		struct easm_directive *direct = file->lines[i]->directive;
+		struct lstate *ls = &ctx->lstate[i];
+		switch (file->lines[i]->type) {
+			case EASM_LINE_INSN:
+				if (ctx->isa->i_need_g80as_hack) {
+					if (ctx->im[i].m[0].oplen == 8 && (ctx->sections[cursect].pos & 7))
+						ctx->sections[cursect].pos &= ~7ull, ctx->sections[cursect].pos += 8;
+				}
+				ctx->sections[cursect].pos += ctx->im[i].m[0].oplen * stride;
+				break;
+			case EASM_LINE_LABEL:
+				if (!first) {
+					ctx->labels[ls->label].val = ctx->sections[cursect].pos / stride + ctx->sections[cursect].base;
 					break;
-				case EASM_LINE_LABEL:
-					if (file->lines[i]->lname[0] == '_' && file->lines[i]->lname[1] != '_') {
-						char *full_label = expand_local_label(file->lines[i]->lname, ctx->cur_global_label);
-						free(file->lines[i]->lname);
-						file->lines[i]->lname = full_label;
-					}
-					else
-						ctx->cur_global_label = file->lines[i]->lname;
+				}
+				if (file->lines[i]->lname[0] == '_' && file->lines[i]->lname[1] != '_') {
+					char *full_label = expand_local_label(file->lines[i]->lname, ctx->cur_global_label);
+					free(file->lines[i]->lname);
+					file->lines[i]->lname = full_label;
+				}
+				else
+					ctx->cur_global_label = file->lines[i]->lname;
 
-					if (symtab_put(ctx->symtab, file->lines[i]->lname, 0, ctx->labelsnum) == -1) {
-						fprintf (stderr, LOC_FORMAT(file->lines[i]->loc, "Label %s redeclared!\n"), file->lines[i]->lname);
-						return 1;
-					}
-					struct label l = { file->lines[i]->lname, ctx->sections[cursect].pos / stride + ctx->sections[cursect].base };
-					if (ctx->sections[cursect].first_label < 0)
-						ctx->sections[cursect].first_label = ctx->labelsnum;
-					ctx->sections[cursect].last_label = ctx->labelsnum;
-					ADDARRAY(ctx->labels, l);
-					break;
-				case EASM_LINE_DIRECTIVE:
-					if (!strcmp(direct->str, "section")) {
+				if (symtab_put(ctx->symtab, file->lines[i]->lname, 0, ctx->labelsnum) == -1) {
+					fprintf (stderr, LOC_FORMAT(file->lines[i]->loc, "Label %s redeclared!\n"), file->lines[i]->lname);
+					return 1;
+				}
+				struct label l = { file->lines[i]->lname, ctx->sections[cursect].pos / stride + ctx->sections[cursect].base };
+				if (ctx->sections[cursect].first_label < 0)
+					ctx->sections[cursect].first_label = ctx->labelsnum;
+				ctx->sections[cursect].last_label = ctx->labelsnum;
+				ls->label = ctx->labelsnum;
+				ADDARRAY(ctx->labels, l);
+				break;
+			case EASM_LINE_DIRECTIVE:
+				if (!strcmp(direct->str, "section")) {
+					if (first) {
 						if (direct->paramsnum > 2) {
 							fprintf (stderr, LOC_FORMAT(direct->loc, "Too many arguments for .section\n"));
 							return 1;
@@ -326,47 +390,52 @@ int envyas_layout(struct asctx *ctx, struct easm_file *file) {
 								s.base = direct->params[1]->num;
 							ADDARRAY(ctx->sections, s);
 						}
-						cursect = j;
-					} else if (!strcmp(direct->str, "align")) {
-						if (direct->paramsnum > 1) {
-							fprintf (stderr, LOC_FORMAT(direct->loc, "Too many arguments for .align\n"));
-							return 1;
-						}
-						if (direct->params[0]->type != EASM_EXPR_NUM) {
-							fprintf (stderr, LOC_FORMAT(direct->loc, "Wrong arguments for .align\n"));
-							return 1;
-						}
-						ull num = direct->params[0]->num;
-						ctx->sections[cursect].pos += num - 1;
-						ctx->sections[cursect].pos /= num;
-						ctx->sections[cursect].pos *= num;
-					} else if (!strcmp(direct->str, "size")) {
-						if (direct->paramsnum > 1) {
-							fprintf (stderr, LOC_FORMAT(direct->loc, "Too many arguments for .size\n"));
-							return 1;
-						}
-						if (direct->params[0]->type != EASM_EXPR_NUM) {
-							fprintf (stderr, LOC_FORMAT(direct->loc, "Wrong arguments for .size\n"));
-							return 1;
-						}
-						ull num = direct->params[0]->num;
-						if (ctx->sections[cursect].pos > num) {
-							fprintf (stderr, LOC_FORMAT(direct->loc, "Section '%s' exceeds .size by %llu bytes\n"), ctx->sections[cursect].name, ctx->sections[cursect].pos - num);
-							return 1;
-						}
-						ctx->sections[cursect].pos = num;
-					} else if (!strcmp(direct->str, "skip")) {
-						if (direct->paramsnum > 1) {
-							fprintf (stderr, LOC_FORMAT(direct->loc, "Too many arguments for .skip\n"));
-							return 1;
-						}
-						if (direct->params[0]->type != EASM_EXPR_NUM) {
-							fprintf (stderr, LOC_FORMAT(direct->loc, "Wrong arguments for .skip\n"));
-							return 1;
-						}
-						ull num = direct->params[0]->num;
-						ctx->sections[cursect].pos += num;
-					} else if (!strcmp(direct->str, "equ")) {
+						ls->sect = j;
+					}
+					cursect = ls->sect;
+				} else if (!strcmp(direct->str, "align")) {
+					if (direct->paramsnum > 1) {
+						fprintf (stderr, LOC_FORMAT(direct->loc, "Too many arguments for .align\n"));
+						return 1;
+					}
+					if (direct->params[0]->type != EASM_EXPR_NUM) {
+						fprintf (stderr, LOC_FORMAT(direct->loc, "Wrong arguments for .align\n"));
+						return 1;
+					}
+					ull num = direct->params[0]->num;
+					ctx->sections[cursect].pos += num - 1;
+					ctx->sections[cursect].pos /= num;
+					ctx->sections[cursect].pos *= num;
+				} else if (!strcmp(direct->str, "size")) {
+					if (direct->paramsnum > 1) {
+						fprintf (stderr, LOC_FORMAT(direct->loc, "Too many arguments for .size\n"));
+						return 1;
+					}
+					if (direct->params[0]->type != EASM_EXPR_NUM) {
+						fprintf (stderr, LOC_FORMAT(direct->loc, "Wrong arguments for .size\n"));
+						return 1;
+					}
+					ull num = direct->params[0]->num;
+					if (ctx->sections[cursect].pos > num) {
+						fprintf (stderr, LOC_FORMAT(direct->loc, "Section '%s' exceeds .size by %llu bytes\n"), ctx->sections[cursect].name, ctx->sections[cursect].pos - num);
+						return 1;
+					}
+					ctx->sections[cursect].pos = num;
+				} else if (!strcmp(direct->str, "skip")) {
+					if (direct->paramsnum > 1) {
+						fprintf (stderr, LOC_FORMAT(direct->loc, "Too many arguments for .skip\n"));
+						return 1;
+					}
+					if (direct->params[0]->type != EASM_EXPR_NUM) {
+						fprintf (stderr, LOC_FORMAT(direct->loc, "Wrong arguments for .skip\n"));
+						return 1;
+					}
+					ull num = direct->params[0]->num;
+					ctx->sections[cursect].pos += num;
+				} else if (!strcmp(direct->str, "equ")) {
+					if (!first) {
+						ctx->labels[ls->label].val = calc(direct->params[1], ctx);
+					} else {
 						if (direct->paramsnum != 2
 							|| direct->params[0]->type != EASM_EXPR_LABEL
 							|| !easm_isimm(direct->params[1])) {
@@ -384,99 +453,154 @@ int envyas_layout(struct asctx *ctx, struct easm_file *file) {
 							return 1;
 						}
 						struct label l = { direct->params[0]->str, num , /* Distinguish .equ labels from regular labels */ 1 };
+						ls->label = ctx->labelsnum;
 						ADDARRAY(ctx->labels, l);
-					} else if (!donum(&ctx->sections[cursect], direct, ctx, 0)) {
-						fprintf (stderr, LOC_FORMAT(direct->loc, "Unknown directive .%s\n"), direct->str);
-						return 1;
 					}
-					break;
-			}
+				} else if (!donum(&ctx->sections[cursect], direct, ctx, 0)) {
+					fprintf (stderr, LOC_FORMAT(direct->loc, "Unknown directive .%s\n"), direct->str);
+					return 1;
+				}
+				break;
 		}
-		cursect = 0;
-		ctx->cur_global_label = NULL;
-		for (j = 0; j < ctx->sectionsnum; j++)
-			ctx->sections[j].pos = 0;
-		ull val[MAXOPLEN];
-		for (i = 0; i < file->linesnum; i++) {
-			struct easm_directive *direct = file->lines[i]->directive;
-			switch (file->lines[i]->type) {
-				case EASM_LINE_INSN:
-					if (!resolve(ctx, val, ctx->im[i].m[0], ctx->sections[cursect].pos / stride + ctx->sections[cursect].base)) {
-						ctx->sections[cursect].pos += ctx->im[i].m[0].oplen * stride;
-						ctx->im[i].m++;
-						ctx->im[i].mnum--;
-						if (!ctx->im[i].mnum) {
-							fprintf (stderr, LOC_FORMAT(file->lines[i]->loc, "Relocation failed\n"));
-							return 1;
-						}
-						allok = 0;
-					} else {
-						if (ctx->isa->i_need_g80as_hack) {
-							if (ctx->im[i].m[0].oplen == 8 && (ctx->sections[cursect].pos & 7)) {
-								j = i - 1;
-								while (j != -1ull && file->lines[j]->type == EASM_LINE_LABEL)
-									j--;
-								assert (j != -1ull && file->lines[j]->type == EASM_LINE_INSN);
-								if (ctx->im[j].m[0].oplen == 4) {
-									ctx->im[j].m++;
-									ctx->im[j].mnum--;
+	}
+	return 0;
+}
+
+/*
+ * Resolves the instructions, giving the next form to those that don't fit.
+ * Returns 1 if all of them did, 0 if the labels have to be placed again, -1
+ * on error. With emit, resolves everything and writes out the code.
+ */
+static int layout_resolve(struct asctx *ctx, struct easm_file *file, int stride, int emit) {
+	int i, j;
+	int allok = 1;
+	int cursect = 0;
+	ull val[MAXOPLEN];
+	ctx->cur_global_label = NULL;
+	for (j = 0; j < ctx->sectionsnum; j++)
+		ctx->sections[j].pos = 0;
+	for (i = 0; i < file->linesnum; i++) {
+		struct easm_directive *direct = file->lines[i]->directive;
+		struct lstate *ls = &ctx->lstate[i];
+		ull pos;
+		int ok;
+		switch (file->lines[i]->type) {
+			case EASM_LINE_INSN:
+				pos = ctx->sections[cursect].pos / stride + ctx->sections[cursect].base;
+				if (emit)
+					ok = reloc_as(&ctx->im[i].m[0], pos, calc_reloc, ctx, val);
+				else
+					ok = unchanged(ctx, ls, pos) || resolve_noted(ctx, ls, val, &ctx->im[i].m[0], pos);
+				if (!ok) {
+					ctx->sections[cursect].pos += ctx->im[i].m[0].oplen * stride;
+					ctx->im[i].m++;
+					ctx->im[i].mnum--;
+					if (!ctx->im[i].mnum) {
+						fprintf (stderr, LOC_FORMAT(file->lines[i]->loc, "Relocation failed\n"));
+						return -1;
+					}
+					allok = 0;
+				} else {
+					if (ctx->isa->i_need_g80as_hack) {
+						if (ctx->im[i].m[0].oplen == 8 && (ctx->sections[cursect].pos & 7)) {
+							j = i - 1;
+							while (j != -1ull && file->lines[j]->type == EASM_LINE_LABEL)
+								j--;
+							assert (j != -1ull && file->lines[j]->type == EASM_LINE_INSN);
+							if (ctx->im[j].m[0].oplen == 4) {
+								if (ctx->im[j].mnum == 1) {
+									fprintf (stderr, LOC_FORMAT(file->lines[j]->loc, "No long form to align the next instruction\n"));
+									return -1;
 								}
-								allok = 0;
-								ctx->sections[cursect].pos &= ~7ull, ctx->sections[cursect].pos += 8;
+								ctx->im[j].m++;
+								ctx->im[j].mnum--;
+								ctx->lstate[j].resolved = 0;
 							}
+							allok = 0;
+							ctx->sections[cursect].pos &= ~7ull, ctx->sections[cursect].pos += 8;
 						}
-						extend(&ctx->sections[cursect], ctx->im[i].m[0].oplen * stride);
-						for (j = 0; j < ctx->im[i].m[0].oplen * stride; j++)
-							ctx->sections[cursect].code[ctx->sections[cursect].pos++] = val[j>>3] >> (8*(j&7));
 					}
-					break;
-				case EASM_LINE_LABEL:
-					if (file->lines[i]->lname[0] != '_')
-						ctx->cur_global_label = file->lines[i]->lname;
-					break;
-				case EASM_LINE_DIRECTIVE:
-					if (!strcmp(direct->str, "section")) {
-						for (j = 0; j < ctx->sectionsnum; j++)
-							if (!strcmp(ctx->sections[j].name, direct->params[0]->str))
-								break;
-						cursect = j;
-					} else if (!strcmp(direct->str, "align")) {
-						ull num = direct->params[0]->num;
-						ull oldpos = ctx->sections[cursect].pos;
-						ctx->sections[cursect].pos += num - 1;
-						ctx->sections[cursect].pos /= num;
-						ctx->sections[cursect].pos *= num;
+					if (!emit) {
+						ctx->sections[cursect].pos += ctx->im[i].m[0].oplen * stride;
+						break;
+					}
+					extend(&ctx->sections[cursect], ctx->im[i].m[0].oplen * stride);
+					for (j = 0; j < ctx->im[i].m[0].oplen * stride; j++)
+						ctx->sections[cursect].code[ctx->sections[cursect].pos++] = val[j>>3] >> (8*(j&7));
+				}
+				break;
+			case EASM_LINE_LABEL:
+				if (file->lines[i]->lname[0] != '_')
+					ctx->cur_global_label = file->lines[i]->lname;
+				break;
+			case EASM_LINE_DIRECTIVE:
+				if (!strcmp(direct->str, "section")) {
+					for (j = 0; j < ctx->sectionsnum; j++)
+						if (!strcmp(ctx->sections[j].name, direct->params[0]->str))
+							break;
+					cursect = j;
+				} else if (!strcmp(direct->str, "align")) {
+					ull num = direct->params[0]->num;
+					ull oldpos = ctx->sections[cursect].pos;
+					ctx->sections[cursect].pos += num - 1;
+					ctx->sections[cursect].pos /= num;
+					ctx->sections[cursect].pos *= num;
+					if (emit) {
 						extend(&ctx->sections[cursect], 0);
 						for (j = oldpos; j < ctx->sections[cursect].pos; j++)
 							ctx->sections[cursect].code[j] = 0;
-					} else if (!strcmp(direct->str, "size")) {
-						ull num = direct->params[0]->num;
-						ull oldpos = ctx->sections[cursect].pos;
-						if (ctx->sections[cursect].pos > num) {
-							fprintf (stderr, LOC_FORMAT(direct->loc, "Section '%s' exceeds .size by %llu bytes\n"), ctx->sections[cursect].name, ctx->sections[cursect].pos - num);
-							return 1;
-						}
-						ctx->sections[cursect].pos = num;
+					}
+				} else if (!strcmp(direct->str, "size")) {
+					ull num = direct->params[0]->num;
+					ull oldpos = ctx->sections[cursect].pos;
+					if (ctx->sections[cursect].pos > num) {
+						fprintf (stderr, LOC_FORMAT(direct->loc, "Section '%s' exceeds .size by %llu bytes\n"), ctx->sections[cursect].name, ctx->sections[cursect].pos - num);
+						return -1;
+					}
+					ctx->sections[cursect].pos = num;
+					if (emit) {
 						extend(&ctx->sections[cursect], 0);
 						for (j = oldpos; j < ctx->sections[cursect].pos; j++)
 							ctx->sections[cursect].code[j] = 0;
-					} else if (!strcmp(direct->str, "skip")) {
-						ull num = direct->params[0]->num;
-						ull oldpos = ctx->sections[cursect].pos;
-						ctx->sections[cursect].pos += num;
+					}
+				} else if (!strcmp(direct->str, "skip")) {
+					ull num = direct->params[0]->num;
+					ull oldpos = ctx->sections[cursect].pos;
+					ctx->sections[cursect].pos += num;
+					if (emit) {
 						extend(&ctx->sections[cursect], 0);
 						for (j = oldpos; j < ctx->sections[cursect].pos; j++)
 							ctx->sections[cursect].code[j] = 0;
-					} else if (!strcmp(direct->str, "equ")) {
-						/* nothing to be done */
-					} else if (!donum(&ctx->sections[cursect], direct, ctx, 1)) {
-						fprintf (stderr, LOC_FORMAT(direct->loc, "Unknown directive .%s\n"), direct->str);
-						return 1;
 					}
-			}
+				} else if (!strcmp(direct->str, "equ")) {
+					/* nothing to be done */
+				} else if (!donum(&ctx->sections[cursect], direct, ctx, emit)) {
+					fprintf (stderr, LOC_FORMAT(direct->loc, "Unknown directive .%s\n"), direct->str);
+					return -1;
+				}
 		}
-	} while (!allok);
-	return 0;
+	}
+	return allok;
+}
+
+int envyas_layout(struct asctx *ctx, struct easm_file *file) {
+	int stride = ed_getcstride(ctx->isa, ctx->varinfo);
+	int res, i;
+	ctx->symtab = symtab_new();
+	ctx->lstate = calloc(sizeof *ctx->lstate, file->linesnum);
+	res = layout_labels(ctx, file, stride, 1) ? -1 : 0;
+	while (!res && !(res = layout_resolve(ctx, file, stride, 0)))
+		if (layout_labels(ctx, file, stride, 0))
+			res = -1;
+	if (res > 0) {
+		res = layout_resolve(ctx, file, stride, 1);
+		assert (res == 1);
+	}
+	for (i = 0; i < file->linesnum; i++)
+		free(ctx->lstate[i].deps);
+	free(ctx->lstate);
+	ctx->lstate = 0;
+	return res < 0;
 }
 
 int envyas_output(struct asctx *ctx, enum envyas_ofmt ofmt, const char *outname, int stride) {
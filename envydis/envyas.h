@@ -53,4 +53,11 @@ ull getrbf_as(const struct rbitfield *bf, ull *a, ull *m, ull cpos);
 
 struct matches *do_as(const struct disisa *isa, struct varinfo *varinfo, struct easm_insn *insn);
 
+/*
+ * Encodes a match for an instruction at pos into val, filling in the
+ * relocations do_as left: calc gives the value of their expressions, or 0
+ * if it can't. Returns 0 if it couldn't, or if a value doesn't fit.
+ */
+int reloc_as(const struct match *match, ull pos, int (*calc)(struct easm_expr *expr, void *arg, ull *res), void *arg, ull *val);
+
 #endif
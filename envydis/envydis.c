@@ -29,13 +29,17 @@
 #include <unistd.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 /*
  * Options:
  *
  *  -b <base>    Use a fake base address
- *  -d <num>     Discarad this many initial bytes of the input
- *  -l <num>     Limit disassembling to <num> bytes of input
+ *  -d <num>     Discard this many initial bytes of the input
+ *  -l <num>     Limit disassembling to <num> code units of input
  *
  *  -w           Treat input as a sequence of 32-bit words instead of bytes
  *  -W           Treat input as a sequence of 64-bit words instead of bytes
@@ -53,10 +57,93 @@
  *
  *  -n           Disable color escape sequences in output
  *  -q           Disable printing address + opcodes
+ *  -j <threads> Decode and print with several threads
  *
  * Refer to docs/envydis/index.rst for ISA details
  */
 
+/*
+ * The input: regular files are mapped, so that only the part of a big dump
+ * that's disassembled is ever read, anything else is read up to max bytes.
+ */
+struct input {
+	uint8_t *data;
+	size_t len;
+};
+
+static int input_open(struct input *in, FILE *f, size_t max) {
+	struct stat st;
+	size_t size;
+	if (!fstat(fileno(f), &st) && S_ISREG(st.st_mode) && st.st_size > 0 && !ftello(f)) {
+		in->len = min((uint64_t)st.st_size, max);
+		in->data = mmap(0, in->len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(f), 0);
+		if (in->data != MAP_FAILED)
+			return 0;
+	}
+	in->data = 0;
+	in->len = 0;
+	size = 0;
+	while (in->len < max) {
+		size_t got;
+		if (in->len == size) {
+			size = size ? size * 2 : 0x10000;
+			in->data = realloc(in->data, size);
+		}
+		got = fread(in->data + in->len, 1, min(size, max) - in->len, f);
+		if (!got)
+			break;
+		in->len += got;
+	}
+	if (ferror(f)) {
+		perror("read");
+		return 1;
+	}
+	return 0;
+}
+
+static int hexval(int c) {
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+/*
+ * Reads a number from hex input like fscanf "%llx" followed by " ," did:
+ * numbers are separated by whitespace and optionally a comma. Returns 0 at
+ * the end, and at anything that isn't a number.
+ */
+static int next_hex(const uint8_t **pp, const uint8_t *end, unsigned long long *res) {
+	const uint8_t *p = *pp;
+	unsigned long long v = 0;
+	int neg = 0, digits = 0, ovf = 0, d;
+	while (p < end && isspace(*p))
+		p++;
+	if (p < end && (*p == '+' || *p == '-'))
+		neg = *p++ == '-';
+	if (end - p >= 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+		p += 2;
+		digits++;
+	}
+	for (; p < end && (d = hexval(*p)) >= 0; p++, digits++) {
+		if (v >> 60)
+			ovf = 1;
+		v = v << 4 | d;
+	}
+	if (!digits)
+		return 0;
+	while (p < end && isspace(*p))
+		p++;
+	if (p < end && *p == ',')
+		p++;
+	*pp = p;
+	*res = ovf ? ~0ull : neg ? -v : v;
+	return 1;
+}
+
 int main(int argc, char **argv) {
 	FILE *infile = stdin;
 	const struct disisa *isa = 0;
@@ -85,7 +172,7 @@ int main(int argc, char **argv) {
 	}
 	int c;
 	unsigned base = 0, skip = 0, limit = 0;
-	while ((c = getopt (argc, argv, "b:d:l:m:V:O:F:wWinqu:M:S:")) != -1)
+	while ((c = getopt (argc, argv, "b:d:l:m:V:O:F:wWinqu:M:S:j:")) != -1)
 		switch (c) {
 			case 'b':
 				sscanf(optarg, "%x", &base);
@@ -111,6 +198,11 @@ int main(int argc, char **argv) {
 			case 'q':
 				quiet = 1;
 				break;
+			case 'j':
+				ed_dis_threads = strtol(optarg, NULL, 0);
+				if (ed_dis_threads < 1)
+					ed_dis_threads = 1;
+				break;
 			case 'n':
 				cols = &envy_null_colors;
 				break;
@@ -159,28 +251,28 @@ int main(int argc, char **argv) {
 
 						switch (type) {
 							case 'B':
-								nl.type = 1;
+								nl.type = ED_MARK_BTARG;
 								break;
 							case 'C':
-								nl.type = 2;
+								nl.type = ED_MARK_CTARG;
 								break;
 							case 'E':
-								nl.type = 4;
+								nl.type = ED_MARK_END;
 								break;
 							case 'S':
-								nl.type = 0x20;
+								nl.type = ED_MARK_STRING;
 								break;
 							case 'N':
-								nl.type = 0x42;
+								nl.type = ED_MARK_NORET | ED_MARK_CTARG;
 								break;
 							case 'D':
-								nl.type = 0x10;
+								nl.type = ED_MARK_DWORD;
 								break;
 							case 'b':
-								nl.type = 0x80;
+								nl.type = ED_MARK_BYTE;
 								break;
 							case 'w':
-								nl.type = 0x100;
+								nl.type = ED_MARK_WORD;
 								break;
 							default:
 								fprintf (stderr, "Unknown label type %c\n", type);
@@ -200,8 +292,9 @@ int main(int argc, char **argv) {
 				{
 					struct label nl;
 					sscanf(optarg, "%llx", &nl.val);
-					nl.type = 1;
+					nl.type = ED_MARK_BTARG;
 					nl.name = 0;
+					nl.size = 0;
 					ADDARRAY(labels, nl);
 					break;
 				}
@@ -243,53 +336,68 @@ int main(int argc, char **argv) {
 		fprintf(stderr, "Byte size too large for non-binary input!\n");
 		return 1;
 	}
-	int num = 0;
-	int maxnum = 16;
-	uint8_t *code = malloc (maxnum);
-	unsigned long long t;
+	struct input in;
+	uint8_t *code;
+	size_t codelen, cb = CEILDIV(cbsz, 8);
+	/* what's to be disassembled is from skip to end, in bytes of code */
+	size_t end = limit ? skip + (size_t)limit * ed_getcstride(isa, var) : SIZE_MAX;
 	if (bin) {
 		if (!wsz)
-			wsz = CEILDIV(cbsz, 8);
-		if (wsz < CEILDIV(cbsz, 8)) {
+			wsz = cb;
+		if (wsz < cb) {
 			fprintf(stderr, "Stride too small!\n");
 			return 1;
 		}
-		int pos = 0;
-		int c;
-		while ((c = getc(infile)) != EOF) {
-			if (pos < CEILDIV(cbsz, 8)) {
-				if (num >= maxnum) maxnum *= 2, code = realloc (code, maxnum);
-				code[num++] = c;
-			}
-			pos++;
-			if (pos == wsz)
-				pos = 0;
+		/* only the first cb bytes of every wsz are code */
+		if (input_open(&in, infile, end == SIZE_MAX ? SIZE_MAX : (end - 1) / cb * wsz + (end - 1) % cb + 1))
+			return 1;
+		codelen = in.len / wsz * cb + min(in.len % wsz, cb);
+		if (codelen > end)
+			codelen = end;
+		if (codelen <= skip)
+			return 0;
+		codelen -= skip;
+		if (wsz == cb) {
+			code = in.data + skip;
+		} else {
+			size_t k;
+			code = malloc(codelen);
+			for (k = 0; k < codelen; k++)
+				code[k] = in.data[(skip + k) / cb * wsz + (skip + k) % cb];
 		}
 	} else {
+		const uint8_t *p, *pend;
+		unsigned long long t;
+		size_t maxnum = 16, pos = 0;
 		if (wsz) {
 			fprintf(stderr, "Stride is meaningless in hex input mode!\n");
 			return 1;
 		}
-		wsz = CEILDIV(cbsz, 8);
+		wsz = cb;
 		if (cbsz == 8 && w == 1)
 			wsz = 4;
 		if (cbsz == 8 && w == 2)
 			wsz = 8;
-		while (!feof(infile) && fscanf (infile, "%llx", &t) == 1) {
-			if (num + wsz - 1 >= maxnum) maxnum *= 2, code = realloc (code, maxnum);
-			for (i = 0; i < wsz; i++) {
-				code[num++] = t & 0xff;
+		if (input_open(&in, infile, SIZE_MAX))
+			return 1;
+		p = in.data;
+		pend = in.data + in.len;
+		codelen = 0;
+		code = malloc(maxnum);
+		/* the bytes before skip are parsed, but not kept */
+		while (pos < end && next_hex(&p, pend, &t)) {
+			for (i = 0; i < wsz; i++, pos++) {
+				if (pos >= skip && pos < end) {
+					if (codelen >= maxnum)
+						maxnum *= 2, code = realloc(code, maxnum);
+					code[codelen++] = t & 0xff;
+				}
 				t >>= 8;
 			}
-			fscanf (infile, " ,");
 		}
+		if (!codelen)
+			return 0;
 	}
-	if (num <= skip)
-		return 0;
-	int cnt = num - skip;
-	cnt /= ed_getcstride(isa, var);
-	if (limit && limit < cnt)
-		cnt = limit;
-	envydis (isa, stdout, code+skip, base, cnt, var, quiet, labels, labelsnum, cols);
+	envydis (isa, stdout, code, base, codelen / ed_getcstride(isa, var), var, quiet, labels, labelsnum, cols);
 	return 0;
 }
@@ -950,7 +950,7 @@ F(su1d, 0x38, N("1d"), N("2d"))
 F(vsclamp, 0x34, N("clamp"), N("wrap"))
 
 static struct insn tabus64_28[] = {
-	{ 0x0000000000000000ull, 0x0000030000000000ull },
+	{ 0x0000000000000000ull, 0x0000030000000000ull, N("b32") },
 	{ 0x0000020000000000ull, 0x0000030000000000ull, N("u64") },
 	{ 0x0000030000000000ull, 0x0000030000000000ull, N("s64") },
 	{ 0, 0, OOPS },
@@ -44,6 +44,23 @@ struct disisa {
 	struct insn *trootas;
 	struct insn *tsched;
 	int schedpos;
+	/* compiled decoding tables, per variant */
+	struct ed_dispatch *dispatch;
+	/* the tables indexed by what entries start with, for assembling */
+	struct ed_asindex *asindex;
+};
+
+/* label types, also what the disassembler marks code positions with */
+enum ed_mark {
+	ED_MARK_BTARG = 0x1,	/* branch target */
+	ED_MARK_CTARG = 0x2,	/* call target */
+	ED_MARK_END = 0x4,	/* code stops after the instruction here */
+	ED_MARK_DWORD = 0x10,	/* data: 32-bit word */
+	ED_MARK_STRING = 0x20,	/* data: NUL-terminated string */
+	ED_MARK_NORET = 0x40,	/* call target that doesn't return */
+	ED_MARK_BYTE = 0x80,	/* data: byte */
+	ED_MARK_WORD = 0x100,	/* data: 16-bit word */
+	ED_MARK_DATA = ED_MARK_DWORD | ED_MARK_STRING | ED_MARK_BYTE | ED_MARK_WORD,
 };
 
 struct label {
@@ -62,6 +79,85 @@ static inline int ed_getcstride(const struct disisa *isa, struct varinfo *varinf
 	return CEILDIV(ed_getcbsz(isa, varinfo), 8);
 }
 
+/* longest instruction, in 64-bit words */
+#define ED_MAXOPLEN 2
+
+enum ed_dis_status {
+	ED_DIS_EOF = 0x1,		/* EOF in the middle of an opcode */
+	ED_DIS_UNK_FORM = 0x2,		/* failed to determine instruction format - opcode length uncertain */
+	ED_DIS_UNK_INSN = 0x4,		/* failed to determine instruction name */
+	ED_DIS_UNK_OPERAND = 0x8,	/* failed to determine instruction operands */
+	ED_DIS_UNUSED_BITS = 0x10,	/* instruction decoded, but some bits weren't used */
+};
+
+struct easm_insn;
+
+struct ed_target {
+	uint64_t pos;
+	int type;	/* ED_MARK_BTARG or ED_MARK_CTARG */
+};
+
+/*
+ * One thing the disassembler has to say about the code, in order. In label
+ * mode, code that isn't reached from any label is skipped over, with
+ * ED_ITEM_SKIP telling how much of it there was.
+ */
+struct ed_item {
+	enum ed_item_type {
+		ED_ITEM_INSN,
+		ED_ITEM_LABEL,	/* a named label, before what's at pos */
+		ED_ITEM_DATA,	/* data given by a label, mark says which kind */
+		ED_ITEM_SKIP,
+	} type;
+	/* address of the item, in code units */
+	uint32_t pos;
+	/* length, in code units */
+	uint32_t len;
+	/* ED_MARK_* bits at pos */
+	int mark;
+	/* name of the label at pos, if there's one */
+	const char *label;
+	/* code at pos, and how many code units are left from there */
+	const uint8_t *code;
+	uint32_t left;
+	/* ED_ITEM_DATA: the value, ED_ITEM_SKIP: whether anything skipped is nonzero */
+	uint64_t val;
+	/* ED_ITEM_INSN only from here on */
+	int status;	/* enum ed_dis_status */
+	struct easm_insn *insn;	/* positions substituted and constants folded */
+	const char *mnemonic;	/* of the first sub-instruction */
+	int mnemonic_id;	/* equal ids for equal mnemonics within one ed_dis */
+	struct ed_target *targets;
+	int targetsnum;
+	int endmark;	/* the code doesn't go on after this */
+	uint64_t unknown[ED_MAXOPLEN];	/* opcode bits no table looked at */
+};
+
+/*
+ * Finds out up front what's code in a block and what it marks (following it
+ * from the labels, if there are any), then hands out the items one by one,
+ * decoding them as it goes if there are no labels. An item is
+ * overwritten by the next one, but what it points to stays around until
+ * ed_dis_release or ed_dis_del. ed_dis_release lets go of what the items so
+ * far point to, once they're printed - it keeps everything if there are
+ * labels. Mnemonics are kept until ed_dis_del either way.
+ */
+struct ed_dis;
+struct ed_dis *ed_dis_new(const struct disisa *isa, struct varinfo *varinfo, uint8_t *code, uint32_t start, int num, struct label *labels, int labelsnum);
+const struct ed_item *ed_dis_next(struct ed_dis *dis);
+void ed_dis_release(struct ed_dis *dis);
+void ed_dis_del(struct ed_dis *dis);
+const char *ed_dis_mnemonic(struct ed_dis *dis, int id);
+
+/*
+ * Threads ed_dis_new decodes code without labels with, and envydis prints
+ * with. The output doesn't depend on it.
+ */
+extern int ed_dis_threads;
+
+/* prints items like envydis does */
+void ed_print_item(FILE *out, const struct disisa *isa, struct varinfo *varinfo, const struct ed_item *item, int quiet, const struct envy_colors *cols);
+
 void envydis (const struct disisa *isa, FILE *out, uint8_t *code, uint32_t start, int num, struct varinfo *varinfo, int quiet, struct label *labels, int labelsnum, const struct envy_colors *cols);
 
 #endif
@@ -105,6 +105,8 @@ struct easm_expr {
 	struct envy_loc loc;
 	char *alabel;
 	uint64_t alit;
+	/* allocated from an arena, along with everything below it */
+	int inarena;
 };
 
 struct easm_directive {
@@ -174,6 +176,19 @@ struct easm_expr *easm_expr_astr(struct astr astr);
 struct easm_expr *easm_expr_sinsn(struct easm_sinsn *sinsn);
 struct easm_expr *easm_expr_simple(enum easm_expr_type type);
 
+/*
+ * The same, allocating from an arena instead (or with malloc if arena is
+ * NULL). The disassembler builds whole instructions this way - such trees
+ * go away with the arena, easm_del_* leave them alone.
+ */
+struct easm_expr *easm_arena_expr_bin(struct arena *arena, enum easm_expr_type type, struct easm_expr *e1, struct easm_expr *e2);
+struct easm_expr *easm_arena_expr_un(struct arena *arena, enum easm_expr_type type, struct easm_expr *e1);
+struct easm_expr *easm_arena_expr_num(struct arena *arena, enum easm_expr_type type, uint64_t num);
+struct easm_expr *easm_arena_expr_str(struct arena *arena, enum easm_expr_type type, char *str);
+struct easm_expr *easm_arena_expr_astr(struct arena *arena, struct astr astr);
+struct easm_expr *easm_arena_expr_sinsn(struct arena *arena, struct easm_sinsn *sinsn);
+struct easm_expr *easm_arena_expr_simple(struct arena *arena, enum easm_expr_type type);
+
 void easm_del_mod(struct easm_mod *mod);
 void easm_del_mods(struct easm_mods *mods);
 void easm_del_expr(struct easm_expr *expr);
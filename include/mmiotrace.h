@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2026 The envytools authors.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef MMIOTRACE_H
+#define MMIOTRACE_H
+
+#include <stdio.h>
+#include <inttypes.h>
+
+/*
+ * Reader for mmiotrace files. Handles both the text format of the kernel's
+ * mmiotrace and the binary format below, telling them apart by the magic.
+ * Regular files are mmapped, pipes are read through a big buffer. Lines are
+ * split in place and numbers are parsed by hand, nothing is allocated per
+ * line.
+ */
+
+enum mmiotrace_type {
+	MMIOTRACE_OTHER,	/* anything else, including malformed records */
+	MMIOTRACE_READ,
+	MMIOTRACE_WRITE,
+	MMIOTRACE_PCIDEV,
+	MMIOTRACE_MARK,
+	MMIOTRACE_MAP,
+	MMIOTRACE_UNMAP,
+};
+
+#define MMIOTRACE_PCI_BARS 7
+
+struct mmiotrace_rec {
+	enum mmiotrace_type type;
+	/* the whole line, including the newline if there was one; READ and
+	 * WRITE records of binary traces have no line (NULL, 0) */
+	const char *line;
+	size_t len;
+	/* timestamp in nanoseconds, for all types except PCIDEV */
+	uint64_t ts;
+	/* READ, WRITE: access width in bytes */
+	int width;
+	/* READ, WRITE, MAP, UNMAP */
+	int map_id;
+	/* READ, WRITE, MAP: physical address */
+	uint64_t addr;
+	/* READ, WRITE */
+	uint64_t value;
+	/* MAP */
+	uint64_t virt, maplen;
+	/* PCIDEV */
+	uint32_t devfn, pciid;
+	uint64_t bar[MMIOTRACE_PCI_BARS], barlen[MMIOTRACE_PCI_BARS];
+	/* MARK: text after the timestamp, without the newline */
+	const char *text;
+	size_t textlen;
+};
+
+/*
+ * Binary format: the 16-byte header, then one fixed-size record per line of
+ * the text trace, in host byte order. READ and WRITE records are complete in
+ * themselves; every other line is stored as a side record followed by its
+ * text, padded to a multiple of 8 bytes.
+ */
+
+#define MMIOTRACE_BIN_MAGIC "MMIOTBIN"
+#define MMIOTRACE_BIN_VERSION 1
+
+struct mmiotrace_bin_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t rec_size;
+};
+
+struct mmiotrace_bin_rec {
+	uint8_t type;
+	uint8_t width;
+	uint16_t reserved;
+	union {
+		uint32_t map_id;	/* READ, WRITE */
+		uint32_t textlen;	/* side records */
+	};
+	uint64_t ts;
+	uint64_t addr;
+	uint64_t value;
+};
+
+struct mmiotrace_reader;
+
+struct mmiotrace_reader *mmiotrace_reader_new(FILE *f);
+void mmiotrace_reader_del(struct mmiotrace_reader *r);
+/* returns 0 at the end of input; rec->line stays valid until the next call */
+int mmiotrace_next(struct mmiotrace_reader *r, struct mmiotrace_rec *rec);
+
+void mmiotrace_write_bin_header(FILE *out);
+void mmiotrace_write_bin(FILE *out, const struct mmiotrace_rec *rec);
+
+/* tokenizes a single line, "len" doesn't need to include a newline */
+void mmiotrace_parse_line(const char *line, size_t len, struct mmiotrace_rec *rec);
+
+#endif
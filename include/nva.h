@@ -26,6 +26,7 @@
 #define NVA_H
 #include <stdint.h>
 #include <stddef.h>
+#include <stdio.h>
 #include "nvhw/chipset.h"
 
 #ifdef __cplusplus
@@ -42,14 +43,18 @@ enum nva_card_type {
 enum nva_bus_type {
 	NVA_BUS_PCI,
 	NVA_BUS_PLATFORM,
+	NVA_BUS_FILE,
 };
 
+struct nva_offline;
+
 struct nva_card {
 	enum nva_card_type type;
 	enum nva_bus_type bus_type;
 	union {
 		struct pci_device *pci;
 		uint32_t platform_address;
+		char *path;
 	} bus;
 	struct chipset_info chipset;
 	void *bar0;
@@ -64,9 +69,15 @@ struct nva_card {
 	size_t iobarlen;
 	void *rawmem;
 	struct pci_io_handle *rawio;
+	/* set for cards backed by a file, see offline.c */
+	struct nva_offline *offline;
 };
 
 int nva_init();
+int nva_init_offline(const char *spec);
+void nva_offline_wr(struct nva_card *card, int width, uint32_t addr, uint64_t val);
+FILE *nva_offline_set_log(FILE *log);
+void nva_offline_merge_logs(FILE **logs, int num);
 extern struct nva_card **nva_cards;
 extern int nva_cardsnum;
 
@@ -92,6 +103,8 @@ static inline uint32_t nva_rd32(int card, uint32_t addr) {
 
 static inline void nva_wr32(int card, uint32_t addr, uint32_t val) {
 	nva_gwr32(nva_cards[card]->bar0, addr, val);
+	if (nva_cards[card]->offline)
+		nva_offline_wr(nva_cards[card], 4, addr, val);
 }
 
 static inline uint32_t nva_rd8(int card, uint32_t addr) {
@@ -100,6 +113,8 @@ static inline uint32_t nva_rd8(int card, uint32_t addr) {
 
 static inline void nva_wr8(int card, uint32_t addr, uint32_t val) {
 	nva_gwr8(nva_cards[card]->bar0, addr, val);
+	if (nva_cards[card]->offline)
+		nva_offline_wr(nva_cards[card], 1, addr, val);
 }
 
 static inline uint32_t nva_mask(int cnum, uint32_t reg, uint32_t mask, uint32_t val)
@@ -145,6 +160,16 @@ struct nva_regspace {
 int nva_wr(struct nva_regspace *regspace, uint32_t addr, uint64_t val);
 int nva_rd(struct nva_regspace *regspace, uint32_t addr, uint64_t *val);
 
+struct nva_regval {
+	uint32_t addr;
+	uint64_t val;
+};
+
+/* registers at addr, addr + regsz/unitsz, ... */
+int nva_rdrange(struct nva_regspace *regspace, uint32_t addr, int num, uint64_t *vals, int *errs);
+int nva_wrv(struct nva_regspace *regspace, const struct nva_regval *regs, int num, int *errs);
+int nva_fill(struct nva_regspace *regspace, uint32_t addr, int num, uint64_t val, int *errs);
+
 enum nva_err {
 	NVA_ERR_SUCCESS,
 	NVA_ERR_RANGE,
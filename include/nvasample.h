@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2026 The envytools authors.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef NVASAMPLE_H
+#define NVASAMPLE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/*
+ * High-rate register sampler. A set of 32-bit BAR0 registers is read in a
+ * tight loop, each sample stored with a timestamp in a preallocated ring
+ * buffer; a writer thread drains the ring to a file, so the sampling loop
+ * never waits for I/O. If the writer can't keep up, samples are dropped
+ * and counted, never blocked on. The file can be summarized later with
+ * nva_sample_summarize (nvapeekstat -f).
+ */
+
+#define NVA_SAMPLE_MAGIC "NVASAMPL"
+#define NVA_SAMPLE_VERSION 1
+#define NVA_SAMPLE_MAX_REGS 16
+
+enum nva_sample_clock {
+	NVA_SAMPLE_CLOCK_HOST,		/* CLOCK_MONOTONIC, in ns */
+	NVA_SAMPLE_CLOCK_PTIMER,	/* the card's 64-bit PTIMER */
+};
+
+/*
+ * File format: this header, then fixed-size records of rec_size bytes, in
+ * host byte order: a 64-bit timestamp followed by one 32-bit value for each
+ * register, padded to a multiple of 8 bytes.
+ */
+struct nva_sample_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t rec_size;
+	uint32_t clock;
+	uint32_t nregs;
+	uint32_t regs[NVA_SAMPLE_MAX_REGS];
+	uint32_t masks[NVA_SAMPLE_MAX_REGS];
+};
+
+struct nva_sampler;
+
+/*
+ * Samples regs of card cnum to out. With changes_only, a sample is only
+ * recorded when a register changed in the bits set in its mask (the first
+ * one always is). ringsize is in samples, rounded up to a power of two.
+ * Writes the file header; returns NULL on failure.
+ */
+struct nva_sampler *nva_sampler_new(int cnum, const uint32_t *regs, const uint32_t *masks, int nregs,
+		enum nva_sample_clock clock, int changes_only, size_t ringsize, FILE *out);
+/* samples in the calling thread until count samples were taken (0 for no
+ * limit) or nva_sampler_stop is called; returns -1 if writing failed */
+int nva_sampler_run(struct nva_sampler *s, uint64_t count);
+/* async-signal-safe */
+void nva_sampler_stop(struct nva_sampler *s);
+void nva_sampler_stats(struct nva_sampler *s, uint64_t *taken, uint64_t *recorded, uint64_t *dropped);
+void nva_sampler_del(struct nva_sampler *s);
+
+enum {
+	NVA_SAMPLE_EVENTS = 1,	/* print every change event */
+};
+
+/*
+ * Prints a summary of a sample file: sampling rate, and for each register
+ * the most frequent values (up to top, all if 0), the number of changes and
+ * a log2 histogram of times between changes. Returns -1 if the file isn't
+ * a valid sample file.
+ */
+int nva_sample_summarize(FILE *in, FILE *out, int top, int flags);
+
+#endif
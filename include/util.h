@@ -28,6 +28,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <inttypes.h>
 #include <assert.h>
 
@@ -117,6 +118,27 @@ void print_escaped_astr(FILE *out, struct astr *astr);
 
 char *aprintf(const char *format, ...);
 
+struct arena;
+struct arena *arena_new(void);
+void arena_del(struct arena *arena);
+void arena_reset(struct arena *arena);
+void *arena_alloc(struct arena *arena, size_t size);
+char *arena_strdup(struct arena *arena, const char *str);
+char *arena_printf(struct arena *arena, const char *format, ...);
+
+/* ADDARRAY for arrays in an arena, which get copied when they grow */
+#define ARENA_ADDARRAY(arena, a, e) \
+	do { \
+	if ((a ## num) >= (a ## max)) { \
+		void *__old = (a); \
+		(a ## max) = (a ## max) ? (a ## max) * 2 : 4; \
+		(a) = arena_alloc((arena), (a ## max)*sizeof(*(a))); \
+		if (a ## num) \
+			memcpy((a), __old, (a ## num)*sizeof(*(a))); \
+	} \
+	(a)[(a ## num)++] = (e); \
+	} while(0)
+
 FILE *open_input(const char *filename);
 
 #ifdef NDEBUG
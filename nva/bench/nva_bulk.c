@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2026 The envytools authors.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/*
+ * Compares register-at-a-time nva_rd/nva_wr loops with nva_rdrange, nva_wrv
+ * and nva_fill on a few register spaces of a card, and checks both read the
+ * same values. Meant to be run on an offline card (NVA_OFFLINE=regs.txt),
+ * where it measures the library overhead rather than the bus - it writes
+ * to the card, so don't point it at real hardware you care about.
+ *
+ * Usage: NVA_OFFLINE=regs.txt nva_bulk [-c card] [-n registers] [-r rounds]
+ */
+
+#include "nva.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *name, const char *op, int regs, double single, double bulk) {
+	printf("%-6s %-5s %10.0f regs/s single %10.0f regs/s bulk %6.2fx\n", name, op,
+			regs / single, regs / bulk, single / bulk);
+}
+
+static int bench(struct nva_regspace *rs, const char *name, uint32_t addr, int num, int rounds) {
+	uint64_t *a = calloc(num, sizeof *a), *b = calloc(num, sizeof *b);
+	struct nva_regval *regs = calloc(num, sizeof *regs);
+	int *e = calloc(num, sizeof *e);
+	uint32_t step = rs->regsz / nva_rsunitsz(rs);
+	double t0, t1, t2;
+	int i, r, res = 0;
+
+	t0 = now();
+	for (r = 0; r < rounds; r++)
+		for (i = 0; i < num; i++)
+			nva_rd(rs, addr + i * step, &a[i]);
+	t1 = now();
+	for (r = 0; r < rounds; r++)
+		nva_rdrange(rs, addr, num, b, e);
+	t2 = now();
+	report(name, "read", num * rounds, t1 - t0, t2 - t1);
+	if (memcmp(a, b, num * sizeof *a)) {
+		fprintf(stderr, "%s: nva_rdrange disagrees with nva_rd\n", name);
+		res = 1;
+	}
+
+	/* write back what was read, so the card is left as it was */
+	for (i = 0; i < num; i++) {
+		regs[i].addr = addr + i * step;
+		regs[i].val = a[i];
+	}
+	t0 = now();
+	for (r = 0; r < rounds; r++)
+		for (i = 0; i < num; i++)
+			nva_wr(rs, regs[i].addr, regs[i].val);
+	t1 = now();
+	for (r = 0; r < rounds; r++)
+		nva_wrv(rs, regs, num, e);
+	t2 = now();
+	report(name, "write", num * rounds, t1 - t0, t2 - t1);
+
+	t0 = now();
+	for (r = 0; r < rounds; r++)
+		for (i = 0; i < num; i++)
+			nva_wr(rs, addr + i * step, 0);
+	t1 = now();
+	for (r = 0; r < rounds; r++)
+		nva_fill(rs, addr, num, 0, e);
+	t2 = now();
+	report(name, "fill", num * rounds, t1 - t0, t2 - t1);
+	nva_wrv(rs, regs, num, e);
+
+	free(a);
+	free(b);
+	free(regs);
+	free(e);
+	return res;
+}
+
+int main(int argc, char **argv) {
+	int c, cnum = 0, num = 0x10000, rounds = 20, res = 0;
+	while ((c = getopt(argc, argv, "c:n:r:")) != -1)
+		switch (c) {
+			case 'c':
+				cnum = strtol(optarg, NULL, 0);
+				break;
+			case 'n':
+				num = strtol(optarg, NULL, 0);
+				break;
+			case 'r':
+				rounds = strtol(optarg, NULL, 0);
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-c card] [-n registers] [-r rounds]\n", argv[0]);
+				return 1;
+		}
+	if (nva_init()) {
+		fprintf (stderr, "PCI init failure!\n");
+		return 1;
+	}
+	if (cnum >= nva_cardsnum) {
+		fprintf (stderr, "No such card.\n");
+		return 1;
+	}
+	struct nva_regspace rs = { .card = nva_cards[cnum], .cnum = cnum, .type = NVA_REGSPACE_BAR0, .regsz = 4 };
+	res |= bench(&rs, "bar0", 0x100000, num, rounds);
+	rs.type = NVA_REGSPACE_VGA_CR;
+	rs.regsz = 1;
+	res |= bench(&rs, "cr", 0, 0x100, rounds * num / 0x100);
+	rs.type = NVA_REGSPACE_VGA_SR;
+	res |= bench(&rs, "sr", 0, 8, rounds * num / 8);
+	return res;
+}
@@ -333,6 +333,9 @@ struct {
 
 int nva_init() {
 	int ret;
+	const char *offline = getenv("NVA_OFFLINE");
+	if (offline)
+		return nva_init_offline(offline);
 	ret = pci_system_init();
 	if (ret)
 		return -1;
@@ -56,8 +56,16 @@ int main(int argc, char **argv) {
 		sscanf (argv[optind + 1], "%x", &b);
 	if (optind + 2 < argc)
 		sscanf (argv[optind + 2], "%x", &v);
+	struct nva_regspace rs = { .card = nva_cards[cnum], .cnum = cnum, .type = NVA_REGSPACE_BAR0, .regsz = 4 };
+	static struct nva_regval regs[256];
+	int n = 0;
 	for (i = 0; i < b; i += 4) {
-		nva_wr32(cnum, a+i, v+i);
+		regs[n].addr = a+i;
+		regs[n].val = (uint32_t)(v+i);
+		if (++n == 256 || i + 4 >= b) {
+			nva_wrv(&rs, regs, n, NULL);
+			n = 0;
+		}
 	}
 	return 0;
 }
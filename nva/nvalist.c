@@ -65,6 +65,9 @@ int main() {
 		case NVA_BUS_PLATFORM:
 			printf ("(platform) 0x%08x", card->bus.platform_address);
 			break;
+		case NVA_BUS_FILE:
+			printf ("(file) %s", card->bus.path);
+			break;
 		}
 
 		switch (card->type) {
@@ -23,6 +23,7 @@
  */
 
 #include "nva.h"
+#include "mmiotrace.h"
 #include <stdio.h>
 #include <unistd.h>
 #include <inttypes.h>
@@ -55,33 +56,19 @@ FILE *open_input(char *filename) {
 	return fopen(filename, "r");
 }
 
-int parse_line(const char *line, size_t len, uint32_t *reg, uint32_t *val)
-{
-	unsigned int size, useless;
-	float time;
-
-	if (line[0] != 'W')
-		return 0;
-
-	sscanf(line + 2, "%u %f %u %x %x", &size, &time, &useless, reg, val);
-	*reg &= 0xffffff;
-
-	return 1;
-}
-
 int main(int argc, char **argv) {
 	if (nva_init()) {
 		fprintf (stderr, "PCI init failure!\n");
 		return 1;
 	}
-	int c, cnum, verbose = 0;
+	int c, verbose = 0;
 	size_t start = 0, steps = -1;
 	uint32_t mmio_start = 0, mmio_end = 0xffffffff;
 	struct nva_regspace rs = { 0 };
 	while ((c = getopt (argc, argv, "c:b:s:l:h:v")) != -1)
 		switch (c) {
 			case 'c':
-				sscanf(optarg, "%d", &cnum);
+				sscanf(optarg, "%d", &rs.cnum);
 				break;
 			case 'b':
 				sscanf(optarg, "%zu", &start);
@@ -122,11 +109,11 @@ int main(int argc, char **argv) {
 		printf("limit the replay to registers in the range [%x:%x]\n",
 		       mmio_start, mmio_end);
 
-	char *buf = NULL;
-	size_t len, cur = 0, reg_writes = -1;
+	struct mmiotrace_reader *reader = mmiotrace_reader_new(f);
+	struct mmiotrace_rec rec;
+	size_t cur = 0, reg_writes = -1;
 
-	while (getline(&buf, &len, f) > 0) {
-		uint32_t reg, val;
+	while (mmiotrace_next(reader, &rec)) {
 		if (cur >= start) {
 			if (reg_writes == (size_t) -1) {
 				if (steps < (size_t) -1) {
@@ -134,14 +121,17 @@ int main(int argc, char **argv) {
 					       steps, cur);
 					fflush(stdout);
 					reg_writes = 0;
-				} else
+				} else {
 					printf("replay from line %zu to the end\n", cur);
+					reg_writes = 0;
+				}
 			}
 
-			if (parse_line(buf, len, &reg, &val) &&
+			uint32_t reg = rec.addr & 0xffffff, val = rec.value;
+			if (rec.type == MMIOTRACE_WRITE &&
 				reg >= mmio_start && reg <= mmio_end)
 			{
-				nva_wr32(cnum, reg, val);
+				nva_wr32(rs.cnum, reg, val);
 				if (verbose > 0)
 					printf("\n	%x <= %x ", reg, val);
 				reg_writes++;
@@ -157,6 +147,7 @@ int main(int argc, char **argv) {
 		cur++;
 	}
 	printf("\n");
+	mmiotrace_reader_del(reader);
 
 	return 0;
 }
@@ -67,7 +67,7 @@ int main(int argc, char **argv) {
 	if (rs.regsz == 0)
 		rs.regsz = nva_rsdefsz(&rs);
 	int unit = nva_rsunitsz(&rs);
-	int32_t a, b = rs.regsz/unit, i, j;
+	int32_t a, b = rs.regsz/unit, i;
 	if (optind >= argc) {
 		fprintf (stderr, "No address specified.\n");
 		return 1;
@@ -75,28 +75,32 @@ int main(int argc, char **argv) {
 	sscanf (argv[optind], "%x", &a);
 	if (optind + 1 < argc)
 		sscanf (argv[optind + 1], "%x", &b);
-	int ls = 1;
+	int ls = 1, step = rs.regsz/unit, row = 16/rs.regsz, n, k;
+	static uint64_t z[1024];
+	static int e[1024];
 	while (b > 0) {
-		uint64_t z[16];
-		int e[16];
-		int s = 0;
-		for (i = j = 0; i < 16/unit && i < b; i+=rs.regsz/unit, j++) {
-			e[j] = nva_rd(&rs, a+i, &z[j]);
-			if (e[j] || z[j])
-				s = 1;
-		}
-		if (s) {
-			ls = 1;
-			printf ("%08x:", a);
-			for (i = j = 0; i < 16/unit && i < b; i+=rs.regsz/unit, j++) {
-				nva_rsprint(&rs, e[j], z[j]);
+		/* whole rows at a time, the last one possibly cut short */
+		n = (b + step - 1) / step;
+		if (n > 1024)
+			n = 1024;
+		nva_rdrange(&rs, a, n, z, e);
+		for (k = 0; k < n; k += row) {
+			int s = 0;
+			for (i = k; i < k + row && i < n; i++)
+				if (e[i] || z[i])
+					s = 1;
+			if (s) {
+				ls = 1;
+				printf ("%08x:", a + k * step);
+				for (i = k; i < k + row && i < n; i++)
+					nva_rsprint(&rs, e[i], z[i]);
+				printf ("\n");
+			} else  {
+				if (ls) printf ("...\n"), ls = 0;
 			}
-			printf ("\n");
-		} else  {
-			if (ls) printf ("...\n"), ls = 0;
 		}
-		a+=16/unit;
-		b-=16/unit;
+		a += n * step;
+		b -= n * step;
 	}
 	return 0;
 }
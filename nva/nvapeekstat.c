@@ -23,6 +23,7 @@
  */
 
 #include "nva.h"
+#include "nvasample.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -34,18 +35,43 @@ int cmp(const void *pa, const void *pb) {
 }
 
 int main(int argc, char **argv) {
-	if (nva_init()) {
-		fprintf (stderr, "PCI init failure!\n");
-		return 1;
-	}
 	int c;
 	int cnum =0;
-	while ((c = getopt (argc, argv, "c:")) != -1)
+	int top = 16, events = 0;
+	const char *infile = 0;
+	while ((c = getopt (argc, argv, "c:f:k:e")) != -1)
 		switch (c) {
 			case 'c':
 				sscanf(optarg, "%d", &cnum);
 				break;
+			case 'f':
+				infile = optarg;
+				break;
+			case 'k':
+				sscanf(optarg, "%d", &top);
+				break;
+			case 'e':
+				events = 1;
+				break;
+		}
+	if (infile) {
+		/* summarize what nvawatch -o recorded, no card needed */
+		FILE *in = fopen(infile, "rb");
+		if (!in) {
+			perror(infile);
+			return 1;
+		}
+		if (nva_sample_summarize(in, stdout, top, events ? NVA_SAMPLE_EVENTS : 0)) {
+			fprintf (stderr, "%s: not a sample file\n", infile);
+			return 1;
 		}
+		fclose(in);
+		return 0;
+	}
+	if (nva_init()) {
+		fprintf (stderr, "PCI init failure!\n");
+		return 1;
+	}
 	if (cnum >= nva_cardsnum) {
 		if (nva_cardsnum)
 			fprintf (stderr, "No such card.\n");
@@ -61,7 +87,15 @@ int main(int argc, char **argv) {
 	sscanf (argv[optind], "%x", &a);
 	if (optind + 1 < argc)
 		sscanf (argv[optind + 1], "%d", &b);
-	uint32_t tab[b];
+	if (b < 1) {
+		fprintf (stderr, "Invalid count.\n");
+		return 1;
+	}
+	uint32_t *tab = malloc(b * sizeof *tab);
+	if (!tab) {
+		perror("malloc");
+		return 1;
+	}
 	for (i = 0; i < b; i++)
 		tab[i] = nva_rd32(cnum, a);
 	qsort(tab, b, sizeof *tab, cmp);
@@ -76,5 +110,6 @@ int main(int argc, char **argv) {
 		cnt++;
 	}
 	printf("%08x: %d\n", prev, cnt);
+	free(tab);
 	return 0;
 }
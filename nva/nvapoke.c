@@ -87,13 +87,25 @@ int main(int argc, char **argv) {
 	}
 	if (optind + 3 < argc)
 		sscanf (argv[optind + 3], "%"SCNx64, &step);
-	while (b > 0) {
-		int e = nva_wr(&rs, a, val);
-		if (e)
-			printf("%08x: ERR %c\n", a, nva_rserrc(e));
-		a += rs.regsz/unit;
-		b -= rs.regsz/unit;
-		val += step;
+	uint32_t rstep = rs.regsz/unit, n = (b + rstep - 1) / rstep, i, j, k;
+	static struct nva_regval regs[256];
+	static int e[256];
+	for (i = 0; i < n; i += k) {
+		k = n - i < 256 ? n - i : 256;
+		if (!step) {
+			nva_fill(&rs, a, k, val, e);
+		} else {
+			for (j = 0; j < k; j++) {
+				regs[j].addr = a + j * rstep;
+				regs[j].val = val;
+				val += step;
+			}
+			nva_wrv(&rs, regs, k, e);
+		}
+		for (j = 0; j < k; j++)
+			if (e[j])
+				printf("%08x: ERR %c\n", a + j * rstep, nva_rserrc(e[j]));
+		a += k * rstep;
 	}
 	return 0;
 }
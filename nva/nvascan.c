@@ -25,8 +25,125 @@
 
 #include "nva.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+/*
+ * The scan is done in two passes. The probe pass reads, writes and reads
+ * back each register, one register at a time as before, and only records
+ * the results in a table. It can be split into slices probed by several
+ * processes, possibly on several (identical) cards, the table being
+ * shared. Spaces reached through index/data registers take at most one
+ * process per card, since probes running alongside on the same card would
+ * clobber each other's index. The analysis pass then works from the
+ * table: which bits are writable. Aliases still need the card - with -a,
+ * each changing register is tried against every earlier one after the
+ * probe pass, in the main process alone.
+ */
+
+struct probe {
+	uint64_t x, y, z;
+	uint8_t ex, ey, ez, werr;
+};
+
+static struct nva_regspace rs;
+static int32_t base;
+static int step;
+static int slow;
+
+static void probe_one(struct nva_regspace *rs, int32_t addr, struct probe *p) {
+	int ew, ev, eb;
+	p->ex = nva_rd(rs, addr, &p->x);
+	if (!p->ex) {
+		ew = nva_wr(rs, addr, -1ll);
+		p->ey = nva_rd(rs, addr, &p->y);
+		ev = nva_wr(rs, addr, 0);
+		p->ez = nva_rd(rs, addr, &p->z);
+		eb = nva_wr(rs, addr, p->x);
+		p->werr = ew || ev || eb;
+	}
+	if (slow) {
+		int j;
+		for (j = 0; j < 100; j++)
+			nva_rd32(rs->cnum, 0);
+		usleep(10000);
+		for (j = 0; j < 100; j++)
+			nva_rd32(rs->cnum, 0);
+	}
+}
+
+static void probe_slice(int cnum, struct probe *tab, int lo, int hi) {
+	struct nva_regspace srs = rs;
+	int i;
+	srs.cnum = cnum;
+	srs.card = nva_cards[cnum];
+	for (i = lo; i < hi; i++)
+		probe_one(&srs, base + i * step, &tab[i]);
+}
+
+static int cool(const struct probe *p) {
+	return !p->ex && (p->x != p->y || p->y != p->z);
+}
+
+static int interesting(const struct probe *p) {
+	return p->ex || p->ey || p->ez || p->werr || p->x || p->y || p->z;
+}
+
+/*
+ * For each changing register, the first earlier register whose zeroing
+ * shows up in it. Every earlier register is tried, in 4-unit steps like
+ * the scan always did: an alias can read back differently, or not at
+ * all, so the probe results can't rule candidates out.
+ */
+static void find_aliases(struct probe *tab, int n, int *aliases) {
+	int i;
+	for (i = 0; i < n; i++) {
+		int32_t ai = base + i * step, j;
+		aliases[i] = -1;
+		if (!cool(&tab[i]))
+			continue;
+		nva_wr(&rs, ai, -1ll);
+		for (j = 0; j < i * step; j += 4) {
+			uint64_t sv, ch;
+			int es = nva_rd(&rs, base + j, &sv);
+			if (!es) {
+				es |= nva_wr(&rs, base + j, 0);
+				es |= nva_rd(&rs, ai, &ch);
+				es |= nva_wr(&rs, base + j, sv);
+				if (ch == tab[i].z && !es) {
+					aliases[i] = j;
+					break;
+				}
+			}
+		}
+		nva_wr(&rs, ai, tab[i].x);
+	}
+}
+
+/* whether each access is a single read or write, with no index to set up */
+static int direct_space(const struct nva_regspace *rs) {
+	switch (rs->type) {
+		case NVA_REGSPACE_BAR0:
+		case NVA_REGSPACE_BAR1:
+		case NVA_REGSPACE_BAR2:
+		case NVA_REGSPACE_RAWMEM:
+		case NVA_REGSPACE_IOBAR:
+		case NVA_REGSPACE_RAWIO:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+/* bits that follow writes, given the readbacks of all ones and all zeroes */
+static uint64_t writable(const struct probe *p) {
+	return p->y & ~p->z;
+}
 
 int main(int argc, char **argv) {
 	if (nva_init()) {
@@ -34,10 +151,12 @@ int main(int argc, char **argv) {
 		return 1;
 	}
 	int alias = 0;
-	int slow = 0;
+	int showbits = 0;
+	int verbose = 0;
+	int jobs = 1;
+	int cards[16], ncards = 0;
 	int c;
-	struct nva_regspace rs = { 0 };
-	while ((c = getopt (argc, argv, "asc:i:b:t:")) != -1)
+	while ((c = getopt (argc, argv, "aswvj:c:i:b:t:")) != -1)
 		switch (c) {
 			case 'a':
 				alias = 1;
@@ -45,8 +164,25 @@ int main(int argc, char **argv) {
 			case 's':
 				slow = 1;
 				break;
+			case 'w':
+				showbits = 1;
+				break;
+			case 'v':
+				verbose = 1;
+				break;
+			case 'j':
+				sscanf(optarg, "%d", &jobs);
+				if (jobs < 1) {
+					fprintf (stderr, "Invalid number of jobs.\n");
+					return 1;
+				}
+				break;
 			case 'c':
-				sscanf(optarg, "%d", &rs.cnum);
+				if (ncards == 16) {
+					fprintf (stderr, "Too many cards.\n");
+					return 1;
+				}
+				sscanf(optarg, "%d", &cards[ncards++]);
 				break;
 			case 'i':
 				sscanf(optarg, "%d", &rs.idx);
@@ -66,73 +202,129 @@ int main(int argc, char **argv) {
 				}
 				break;
 		}
-	if (rs.cnum >= nva_cardsnum) {
-		if (nva_cardsnum)
-			fprintf (stderr, "No such card.\n");
-		else
-			fprintf (stderr, "No cards found.\n");
-		return 1;
+	if (!ncards)
+		cards[ncards++] = 0;
+	for (c = 0; c < ncards; c++) {
+		int d;
+		for (d = 0; d < c && cards[d] != cards[c]; d++);
+		if (d < c) {
+			/* the same card twice is no second card */
+			memmove(&cards[c], &cards[c + 1], (ncards - c - 1) * sizeof *cards);
+			ncards--;
+			c--;
+			continue;
+		}
+		if (cards[c] < 0 || cards[c] >= nva_cardsnum) {
+			if (nva_cardsnum)
+				fprintf (stderr, "No such card.\n");
+			else
+				fprintf (stderr, "No cards found.\n");
+			return 1;
+		}
 	}
+	rs.cnum = cards[0];
 	rs.card = nva_cards[rs.cnum];
 	if (rs.regsz == 0)
 		rs.regsz = nva_rsdefsz(&rs);
 	int unit = nva_rsunitsz(&rs);
-	int32_t a, b = rs.regsz/unit, i;
+	int32_t b = rs.regsz/unit, i;
 	if (optind >= argc) {
 		fprintf (stderr, "No address specified.\n");
 		return 1;
 	}
-	sscanf (argv[optind], "%x", &a);
+	sscanf (argv[optind], "%x", &base);
 	if (optind + 1 < argc)
 		sscanf (argv[optind + 1], "%x", &b);
-	int ls = 1;
-	for (i = 0; i < b; i+=rs.regsz/unit) {
-		uint64_t x, y, z;
-		int ex = nva_rd(&rs, a+i, &x);
-		int ew = 0, ey = 0, ev = 0, ez = 0, eb = 0;
-		if (!ex) {
-			ew = nva_wr(&rs, a+i, -1ll);
-			ey = nva_rd(&rs, a+i, &y);
-			ev = nva_wr(&rs, a+i, 0);
-			ez = nva_rd(&rs, a+i, &z);
-			eb = nva_wr(&rs, a+i, x);
+	step = rs.regsz/unit;
+	int n = b > 0 ? (b + step - 1) / step : 0;
+	if (jobs < ncards)
+		jobs = ncards;
+	if (jobs > ncards && !direct_space(&rs)) {
+		if (verbose)
+			fprintf (stderr, "Register space is indexed, using one job per card.\n");
+		jobs = ncards;
+	}
+	if (jobs > n)
+		jobs = n ? n : 1;
+
+	/* shared, so that the probing processes can fill it in */
+	struct probe *tab = mmap(0, (n ? n : 1) * sizeof *tab, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (tab == MAP_FAILED) {
+		perror("mmap");
+		return 1;
+	}
+	struct timespec t0, t1;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	if (jobs == 1) {
+		probe_slice(rs.cnum, tab, 0, n);
+	} else {
+		/* each process logs offline writes on its own, merged afterwards */
+		FILE *log = nva_offline_set_log(0);
+		FILE **logs = calloc(jobs, sizeof *logs);
+		int failed = 0;
+		for (c = 0; c < jobs && log; c++)
+			if (!(logs[c] = tmpfile())) {
+				perror("tmpfile");
+				return 1;
+			}
+		fflush(NULL);
+		for (c = 0; c < jobs; c++) {
+			pid_t pid = fork();
+			if (pid < 0) {
+				perror("fork");
+				return 1;
+			}
+			if (!pid) {
+				nva_offline_set_log(logs[c]);
+				probe_slice(cards[c % ncards], tab, (int64_t)n * c / jobs, (int64_t)n * (c + 1) / jobs);
+				fflush(NULL);
+				_exit(0);
+			}
 		}
-		if (ex || ey || ez || ey || ev || eb || x || y || z) {
-			if (ex) {
-				printf ("%06x: %c\n", a+i, nva_rserrc(ex));
+		for (c = 0; c < jobs; c++) {
+			int status;
+			if (wait(&status) < 0 || !WIFEXITED(status) || WEXITSTATUS(status))
+				failed = 1;
+		}
+		nva_offline_set_log(log);
+		if (log)
+			nva_offline_merge_logs(logs, jobs);
+		free(logs);
+		if (failed) {
+			fprintf (stderr, "A probing process failed.\n");
+			return 1;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	int *aliases = malloc((n ? n : 1) * sizeof *aliases);
+	if (alias)
+		find_aliases(tab, n, aliases);
+	if (verbose)
+		fprintf (stderr, "%d registers probed in %.3f s\n", n,
+				t1.tv_sec - t0.tv_sec + (t1.tv_nsec - t0.tv_nsec) / 1e9);
+
+	int ls = 1;
+	for (i = 0; i < n; i++) {
+		struct probe *p = &tab[i];
+		if (interesting(p)) {
+			if (p->ex) {
+				printf ("%06x: %c\n", base + i * step, nva_rserrc(p->ex));
 			} else {
-				int cool = (x != y) || (y != z);
-				int isalias = 0, areg;
-				if (cool && alias) {
-					int j;
-					nva_wr(&rs, a+i, -1ll);
-					for (j = 0; j < i; j+=4) {
-						uint64_t sv;
-						uint64_t ch;
-						int es = nva_rd(&rs, a+j, &sv);
-						if (!es) {
-							es |= nva_wr(&rs, a+j, 0);
-							es |= nva_rd(&rs, a+i, &ch);
-							es |= nva_wr(&rs, a+j, sv);
-							if (ch == z && !es) {
-								areg = a + j;
-								isalias = 1;
-								break;
-							}
-						}
-					}
-					nva_wr(&rs, a+i, x);
-				}
-				printf ("%06x:", a+i);
-				nva_rsprint(&rs, ex, x);
-				nva_rsprint(&rs, ey, y);
-				nva_rsprint(&rs, ez, z);
-				if (ew || ev || eb)
+				printf ("%06x:", base + i * step);
+				nva_rsprint(&rs, p->ex, p->x);
+				nva_rsprint(&rs, p->ey, p->y);
+				nva_rsprint(&rs, p->ez, p->z);
+				if (p->werr)
 					printf(" WERR");
-				if (cool)
+				if (cool(p))
 					printf(" *");
-				if (isalias) {
-					printf(" ALIASES %06x", areg);
+				if (showbits && cool(p)) {
+					printf(" W");
+					nva_rsprint(&rs, 0, writable(p));
+				}
+				if (alias && aliases[i] >= 0) {
+					printf(" ALIASES %06x", base + aliases[i]);
 				}
 				printf("\n");
 			}
@@ -142,14 +334,8 @@ int main(int argc, char **argv) {
 				printf("...\n");
 			ls = 0;
 		}
-		if (slow) {
-			int j;
-			for (j = 0; j < 100; j++)
-				nva_rd32(rs.cnum, 0);
-			usleep(10000);
-			for (j = 0; j < 100; j++)
-				nva_rd32(rs.cnum, 0);
-		}
 	}
+	free(aliases);
+	munmap(tab, (n ? n : 1) * sizeof *tab);
 	return 0;
 }
@@ -23,8 +23,11 @@
  */
 
 #include "nva.h"
+#include "nvasample.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
+#include <signal.h>
 #include <pthread.h>
 #include <sched.h>
 #include <inttypes.h>
@@ -102,6 +105,44 @@ void *t64watchfun(void *x) {
 	}
 }
 
+static struct nva_sampler *sampler;
+
+static void stop_sampler(int sig) {
+	nva_sampler_stop(sampler);
+}
+
+/* -o: samples all given registers into a file instead of printing changes */
+static int record(const char *file, uint32_t *regs, int nregs, int wanttime, int all, uint64_t count) {
+	uint32_t masks[NVA_SAMPLE_MAX_REGS];
+	uint64_t taken, recorded, dropped;
+	int i, res;
+	FILE *out = fopen(file, "wb");
+	if (!out) {
+		perror(file);
+		return 1;
+	}
+	for (i = 0; i < nregs; i++)
+		masks[i] = mask;
+	sampler = nva_sampler_new(cnum, regs, masks, nregs, wanttime ? NVA_SAMPLE_CLOCK_PTIMER : NVA_SAMPLE_CLOCK_HOST,
+			!all, SZ, out);
+	if (!sampler) {
+		fprintf (stderr, "Can't start sampling.\n");
+		fclose(out);
+		return 1;
+	}
+	signal(SIGINT, stop_sampler);
+	signal(SIGTERM, stop_sampler);
+	res = nva_sampler_run(sampler, count);
+	nva_sampler_stats(sampler, &taken, &recorded, &dropped);
+	fprintf (stderr, "%"PRIu64" samples taken, %"PRIu64" recorded, %"PRIu64" dropped\n", taken, recorded, dropped);
+	nva_sampler_del(sampler);
+	if (fclose(out) || res) {
+		perror(file);
+		return 1;
+	}
+	return 0;
+}
+
 int main(int argc, char **argv) {
 	if (nva_init()) {
 		fprintf (stderr, "PCI init failure!\n");
@@ -109,7 +150,10 @@ int main(int argc, char **argv) {
 	}
 	int c;
 	unsigned int wanttime = 0;
-	while ((c = getopt (argc, argv, "tc:m:")) != -1)
+	const char *outfile = 0;
+	uint64_t count = 0;
+	int all = 0;
+	while ((c = getopt (argc, argv, "tc:m:o:n:a")) != -1)
 		switch (c) {
 			case 't':
 				wanttime++;
@@ -122,6 +166,15 @@ int main(int argc, char **argv) {
 			case 'm':
 				sscanf(optarg, "%x", &mask);
 				break;
+			case 'o':
+				outfile = optarg;
+				break;
+			case 'n':
+				sscanf(optarg, "%"SCNu64, &count);
+				break;
+			case 'a':
+				all = 1;
+				break;
 		}
 	if (cnum >= nva_cardsnum) {
 		if (nva_cardsnum)
@@ -135,6 +188,18 @@ int main(int argc, char **argv) {
 		return 1;
 	}
 	sscanf (argv[optind], "%x", &a);
+	if (outfile) {
+		uint32_t regs[NVA_SAMPLE_MAX_REGS];
+		int nregs = 0;
+		for (; optind < argc; optind++) {
+			if (nregs == NVA_SAMPLE_MAX_REGS) {
+				fprintf (stderr, "Too many registers.\n");
+				return 1;
+			}
+			sscanf (argv[optind], "%x", &regs[nregs++]);
+		}
+		return record(outfile, regs, nregs, wanttime, all, count);
+	}
 
 	pthread_t thr;
 	if (wanttime == 0)
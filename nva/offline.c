@@ -0,0 +1,247 @@
+/*
+ * Copyright (C) 2026 The envytools authors.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Cards backed by files instead of hardware, for running the tools on
+ * machines without a GPU. Each file in NVA_OFFLINE (separated by ':') is
+ * one card, whose BAR0 is plain memory initialized from the file: either
+ * a raw image of BAR0, or a register file in the format nvapeek prints
+ * ("address: value value..." lines, "..." and error markers skipped).
+ * Registers then behave like memory - reads return the last value written.
+ *
+ * If NVA_OFFLINE_LOG is set, writes to BAR0 of offline cards are logged
+ * there as a text mmiotrace, which demmio can decode and
+ * nvammiotracereplay can replay on a real card. Processes writing to the
+ * cards alongside each other should each log to their own file, to be
+ * merged into the main log by timestamp once they're done.
+ */
+
+#include "nva.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <inttypes.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define OFFLINE_BAR0_SIZE 0x1000000
+
+struct nva_offline {
+	int map_id;
+};
+
+extern int nva_cardsmax;
+
+static FILE *offline_log;
+
+static uint64_t offline_ts(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* same placement as mmiotrace_gen: the first card at the usual place below 4GiB, others above */
+static uint64_t offline_bar0_addr(int map_id) {
+	return map_id == 1 ? 0xf2000000ull : (uint64_t)map_id << 32;
+}
+
+void nva_offline_wr(struct nva_card *card, int width, uint32_t addr, uint64_t val) {
+	uint64_t ts;
+	if (!offline_log)
+		return;
+	ts = offline_ts();
+	if (width < 8)
+		val &= (1ull << width * 8) - 1;
+	fprintf(offline_log, "W %d %"PRIu64".%06"PRIu64" %d 0x%"PRIx64" 0x%"PRIx64" 0x0 0\n", width,
+			ts / 1000000000, ts / 1000 % 1000000, card->offline->map_id,
+			offline_bar0_addr(card->offline->map_id) + addr, val);
+}
+
+/* sends the log somewhere else, returns where it went before */
+FILE *nva_offline_set_log(FILE *log) {
+	FILE *old = offline_log;
+	offline_log = log;
+	return old;
+}
+
+static int log_line(FILE *f, char *line, int size, uint64_t *ts) {
+	uint64_t sec, usec;
+	if (!fgets(line, size, f))
+		return 0;
+	*ts = sscanf(line, "%*s %*d %"SCNu64".%"SCNu64, &sec, &usec) == 2 ? sec * 1000000 + usec : 0;
+	return 1;
+}
+
+/* appends the logs to the main one in timestamp order, and closes them */
+void nva_offline_merge_logs(FILE **logs, int num) {
+	char (*lines)[256] = calloc(num, sizeof *lines);
+	uint64_t *ts = calloc(num, sizeof *ts);
+	int *more = calloc(num, sizeof *more);
+	int i;
+	for (i = 0; i < num; i++) {
+		fflush(logs[i]);
+		rewind(logs[i]);
+		more[i] = log_line(logs[i], lines[i], sizeof lines[i], &ts[i]);
+	}
+	for (;;) {
+		int min = -1;
+		for (i = 0; i < num; i++)
+			if (more[i] && (min < 0 || ts[i] < ts[min]))
+				min = i;
+		if (min < 0)
+			break;
+		if (offline_log)
+			fputs(lines[min], offline_log);
+		more[min] = log_line(logs[min], lines[min], sizeof lines[min], &ts[min]);
+	}
+	for (i = 0; i < num; i++)
+		fclose(logs[i]);
+	if (offline_log)
+		fflush(offline_log);
+	free(lines);
+	free(ts);
+	free(more);
+}
+
+static int load_regfile(struct nva_card *card, FILE *f) {
+	char line[1024];
+	while (fgets(line, sizeof line, f)) {
+		char *p = line, *end;
+		uint32_t addr = strtoul(p, &end, 16);
+		if (end == p || *end != ':')
+			continue;
+		p = end + 1;
+		for (;;) {
+			uint32_t val;
+			while (*p == ' ' || *p == '\t')
+				p++;
+			if (!*p || *p == '\n')
+				break;
+			val = strtoul(p, &end, 16);
+			if (end == p || (*end && !isspace(*end))) {
+				/* an error marker, nothing was read there */
+				while (*p && !isspace(*p))
+					p++;
+			} else {
+				p = end;
+				if (addr <= card->bar0len - 4)
+					nva_gwr32(card->bar0, addr, val);
+			}
+			addr += 4;
+		}
+	}
+	return ferror(f) ? -1 : 0;
+}
+
+static int load_image(struct nva_card *card, FILE *f) {
+	if (fread(card->bar0, 1, card->bar0len, f) < card->bar0len && ferror(f))
+		return -1;
+	return 0;
+}
+
+/* a register file starts with an "address:" line, anything else is taken as a raw image */
+static int is_regfile(FILE *f) {
+	char buf[32];
+	size_t len = fread(buf, 1, sizeof buf - 1, f), i = 0;
+	rewind(f);
+	buf[len] = 0;
+	while (i < len && isxdigit(buf[i]))
+		i++;
+	return i > 0 && buf[i] == ':';
+}
+
+static struct nva_card *offline_card(const char *path, int map_id) {
+	struct nva_card *card;
+	struct stat st;
+	FILE *f = fopen(path, "rb");
+	if (!f) {
+		perror(path);
+		return 0;
+	}
+	card = calloc(sizeof *card, 1);
+	card->offline = calloc(sizeof *card->offline, 1);
+	card->offline->map_id = map_id;
+	card->type = NVA_DEVICE_GPU;
+	card->bus_type = NVA_BUS_FILE;
+	card->bus.path = strdup(path);
+	card->bar0len = OFFLINE_BAR0_SIZE;
+	if (!fstat(fileno(f), &st) && st.st_size > card->bar0len)
+		card->bar0len = (st.st_size + 0xfff) & ~0xfffull;
+	card->bar0 = mmap(0, card->bar0len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (card->bar0 == MAP_FAILED || (is_regfile(f) ? load_regfile(card, f) : load_image(card, f))) {
+		fprintf (stderr, "WARN: Can't load %s\n", path);
+		if (card->bar0 != MAP_FAILED)
+			munmap(card->bar0, card->bar0len);
+		free(card->bus.path);
+		free(card->offline);
+		free(card);
+		fclose(f);
+		return 0;
+	}
+	fclose(f);
+	parse_pmc_id(nva_grd32(card->bar0, 0), &card->chipset);
+	return card;
+}
+
+static void offline_log_header(void) {
+	uint64_t ts = offline_ts();
+	int i;
+	fprintf(offline_log, "VERSION 20070824\n");
+	/* demmio only takes cards with a BAR1, so they get an empty one */
+	for (i = 0; i < nva_cardsnum; i++)
+		fprintf(offline_log, "PCIDEV %04x 10de%04x 0 %08"PRIx64" %08"PRIx64" 0 0 0 0 0 %zx 0 0 0 0 0 0 nva\n",
+				0x100 + i * 0x100, nva_cards[i]->chipset.chipset, offline_bar0_addr(i + 1),
+				offline_bar0_addr(i + 1) + 0x10000000, nva_cards[i]->bar0len);
+	for (i = 0; i < nva_cardsnum; i++) {
+		int id = nva_cards[i]->offline->map_id;
+		fprintf(offline_log, "MAP %"PRIu64".%06"PRIu64" %d 0x%"PRIx64" 0x0 0x%zx 0x0 0\n",
+				ts / 1000000000, ts / 1000 % 1000000, id, offline_bar0_addr(id), nva_cards[i]->bar0len);
+		/* PMC.ID first, so demmio can tell the chipset */
+		fprintf(offline_log, "R 4 %"PRIu64".%06"PRIu64" %d 0x%"PRIx64" 0x%08x 0x0 0\n",
+				ts / 1000000000, ts / 1000 % 1000000, id, offline_bar0_addr(id), nva_grd32(nva_cards[i]->bar0, 0));
+	}
+	fflush(offline_log);
+}
+
+int nva_init_offline(const char *spec) {
+	char *paths = strdup(spec), *path, *save;
+	const char *logname = getenv("NVA_OFFLINE_LOG");
+	for (path = strtok_r(paths, ":", &save); path; path = strtok_r(NULL, ":", &save)) {
+		struct nva_card *card = offline_card(path, nva_cardsnum + 1);
+		if (card)
+			ADDARRAY(nva_cards, card);
+	}
+	free(paths);
+	if (logname && *logname && nva_cardsnum) {
+		offline_log = fopen(logname, "w");
+		if (offline_log)
+			offline_log_header();
+		else
+			perror(logname);
+	}
+	return (nva_cardsnum == 0);
+}
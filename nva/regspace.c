@@ -30,13 +30,58 @@
 #include <inttypes.h>
 #include <pciaccess.h>
 
+/* index port, base and register count of a VGA register space */
+static int vga_port(struct nva_regspace *regspace, uint32_t *vgaio, uint32_t *vgabase, uint32_t *limit) {
+	switch (regspace->type) {
+		case NVA_REGSPACE_VGA_CR:
+			*vgaio = 0x3d4;
+			*limit = 0x100;
+			break;
+		case NVA_REGSPACE_VGA_SR:
+			*vgaio = 0x3c4;
+			*limit = 8;
+			break;
+		case NVA_REGSPACE_VGA_GR:
+			*vgaio = 0x3ce;
+			*limit = 0x10;
+			break;
+		case NVA_REGSPACE_VGA_AR:
+			*vgaio = 0x3c0;
+			*limit = 0x20;
+			break;
+		default:
+			abort();
+	}
+	if (regspace->regsz != 1)
+		return NVA_ERR_REGSZ;
+	if (regspace->card->chipset.card_type == 0x01) {
+		*vgabase = 0x6d0000;
+		if (regspace->idx != 0)
+			return NVA_ERR_NOSPC;
+	} else if (regspace->card->chipset.card_type < 0x50) {
+		if (*vgaio == 0x3c4 || *vgaio == 0x3ce)
+			*vgabase = 0x0c0000;
+		else
+			*vgabase = 0x601000;
+		if (regspace->idx > 2)
+			return NVA_ERR_NOSPC;
+		if ((regspace->card->chipset.chipset < 0x17 || regspace->card->chipset.chipset == 0x1a || regspace->card->chipset.chipset == 0x20) && regspace->idx == 1)
+			return NVA_ERR_NOSPC;
+		*vgabase += regspace->idx * 0x2000;
+	} else {
+		*vgabase = 0x601000;
+		if (regspace->idx != 0)
+			return NVA_ERR_NOSPC;
+	}
+	return 0;
+}
+
 int nva_wr(struct nva_regspace *regspace, uint32_t addr, uint64_t val) {
 	void *rawbase = 0;
 	size_t rawlen;
 	void *raw;
-	int i;
-	uint32_t vgaio;
-	uint32_t vgabase;
+	int i, e;
+	uint32_t vgaio, vgabase, vgalimit;
 	switch (regspace->type) {
 		case NVA_REGSPACE_BAR0:
 			rawbase = regspace->card->bar0;
@@ -63,6 +108,8 @@ int nva_wr(struct nva_regspace *regspace, uint32_t addr, uint64_t val) {
 			if (addr > rawlen - regspace->regsz)
 				return NVA_ERR_RANGE;
 			raw = (uint8_t *)rawbase + addr;
+			if (regspace->type == NVA_REGSPACE_BAR0 && regspace->card->offline)
+				nva_offline_wr(regspace->card, regspace->regsz, addr, val);
 			switch (regspace->regsz) {
 				case 1:
 					*(volatile uint8_t *)raw = val;
@@ -139,47 +186,14 @@ int nva_wr(struct nva_regspace *regspace, uint32_t addr, uint64_t val) {
 			while (nva_rd32(regspace->cnum, 0x60a400) & 0x10000000);
 			return 0;
 		case NVA_REGSPACE_VGA_CR:
-			vgaio = 0x3d4;
-			if (addr >= 0x100)
-				return NVA_ERR_RANGE;
-			goto vga;
 		case NVA_REGSPACE_VGA_SR:
-			vgaio = 0x3c4;
-			if (addr >= 8)
-				return NVA_ERR_RANGE;
-			goto vga;
 		case NVA_REGSPACE_VGA_GR:
-			vgaio = 0x3ce;
-			if (addr >= 0x10)
-				return NVA_ERR_RANGE;
-			goto vga;
 		case NVA_REGSPACE_VGA_AR:
-			vgaio = 0x3c0;
-			if (addr >= 0x20)
+			e = vga_port(regspace, &vgaio, &vgabase, &vgalimit);
+			if (addr >= vgalimit)
 				return NVA_ERR_RANGE;
-			goto vga;
-		vga:
-			if (regspace->regsz != 1)
-				return NVA_ERR_REGSZ;
-			if (regspace->card->chipset.card_type == 0x01) {
-				vgabase = 0x6d0000;
-				if (regspace->idx != 0)
-					return NVA_ERR_NOSPC;
-			} else if (regspace->card->chipset.card_type < 0x50) {
-				if (vgaio == 0x3c4 || vgaio == 0x3ce)
-					vgabase = 0x0c0000;
-				else
-					vgabase = 0x601000;
-				if (regspace->idx > 2)
-					return NVA_ERR_NOSPC;
-				if ((regspace->card->chipset.chipset < 0x17 || regspace->card->chipset.chipset == 0x1a || regspace->card->chipset.chipset == 0x20) && regspace->idx == 1)
-					return NVA_ERR_NOSPC;
-				vgabase += regspace->idx * 0x2000;
-			} else {
-				vgabase = 0x601000;
-				if (regspace->idx != 0)
-					return NVA_ERR_NOSPC;
-			}
+			if (e)
+				return e;
 			if (vgaio == 0x3c0) {
 				nva_rd8(regspace->cnum, vgabase + 0x3da);
 				uint8_t idx = nva_rd8(regspace->cnum, vgabase + 0x3c0);
@@ -312,9 +326,8 @@ int nva_rd(struct nva_regspace *regspace, uint32_t addr, uint64_t *val) {
 	void *rawbase = 0;
 	size_t rawlen;
 	void *raw;
-	int i;
-	uint32_t vgaio;
-	uint32_t vgabase;
+	int i, e;
+	uint32_t vgaio, vgabase, vgalimit;
 	switch (regspace->type) {
 		case NVA_REGSPACE_BAR0:
 			rawbase = regspace->card->bar0;
@@ -415,47 +428,14 @@ int nva_rd(struct nva_regspace *regspace, uint32_t addr, uint64_t *val) {
 			*val = nva_rd32(regspace->cnum, 0x60a400) & 0xff;
 			return 0;
 		case NVA_REGSPACE_VGA_CR:
-			vgaio = 0x3d4;
-			if (addr >= 0x100)
-				return NVA_ERR_RANGE;
-			goto vga;
 		case NVA_REGSPACE_VGA_SR:
-			vgaio = 0x3c4;
-			if (addr >= 8)
-				return NVA_ERR_RANGE;
-			goto vga;
 		case NVA_REGSPACE_VGA_GR:
-			vgaio = 0x3ce;
-			if (addr >= 0x10)
-				return NVA_ERR_RANGE;
-			goto vga;
 		case NVA_REGSPACE_VGA_AR:
-			vgaio = 0x3c0;
-			if (addr >= 0x20)
+			e = vga_port(regspace, &vgaio, &vgabase, &vgalimit);
+			if (addr >= vgalimit)
 				return NVA_ERR_RANGE;
-			goto vga;
-		vga:
-			if (regspace->regsz != 1)
-				return NVA_ERR_REGSZ;
-			if (regspace->card->chipset.card_type == 0x01) {
-				vgabase = 0x6d0000;
-				if (regspace->idx != 0)
-					return NVA_ERR_NOSPC;
-			} else if (regspace->card->chipset.card_type < 0x50) {
-				if (vgaio == 0x3c4 || vgaio == 0x3ce)
-					vgabase = 0x0c0000;
-				else
-					vgabase = 0x601000;
-				if (regspace->idx > 2)
-					return NVA_ERR_NOSPC;
-				if ((regspace->card->chipset.chipset < 0x17 || regspace->card->chipset.chipset == 0x1a || regspace->card->chipset.chipset == 0x20) && regspace->idx == 1)
-					return NVA_ERR_NOSPC;
-				vgabase += regspace->idx * 0x2000;
-			} else {
-				vgabase = 0x601000;
-				if (regspace->idx != 0)
-					return NVA_ERR_NOSPC;
-			}
+			if (e)
+				return e;
 			if (vgaio == 0x3c0) {
 				nva_rd8(regspace->cnum, vgabase + 0x3da);
 				uint8_t idx = nva_rd8(regspace->cnum, vgabase + 0x3c0);
@@ -589,6 +569,417 @@ int nva_rd(struct nva_regspace *regspace, uint32_t addr, uint64_t *val) {
 	}
 }
 
+/*
+ * Bulk accesses. These check the register space once instead of for every
+ * register, access raw spaces directly, and keep index registers of
+ * indirect spaces programmed across the batch where the hardware allows
+ * (VGA index saved and restored once, PDAC and macro code address
+ * auto-incremented). Spaces without a batched path fall back to nva_rd and
+ * nva_wr. Per-register errors go to errs if it's not NULL, and the first
+ * error is returned.
+ */
+
+/* base and length of a directly mapped register space, 0 if it isn't one */
+static int raw_space(struct nva_regspace *regspace, int write, void **base, size_t *len) {
+	switch (regspace->type) {
+		case NVA_REGSPACE_BAR0:
+			*base = regspace->card->bar0;
+			*len = regspace->card->bar0len;
+			return 1;
+		case NVA_REGSPACE_BAR1:
+			*base = write && !regspace->card->hasbar1 ? 0 : regspace->card->bar1;
+			*len = regspace->card->bar1len;
+			return 1;
+		case NVA_REGSPACE_BAR2:
+			*base = write && !regspace->card->hasbar2 ? 0 : regspace->card->bar2;
+			*len = regspace->card->bar2len;
+			return 1;
+		case NVA_REGSPACE_RAWMEM:
+			*base = regspace->card->rawmem;
+			*len = 0x100000;
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+static int raw_err(struct nva_regspace *regspace, int write, void *base, size_t len, uint32_t addr) {
+	if (!base) {
+		if (write && (regspace->type == NVA_REGSPACE_BAR1 || regspace->type == NVA_REGSPACE_BAR2))
+			return NVA_ERR_NOSPC;
+		return NVA_ERR_MAP;
+	}
+	if (addr > len - regspace->regsz)
+		return NVA_ERR_RANGE;
+	if (regspace->regsz != 1 && regspace->regsz != 2 && regspace->regsz != 4 && regspace->regsz != 8)
+		return NVA_ERR_REGSZ;
+	return 0;
+}
+
+/*
+ * The error raw_err would give every register of a batch regardless of its
+ * address - or 0, and then only the range is left to check per register.
+ * A bad regsz isn't reported here: raw_err puts the range check first, so
+ * the callers take their slow per-register path for it instead.
+ */
+static int raw_batch_ok(struct nva_regspace *regspace, int write, void *base, int *e) {
+	*e = 0;
+	if (!base) {
+		*e = raw_err(regspace, write, base, 0, 0);
+		return 0;
+	}
+	return regspace->regsz == 1 || regspace->regsz == 2 || regspace->regsz == 4 || regspace->regsz == 8;
+}
+
+/* how many of num registers step apart from addr on are inside the space */
+static int raw_fit(struct nva_regspace *regspace, size_t len, uint32_t addr, uint32_t step, int num) {
+	uint64_t n;
+	if (num <= 0 || len < regspace->regsz || addr > len - regspace->regsz)
+		return 0;
+	n = (len - regspace->regsz - addr) / step + 1;
+	return n < num ? n : num;
+}
+
+/* the first n are fine, the rest out of range */
+static int raw_errs(int *errs, int n, int num) {
+	int i;
+	if (errs)
+		for (i = 0; i < num; i++)
+			errs[i] = i < n ? 0 : NVA_ERR_RANGE;
+	return n < num ? NVA_ERR_RANGE : 0;
+}
+
+/* writes to an offline card's BAR0 go to its log as well */
+static int raw_logged(struct nva_regspace *regspace) {
+	return regspace->type == NVA_REGSPACE_BAR0 && regspace->card->offline;
+}
+
+static void raw_rdloop(struct nva_regspace *regspace, void *base, uint32_t addr, uint32_t step, int num, uint64_t *vals) {
+	uint8_t *raw = (uint8_t *)base + addr;
+	int i;
+	switch (regspace->regsz) {
+		case 1:
+			for (i = 0; i < num; i++, raw += step)
+				vals[i] = *(volatile uint8_t *)raw;
+			break;
+		case 2:
+			for (i = 0; i < num; i++, raw += step)
+				vals[i] = *(volatile uint16_t *)raw;
+			break;
+		case 4:
+			for (i = 0; i < num; i++, raw += step)
+				vals[i] = *(volatile uint32_t *)raw;
+			break;
+		default:
+			for (i = 0; i < num; i++, raw += step)
+				vals[i] = *(volatile uint64_t *)raw;
+			break;
+	}
+}
+
+static void raw_fillloop(struct nva_regspace *regspace, void *base, uint32_t addr, uint32_t step, int num, uint64_t val) {
+	uint8_t *raw = (uint8_t *)base + addr;
+	int i;
+	if (raw_logged(regspace))
+		for (i = 0; i < num; i++)
+			nva_offline_wr(regspace->card, regspace->regsz, addr + i * step, val);
+	switch (regspace->regsz) {
+		case 1:
+			for (i = 0; i < num; i++, raw += step)
+				*(volatile uint8_t *)raw = val;
+			break;
+		case 2:
+			for (i = 0; i < num; i++, raw += step)
+				*(volatile uint16_t *)raw = val;
+			break;
+		case 4:
+			for (i = 0; i < num; i++, raw += step)
+				*(volatile uint32_t *)raw = val;
+			break;
+		default:
+			for (i = 0; i < num; i++, raw += step)
+				*(volatile uint64_t *)raw = val;
+			break;
+	}
+}
+
+/* like raw_fillloop, but every register has its own address, checked here */
+static int raw_wrloop(struct nva_regspace *regspace, void *base, size_t len, const struct nva_regval *regs, int num, int *errs) {
+	uint8_t *raw = base;
+	size_t limit = len < regspace->regsz ? 0 : len - regspace->regsz + 1;
+	int i, bad = 0;
+	if (raw_logged(regspace))
+		for (i = 0; i < num; i++)
+			if (regs[i].addr < limit)
+				nva_offline_wr(regspace->card, regspace->regsz, regs[i].addr, regs[i].val);
+	switch (regspace->regsz) {
+		case 1:
+			for (i = 0; i < num; i++)
+				if (regs[i].addr < limit)
+					*(volatile uint8_t *)(raw + regs[i].addr) = regs[i].val;
+				else
+					bad = 1;
+			break;
+		case 2:
+			for (i = 0; i < num; i++)
+				if (regs[i].addr < limit)
+					*(volatile uint16_t *)(raw + regs[i].addr) = regs[i].val;
+				else
+					bad = 1;
+			break;
+		case 4:
+			for (i = 0; i < num; i++)
+				if (regs[i].addr < limit)
+					*(volatile uint32_t *)(raw + regs[i].addr) = regs[i].val;
+				else
+					bad = 1;
+			break;
+		default:
+			for (i = 0; i < num; i++)
+				if (regs[i].addr < limit)
+					*(volatile uint64_t *)(raw + regs[i].addr) = regs[i].val;
+				else
+					bad = 1;
+			break;
+	}
+	if (errs)
+		for (i = 0; i < num; i++)
+			errs[i] = regs[i].addr < limit ? 0 : NVA_ERR_RANGE;
+	return bad ? NVA_ERR_RANGE : 0;
+}
+
+static int seterr(int *errs, int i, int e, int res) {
+	if (errs)
+		errs[i] = e;
+	return res ? res : e;
+}
+
+int nva_rdrange(struct nva_regspace *regspace, uint32_t addr, int num, uint64_t *vals, int *errs) {
+	uint32_t step = regspace->regsz / nva_rsunitsz(regspace);
+	uint32_t vgaio, vgabase, vgalimit, a;
+	int i, j, e, res = 0;
+	uint8_t idx = 0;
+	size_t rawlen;
+	void *rawbase;
+	if (raw_space(regspace, 0, &rawbase, &rawlen)) {
+		if (raw_batch_ok(regspace, 0, rawbase, &e)) {
+			j = raw_fit(regspace, rawlen, addr, step, num);
+			raw_rdloop(regspace, rawbase, addr, step, j, vals);
+			for (i = j; i < num; i++)
+				vals[i] = 0;
+			return raw_errs(errs, j, num);
+		}
+		for (i = 0, a = addr; i < num; i++, a += step) {
+			vals[i] = 0;
+			res = seterr(errs, i, e ? e : raw_err(regspace, 0, rawbase, rawlen, a), res);
+		}
+		return res;
+	}
+	switch (regspace->type) {
+		case NVA_REGSPACE_VGA_CR:
+		case NVA_REGSPACE_VGA_SR:
+		case NVA_REGSPACE_VGA_GR:
+		case NVA_REGSPACE_VGA_AR:
+			e = vga_port(regspace, &vgaio, &vgabase, &vgalimit);
+			if (!e && num && addr < vgalimit) {
+				if (vgaio == 0x3c0) {
+					nva_rd8(regspace->cnum, vgabase + 0x3da);
+					idx = nva_rd8(regspace->cnum, vgabase + 0x3c0);
+				} else {
+					idx = nva_rd8(regspace->cnum, vgabase + vgaio);
+				}
+			}
+			for (i = 0, a = addr; i < num; i++, a += step) {
+				vals[i] = 0;
+				if (a >= vgalimit) {
+					res = seterr(errs, i, NVA_ERR_RANGE, res);
+					continue;
+				}
+				if (!e) {
+					if (vgaio == 0x3c0) {
+						nva_rd8(regspace->cnum, vgabase + 0x3da);
+						nva_wr8(regspace->cnum, vgabase + 0x3c0, a);
+						vals[i] = nva_rd8(regspace->cnum, vgabase + 0x3c1);
+					} else {
+						nva_wr8(regspace->cnum, vgabase + vgaio, a);
+						vals[i] = nva_rd8(regspace->cnum, vgabase + vgaio + 1);
+					}
+				}
+				res = seterr(errs, i, e, res);
+			}
+			if (!e && num && addr < vgalimit) {
+				if (vgaio == 0x3c0) {
+					nva_rd8(regspace->cnum, vgabase + 0x3da);
+					nva_wr8(regspace->cnum, vgabase + 0x3c0, idx);
+				} else {
+					nva_wr8(regspace->cnum, vgabase + vgaio, idx);
+				}
+			}
+			return res;
+		case NVA_REGSPACE_PDAC:
+			if (regspace->card->chipset.chipset != 0x01 || regspace->regsz > 8)
+				break;
+			/* the address auto-increments with every byte */
+			for (i = 0, a = addr; i < num; i++, a += step) {
+				vals[i] = 0;
+				if (a > 0x10000 - regspace->regsz) {
+					res = seterr(errs, i, NVA_ERR_RANGE, res);
+					continue;
+				}
+				if (i == 0) {
+					nva_wr32(regspace->cnum, 0x609010, a & 0xff);
+					nva_wr32(regspace->cnum, 0x609014, a >> 8);
+				}
+				for (j = 0; j < regspace->regsz; j++)
+					vals[i] |= (uint64_t)(nva_rd32(regspace->cnum, 0x609018) & 0xff) << j * 8;
+				res = seterr(errs, i, 0, res);
+			}
+			return res;
+		case NVA_REGSPACE_MACRO_CODE:
+			if (regspace->card->chipset.chipset < 0xc0 || regspace->regsz != 4 || !num)
+				break;
+			/* every read steps to the next word, so don't start over for each one */
+			nva_wr32(regspace->cnum, 0x40986c, 0x10);
+			nva_wr32(regspace->cnum, 0x409ffc, 2);
+			nva_wr32(regspace->cnum, 0x409928, 0xc);
+			while (nva_rd32(regspace->cnum, 0x409928));
+			nva_wr32(regspace->cnum, 0x40993c, 0xf);
+			nva_wr32(regspace->cnum, 0x409928, 0xa);
+			while (nva_rd32(regspace->cnum, 0x409928));
+			nva_wr32(regspace->cnum, 0x40991c, 0x1);
+			nva_wr32(regspace->cnum, 0x409928, 0x1);
+			while (nva_rd32(regspace->cnum, 0x409928));
+			for (a = 0; a < addr; a += 4) {
+				nva_wr32(regspace->cnum, 0x409928, 0x6);
+				while (nva_rd32(regspace->cnum, 0x409928));
+			}
+			for (i = 0; i < num; i++) {
+				nva_wr32(regspace->cnum, 0x409928, 0x6);
+				while (nva_rd32(regspace->cnum, 0x409928));
+				vals[i] = nva_rd32(regspace->cnum, 0x409918);
+				res = seterr(errs, i, 0, res);
+			}
+			return res;
+		default:
+			break;
+	}
+	for (i = 0, a = addr; i < num; i++, a += step) {
+		vals[i] = 0;
+		res = seterr(errs, i, nva_rd(regspace, a, &vals[i]), res);
+	}
+	return res;
+}
+
+int nva_wrv(struct nva_regspace *regspace, const struct nva_regval *regs, int num, int *errs) {
+	uint32_t vgaio, vgabase, vgalimit, next = 0;
+	int i, j, e, res = 0, saved = 0;
+	uint8_t idx = 0;
+	size_t rawlen;
+	void *rawbase;
+	if (raw_space(regspace, 1, &rawbase, &rawlen)) {
+		if (raw_batch_ok(regspace, 1, rawbase, &e))
+			return raw_wrloop(regspace, rawbase, rawlen, regs, num, errs);
+		for (i = 0; i < num; i++)
+			res = seterr(errs, i, e ? e : raw_err(regspace, 1, rawbase, rawlen, regs[i].addr), res);
+		return res;
+	}
+	switch (regspace->type) {
+		case NVA_REGSPACE_VGA_CR:
+		case NVA_REGSPACE_VGA_SR:
+		case NVA_REGSPACE_VGA_GR:
+		case NVA_REGSPACE_VGA_AR:
+			e = vga_port(regspace, &vgaio, &vgabase, &vgalimit);
+			for (i = 0; i < num; i++) {
+				uint32_t a = regs[i].addr;
+				if (a >= vgalimit) {
+					res = seterr(errs, i, NVA_ERR_RANGE, res);
+					continue;
+				}
+				if (!e) {
+					if (!saved) {
+						if (vgaio == 0x3c0) {
+							nva_rd8(regspace->cnum, vgabase + 0x3da);
+							idx = nva_rd8(regspace->cnum, vgabase + 0x3c0);
+						} else {
+							idx = nva_rd8(regspace->cnum, vgabase + vgaio);
+						}
+						saved = 1;
+					}
+					if (vgaio == 0x3c0) {
+						nva_rd8(regspace->cnum, vgabase + 0x3da);
+						nva_wr8(regspace->cnum, vgabase + 0x3c0, a);
+						nva_wr8(regspace->cnum, vgabase + 0x3c0, regs[i].val);
+					} else {
+						nva_wr8(regspace->cnum, vgabase + vgaio, a);
+						nva_wr8(regspace->cnum, vgabase + vgaio + 1, regs[i].val);
+					}
+				}
+				res = seterr(errs, i, e, res);
+			}
+			if (saved) {
+				if (vgaio == 0x3c0)
+					nva_rd8(regspace->cnum, vgabase + 0x3da);
+				nva_wr8(regspace->cnum, vgabase + vgaio, idx);
+			}
+			return res;
+		case NVA_REGSPACE_PDAC:
+			if (regspace->card->chipset.chipset != 0x01 || regspace->regsz > 8)
+				break;
+			/* the address auto-increments with every byte, only set it on jumps */
+			for (i = 0; i < num; i++) {
+				uint32_t a = regs[i].addr;
+				if (a > 0x10000 - regspace->regsz) {
+					res = seterr(errs, i, NVA_ERR_RANGE, res);
+					continue;
+				}
+				if (!saved || a != next) {
+					nva_wr32(regspace->cnum, 0x609010, a & 0xff);
+					nva_wr32(regspace->cnum, 0x609014, a >> 8);
+					saved = 1;
+				}
+				for (j = 0; j < regspace->regsz; j++)
+					nva_wr32(regspace->cnum, 0x609018, (regs[i].val >> j * 8) & 0xff);
+				next = a + regspace->regsz;
+				res = seterr(errs, i, 0, res);
+			}
+			return res;
+		default:
+			break;
+	}
+	for (i = 0; i < num; i++)
+		res = seterr(errs, i, nva_wr(regspace, regs[i].addr, regs[i].val), res);
+	return res;
+}
+
+int nva_fill(struct nva_regspace *regspace, uint32_t addr, int num, uint64_t val, int *errs) {
+	uint32_t step = regspace->regsz / nva_rsunitsz(regspace), a;
+	struct nva_regval regs[256];
+	int i, j, n, e, res = 0;
+	size_t rawlen;
+	void *rawbase;
+	if (raw_space(regspace, 1, &rawbase, &rawlen)) {
+		if (raw_batch_ok(regspace, 1, rawbase, &e)) {
+			n = raw_fit(regspace, rawlen, addr, step, num);
+			raw_fillloop(regspace, rawbase, addr, step, n, val);
+			return raw_errs(errs, n, num);
+		}
+		for (i = 0, a = addr; i < num; i++, a += step)
+			res = seterr(errs, i, e ? e : raw_err(regspace, 1, rawbase, rawlen, a), res);
+		return res;
+	}
+	for (i = 0; i < num; i += n) {
+		n = num - i < 256 ? num - i : 256;
+		for (j = 0; j < n; j++) {
+			regs[j].addr = addr + (i + j) * step;
+			regs[j].val = val;
+		}
+		e = nva_wrv(regspace, regs, n, errs ? errs + i : NULL);
+		if (!res)
+			res = e;
+	}
+	return res;
+}
+
 int nva_rstype(const char *name) {
 	if (!strcmp(name, "bar0"))
 		return NVA_REGSPACE_BAR0;
@@ -0,0 +1,389 @@
+/*
+ * Copyright (C) 2026 The envytools authors.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "nva.h"
+#include "nvasample.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <inttypes.h>
+
+struct nva_sampler {
+	int cnum;
+	int nregs;
+	uint32_t regs[NVA_SAMPLE_MAX_REGS];
+	uint32_t masks[NVA_SAMPLE_MAX_REGS];
+	enum nva_sample_clock clock;
+	int changes_only;
+	FILE *out;
+	/* the ring: the sampling loop only moves head, the writer only tail */
+	uint8_t *ring;
+	size_t rec_size, ring_mask;
+	_Atomic size_t head, tail;
+	atomic_int stop, done, error;
+	uint64_t taken, recorded, dropped;
+	pthread_t writer;
+};
+
+#define NV04_PTIMER_TIME_0 0x9400
+#define NV04_PTIMER_TIME_1 0x9410
+
+static uint64_t ptimer_time(int cnum) {
+	uint32_t low, high1, high2 = nva_rd32(cnum, NV04_PTIMER_TIME_1);
+	do {
+		high1 = high2;
+		low = nva_rd32(cnum, NV04_PTIMER_TIME_0);
+		high2 = nva_rd32(cnum, NV04_PTIMER_TIME_1);
+	} while (high1 != high2);
+	return (uint64_t)high2 << 32 | low;
+}
+
+static uint64_t host_time(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static size_t rec_size(int nregs) {
+	return (8 + 4 * nregs + 7) & ~(size_t)7;
+}
+
+/* how long the writer sleeps on an empty ring, doubling while it stays empty */
+#define WRITER_IDLE_MIN 10000
+#define WRITER_IDLE_MAX 1000000
+
+/*
+ * Writes out whatever the sampling loop has put in the ring, in contiguous
+ * pieces. It sleeps rather than spins while there's nothing to write, so
+ * as not to take a core from the sampling loop.
+ */
+static void *writer_fun(void *x) {
+	struct nva_sampler *s = x;
+	long idle = 0;
+	for (;;) {
+		size_t head = atomic_load_explicit(&s->head, memory_order_acquire);
+		size_t tail = atomic_load_explicit(&s->tail, memory_order_relaxed);
+		if (head == tail) {
+			struct timespec ts = { 0 };
+			if (atomic_load(&s->done))
+				break;
+			idle = idle ? idle * 2 : WRITER_IDLE_MIN;
+			if (idle > WRITER_IDLE_MAX)
+				idle = WRITER_IDLE_MAX;
+			ts.tv_nsec = idle;
+			nanosleep(&ts, 0);
+			continue;
+		}
+		idle = 0;
+		size_t start = tail & s->ring_mask;
+		size_t num = head - tail;
+		if (num > s->ring_mask + 1 - start)
+			num = s->ring_mask + 1 - start;
+		if (fwrite(s->ring + start * s->rec_size, s->rec_size, num, s->out) != num)
+			atomic_store(&s->error, 1);
+		atomic_store_explicit(&s->tail, tail + num, memory_order_release);
+	}
+	if (fflush(s->out))
+		atomic_store(&s->error, 1);
+	return 0;
+}
+
+struct nva_sampler *nva_sampler_new(int cnum, const uint32_t *regs, const uint32_t *masks, int nregs,
+		enum nva_sample_clock clock, int changes_only, size_t ringsize, FILE *out) {
+	struct nva_sample_header hdr = { .magic = NVA_SAMPLE_MAGIC, .version = NVA_SAMPLE_VERSION };
+	struct nva_sampler *s;
+	size_t size = 1;
+	int i;
+	if (nregs < 1 || nregs > NVA_SAMPLE_MAX_REGS)
+		return NULL;
+	while (size < ringsize)
+		size <<= 1;
+	s = calloc(1, sizeof *s);
+	s->cnum = cnum;
+	s->nregs = nregs;
+	s->clock = clock;
+	s->changes_only = changes_only;
+	s->out = out;
+	s->rec_size = rec_size(nregs);
+	s->ring_mask = size - 1;
+	s->ring = malloc(size * s->rec_size);
+	if (!s->ring) {
+		free(s);
+		return NULL;
+	}
+	/* fault the ring in now rather than in the sampling loop */
+	memset(s->ring, 0, size * s->rec_size);
+	hdr.rec_size = s->rec_size;
+	hdr.clock = clock;
+	hdr.nregs = nregs;
+	for (i = 0; i < nregs; i++) {
+		hdr.regs[i] = s->regs[i] = regs[i];
+		hdr.masks[i] = s->masks[i] = masks ? masks[i] : 0xffffffff;
+	}
+	if (fwrite(&hdr, sizeof hdr, 1, out) != 1) {
+		free(s->ring);
+		free(s);
+		return NULL;
+	}
+	return s;
+}
+
+int nva_sampler_run(struct nva_sampler *s, uint64_t count) {
+	uint32_t prev[NVA_SAMPLE_MAX_REGS], cur[NVA_SAMPLE_MAX_REGS];
+	size_t head = atomic_load(&s->head);
+	int i, first = 1;
+	atomic_store(&s->done, 0);
+	if (pthread_create(&s->writer, 0, writer_fun, s))
+		return -1;
+	while ((!count || s->taken < count) && !atomic_load_explicit(&s->stop, memory_order_relaxed)) {
+		uint64_t ts = s->clock == NVA_SAMPLE_CLOCK_PTIMER ? ptimer_time(s->cnum) : host_time();
+		int changed = first;
+		for (i = 0; i < s->nregs; i++)
+			cur[i] = nva_rd32(s->cnum, s->regs[i]);
+		s->taken++;
+		if (s->changes_only && !first) {
+			for (i = 0; i < s->nregs; i++)
+				if ((cur[i] ^ prev[i]) & s->masks[i])
+					changed = 1;
+			if (!changed)
+				continue;
+		}
+		if (head - atomic_load_explicit(&s->tail, memory_order_acquire) > s->ring_mask) {
+			s->dropped++;
+			continue;
+		}
+		uint8_t *rec = s->ring + (head & s->ring_mask) * s->rec_size;
+		memcpy(rec, &ts, 8);
+		memcpy(rec + 8, cur, 4 * s->nregs);
+		atomic_store_explicit(&s->head, ++head, memory_order_release);
+		memcpy(prev, cur, sizeof cur);
+		first = 0;
+		s->recorded++;
+	}
+	atomic_store(&s->done, 1);
+	pthread_join(s->writer, 0);
+	return atomic_load(&s->error) ? -1 : 0;
+}
+
+void nva_sampler_stop(struct nva_sampler *s) {
+	atomic_store(&s->stop, 1);
+}
+
+void nva_sampler_stats(struct nva_sampler *s, uint64_t *taken, uint64_t *recorded, uint64_t *dropped) {
+	*taken = s->taken;
+	*recorded = s->recorded;
+	*dropped = s->dropped;
+}
+
+void nva_sampler_del(struct nva_sampler *s) {
+	if (!s)
+		return;
+	free(s->ring);
+	free(s);
+}
+
+/*
+ * Value histogram: an open addressing hash of value -> count. Counter-like
+ * registers can take a new value every sample, so past HIST_MAX distinct
+ * values new ones are only counted in "other".
+ */
+#define HIST_MAX (1 << 22)
+
+struct hist {
+	uint32_t *vals;
+	uint64_t *cnts;
+	size_t size, used;
+	uint64_t other;
+};
+
+static size_t hist_slot(const struct hist *h, uint32_t val) {
+	size_t i = (val * 0x9e3779b1u) & (h->size - 1);
+	while (h->cnts[i] && h->vals[i] != val)
+		i = (i + 1) & (h->size - 1);
+	return i;
+}
+
+static void hist_grow(struct hist *h) {
+	struct hist old = *h;
+	size_t i;
+	h->size = old.size ? old.size * 2 : 256;
+	h->vals = calloc(h->size, sizeof *h->vals);
+	h->cnts = calloc(h->size, sizeof *h->cnts);
+	for (i = 0; i < old.size; i++)
+		if (old.cnts[i]) {
+			size_t j = hist_slot(h, old.vals[i]);
+			h->vals[j] = old.vals[i];
+			h->cnts[j] = old.cnts[i];
+		}
+	free(old.vals);
+	free(old.cnts);
+}
+
+static void hist_add(struct hist *h, uint32_t val) {
+	size_t i;
+	if (h->used * 2 >= h->size && h->size < 2 * HIST_MAX)
+		hist_grow(h);
+	i = hist_slot(h, val);
+	if (!h->cnts[i]) {
+		if (h->used >= HIST_MAX) {
+			h->other++;
+			return;
+		}
+		h->vals[i] = val;
+		h->used++;
+	}
+	h->cnts[i]++;
+}
+
+struct hist_ent {
+	uint32_t val;
+	uint64_t cnt;
+};
+
+static int hist_cmp(const void *pa, const void *pb) {
+	const struct hist_ent *a = pa, *b = pb;
+	if (a->cnt != b->cnt)
+		return a->cnt < b->cnt ? 1 : -1;
+	return (a->val > b->val) - (a->val < b->val);
+}
+
+struct regstat {
+	struct hist hist;
+	uint32_t last;
+	uint64_t lastts, changes;
+	uint64_t imin, imax, isum, ibucket[64];
+};
+
+static int log2_bucket(uint64_t x) {
+	int i = 0;
+	while (x > 1) {
+		x >>= 1;
+		i++;
+	}
+	return i;
+}
+
+static void print_regstat(FILE *out, const struct nva_sample_header *hdr, int r, struct regstat *st,
+		uint64_t samples, int top) {
+	struct hist_ent *ents = malloc((st->hist.used + 1) * sizeof *ents);
+	size_t i, n = 0;
+	for (i = 0; i < st->hist.size; i++)
+		if (st->hist.cnts[i]) {
+			ents[n].val = st->hist.vals[i];
+			ents[n].cnt = st->hist.cnts[i];
+			n++;
+		}
+	qsort(ents, n, sizeof *ents, hist_cmp);
+	fprintf(out, "%08x", hdr->regs[r]);
+	if (hdr->masks[r] != 0xffffffff)
+		fprintf(out, " & %08x", hdr->masks[r]);
+	fprintf(out, ": %"PRIu64" changes, %zu%s distinct values\n", st->changes, n, st->hist.other ? "+" : "");
+	for (i = 0; i < n && (!top || i < top); i++)
+		fprintf(out, "\t%08x: %"PRIu64" (%.2f%%)\n", ents[i].val, ents[i].cnt, 100.0 * ents[i].cnt / samples);
+	if (i < n || st->hist.other) {
+		uint64_t rest = st->hist.other;
+		for (; i < n; i++)
+			rest += ents[i].cnt;
+		fprintf(out, "\tothers: %"PRIu64" (%.2f%%)\n", rest, 100.0 * rest / samples);
+	}
+	if (st->changes > 1) {
+		fprintf(out, "\tbetween changes: min %"PRIu64" mean %.1f max %"PRIu64"\n",
+				st->imin, (double)st->isum / (st->changes - 1), st->imax);
+		for (i = 0; i < 64; i++)
+			if (st->ibucket[i])
+				fprintf(out, "\t\t[%"PRIu64", %"PRIu64"): %"PRIu64"\n", i ? (uint64_t)1 << i : 0,
+						i < 63 ? (uint64_t)2 << i : UINT64_MAX, st->ibucket[i]);
+	}
+	free(ents);
+}
+
+int nva_sample_summarize(FILE *in, FILE *out, int top, int flags) {
+	struct nva_sample_header hdr;
+	struct regstat st[NVA_SAMPLE_MAX_REGS];
+	uint64_t samples = 0, first = 0, last = 0;
+	size_t chunk = 4096, n, i;
+	uint8_t *buf;
+	int r;
+	if (fread(&hdr, sizeof hdr, 1, in) != 1 || memcmp(hdr.magic, NVA_SAMPLE_MAGIC, sizeof hdr.magic) ||
+			hdr.version != NVA_SAMPLE_VERSION || hdr.nregs < 1 || hdr.nregs > NVA_SAMPLE_MAX_REGS ||
+			hdr.rec_size != rec_size(hdr.nregs))
+		return -1;
+	memset(st, 0, sizeof st);
+	buf = malloc(chunk * hdr.rec_size);
+	while ((n = fread(buf, hdr.rec_size, chunk, in))) {
+		for (i = 0; i < n; i++) {
+			uint8_t *rec = buf + i * hdr.rec_size;
+			uint64_t ts;
+			memcpy(&ts, rec, 8);
+			if (!samples)
+				first = ts;
+			last = ts;
+			for (r = 0; r < hdr.nregs; r++) {
+				struct regstat *s = &st[r];
+				uint32_t val;
+				memcpy(&val, rec + 8 + 4 * r, 4);
+				hist_add(&s->hist, val);
+				if (samples && !((val ^ s->last) & hdr.masks[r])) {
+					s->last = val;
+					continue;
+				}
+				if (samples) {
+					uint64_t d = ts - s->lastts;
+					if (flags & NVA_SAMPLE_EVENTS)
+						fprintf(out, "%016"PRIu64"[+%"PRIu64"] %08x: %08x -> %08x\n",
+								ts, d, hdr.regs[r], s->last, val);
+					/* the first change has nothing to be measured from */
+					if (s->changes) {
+						if (s->changes == 1 || d < s->imin)
+							s->imin = d;
+						if (d > s->imax)
+							s->imax = d;
+						s->isum += d;
+						s->ibucket[log2_bucket(d)]++;
+					}
+					s->changes++;
+				}
+				s->last = val;
+				s->lastts = ts;
+			}
+			samples++;
+		}
+	}
+	free(buf);
+	fprintf(out, "%"PRIu64" samples of %d registers over %"PRIu64" %s",
+			samples, hdr.nregs, last - first, hdr.clock == NVA_SAMPLE_CLOCK_PTIMER ? "PTIMER ticks" : "ns");
+	if (last != first && hdr.clock == NVA_SAMPLE_CLOCK_HOST)
+		fprintf(out, " (%.0f samples/s)", samples / ((last - first) / 1e9));
+	fprintf(out, "\n");
+	for (r = 0; r < hdr.nregs; r++) {
+		if (samples)
+			print_regstat(out, &hdr, r, &st[r], samples, top);
+		free(st[r].hist.vals);
+		free(st[r].hist.cnts);
+	}
+	return 0;
+}
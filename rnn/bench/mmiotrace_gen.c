@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2026 The envytools authors.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Writes a synthetic mmiotrace of an NVIDIA card in the kernel's text format:
+ * the header, a PCIDEV line, MAPs of the BARs, a mix of register reads and
+ * writes to BAR0 (PMC, PTIMER, PFIFO, PGRAPH, PRAMIN window...) with some
+ * BAR1 and BAR3 traffic, occasional MARKs and UNMAPs at the end. With -g,
+ * several such cards are traced at once, accesses going to random cards.
+ *
+ * Usage: mmiotrace_gen [-n accesses] [-c chipset] [-g cards] [-s seed] > trace.txt
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <unistd.h>
+
+static uint32_t seed = 1;
+
+static uint32_t rnd(void) {
+	seed = seed * 1103515245 + 12345;
+	return seed >> 8;
+}
+
+#define MAX_CARDS 16
+
+/* the first card sits at the usual place below 4GiB, others above */
+static uint64_t bar0[MAX_CARDS], bar1[MAX_CARDS], bar3[MAX_CARDS];
+
+static void set_bars(int card) {
+	uint64_t base = (uint64_t)(card + 1) << 32;
+	if (!card) {
+		bar0[card] = 0xf2000000ull;
+		bar1[card] = 0xe0000000ull;
+		bar3[card] = 0xf0000000ull;
+	} else {
+		bar0[card] = base;
+		bar1[card] = base + 0x10000000;
+		bar3[card] = base + 0x20000000;
+	}
+}
+
+/* register ranges the blob hits the most, with weights */
+static const struct {
+	uint32_t base, size;
+	int weight;
+} ranges[] = {
+	{ 0x000000, 0x200, 10 },	/* PMC */
+	{ 0x009400, 0x20, 20 },		/* PTIMER */
+	{ 0x002000, 0x1000, 10 },	/* PFIFO */
+	{ 0x400000, 0x10000, 20 },	/* PGRAPH */
+	{ 0x610000, 0x2000, 10 },	/* PDISPLAY */
+	{ 0x700000, 0x100000, 15 },	/* PRAMIN */
+	{ 0x00e000, 0x800, 5 },		/* PNVIO/I2C */
+	{ 0x10a000, 0x1000, 5 },	/* PDAEMON */
+	{ 0x001700, 0x20, 5 },		/* PBUS */
+};
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+int main(int argc, char **argv) {
+	long n = 1000000, i;
+	int c, chipset = 0xe4, cards = 1, card;
+	uint64_t ts = 100000000000ull;	/* ns */
+	int total = 0;
+
+	while ((c = getopt(argc, argv, "n:c:g:s:")) != -1)
+		switch (c) {
+			case 'n':
+				n = strtol(optarg, NULL, 0);
+				break;
+			case 'c':
+				chipset = strtol(optarg, NULL, 16);
+				break;
+			case 'g':
+				cards = strtol(optarg, NULL, 0);
+				if (cards < 1 || cards > MAX_CARDS) {
+					fprintf(stderr, "number of cards must be between 1 and %d\n", MAX_CARDS);
+					return 1;
+				}
+				break;
+			case 's':
+				seed = strtoul(optarg, NULL, 0);
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-n accesses] [-c chipset] [-g cards] [-s seed]\n", argv[0]);
+				return 1;
+		}
+
+	for (i = 0; i < ARRAY_SIZE(ranges); i++)
+		total += ranges[i].weight;
+
+	printf("VERSION 20070824\n");
+	for (card = 0; card < cards; card++) {
+		set_bars(card);
+		printf("PCIDEV %04x 10de%04x 10 %08"PRIx64" %08"PRIx64" 0 %08"PRIx64" 0 e001 c0000 "
+				"1000000 8000000 0 2000000 0 80 80000 nvidia\n",
+				0x100 + card * 0x100, 0x1180 + (chipset & 0xf), bar0[card], bar1[card] | 0xc, bar3[card] | 0xc);
+	}
+	for (card = 0; card < cards; card++) {
+		printf("MAP %"PRIu64".%06"PRIu64" %d 0x%"PRIx64" 0xffffc90010000000 0x1000000 0x0 0\n", ts / 1000000000, ts / 1000 % 1000000, card * 3 + 1, bar0[card]);
+		printf("MAP %"PRIu64".%06"PRIu64" %d 0x%"PRIx64" 0xffffc90020000000 0x200000 0x0 0\n", ts / 1000000000, ts / 1000 % 1000000, card * 3 + 2, bar1[card]);
+		printf("MAP %"PRIu64".%06"PRIu64" %d 0x%"PRIx64" 0xffffc90030000000 0x200000 0x0 0\n", ts / 1000000000, ts / 1000 % 1000000, card * 3 + 3, bar3[card]);
+
+		/* PMC.ID first, so demmio can tell the chipset */
+		printf("R 4 %"PRIu64".%06"PRIu64" %d 0x%"PRIx64" 0x%08x 0x0 0\n", ts / 1000000000, ts / 1000 % 1000000, card * 3 + 1, bar0[card],
+				chipset << 20 | 0xa1);
+	}
+
+	for (i = 0; i < n; i++) {
+		uint32_t r = rnd();
+		uint64_t addr;
+		int map, j;
+
+		/* mostly back-to-back accesses, sometimes a pause long enough for a SLEEP */
+		ts += (r & 0xff) == 0 ? 150000 + rnd() % 1000000 : 200 + rnd() % 5000;
+
+		if ((r & 0xffff) == 1) {
+			printf("MARK %"PRIu64".%06"PRIu64" step %ld\n", ts / 1000000000, ts / 1000 % 1000000, i);
+			continue;
+		}
+
+		card = cards > 1 ? rnd() % cards : 0;
+		if (r % 100 < 90) {
+			int w = rnd() % total;
+			for (j = 0; w >= ranges[j].weight; j++)
+				w -= ranges[j].weight;
+			addr = bar0[card] + ranges[j].base + (rnd() % ranges[j].size & ~3);
+			map = card * 3 + 1;
+		} else if (r % 100 < 95) {
+			addr = bar1[card] + (rnd() % 0x200000 & ~3);
+			map = card * 3 + 2;
+		} else {
+			addr = bar3[card] + (rnd() % 0x200000 & ~3);
+			map = card * 3 + 3;
+		}
+
+		printf("%c 4 %"PRIu64".%06"PRIu64" %d 0x%"PRIx64" 0x%08x 0x0 0\n", rnd() & 1 ? 'W' : 'R',
+				ts / 1000000000, ts / 1000 % 1000000, map, addr, rnd() << 8 | (rnd() & 0xff));
+	}
+
+	for (c = 1; c <= cards * 3; c++)
+		printf("UNMAP %"PRIu64".%06"PRIu64" %d 0x0 0\n", ts / 1000000000, ts / 1000 % 1000000, c);
+
+	return 0;
+}
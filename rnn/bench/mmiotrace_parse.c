@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2026 The envytools authors.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Compares the mmiotrace tokenizer with the fgets + sscanf parsing demmio
+ * used to do, on an mmiotrace file (see mmiotrace_gen). If the same trace
+ * converted by mmiotrace2bin is given too, the binary reader is also run.
+ * All parsers have to agree on every access; lines/s and MB/s are reported
+ * for each.
+ *
+ * Usage: mmiotrace_parse trace.txt [trace.bin]
+ */
+
+#include "mmiotrace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include <sys/stat.h>
+
+struct result {
+	uint64_t lines, bytes, accesses, sum;
+};
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void parse_sscanf(FILE *f, struct result *res) {
+	char line[1024];
+	while (fgets(line, sizeof(line), f)) {
+		res->lines++;
+		if (!strncmp(line, "PCIDEV ", 7)) {
+			uint64_t bar[4], len[4], pciid;
+			sscanf (line, "%*s %*s %"SCNx64" %*s %"SCNx64" %"SCNx64" %"SCNx64" %"SCNx64" %*s %*s %*s %"SCNx64" %"SCNx64" %"SCNx64" %"SCNx64"", &pciid, &bar[0], &bar[1], &bar[2], &bar[3], &len[0], &len[1], &len[2], &len[3]);
+			res->sum += pciid + bar[0] + len[0];
+		} else if (!strncmp(line, "W ", 2) || !strncmp(line, "R ", 2)) {
+			double timestamp;
+			uint64_t addr, value;
+			int width;
+			sscanf (line, "%*s %d %lf %*d %"SCNx64" %"SCNx64, &width, &timestamp, &addr, &value);
+			res->accesses++;
+			res->sum += width + (uint64_t)(timestamp * 1e6 + 0.5) + addr + value;
+		}
+	}
+}
+
+static void parse_tokenizer(FILE *f, struct result *res) {
+	struct mmiotrace_reader *r = mmiotrace_reader_new(f);
+	struct mmiotrace_rec rec;
+	while (mmiotrace_next(r, &rec)) {
+		res->lines++;
+		if (rec.type == MMIOTRACE_PCIDEV) {
+			res->sum += rec.pciid + rec.bar[0] + rec.barlen[0];
+		} else if (rec.type == MMIOTRACE_READ || rec.type == MMIOTRACE_WRITE) {
+			res->accesses++;
+			res->sum += rec.width + (rec.ts + 500) / 1000 + rec.addr + rec.value;
+		}
+	}
+	mmiotrace_reader_del(r);
+}
+
+static int run(const char *name, const char *file, void (*parse)(FILE *, struct result *), struct result *res) {
+	FILE *f = fopen(file, "r");
+	struct stat st;
+	double t;
+	if (!f || fstat(fileno(f), &st)) {
+		perror(file);
+		return 1;
+	}
+	memset(res, 0, sizeof *res);
+	t = now();
+	parse(f, res);
+	t = now() - t;
+	fclose(f);
+	res->bytes = st.st_size;
+	printf("%-10s %10"PRIu64" lines %10.0f lines/s %8.1f MB/s %7.3f s\n", name, res->lines,
+			res->lines / t, res->bytes / t / 1e6, t);
+	return 0;
+}
+
+static int disagree(const struct result *a, const struct result *b) {
+	if (a->lines == b->lines && a->accesses == b->accesses && a->sum == b->sum)
+		return 0;
+	fprintf(stderr, "parsers disagree: %"PRIu64"/%"PRIu64" lines, %"PRIu64"/%"PRIu64" accesses\n",
+			a->lines, b->lines, a->accesses, b->accesses);
+	return 1;
+}
+
+int main(int argc, char **argv) {
+	struct result a, b;
+	if (argc != 2 && argc != 3) {
+		fprintf(stderr, "usage: %s trace.txt [trace.bin]\n", argv[0]);
+		return 1;
+	}
+	if (run("sscanf", argv[1], parse_sscanf, &a) || run("tokenizer", argv[1], parse_tokenizer, &b))
+		return 1;
+	if (disagree(&a, &b))
+		return 1;
+	if (argc == 3 && (run("binary", argv[2], parse_tokenizer, &b) || disagree(&a, &b)))
+		return 1;
+	return 0;
+}
@@ -242,6 +242,7 @@ dedma(struct state *s, FILE *f, bool dry_run)
 
 	s->f = f;
 	s->op.print = (dry_run ? dont_printf : printf);
+	init_cache(s);
 
 	for (i = 0; e1 = e0, e0 = get_ent(s, i); i++) {
 		if (!e1)
@@ -274,41 +275,43 @@ dedma(struct state *s, FILE *f, bool dry_run)
 			}
 
 		} else if (e0->addr < e1->addr + 4) {
-			/* badly ordered write, find a place for it */
-
-			for (j = i - 1; (j > i - MAX_DELTA &&
-					 (e1 = get_ent(s, j))); j--) {
-				if (e0->addr == e1->addr) {
-					/* duplicated write, keep the
-					 * most recent one */
-					*e1 = *e0;
-					drop_ent(s, i--);
-					break;
-
-				} else if (e0->addr == e1->addr + 3) {
-					/* 8bit writes */
-					e1->val |= e0->val << 24;
-					drop_ent(s, i--);
-					break;
-
-				} else if (e0->addr == e1->addr + 2) {
-					/* 16bit writes */
-					e1->val |= e0->val << 16;
-					drop_ent(s, i--);
-					break;
-
-				} else if (e0->addr == e1->addr + 1) {
-					/* 8bit writes */
-					e1->val |= e0->val << 8;
-					drop_ent(s, i--);
-					break;
-
-				} else if (e0->addr > e1->addr) {
-					/* unordered write */
-					rotate_ent(s, j + 1, i);
-					break;
-				}
+			/* badly ordered write, find a place for it after
+			 * the last write to a lower address */
+
+			j = find_ent_le(s, i - MAX_DELTA + 1, i - 1, e0->addr);
+			if (j < 0)
+				continue;
+
+			e1 = get_ent(s, j);
+			if (e0->addr == e1->addr) {
+				/* duplicated write, keep the
+				 * most recent one */
+				*e1 = *e0;
+				drop_ent(s, i--);
+
+			} else if (e0->addr == e1->addr + 3) {
+				/* 8bit writes */
+				e1->val |= e0->val << 24;
+				drop_ent(s, i--);
+
+			} else if (e0->addr == e1->addr + 2) {
+				/* 16bit writes */
+				e1->val |= e0->val << 16;
+				drop_ent(s, i--);
+
+			} else if (e0->addr == e1->addr + 1) {
+				/* 8bit writes */
+				e1->val |= e0->val << 8;
+				drop_ent(s, i--);
+
+			} else {
+				/* unordered write */
+				rotate_ent(s, j + 1, i);
 			}
+
+			/* the next write is compared with the one that
+			 * took this one's place */
+			e0 = get_ent(s, i);
 		}
 	}
 
@@ -361,6 +364,14 @@ configure(struct state *s, int argc, char *argv[], char **path,
 			s->filter.map = strtol(argv[++i], NULL, 10);
 			*path = argv[++i];
 
+		} else if (!strcmp(argv[i], "-b")) {
+			if (i + 2 >= argc)
+				goto fail;
+
+			s->op.parse = parse_mmt;
+			s->filter.map = strtol(argv[++i], NULL, 10);
+			*path = argv[++i];
+
 		} else {
 			goto fail;
 		}
@@ -377,14 +388,16 @@ configure(struct state *s, int argc, char *argv[], char **path,
 	return true;
 fail:
 	fprintf(stderr, "usage: %s [ -x ] [ -c ] [ -m 'chipset' ]"
-		" [ -o 'handle' 'class' ] [ -r 'file' ] [ -v 'map' 'file' ]\n"
+		" [ -o 'handle' 'class' ] [ -r 'file' ] [ -v 'map' 'file' ]"
+		" [ -b 'map' 'file' ]\n"
 		"\t-x\tHexadecimal output mode.\n"
 		"\t-c\tClassy output mode.\n"
 		"\t-m\tForce chipset version.\n"
 		"\t-o\tForce handle to class mapping"
 		" (repeat for multiple mappings).\n"
 		"\t-r\tParse a renouveau trace.\n"
-		"\t-v\tParse a valgrind-mmt trace.\n",
+		"\t-v\tParse a valgrind-mmt trace.\n"
+		"\t-b\tParse a binary valgrind-mmt trace.\n",
 		argv[0]);
 	return false;
 }
@@ -414,6 +427,10 @@ main(int argc, char *argv[])
 		}
 	}
 
+	/* the mmt decoder reads from stdin */
+	if (s.op.parse == parse_mmt && f != stdin)
+		dup2(fileno(f), 0);
+
 	/* set up an rnn context */
 	rnn_init();
 	s.db = rnn_newdb();
@@ -35,6 +35,7 @@
 #include <stdint.h>
 #include <string.h>
 #include <stdio.h>
+#include <unistd.h>
 
 #include "rnn.h"
 #include "rnndec.h"
@@ -42,6 +43,7 @@
 #define MAX_DELTA 16384 /* size of the reordering window */
 #define MAX_OUT_OF_BAND 8 /* maximum consecutive out of band data entries */
 #define MAX_CACHE 4096 /* dump cache size */
+#define CACHE_EVICT 64 /* flushed cache entries freed at a time */
 #define MAX_OBJECTS 256 /* object cache size */
 #define MAX_SUBCHAN 8
 
@@ -63,10 +65,27 @@ struct filter {
 	uint32_t addr0, addr1; /* address range we care about */
 };
 
+/* dump cache entries form an implicit treap ordered by dump line number,
+ * and a list in the same order, linked by index into the node pool */
+struct cache_node {
+	struct ent ent;
+	int l, r; /* children, -1 if none */
+	int prev, next; /* neighbours, -1 if none */
+	int size; /* number of nodes in the subtree */
+	uint32_t prio;
+	uint32_t min_addr; /* lowest address in the subtree */
+};
+
 struct cache {
 	int i0, i1; /* cached index range */
-	int k; /* offset the cache starts in */
-	struct ent ent[MAX_CACHE];
+	int dead; /* flushed entries still at the start of the treap */
+	int root;
+	int head, tail; /* first and last entry in the window */
+	int pending; /* first entry not put in the treap yet, -1 if none */
+	int free; /* first free node, linked through l */
+	uint32_t seed;
+	struct cache_node node[MAX_CACHE + CACHE_EVICT];
+	int spine[MAX_CACHE + CACHE_EVICT]; /* scratch space for building */
 };
 
 struct dma {
@@ -124,6 +143,9 @@ get_ent(struct state *s, int i);
 void
 rotate_ent(struct state *s, int i, int j);
 
+int
+find_ent_le(struct state *s, int i, int j, uint32_t addr);
+
 void
 add_ent(struct state *s, struct ent *e);
 
@@ -133,6 +155,9 @@ drop_ent(struct state *s, int i);
 void
 flush_cache(struct state *s);
 
+void
+init_cache(struct state *s);
+
 /* dedma_back.c */
 void
 parse_renouveau_chipset(struct state *s, char *path);
@@ -149,4 +174,7 @@ parse_renouveau(struct state *s);
 bool
 parse_valgrind(struct state *s);
 
+bool
+parse_mmt(struct state *s);
+
 #endif
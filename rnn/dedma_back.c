@@ -23,6 +23,9 @@
  */
 
 #include "dedma.h"
+#include "mmt_bin_decode.h"
+#include "mmt_bin_decode_nvidia.h"
+#include "nvrm_ioctl.h"
 
 void
 parse_renouveau_chipset(struct state *s, char *path)
@@ -175,3 +178,131 @@ parse_valgrind(struct state *s)
 
 	return true;
 }
+
+/* handles a text line of the trace the way parse_valgrind does */
+static void
+mmt_line(struct state *s, const uint8_t *data, unsigned len)
+{
+	uint32_t handle, class;
+	int m;
+
+	if (s->parse.n < len + 2) {
+		s->parse.n = len + 2;
+		s->parse.buf = realloc(s->parse.buf, s->parse.n);
+	}
+	memcpy(s->parse.buf, data, len);
+	s->parse.buf[len] = '\n';
+	s->parse.buf[len + 1] = 0;
+
+	if (sscanf(s->parse.buf, "--%*d-- create gpu object"
+		   " 0x%*x:0x%x type 0x%x", &handle, &class) == 2)
+		add_object(s, handle, class);
+
+	if (sscanf(s->parse.buf, "--%d-- ", &m) < 1)
+		printf("%s", s->parse.buf);
+}
+
+static void
+mmt_msg(uint8_t *data, unsigned int len, void *state)
+{
+	mmt_line(state, data, len);
+}
+
+static void
+mmt_write_syscall(struct mmt_write_syscall *o, void *state)
+{
+	uint8_t *p = o->data.data, *end = p + o->data.len, *nl;
+
+	while (p < end) {
+		nl = memchr(p, '\n', end - p);
+		if (!nl)
+			nl = end;
+		mmt_line(state, p, nl - p);
+		p = nl + 1;
+	}
+}
+
+static void
+mmt_memwrite(struct mmt_write *w, void *state)
+{
+	struct state *s = state;
+	struct ent e = {};
+	uint16_t v16;
+	int i;
+
+	if (w->id != s->filter.map)
+		return;
+
+	if (w->len == 1) {
+		e.addr = w->offset;
+		e.val = w->data[0];
+		add_ent(s, &e);
+
+	} else if (w->len == 2) {
+		memcpy(&v16, w->data, 2);
+		e.addr = w->offset;
+		e.val = v16;
+		add_ent(s, &e);
+
+	} else if (w->len % 4 == 0) {
+		for (i = 0; i < w->len; i += 4) {
+			e.addr = w->offset + i;
+			memcpy(&e.val, &w->data[i], 4);
+			add_ent(s, &e);
+		}
+
+	} else {
+		fprintf(stderr, "Unknown write size: %d\n", w->len);
+	}
+}
+
+static void
+mmt_ioctl(struct state *s, uint32_t id, struct mmt_buf *data)
+{
+	struct nvrm_ioctl_create *c = (void *)data->data;
+	struct nvrm_ioctl_create_simple *cs = (void *)data->data;
+
+	if (id == NVRM_IOCTL_CREATE && data->len >= sizeof(*c))
+		add_object(s, c->handle, c->cls);
+	else if (id == NVRM_IOCTL_CREATE_SIMPLE && data->len >= sizeof(*cs))
+		add_object(s, cs->handle, cs->cls);
+}
+
+static void
+mmt_ioctl_pre(struct mmt_ioctl_pre *ctl, void *state,
+	      struct mmt_memory_dump *args, int argc)
+{
+	mmt_ioctl(state, ctl->id, &ctl->data);
+}
+
+static void
+mmt_ioctl_pre_v2(struct mmt_ioctl_pre_v2 *ctl, void *state,
+		 struct mmt_memory_dump *args, int argc)
+{
+	mmt_ioctl(state, ctl->id, &ctl->data);
+}
+
+static const struct mmt_nvidia_decode_funcs mmt_funcs = {
+	.base = {
+		.memwrite = mmt_memwrite,
+		.msg = mmt_msg,
+		.write_syscall = mmt_write_syscall,
+		.ioctl_pre = mmt_ioctl_pre_v2,
+	},
+	.ioctl_pre = mmt_ioctl_pre,
+};
+
+/* reads a binary mmt trace from stdin, decoding messages until one of them
+ * is a write to the mapping we're after */
+bool
+parse_mmt(struct state *s)
+{
+	int i1 = s->cache.i1;
+
+	while (s->cache.i1 == i1) {
+		if (!mmt_decode_next(&mmt_funcs.base, s))
+			return false;
+	}
+
+	return true;
+}
@@ -23,9 +23,249 @@
  */
 
 #include "dedma.h"
+#include "util.h"
 
-#define CACHE_ENT(s, i)							\
-	(&(s)->cache.ent[((i) - (s)->cache.i0 + (s)->cache.k) % MAX_CACHE])
+/*
+ * The cache is the reordering window: entries from i0 to i1 (excluded), in
+ * dump line order, which the reordering logic moves around. They're kept in
+ * a treap keyed implicitly by position, so finding, moving and dropping an
+ * entry are O(log n) instead of memmoving the entries in between.
+ *
+ * Most writes come in order and never need any of that, so new entries are
+ * only appended to the list, and put in the treap all at once the next time
+ * an entry has to be looked up by position or moved. Entries leaving the
+ * window are flushed right away but only taken out of the treap
+ * CACHE_EVICT at a time.
+ */
+
+#define NODE(c, t) (&(c)->node[t])
+#define POS(c, i) ((i) - (c)->i0 + (c)->dead)
+
+static int
+size(struct cache *c, int t)
+{
+	return t < 0 ? 0 : NODE(c, t)->size;
+}
+
+static void
+update(struct cache *c, int t)
+{
+	struct cache_node *n = NODE(c, t);
+
+	n->size = 1 + size(c, n->l) + size(c, n->r);
+	n->min_addr = n->ent.addr;
+	if (n->l >= 0)
+		n->min_addr = min(n->min_addr, NODE(c, n->l)->min_addr);
+	if (n->r >= 0)
+		n->min_addr = min(n->min_addr, NODE(c, n->r)->min_addr);
+}
+
+/* splits t into its first k entries and the rest */
+static void
+split(struct cache *c, int t, int k, int *a, int *b)
+{
+	struct cache_node *n;
+
+	if (t < 0) {
+		*a = *b = -1;
+		return;
+	}
+
+	n = NODE(c, t);
+	if (size(c, n->l) < k) {
+		split(c, n->r, k - size(c, n->l) - 1, &n->r, b);
+		*a = t;
+	} else {
+		split(c, n->l, k, a, &n->l);
+		*b = t;
+	}
+	update(c, t);
+}
+
+static int
+merge(struct cache *c, int a, int b)
+{
+	if (a < 0)
+		return b;
+	if (b < 0)
+		return a;
+
+	if (NODE(c, a)->prio > NODE(c, b)->prio) {
+		NODE(c, a)->r = merge(c, NODE(c, a)->r, b);
+		update(c, a);
+		return a;
+	} else {
+		NODE(c, b)->l = merge(c, a, NODE(c, b)->l);
+		update(c, b);
+		return b;
+	}
+}
+
+/* node at position k */
+static int
+nth(struct cache *c, int k)
+{
+	int t = c->root;
+
+	while (t >= 0) {
+		int ls = size(c, NODE(c, t)->l);
+
+		if (k < ls) {
+			t = NODE(c, t)->l;
+		} else if (k == ls) {
+			return t;
+		} else {
+			k -= ls + 1;
+			t = NODE(c, t)->r;
+		}
+	}
+	return -1;
+}
+
+/* position of the last node in [lo, hi] of subtree t (whose first node is
+ * at position base) with an address not above addr, -1 if there's none */
+static int
+find_last(struct cache *c, int t, int base, int lo, int hi, uint32_t addr)
+{
+	struct cache_node *n;
+	int k, res;
+
+	if (t < 0 || lo > hi || hi < base || lo >= base + NODE(c, t)->size ||
+	    NODE(c, t)->min_addr > addr)
+		return -1;
+
+	n = NODE(c, t);
+	k = base + size(c, n->l);
+
+	res = find_last(c, n->r, k + 1, lo, hi, addr);
+	if (res >= 0)
+		return res;
+
+	if (k >= lo && k <= hi && n->ent.addr <= addr)
+		return k;
+
+	return find_last(c, n->l, base, lo, hi, addr);
+}
+
+static int
+alloc_node(struct cache *c, struct ent *e)
+{
+	int t = c->free;
+	struct cache_node *n = NODE(c, t);
+
+	c->free = n->l;
+	c->seed = c->seed * 1103515245 + 12345;
+
+	n->ent = *e;
+	n->l = n->r = -1;
+	n->prev = n->next = -1;
+	n->prio = c->seed;
+	update(c, t);
+	return t;
+}
+
+static void
+unlink_node(struct cache *c, int t)
+{
+	struct cache_node *n = NODE(c, t);
+
+	if (n->prev >= 0)
+		NODE(c, n->prev)->next = n->next;
+	else
+		c->head = n->next;
+
+	if (n->next >= 0)
+		NODE(c, n->next)->prev = n->prev;
+	else
+		c->tail = n->prev;
+}
+
+/* links t in before u, or at the end if u is -1 */
+static void
+link_node(struct cache *c, int t, int u)
+{
+	struct cache_node *n = NODE(c, t);
+
+	n->next = u;
+	n->prev = (u >= 0 ? NODE(c, u)->prev : c->tail);
+
+	if (n->prev >= 0)
+		NODE(c, n->prev)->next = t;
+	else
+		c->head = t;
+
+	if (u >= 0)
+		NODE(c, u)->prev = t;
+	else
+		c->tail = t;
+}
+
+static void
+free_node(struct cache *c, int t)
+{
+	NODE(c, t)->l = c->free;
+	c->free = t;
+}
+
+/* puts the pending entries in the treap: they're built into a treap of
+ * their own in one pass, keeping its right spine on a stack, which is then
+ * appended to the main one */
+static void
+sync_cache(struct cache *c)
+{
+	int *spine = c->spine;
+	int d = 0, t, x;
+
+	if (c->pending < 0)
+		return;
+
+	for (x = c->pending; x >= 0; x = NODE(c, x)->next) {
+		t = -1;
+		while (d && NODE(c, spine[d - 1])->prio < NODE(c, x)->prio) {
+			t = spine[--d];
+			update(c, t);
+		}
+
+		NODE(c, x)->l = t;
+		NODE(c, x)->r = -1;
+		if (d)
+			NODE(c, spine[d - 1])->r = x;
+		spine[d++] = x;
+	}
+
+	while (d > 1)
+		update(c, spine[--d]);
+	update(c, spine[0]);
+
+	c->root = merge(c, c->root, spine[0]);
+	c->pending = -1;
+}
+
+static void
+free_tree(struct cache *c, int t)
+{
+	if (t < 0)
+		return;
+
+	free_tree(c, NODE(c, t)->l);
+	free_tree(c, NODE(c, t)->r);
+	free_node(c, t);
+}
+
+void
+init_cache(struct state *s)
+{
+	struct cache *c = &s->cache;
+	int i;
+
+	for (i = 0; i < MAX_CACHE + CACHE_EVICT; i++)
+		c->node[i].l = i + 1 < MAX_CACHE + CACHE_EVICT ? i + 1 : -1;
+
+	c->free = 0;
+	c->dead = 0;
+	c->root = c->head = c->tail = c->pending = -1;
+	c->i0 = c->i1 = 0;
+}
 
 struct ent *
 get_ent(struct state *s, int i)
@@ -38,49 +278,88 @@ get_ent(struct state *s, int i)
 	if (i == c->i1 && !s->op.parse(s))
 		return NULL;
 
-	return CACHE_ENT(s, i);
+	/* the common case, a write just parsed */
+	if (i == c->i1 - 1)
+		return &NODE(c, c->tail)->ent;
+
+	sync_cache(c);
+	return &NODE(c, nth(c, POS(c, i)))->ent;
 }
 
+/* moves entry j to position i, before the entries from i to j - 1 */
 void
 rotate_ent(struct state *s, int i, int j)
 {
-	const int d = sizeof(struct ent);
 	struct cache *c = &s->cache;
-	int ki = CACHE_ENT(s, i) - c->ent;
-	int kj = CACHE_ENT(s, j) - c->ent;
-	struct ent tmp;
+	int a, b, x, y, u;
 
 	assert(j >= i && j >= c->i0 && j < c->i1 &&
 	       i >= c->i0 && i < c->i1);
 
-	memmove(&tmp, c->ent + kj, d);
+	if (i == j)
+		return;
 
-	if (ki >= c->k && kj < c->k) {
-		/* the region wraps around */
-		memmove(c->ent + 1, c->ent, d * kj);
-		memmove(c->ent, c->ent + MAX_CACHE - 1, d);
-		memmove(c->ent + ki + 1, c->ent + ki, d * (MAX_CACHE - ki - 1));
+	sync_cache(c);
+	u = nth(c, POS(c, i));
+	split(c, c->root, POS(c, j), &a, &b);
+	split(c, b, 1, &x, &y);
+	a = merge(c, a, y);
+	split(c, a, POS(c, i), &a, &b);
+	c->root = merge(c, merge(c, a, x), b);
 
-	} else {
-		/* easy case */
-		memmove(c->ent + ki + 1, c->ent + ki, d * (kj - ki));
-	}
+	unlink_node(c, x);
+	link_node(c, x, u);
+}
+
+/* index of the last entry from i to j with an address not above addr,
+ * -1 if there's none */
+int
+find_ent_le(struct state *s, int i, int j, uint32_t addr)
+{
+	struct cache *c = &s->cache;
+	int k;
+
+	sync_cache(c);
+	i = max(i, c->i0);
+	j = min(j, c->i1 - 1);
+	k = find_last(c, c->root, 0, POS(c, i), POS(c, j), addr);
 
-	memmove(c->ent + ki, &tmp, d);
+	return k < 0 ? -1 : k - POS(c, 0);
 }
 
 void
 add_ent(struct state *s, struct ent *e)
 {
 	struct cache *c = &s->cache;
+	int a, b, x;
 
 	if (c->i1 - c->i0 == MAX_CACHE) {
-		s->op.flush(s, CACHE_ENT(s, c->i0));
-		c->k = (c->k + 1) % MAX_CACHE;
+		int t = c->head;
+
+		s->op.flush(s, &NODE(c, t)->ent);
+		unlink_node(c, t);
 		c->i0++;
+
+		if (t == c->pending) {
+			/* never made it to the treap */
+			c->pending = NODE(c, t)->next;
+			free_node(c, t);
+		} else {
+			c->dead++;
+		}
+
+		if (c->dead == CACHE_EVICT) {
+			split(c, c->root, c->dead, &a, &b);
+			free_tree(c, a);
+			c->root = b;
+			c->dead = 0;
+		}
 	}
 
-	*CACHE_ENT(s, c->i1) = *e;
+	x = alloc_node(c, e);
+	link_node(c, x, -1);
+	if (c->pending < 0)
+		c->pending = x;
 	c->i1++;
 }
 
@@ -88,9 +367,14 @@ void
 drop_ent(struct state *s, int i)
 {
 	struct cache *c = &s->cache;
+	int a, b, x, y;
 
-	rotate_ent(s, c->i0, i);
-	c->k = (c->k + 1) % MAX_CACHE;
+	sync_cache(c);
+	split(c, c->root, POS(c, i), &a, &b);
+	split(c, b, 1, &x, &y);
+	unlink_node(c, x);
+	free_node(c, x);
+	c->root = merge(c, a, y);
 	c->i1--;
 }
 
@@ -98,10 +382,10 @@ void
 flush_cache(struct state *s)
 {
 	struct cache *c = &s->cache;
-	int i;
+	int t;
 
-	for (i = c->i0; i < c->i1; i++)
-		s->op.flush(s, CACHE_ENT(s, i));
+	for (t = c->head; t >= 0; t = NODE(c, t)->next)
+		s->op.flush(s, &NODE(c, t)->ent);
 
-	c->i0 = c->i1 = 0;
+	init_cache(s);
 }
@@ -30,14 +30,19 @@
 #include "util.h"
 #include "nvhw/chipset.h"
 #include "seq.h"
+#include "mmiotrace.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <inttypes.h>
 #include <string.h>
 #include <getopt.h>
+#include <pthread.h>
 
 int sleep_disabled = 0;
 
+/* where decoded output goes; a batch buffer when decoding with worker threads */
+static FILE *out;
+
 struct i2c_ctx {
 	int last;
 	int aok;
@@ -58,8 +63,10 @@ struct cctx {
 	uint32_t hwsqnext;
 	uint32_t ctxpos;
 	uint8_t hwsq[0x200];
+	/* open-addressed hash of emulated memory pages, keyed by tag */
 	struct mpage **pages;
-	int pagesnum, pagesmax;
+	uint64_t pagesnum, pagesmask;
+	struct mpage *lastpage;
 	uint64_t bar0, bar0l, bar1, bar1l, bar2, bar2l;
 	struct i2c_ctx i2cb[10];
 	int crx0, crx1;
@@ -82,19 +89,58 @@ struct mpage {
 	uint32_t contents[0x1000/4];
 };
 
+static uint64_t page_slot (struct cctx *ctx, uint64_t tag) {
+	return (tag >> 12) * 0x9e3779b97f4a7c15ull >> 32 & ctx->pagesmask;
+}
+
+static struct mpage *lookup_page (struct cctx *ctx, uint64_t tag) {
+	uint64_t i;
+	if (ctx->lastpage && ctx->lastpage->tag == tag)
+		return ctx->lastpage;
+	if (!ctx->pages)
+		return NULL;
+	for (i = page_slot(ctx, tag); ctx->pages[i]; i = (i + 1) & ctx->pagesmask)
+		if (ctx->pages[i]->tag == tag)
+			return ctx->lastpage = ctx->pages[i];
+	return NULL;
+}
+
+static void insert_page (struct cctx *ctx, struct mpage *pg) {
+	uint64_t i;
+	for (i = page_slot(ctx, pg->tag); ctx->pages[i]; i = (i + 1) & ctx->pagesmask);
+	ctx->pages[i] = pg;
+}
+
+/* returns the word at addr, allocating its page if needed */
 uint32_t *findmem (struct cctx *ctx, uint64_t addr) {
-	int i;
 	uint64_t tag = addr & ~0xfffull;
-	for (i = 0; i < ctx->pagesnum; i++) {
-		if (tag == ctx->pages[i]->tag)
-			return &ctx->pages[i]->contents[(addr&0xfff)/4];
+	struct mpage *pg = lookup_page(ctx, tag);
+	if (!pg) {
+		if (!ctx->pages || (ctx->pagesnum + 1) * 2 > ctx->pagesmask + 1) {
+			struct mpage **old = ctx->pages;
+			uint64_t i, oldsize = old ? ctx->pagesmask + 1 : 0;
+			ctx->pagesmask = oldsize ? oldsize * 2 - 1 : 0xff;
+			ctx->pages = calloc(ctx->pagesmask + 1, sizeof *ctx->pages);
+			for (i = 0; i < oldsize; i++)
+				if (old[i])
+					insert_page(ctx, old[i]);
+			free(old);
+		}
+		pg = calloc (sizeof *pg, 1);
+		pg->tag = tag;
+		insert_page(ctx, pg);
+		ctx->pagesnum++;
+		ctx->lastpage = pg;
 	}
-	struct mpage *pg = calloc (sizeof *pg, 1);
-	pg->tag = tag;
-	ADDARRAY(ctx->pages, pg);
 	return &pg->contents[(addr&0xfff)/4];
 }
 
+/* like findmem, but doesn't allocate pages that were never written */
+uint32_t readmem (struct cctx *ctx, uint64_t addr) {
+	struct mpage *pg = lookup_page(ctx, addr & ~0xfffull);
+	return pg ? pg->contents[(addr&0xfff)/4] : 0;
+}
+
 int i2c_bus_num (uint64_t addr) {
 	switch (addr) {
 		case 0xe138:
@@ -126,9 +172,9 @@ void doi2cr (struct cctx *cc, struct i2c_ctx *ctx, int byte) {
 	if (ctx->pend) {
 		if (ctx->bits == 8) {
 			if (byte & 2)
-				printf ("- ");
+				fprintf(out, "- ");
 			else
-				printf ("+ ");
+				fprintf(out, "+ ");
 			if (!ctx->aok) {
 				ctx->aok = 1;
 				ctx->wr = !(ctx->b&1);
@@ -140,7 +186,7 @@ void doi2cr (struct cctx *cc, struct i2c_ctx *ctx, int byte) {
 			ctx->b |= (byte & 2) >> 1;
 			ctx->bits++;
 			if (ctx->bits == 8) {
-				printf ("<%02x", ctx->b);
+				fprintf(out, "<%02x", ctx->b);
 			}
 		}
 		ctx->pend = 0;
@@ -155,7 +201,7 @@ void doi2cw (struct cctx *cc, struct i2c_ctx *ctx, int byte) {
 	}
 	if ((byte & 1) && !(ctx->last & 1)) {
 		if (ctx->pend) {
-			printf ("\nI2C LOST!\n");
+			fprintf(out, "\nI2C LOST!\n");
 			doi2cr(cc, ctx, 0);
 			ctx->pend = 0;
 		}
@@ -165,9 +211,9 @@ void doi2cw (struct cctx *cc, struct i2c_ctx *ctx, int byte) {
 				ctx->pend = 1;
 			} else {
 				if (byte & 2)
-					printf ("- ");
+					fprintf(out, "- ");
 				else
-					printf ("+ ");
+					fprintf(out, "+ ");
 				ctx->bits = 0;
 				ctx->b = 0;
 			}
@@ -177,7 +223,7 @@ void doi2cw (struct cctx *cc, struct i2c_ctx *ctx, int byte) {
 				ctx->b |= (byte & 2) >> 1;
 				ctx->bits++;
 				if (ctx->bits == 8) {
-					printf (">%02x", ctx->b);
+					fprintf(out, ">%02x", ctx->b);
 				}
 			} else {
 				ctx->pend = 1;
@@ -186,7 +232,7 @@ void doi2cw (struct cctx *cc, struct i2c_ctx *ctx, int byte) {
 	}
 	if ((byte & 1) && !(byte & 2) && (ctx->last & 2)) {
 		/* data went low with high clock - start bit */
-		printf ("START ");
+		fprintf(out, "START ");
 		ctx->bits = 0;
 		ctx->b = 0;
 		ctx->aok = 0;
@@ -196,7 +242,7 @@ void doi2cw (struct cctx *cc, struct i2c_ctx *ctx, int byte) {
 	}
 	if ((byte & 1) && (byte & 2) && !(ctx->last & 2)) {
 		/* data went high with high clock - stop bit */
-		printf ("STOP\n");
+		fprintf(out, "STOP\n");
 		cc->i2cip = -1;
 		ctx->bits = 0;
 		ctx->b = 0;
@@ -208,25 +254,477 @@ void doi2cw (struct cctx *cc, struct i2c_ctx *ctx, int byte) {
 	ctx->last = byte;
 }
 
+static struct rnndomain *mmiodom, *crdom;
+static char *variant = NULL;
+static unsigned long chip = 0;
+static const struct disisa *ctx_isa, *hwsq_isa;
+static struct varinfo *ctx_var_nv40, *ctx_var_g80;
+static struct varinfo *hwsq_var_nv17, *hwsq_var_nv41, *hwsq_var_g80;
+static const struct envy_colors *colors;
+static double timestamp;
+
+/* decodes a plain register access with rnndb - the bulk of demmio's work */
+static void print_mmio (FILE *out, struct rnndeccontext *ctx, int cci, double timestamp, int width, char op, uint64_t addr, uint64_t value) {
+	struct rnndecaddrinfo *ai = rnndec_decodeaddr(ctx, mmiodom, addr, op == 'W');
+	if (width == 32 && ai->width == 8) {
+		/* 32-bit write to 8-bit location - split it up */
+		int b;
+		rnndec_free_decaddrinfo(ai);
+		int cnt;
+		for (b = 0; b < 4; b++) {
+			struct rnndecaddrinfo *ai = rnndec_decodeaddr(ctx, mmiodom, addr+b, op == 'W');
+			char *decoded_val = rnndec_decodeval(ctx, ai->typeinfo, value >> b * 8 & 0xff, ai->width);
+			if (b == 0) {
+				fprintf(out, "[%d] %lf MMIO%d %c 0x%06"PRIx64" 0x%08"PRIx64" %n%s %s %s\n", cci, timestamp, width, op, addr, value, &cnt, ai->name, op=='W'?"<=":"=>", decoded_val);
+			} else {
+				int c;
+				for (c = 0; c < cnt; c++)
+					fprintf(out, " ");
+				fprintf(out, "%s %s %s\n", ai->name, op=='W'?"<=":"=>", decoded_val);
+			}
+			rnndec_free_decaddrinfo(ai);
+			free(decoded_val);
+		}
+	} else {
+		char *decoded_val = rnndec_decodeval(ctx, ai->typeinfo, value, ai->width);
+		fprintf(out, "[%d] %lf MMIO%d %c 0x%06"PRIx64" 0x%08"PRIx64" %s %s %s\n", cci, timestamp, width, op, addr, value, ai->name, op=='W'?"<=":"=>", decoded_val);
+		free(ai->name);
+		free(ai);
+		free(decoded_val);
+	}
+}
+
+/*
+ * With -j, plain register accesses are decoded by a pool of worker threads.
+ * The main thread parses the trace and runs all the stateful tracking in
+ * order, writing its own output into a batch buffer and queueing a job for
+ * each plain access, remembering where in the buffer its output belongs.
+ * Full batches are handed to the workers, each taking a contiguous share of
+ * the jobs, and written out in order with the job outputs stitched in.
+ */
+
+#define BATCH_JOBS 4096
+#define MAX_BATCHES 8
+
+struct mmio_job {
+	struct rnndeccontext *ctx;
+	int cci;
+	double timestamp;
+	int width;
+	char op;
+	uint64_t addr, value;
+	/* position in the batch text */
+	size_t pos;
+	/* output of the job in its worker's buffer */
+	int worker;
+	size_t start, end;
+};
+
+struct batch {
+	char *text;
+	size_t textlen;
+	struct mmio_job *jobs;
+	int jobsnum, jobsmax;
+	char **wbuf;
+	size_t *wlen;
+	int pending;
+};
+
+static int nthreads = 1;
+static pthread_t *workers;
+static pthread_mutex_t batch_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t batch_submitted = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t batch_done = PTHREAD_COND_INITIALIZER;
+static struct batch batches[MAX_BATCHES];
+/* sequence numbers of batches: written < submitted <= current */
+static uint64_t batches_written, batches_submitted;
+static int workers_quit;
+
+static void *mmio_worker (void *arg) {
+	int w = (intptr_t)arg;
+	uint64_t seq;
+	for (seq = 0; ; seq++) {
+		struct batch *b = &batches[seq % MAX_BATCHES];
+		int i, lo, hi;
+		FILE *f;
+		int quit;
+		pthread_mutex_lock(&batch_lock);
+		while (seq >= batches_submitted && !workers_quit)
+			pthread_cond_wait(&batch_submitted, &batch_lock);
+		quit = seq >= batches_submitted;
+		pthread_mutex_unlock(&batch_lock);
+		if (quit)
+			return NULL;
+		lo = (int64_t)b->jobsnum * w / nthreads;
+		hi = (int64_t)b->jobsnum * (w + 1) / nthreads;
+		f = open_memstream(&b->wbuf[w], &b->wlen[w]);
+		for (i = lo; i < hi; i++) {
+			struct mmio_job *job = &b->jobs[i];
+			job->worker = w;
+			job->start = ftell(f);
+			print_mmio(f, job->ctx, job->cci, job->timestamp, job->width, job->op, job->addr, job->value);
+			job->end = ftell(f);
+		}
+		fclose(f);
+		pthread_mutex_lock(&batch_lock);
+		if (!--b->pending)
+			pthread_cond_signal(&batch_done);
+		pthread_mutex_unlock(&batch_lock);
+	}
+}
+
+static void start_batch (void) {
+	struct batch *b = &batches[batches_submitted % MAX_BATCHES];
+	b->jobsnum = 0;
+	out = open_memstream(&b->text, &b->textlen);
+}
+
+static void write_batch (void) {
+	struct batch *b = &batches[batches_written % MAX_BATCHES];
+	size_t pos = 0;
+	int i;
+	pthread_mutex_lock(&batch_lock);
+	while (b->pending)
+		pthread_cond_wait(&batch_done, &batch_lock);
+	pthread_mutex_unlock(&batch_lock);
+	for (i = 0; i < b->jobsnum; i++) {
+		struct mmio_job *job = &b->jobs[i];
+		fwrite(b->text + pos, 1, job->pos - pos, stdout);
+		fwrite(b->wbuf[job->worker] + job->start, 1, job->end - job->start, stdout);
+		pos = job->pos;
+	}
+	fwrite(b->text + pos, 1, b->textlen - pos, stdout);
+	free(b->text);
+	for (i = 0; i < nthreads; i++) {
+		free(b->wbuf[i]);
+		b->wbuf[i] = NULL;
+	}
+	batches_written++;
+}
+
+static void submit_batch (void) {
+	struct batch *b = &batches[batches_submitted % MAX_BATCHES];
+	fclose(out);
+	b->pending = nthreads;
+	pthread_mutex_lock(&batch_lock);
+	batches_submitted++;
+	pthread_cond_broadcast(&batch_submitted);
+	pthread_mutex_unlock(&batch_lock);
+	if (batches_submitted - batches_written == MAX_BATCHES)
+		write_batch();
+	start_batch();
+}
+
+static void queue_mmio (struct rnndeccontext *ctx, int cci, int width, char op, uint64_t addr, uint64_t value) {
+	struct batch *b = &batches[batches_submitted % MAX_BATCHES];
+	struct mmio_job job = { ctx, cci, timestamp, width, op, addr, value, ftell(out) };
+	ADDARRAY(b->jobs, job);
+	if (b->jobsnum == BATCH_JOBS)
+		submit_batch();
+}
+
+/* writes out everything queued so far, needed before a context changes */
+static void sync_batches (void) {
+	if (nthreads <= 1)
+		return;
+	submit_batch();
+	while (batches_written < batches_submitted)
+		write_batch();
+}
+
+static void start_workers (void) {
+	int i;
+	workers = calloc(nthreads, sizeof *workers);
+	for (i = 0; i < MAX_BATCHES; i++) {
+		batches[i].wbuf = calloc(nthreads, sizeof *batches[i].wbuf);
+		batches[i].wlen = calloc(nthreads, sizeof *batches[i].wlen);
+	}
+	for (i = 0; i < nthreads; i++)
+		pthread_create(&workers[i], NULL, mmio_worker, (void *)(intptr_t)i);
+	start_batch();
+}
+
+static void stop_workers (void) {
+	int i;
+	sync_batches();
+	fclose(out);
+	free(batches[batches_submitted % MAX_BATCHES].text);
+	pthread_mutex_lock(&batch_lock);
+	workers_quit = 1;
+	pthread_cond_broadcast(&batch_submitted);
+	pthread_mutex_unlock(&batch_lock);
+	for (i = 0; i < nthreads; i++)
+		pthread_join(workers[i], NULL);
+	free(workers);
+}
+
+typedef void (*bar_handler)(int cci, uint64_t addr, uint64_t value, int width, char op);
+
+static void handle_bar0 (int cci, uint64_t addr, uint64_t value, int width, char op) {
+	struct cctx *cc = &cctx[cci];
+	int skip = 0;
+	if (cc->hwsqip && addr != cc->hwsqnext) {
+		struct varinfo *var = hwsq_var_nv17;
+		if (cc->chipset.chipset >= 0x41)
+			var = hwsq_var_nv41;
+		if (cc->chipset.card_type == 0x50)
+			var = hwsq_var_g80;
+		envydis(hwsq_isa, out, cc->hwsq, 0, cc->hwsqnext & 0x3fc, var, 0, 0, 0, colors);
+		cc->hwsqip = 0;
+	}
+	/* Seq */
+	if (cc->seq.action == SEQ_SKIP && addr != 0x10a1c4) {
+		cc->seq.action = SEQ_NONE;
+	} else if (cc->seq.action == SEQ_PRINT && addr != 0x10a1c4) {
+		seq_print(out, cc->seq.script, cc->seq.len, cc->ctx, mmiodom);
+		cc->seq.len = 0;
+		cc->seq.action = SEQ_NONE;
+	}
+
+	if (!cc->chipset.chipset) {
+		/* unless the user specified it when the card was found */
+		if (!variant && !chip && addr == 0) {
+			parse_pmc_id(value, &cc->chipset);
+			if (cc->chipset.chipset) {
+				/* queued accesses were decoded without it */
+				sync_batches();
+				rnndec_varaddvalue(cc->ctx, "chipset",
+						   cc->chipset.chipset);
+			}
+		}
+	} else if (cc->chipset.card_type >= 0x50 && addr == 0x1700) {
+		cc->praminbase = value << 16;
+	} else if (cc->chipset.card_type == 0x50 && addr == 0x1704) {
+		cc->fakechan = (value & 0xfffffff) << 12;
+	} else if (cc->chipset.card_type == 0x50 && addr == 0x170c) {
+		cc->ramins = (value & 0xffff) << 4;
+	} else if (cc->chipset.card_type >= 0xc0 && addr == 0x1714) {
+		cc->ramins = (value & 0xfffffff) << 12;
+	} else if (addr == 0x6013d4) {
+		cc->crx0 = value & 0xff;
+	} else if (addr == 0x6033d4) {
+		cc->crx1 = value & 0xff;
+	} else if (addr == 0x6013d5) {
+		struct rnndecaddrinfo *ai = rnndec_decodeaddr(cc->ctx, crdom, cc->crx0, op == 'W');
+		char *decoded_val = rnndec_decodeval(cc->ctx, ai->typeinfo, value, ai->width);
+		fprintf(out, "[%d] %lf HEAD0 %c     0x%02x       0x%02"PRIx64" %s %s %s\n", cci, timestamp, op, cc->crx0, value, ai->name, op=='W'?"<=":"=>", decoded_val);
+		rnndec_free_decaddrinfo(ai);
+		free(decoded_val);
+		skip = 1;
+	} else if (addr == 0x6033d5) {
+		struct rnndecaddrinfo *ai = rnndec_decodeaddr(cc->ctx, crdom, cc->crx1, op == 'W');
+		char *decoded_val = rnndec_decodeval(cc->ctx, ai->typeinfo, value, ai->width);
+		fprintf(out, "[%d] %lf HEAD1 %c     0x%02x       0x%02"PRIx64" %s %s %s\n", cci, timestamp, op, cc->crx1, value, ai->name, op=='W'?"<=":"=>", decoded_val);
+		rnndec_free_decaddrinfo(ai);
+		free(decoded_val);
+		skip = 1;
+	} else if (cc->chipset.card_type >= 0x50 && (addr & 0xfff000) == 0xe000) {
+		int bus = i2c_bus_num(addr);
+		if (bus != -1) {
+			if (cc->i2cip != bus) {
+				if (cc->i2cip != -1)
+					fprintf(out, "\n");
+				struct rnndecaddrinfo *ai = rnndec_decodeaddr(cc->ctx, mmiodom, addr, op == 'W');
+				fprintf(out, "[%d] I2C      0x%06"PRIx64"            %s ", cci, addr, ai->name);
+				rnndec_free_decaddrinfo(ai);
+				cc->i2cip = bus;
+			}
+			if (op == 'R') {
+				doi2cr(cc, &cc->i2cb[bus], value);
+			} else {
+				doi2cw(cc, &cc->i2cb[bus], value);
+			}
+			skip = 1;
+		}
+	} else if ((addr & 0xfff000) == 0x9000 && (cc->i2cip != -1)) {
+		/* ignore PTIMER meddling during I2C */
+		skip = 1;
+	} else if (addr == 0x1400 || addr == 0x80000 || (addr == cc->hwsqnext && cc->hwsqip)) {
+		if (!cc->hwsqip) {
+			struct rnndecaddrinfo *ai = rnndec_decodeaddr(cc->ctx, mmiodom, addr, op == 'W');
+			fprintf(out, "[%d] HWSQ     0x%06"PRIx64"            %s\n", cci, addr, ai->name);
+			rnndec_free_decaddrinfo(ai);
+		}
+		cc->hwsq[(addr & 0x1fc) + 0] = value;
+		cc->hwsq[(addr & 0x1fc) + 1] = value >> 8;
+		cc->hwsq[(addr & 0x1fc) + 2] = value >> 16;
+		cc->hwsq[(addr & 0x1fc) + 3] = value >> 24;
+		cc->hwsqip = 1;
+		cc->hwsqnext = addr + 4;
+		skip = 1;
+	} else if (addr == 0x10a1c4) {
+		if (cc->seq.action == SEQ_NONE) {
+			/* Crude test whether this vaguely looks like an opcode..
+			 * print will do a more thorough check */
+			if ((value & 0xfc00ffc0) == 0 && value != 0) {
+				cc->seq.action = SEQ_PRINT;
+			} else {
+				cc->seq.action = SEQ_SKIP;
+			}
+		}
+
+		if(cc->seq.action == SEQ_PRINT) {
+			if (cc->seq.len < 2048) {
+				cc->seq.script[cc->seq.len] = value;
+				cc->seq.len++;
+			} else {
+				fprintf(out, "[%d] PDAEMON  %06"PRIx64" Script too long, skipping\n", cci, addr);
+				cc->seq.len = 0;
+				cc->seq.action = SEQ_SKIP;
+			}
+		}
+	} else if (addr == 0x400324 && cc->chipset.card_type >= 0x40 && cc->chipset.card_type <= 0x50) {
+		cc->ctxpos = value;
+	} else if (addr == 0x400328 && cc->chipset.card_type >= 0x40 && cc->chipset.card_type <= 0x50) {
+		uint8_t param[4];
+		param[0] = value;
+		param[1] = value >> 8;
+		param[2] = value >> 16;
+		param[3] = value >> 24;
+		struct rnndecaddrinfo *ai = rnndec_decodeaddr(cc->ctx, mmiodom, addr, op == 'W');
+		fprintf(out, "[%d] MMIO%d %c 0x%06"PRIx64" 0x%08"PRIx64" %s %s ", cci, width, op, addr, value, ai->name, op=='W'?"<=":"=>");
+		envydis(ctx_isa, out, param, cc->ctxpos, 1, (cc->chipset.card_type == 0x50 ? ctx_var_g80 : ctx_var_nv40), 0, 0, 0, colors);
+		cc->ctxpos++;
+		rnndec_free_decaddrinfo(ai);
+		skip = 1;
+	}
+	if (!skip && (cc->i2cip != -1)) {
+		fprintf(out, "\n");
+		cc->i2cip = -1;
+	}
+	if (cc->chipset.card_type >= 0x50 && addr >= 0x700000 && addr < 0x800000) {
+		addr -= 0x700000;
+		addr += cc->praminbase;
+		fprintf(out, "[%d] %lf, MEM%d %"PRIx64" %s %"PRIx64"\n", cci, timestamp, width, addr, op=='W'?"<=":"=>", value);
+		*findmem(cc, addr) = value;
+	} else if (!skip) {
+		if (nthreads > 1)
+			queue_mmio(cc->ctx, cci, width, op, addr, value);
+		else
+			print_mmio(out, cc->ctx, cci, timestamp, width, op, addr, value);
+	}
+}
+
+static void handle_bar1 (int cci, uint64_t addr, uint64_t value, int width, char op) {
+	fprintf(out, "[%d] %lf, FB%d %"PRIx64" %s %"PRIx64"\n", cci, timestamp, width, addr, op=='W'?"<=":"=>", value);
+}
+
+static void handle_bar2 (int cci, uint64_t addr, uint64_t value, int width, char op) {
+	struct cctx *cc = &cctx[cci];
+	if (cc->chipset.card_type >= 0xc0) {
+		uint64_t pd = readmem(cc, cc->ramins + 0x200);
+		uint64_t pt = readmem(cc, pd + 4);
+		pt &= 0xfffffff0;
+		pt <<= 8;
+		uint64_t pg = readmem(cc, pt + (addr/0x1000) * 8);
+		pg &= 0xfffffff0;
+		pg <<= 8;
+		pg += (addr&0xfff);
+		*findmem(cc, pg) = value;
+//		fprintf(out, "%"PRIx64" %"PRIx64" %"PRIx64" %"PRIx64"\n", ramins, pd, pt, pg);
+		fprintf(out, "[%d] %lf RAMIN%d %"PRIx64" %"PRIx64" %s %"PRIx64"\n", cci, timestamp, width, addr, pg, op=='W'?"<=":"=>", value);
+	} else if (cc->chipset.card_type == 0x50) {
+		uint64_t paddr = addr;
+		paddr += readmem(cc, cc->fakechan + cc->ramins + 8);
+		paddr += (uint64_t)(readmem(cc, cc->fakechan + cc->ramins + 12) >> 24) << 32;
+		uint64_t pt = readmem(cc, cc->fakechan + (cc->chipset.chipset == 0x50 ? 0x1400 : 0x200) + ((paddr >> 29) << 3));
+//		fprintf(out, "%#"PRIx64" PT: %#"PRIx64" %#"PRIx64" ", paddr, fakechan + 0x200 + ((paddr >> 29) << 3), pt);
+		uint32_t div = (pt & 2 ? 0x1000 : 0x10000);
+		pt &= 0xfffff000;
+		uint64_t pg = readmem(cc, pt + ((paddr&0x1ffff000)/div) * 8);
+		uint64_t pgh = readmem(cc, pt + ((paddr&0x1ffff000)/div) * 8 + 4);
+//		fprintf(out, "PG: %#"PRIx64" %#"PRIx64"\n", pt + ((paddr&0x1ffff000)/div) * 8, pgh << 32 | pg);
+		pg &= 0xfffff000;
+		pg |= (pgh & 0xff) << 32;
+		pg += (paddr & (div-1));
+		*findmem(cc, pg) = value;
+//		fprintf(out, "%"PRIx64" %"PRIx64" %"PRIx64" %"PRIx64"\n", ramins, pd, pt, pg);
+		fprintf(out, "[%d] %lf RAMIN%d %"PRIx64" %"PRIx64" %s %"PRIx64"\n", cci, timestamp, width, addr, pg, op=='W'?"<=":"=>", value);
+	} else {
+		fprintf(out, "[%d] %lf RAMIN%d %"PRIx64" %s %"PRIx64"\n", cci, timestamp, width, addr, op=='W'?"<=":"=>", value);
+	}
+}
+
+/* BARs of all cards, sorted by start address */
+struct bar_range {
+	uint64_t start, end;
+	/* largest end of this and all ranges before it */
+	uint64_t maxend;
+	int cci;
+	/* which range wins when they overlap: lowest cci, then BAR number */
+	int order;
+	bar_handler handler;
+};
+
+static struct bar_range *bar_ranges;
+static int bar_rangesnum, bar_rangesmax;
+
+static int bar_range_cmp (const void *a, const void *b) {
+	const struct bar_range *ra = a, *rb = b;
+	if (ra->start != rb->start)
+		return ra->start < rb->start ? -1 : 1;
+	return ra->order - rb->order;
+}
+
+static void add_bar_range (int cci, int bar, uint64_t start, uint64_t len, bar_handler handler) {
+	struct bar_range r = { start, start + len, 0, cci, cci * 3 + bar, handler };
+	if (!start || !len)
+		return;
+	ADDARRAY(bar_ranges, r);
+}
+
+static void add_bar_ranges (int cci) {
+	struct cctx *cc = &cctx[cci];
+	uint64_t maxend = 0;
+	int i;
+	add_bar_range(cci, 0, cc->bar0, cc->bar0l, handle_bar0);
+	add_bar_range(cci, 1, cc->bar1, cc->bar1l, handle_bar1);
+	add_bar_range(cci, 2, cc->bar2, cc->bar2l, handle_bar2);
+	qsort(bar_ranges, bar_rangesnum, sizeof *bar_ranges, bar_range_cmp);
+	for (i = 0; i < bar_rangesnum; i++) {
+		if (bar_ranges[i].end > maxend)
+			maxend = bar_ranges[i].end;
+		bar_ranges[i].maxend = maxend;
+	}
+}
+
+static struct bar_range *find_bar_range (uint64_t addr) {
+	struct bar_range *res = NULL;
+	int lo = 0, hi = bar_rangesnum, i;
+	/* find the last range starting at or below addr */
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (bar_ranges[mid].start <= addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	/* of the ranges containing addr, the first card and BAR, like a plain scan would */
+	for (i = lo - 1; i >= 0 && bar_ranges[i].maxend > addr; i--)
+		if (addr < bar_ranges[i].end && (!res || bar_ranges[i].order < res->order))
+			res = &bar_ranges[i];
+	return res;
+}
+
 static void print_help() {
 	fprintf(stderr,
-		"Usage: demmio [-a <NVXXX>|-c|-f <file>|-h]\n"
+		"Usage: demmio [-a <NVXXX>|-c|-f <file>|-j <threads>|-h]\n"
 		"\n"
-		"Decodes MMIO traces using rnndb\n"
+		"Decodes MMIO traces using rnndb. Both text mmiotraces and ones converted\n"
+		"by mmiotrace2bin are accepted.\n"
 		"\n"
 		"Options:\n"
 		"\t-a <gen>  Specify the chipset variant to use (autodetected by default)\n"
 		"\t-c        Disable colors\n"
 		"\t-f <file> Specify the file to read from (defaults to stdin)\n"
+		"\t-j <num>  Decode register accesses with <num> worker threads\n"
 		"\t-h        Show this help message\n");
 }
 
 int main(int argc, char **argv) {
 	char *file = NULL;
-	char *variant = NULL;
-	unsigned long chip = 0;
 	int c,use_colors=1;
-	while ((c = getopt (argc, argv, "f:ca:h")) != -1) {
+	while ((c = getopt (argc, argv, "f:ca:j:h")) != -1) {
 		switch (c) {
 			case 'a':
 				chip = strtoull(optarg, NULL, 16);
@@ -245,6 +743,12 @@ int main(int argc, char **argv) {
 				use_colors = 0;
 				break;
 			}
+			case 'j':{
+				nthreads = strtol(optarg, NULL, 0);
+				if (nthreads < 1)
+					nthreads = 1;
+				break;
+			}
 			case 'h':{
 				print_help();
 				return 0;
@@ -259,37 +763,38 @@ int main(int argc, char **argv) {
 	struct rnndb *db = rnn_newdb();
 	rnn_parsefile (db, "nv_mmio.xml");
 	rnn_prepdb (db);
-	struct rnndomain *mmiodom = rnn_finddomain(db, "NV_MMIO");
-	struct rnndomain *crdom = rnn_finddomain(db, "NV_CR");
+	mmiodom = rnn_finddomain(db, "NV_MMIO");
+	crdom = rnn_finddomain(db, "NV_CR");
 	FILE *fin = (file==NULL) ? stdin : open_input(file);
 	if (!fin) {
 		fprintf (stderr, "Failed to open input file!\n");
 		return 1;
 	}
 
-	char line[1024];
+	struct mmiotrace_reader *reader = mmiotrace_reader_new(fin);
+	struct mmiotrace_rec rec;
 	int i;
-	const struct disisa *ctx_isa = ed_getisa("ctx");
-	struct varinfo *ctx_var_nv40 = varinfo_new(ctx_isa->vardata);
-	struct varinfo *ctx_var_g80 = varinfo_new(ctx_isa->vardata);
+	ctx_isa = ed_getisa("ctx");
+	ctx_var_nv40 = varinfo_new(ctx_isa->vardata);
+	ctx_var_g80 = varinfo_new(ctx_isa->vardata);
 	varinfo_set_variant(ctx_var_nv40, "nv40");
 	varinfo_set_variant(ctx_var_g80, "g80");
-	const struct disisa *hwsq_isa = ed_getisa("hwsq");
-	struct varinfo *hwsq_var_nv17 = varinfo_new(hwsq_isa->vardata);
-	struct varinfo *hwsq_var_nv41 = varinfo_new(hwsq_isa->vardata);
-	struct varinfo *hwsq_var_g80 = varinfo_new(hwsq_isa->vardata);
+	hwsq_isa = ed_getisa("hwsq");
+	hwsq_var_nv17 = varinfo_new(hwsq_isa->vardata);
+	hwsq_var_nv41 = varinfo_new(hwsq_isa->vardata);
+	hwsq_var_g80 = varinfo_new(hwsq_isa->vardata);
 	varinfo_set_variant(hwsq_var_nv17, "nv17");
 	varinfo_set_variant(hwsq_var_nv41, "nv41");
 	varinfo_set_variant(hwsq_var_g80, "g80");
-	const struct envy_colors *colors = use_colors ? &envy_def_colors : &envy_null_colors;
-	while (1) {
-		/* yes, static buffer. but mmiotrace lines are bound to have sane length anyway. */
-		if (!fgets(line, sizeof(line), fin))
-			break;
-		if (!strncmp(line, "PCIDEV ", 7)) {
-			uint64_t bar[4], len[4], pciid;
-			sscanf (line, "%*s %*s %"SCNx64" %*s %"SCNx64" %"SCNx64" %"SCNx64" %"SCNx64" %*s %*s %*s %"SCNx64" %"SCNx64" %"SCNx64" %"SCNx64"", &pciid, &bar[0], &bar[1], &bar[2], &bar[3], &len[0], &len[1], &len[2], &len[3]);
-			if ((pciid >> 16) == 0x10de && bar[0] && (bar[0] & 0xf) == 0 && bar[1] && (bar[1] & 0x1) == 0x0) {
+	colors = use_colors ? &envy_def_colors : &envy_null_colors;
+	if (nthreads > 1)
+		start_workers();
+	else
+		out = stdout;
+	while (mmiotrace_next(reader, &rec)) {
+		if (rec.type == MMIOTRACE_PCIDEV) {
+			uint64_t *bar = rec.bar, *len = rec.barlen;
+			if ((rec.pciid >> 16) == 0x10de && bar[0] && (bar[0] & 0xf) == 0 && bar[1] && (bar[1] & 0x1) == 0x0) {
 				struct cctx nc = { 0 };
 				nc.bar0 = bar[0], nc.bar0l = len[0];
 				nc.bar1 = bar[1], nc.bar1l = len[1];
@@ -303,237 +808,44 @@ int main(int argc, char **argv) {
 				nc.i2cip = -1;
 				nc.ctx = rnndec_newcontext(db);
 				nc.ctx->colors = colors;
+				/* The user may have manually specified this */
+				if (variant)
+					rnndec_varadd(nc.ctx, "chipset", variant);
+				else if (chip)
+					rnndec_varaddvalue(nc.ctx, "chipset", chip);
 				for (i = 0; i < 10; i++)
 					nc.i2cb[i].last = 7;
 				ADDARRAY(cctx, nc);
+				add_bar_ranges(cctxnum - 1);
 			}
-			printf ("%s", line);
-		} else if (!strncmp(line, "W ", 2) || !strncmp(line, "R ", 2)) {
-			int skip = 0;
-			static double timestamp, timestamp_old = 0;
-			uint64_t addr, value;
-			int width;
-			int cci;
-			sscanf (line, "%*s %d %lf %*d %"SCNx64" %"SCNx64, &width, &timestamp, &addr, &value);
-			width *= 8;
+			fwrite(rec.line, 1, rec.len, out);
+		} else if (rec.type == MMIOTRACE_WRITE || rec.type == MMIOTRACE_READ) {
+			static double timestamp_old = 0;
+			uint64_t addr = rec.addr, value = rec.value;
+			int width = rec.width * 8;
+			char op = rec.type == MMIOTRACE_WRITE ? 'W' : 'R';
+			/*
+			 * seconds, like strtod on the decimal text gives - but not
+			 * always to the last bit, the two round differently
+			 */
+			timestamp = rec.ts / 1e9;
 
 			/* Add a SLEEP line when two mmio accesses are more distant than 100µs */
 			if (!sleep_disabled && timestamp_old > 0 && (timestamp - timestamp_old) > 0.0001)
-				printf("SLEEP %lfms\n", (timestamp - timestamp_old)*1000.0);
+				fprintf(out, "SLEEP %lfms\n", (timestamp - timestamp_old)*1000.0);
 			timestamp_old = timestamp;
 
-			for (cci = 0; cci < cctxnum; cci++) {
-				struct cctx *cc = &cctx[cci];
-				if (cc->bar0 && addr >= cc->bar0 && addr < cc->bar0+cc->bar0l) {
-					addr -= cc->bar0;
-					if (cc->hwsqip && addr != cc->hwsqnext) {
-						struct varinfo *var = hwsq_var_nv17;
-						if (cc->chipset.chipset >= 0x41)
-							var = hwsq_var_nv41;
-						if (cc->chipset.card_type == 0x50)
-							var = hwsq_var_g80;
-						envydis(hwsq_isa, stdout, cc->hwsq, 0, cc->hwsqnext & 0x3fc, var, 0, 0, 0, colors);
-						cc->hwsqip = 0;
-					}
-					/* Seq */
-					if (cc->seq.action == SEQ_SKIP && addr != 0x10a1c4) {
-						cc->seq.action = SEQ_NONE;
-					} else if (cc->seq.action == SEQ_PRINT && addr != 0x10a1c4) {
-						seq_print(cc->seq.script, cc->seq.len, cc->ctx, mmiodom);
-						cc->seq.len = 0;
-						cc->seq.action = SEQ_NONE;
-					}
-
-					if (!cc->chipset.chipset) {
-						/* The user may have manually specified this */
-						if (variant) {
-							rnndec_varadd(cc->ctx, "chipset", variant);
-						} else if (chip) {
-							rnndec_varaddvalue(cc->ctx, "chipset", chip);
-						} else if (addr == 0) {
-							parse_pmc_id(value, &cc->chipset);
-							if (cc->chipset.chipset)
-								rnndec_varaddvalue(cc->ctx, "chipset",
-										   cc->chipset.chipset);
-						}
-					} else if (cc->chipset.card_type >= 0x50 && addr == 0x1700) {
-						cc->praminbase = value << 16;
-					} else if (cc->chipset.card_type == 0x50 && addr == 0x1704) {
-						cc->fakechan = (value & 0xfffffff) << 12;
-					} else if (cc->chipset.card_type == 0x50 && addr == 0x170c) {
-						cc->ramins = (value & 0xffff) << 4;
-					} else if (cc->chipset.card_type >= 0xc0 && addr == 0x1714) {
-						cc->ramins = (value & 0xfffffff) << 12;
-					} else if (addr == 0x6013d4) {
-						cc->crx0 = value & 0xff;
-					} else if (addr == 0x6033d4) {
-						cc->crx1 = value & 0xff;
-					} else if (addr == 0x6013d5) {
-						struct rnndecaddrinfo *ai = rnndec_decodeaddr(cc->ctx, crdom, cc->crx0, line[0] == 'W');
-						char *decoded_val = rnndec_decodeval(cc->ctx, ai->typeinfo, value, ai->width);
-						printf ("[%d] %lf HEAD0 %c     0x%02x       0x%02"PRIx64" %s %s %s\n", cci, timestamp, line[0], cc->crx0, value, ai->name, line[0]=='W'?"<=":"=>", decoded_val);
-						rnndec_free_decaddrinfo(ai);
-						free(decoded_val);
-						skip = 1;
-					} else if (addr == 0x6033d5) {
-						struct rnndecaddrinfo *ai = rnndec_decodeaddr(cc->ctx, crdom, cc->crx1, line[0] == 'W');
-						char *decoded_val = rnndec_decodeval(cc->ctx, ai->typeinfo, value, ai->width);
-						printf ("[%d] %lf HEAD1 %c     0x%02x       0x%02"PRIx64" %s %s %s\n", cci, timestamp, line[0], cc->crx1, value, ai->name, line[0]=='W'?"<=":"=>", decoded_val);
-						rnndec_free_decaddrinfo(ai);
-						free(decoded_val);
-						skip = 1;
-					} else if (cc->chipset.card_type >= 0x50 && (addr & 0xfff000) == 0xe000) {
-						int bus = i2c_bus_num(addr);
-						if (bus != -1) {
-							if (cc->i2cip != bus) {
-								if (cc->i2cip != -1)
-									printf ("\n");
-								struct rnndecaddrinfo *ai = rnndec_decodeaddr(cc->ctx, mmiodom, addr, line[0] == 'W');
-								printf ("[%d] I2C      0x%06"PRIx64"            %s ", cci, addr, ai->name);
-								rnndec_free_decaddrinfo(ai);
-								cc->i2cip = bus;
-							}
-							if (line[0] == 'R') {
-								doi2cr(cc, &cc->i2cb[bus], value);
-							} else {
-								doi2cw(cc, &cc->i2cb[bus], value);
-							}
-							skip = 1;
-						}
-					} else if ((addr & 0xfff000) == 0x9000 && (cc->i2cip != -1)) {
-						/* ignore PTIMER meddling during I2C */
-						skip = 1;
-					} else if (addr == 0x1400 || addr == 0x80000 || (addr == cc->hwsqnext && cc->hwsqip)) {
-						if (!cc->hwsqip) {
-							struct rnndecaddrinfo *ai = rnndec_decodeaddr(cc->ctx, mmiodom, addr, line[0] == 'W');
-							printf ("[%d] HWSQ     0x%06"PRIx64"            %s\n", cci, addr, ai->name);
-							rnndec_free_decaddrinfo(ai);
-						}
-						cc->hwsq[(addr & 0x1fc) + 0] = value;
-						cc->hwsq[(addr & 0x1fc) + 1] = value >> 8;
-						cc->hwsq[(addr & 0x1fc) + 2] = value >> 16;
-						cc->hwsq[(addr & 0x1fc) + 3] = value >> 24;
-						cc->hwsqip = 1;
-						cc->hwsqnext = addr + 4;
-						skip = 1;
-					} else if (addr == 0x10a1c4) {
-						if (cc->seq.action == SEQ_NONE) {
-							/* Crude test whether this vaguely looks like an opcode..
-							 * print will do a more thorough check */
-							if ((value & 0xfc00ffc0) == 0 && value != 0) {
-								cc->seq.action = SEQ_PRINT;
-							} else {
-								cc->seq.action = SEQ_SKIP;
-							}
-						}
-
-						if(cc->seq.action == SEQ_PRINT) {
-							if (cc->seq.len < 2048) {
-								cc->seq.script[cc->seq.len] = value;
-								cc->seq.len++;
-							} else {
-								printf("[%d] PDAEMON  %06"PRIx64" Script too long, skipping\n", cci, addr);
-								cc->seq.len = 0;
-								cc->seq.action = SEQ_SKIP;
-							}
-						}
-					} else if (addr == 0x400324 && cc->chipset.card_type >= 0x40 && cc->chipset.card_type <= 0x50) {
-						cc->ctxpos = value;
-					} else if (addr == 0x400328 && cc->chipset.card_type >= 0x40 && cc->chipset.card_type <= 0x50) {
-						uint8_t param[4];
-						param[0] = value;
-						param[1] = value >> 8;
-						param[2] = value >> 16;
-						param[3] = value >> 24;
-						struct rnndecaddrinfo *ai = rnndec_decodeaddr(cc->ctx, mmiodom, addr, line[0] == 'W');
-						printf ("[%d] MMIO%d %c 0x%06"PRIx64" 0x%08"PRIx64" %s %s ", cci, width, line[0], addr, value, ai->name, line[0]=='W'?"<=":"=>");
-						envydis(ctx_isa, stdout, param, cc->ctxpos, 1, (cc->chipset.card_type == 0x50 ? ctx_var_g80 : ctx_var_nv40), 0, 0, 0, colors);
-						cc->ctxpos++;
-						rnndec_free_decaddrinfo(ai);
-						skip = 1;
-					}
-					if (!skip && (cc->i2cip != -1)) {
-						printf ("\n");
-						cc->i2cip = -1;
-					}
-					if (cc->chipset.card_type >= 0x50 && addr >= 0x700000 && addr < 0x800000) {
-						addr -= 0x700000;
-						addr += cc->praminbase;
-						printf ("[%d] %lf, MEM%d %"PRIx64" %s %"PRIx64"\n", cci, timestamp, width, addr, line[0]=='W'?"<=":"=>", value);
-						*findmem(cc, addr) = value;
-					} else if (!skip) {
-						struct rnndecaddrinfo *ai = rnndec_decodeaddr(cc->ctx, mmiodom, addr, line[0] == 'W');
-						if (width == 32 && ai->width == 8) {
-							/* 32-bit write to 8-bit location - split it up */
-							int b;
-							rnndec_free_decaddrinfo(ai);
-							int cnt;
-							for (b = 0; b < 4; b++) {
-								struct rnndecaddrinfo *ai = rnndec_decodeaddr(cc->ctx, mmiodom, addr+b, line[0] == 'W');
-								char *decoded_val = rnndec_decodeval(cc->ctx, ai->typeinfo, value >> b * 8 & 0xff, ai->width);
-								if (b == 0) {
-									printf ("[%d] %lf MMIO%d %c 0x%06"PRIx64" 0x%08"PRIx64" %n%s %s %s\n", cci, timestamp, width, line[0], addr, value, &cnt, ai->name, line[0]=='W'?"<=":"=>", decoded_val);
-								} else {
-									int c;
-									for (c = 0; c < cnt; c++)
-										printf(" ");
-									printf ("%s %s %s\n", ai->name, line[0]=='W'?"<=":"=>", decoded_val);
-								}
-								rnndec_free_decaddrinfo(ai);
-								free(decoded_val);
-							}
-						} else {
-							char *decoded_val = rnndec_decodeval(cc->ctx, ai->typeinfo, value, ai->width);
-							printf ("[%d] %lf MMIO%d %c 0x%06"PRIx64" 0x%08"PRIx64" %s %s %s\n", cci, timestamp, width, line[0], addr, value, ai->name, line[0]=='W'?"<=":"=>", decoded_val);
-							free(ai->name);
-							free(ai);
-							free(decoded_val);
-						}
-					}
-				} else if (cc->bar1 && addr >= cc->bar1 && addr < cc->bar1+cc->bar1l) {
-					addr -= cc->bar1;
-					printf ("[%d] %lf, FB%d %"PRIx64" %s %"PRIx64"\n", cci, timestamp, width, addr, line[0]=='W'?"<=":"=>", value);
-				} else if (cc->bar2 && addr >= cc->bar2 && addr < cc->bar2+cc->bar2l) {
-					addr -= cc->bar2;
-					if (cc->chipset.card_type >= 0xc0) {
-						uint64_t pd = *findmem(cc, cc->ramins + 0x200);
-						uint64_t pt = *findmem(cc, pd + 4);
-						pt &= 0xfffffff0;
-						pt <<= 8;
-						uint64_t pg = *findmem(cc, pt + (addr/0x1000) * 8);
-						pg &= 0xfffffff0;
-						pg <<= 8;
-						pg += (addr&0xfff);
-						*findmem(cc, pg) = value;
-	//					printf ("%"PRIx64" %"PRIx64" %"PRIx64" %"PRIx64"\n", ramins, pd, pt, pg);
-						printf ("[%d] %lf RAMIN%d %"PRIx64" %"PRIx64" %s %"PRIx64"\n", cci, timestamp, width, addr, pg, line[0]=='W'?"<=":"=>", value);
-					} else if (cc->chipset.card_type == 0x50) {
-						uint64_t paddr = addr;
-						paddr += *findmem(cc, cc->fakechan + cc->ramins + 8);
-						paddr += (uint64_t)(*findmem(cc, cc->fakechan + cc->ramins + 12) >> 24) << 32;
-						uint64_t pt = *findmem(cc, cc->fakechan + (cc->chipset.chipset == 0x50 ? 0x1400 : 0x200) + ((paddr >> 29) << 3));
-	//					printf ("%#"PRIx64" PT: %#"PRIx64" %#"PRIx64" ", paddr, fakechan + 0x200 + ((paddr >> 29) << 3), pt);
-						uint32_t div = (pt & 2 ? 0x1000 : 0x10000);
-						pt &= 0xfffff000;
-						uint64_t pg = *findmem(cc, pt + ((paddr&0x1ffff000)/div) * 8);
-						uint64_t pgh = *findmem(cc, pt + ((paddr&0x1ffff000)/div) * 8 + 4);
-	//					printf ("PG: %#"PRIx64" %#"PRIx64"\n", pt + ((paddr&0x1ffff000)/div) * 8, pgh << 32 | pg);
-						pg &= 0xfffff000;
-						pg |= (pgh & 0xff) << 32;
-						pg += (paddr & (div-1));
-						*findmem(cc, pg) = value;
-	//					printf ("%"PRIx64" %"PRIx64" %"PRIx64" %"PRIx64"\n", ramins, pd, pt, pg);
-						printf ("[%d] %lf RAMIN%d %"PRIx64" %"PRIx64" %s %"PRIx64"\n", cci, timestamp, width, addr, pg, line[0]=='W'?"<=":"=>", value);
-					} else {
-						printf ("[%d] %lf RAMIN%d %"PRIx64" %s %"PRIx64"\n", cci, timestamp, width, addr, line[0]=='W'?"<=":"=>", value);
-					}
-				}
-			}
+			struct bar_range *r = find_bar_range(addr);
+			if (r)
+				r->handler(r->cci, addr - r->start, value, width, op);
 		} else {
-			printf ("%s", line);
+			fwrite(rec.line, 1, rec.len, out);
 		}
 	}
 
+	if (nthreads > 1)
+		stop_workers();
+	mmiotrace_reader_del(reader);
 	rnn_freedb(db);
 	rnn_fini();
 
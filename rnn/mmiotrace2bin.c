@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2026 The envytools authors.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Converts an mmiotrace to the binary format of mmiotrace.h, which demmio
+ * and nvammiotracereplay read without parsing any text.
+ */
+
+#include "mmiotrace.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+static void usage(void) {
+	fprintf(stderr,
+		"Usage: mmiotrace2bin [<input>] [-o <output>]\n"
+		"\n"
+		"Converts a text mmiotrace (possibly compressed) to the binary format.\n"
+		"Reads stdin and writes stdout by default.\n");
+	exit(2);
+}
+
+int main(int argc, char **argv) {
+	const char *outname = NULL;
+	FILE *in = stdin, *out = stdout;
+	struct mmiotrace_reader *reader;
+	struct mmiotrace_rec rec;
+	int c;
+
+	while ((c = getopt(argc, argv, "o:h")) != -1) {
+		switch (c) {
+			case 'o':
+				outname = optarg;
+				break;
+			default:
+				usage();
+		}
+	}
+	if (optind + 1 < argc)
+		usage();
+	if (optind < argc && !(in = open_input(argv[optind]))) {
+		perror(argv[optind]);
+		return 1;
+	}
+	if (outname && !(out = fopen(outname, "w"))) {
+		perror(outname);
+		return 1;
+	}
+
+	reader = mmiotrace_reader_new(in);
+	mmiotrace_write_bin_header(out);
+	while (mmiotrace_next(reader, &rec))
+		mmiotrace_write_bin(out, &rec);
+	mmiotrace_reader_del(reader);
+
+	if (fclose(out)) {
+		perror(outname ? outname : "stdout");
+		return 1;
+	}
+	return 0;
+}
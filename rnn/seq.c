@@ -138,7 +138,7 @@ const char * const seq_wait_status[] = {
 	"!HEAD1_HBLANK",
 };
 
-#define seq_out(p,s,...) printf("%06x: "s,((p) << 2), ##__VA_ARGS__)
+#define seq_out(p,s,...) fprintf(out, "%06x: "s,((p) << 2), ##__VA_ARGS__)
 #define seq_out_op(p,op,s,...) seq_out(p,"%-14s"s, seq_ops[op].txt, ##__VA_ARGS__)
 #define seq_outlast(p,op,val) \
 	seq_out_op(p,op,"%s      %s 0x%08x\n", \
@@ -147,12 +147,13 @@ const char * const seq_wait_status[] = {
 			(val))
 
 /**
- * Print a SEQ script to stdout in human-readable format.
+ * Print a SEQ script in human-readable format.
+ * @param out File to print to.
  * @param script Script to print, native endianness, in 32-bit words.
  * @param len Length of the script in 32-bit words.
  */
 void
-seq_print(uint32_t *script, uint32_t len, struct rnndeccontext *ctx, struct rnndomain *mmiodom)
+seq_print(FILE *out, uint32_t *script, uint32_t len, struct rnndeccontext *ctx, struct rnndomain *mmiodom)
 {
 	unsigned int pc, op, size;
 	char *reg0;
@@ -171,7 +172,7 @@ seq_print(uint32_t *script, uint32_t len, struct rnndeccontext *ctx, struct rnnd
 			return;
 	}
 
-	printf("SEQ script, size: %uB\n", len << 2);
+	fprintf(out, "SEQ script, size: %uB\n", len << 2);
 
 	for(pc = 0; pc < len; pc += size) {
 		op = script[pc] & 0xffff;
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2026 The envytools authors.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/*
+ * Arenas hand out memory from big chunks, for lots of small objects that all
+ * go away together: there's no freeing them one by one, the whole arena is
+ * reset or deleted at once. Memory comes zeroed, like from calloc.
+ */
+
+#include "util.h"
+#include <string.h>
+#include <stdarg.h>
+
+#define ARENA_CHUNK 0x10000
+#define ARENA_ALIGN 16
+
+struct arena_chunk {
+	struct arena_chunk *next;
+	size_t size;
+	size_t used;
+	char data[] __attribute__((aligned(ARENA_ALIGN)));
+};
+
+struct arena {
+	/* the chunk being allocated from, followed by the full ones */
+	struct arena_chunk *chunks;
+	/* chunks left over from a reset, to be reused */
+	struct arena_chunk *spare;
+};
+
+struct arena *arena_new(void) {
+	return calloc(sizeof(struct arena), 1);
+}
+
+static void free_chunks(struct arena_chunk *c) {
+	while (c) {
+		struct arena_chunk *next = c->next;
+		free(c);
+		c = next;
+	}
+}
+
+void arena_del(struct arena *arena) {
+	if (!arena)
+		return;
+	free_chunks(arena->chunks);
+	free_chunks(arena->spare);
+	free(arena);
+}
+
+void arena_reset(struct arena *arena) {
+	while (arena->chunks) {
+		struct arena_chunk *c = arena->chunks;
+		arena->chunks = c->next;
+		/* big allocations got a chunk of their own, don't keep those */
+		if (c->size != ARENA_CHUNK) {
+			free(c);
+			continue;
+		}
+		c->next = arena->spare;
+		arena->spare = c;
+	}
+}
+
+static struct arena_chunk *new_chunk(struct arena *arena, size_t size) {
+	struct arena_chunk *c;
+	if (size <= ARENA_CHUNK && arena->spare) {
+		c = arena->spare;
+		arena->spare = c->next;
+	} else {
+		if (size < ARENA_CHUNK)
+			size = ARENA_CHUNK;
+		c = malloc(sizeof *c + size);
+		c->size = size;
+	}
+	c->used = 0;
+	return c;
+}
+
+void *arena_alloc(struct arena *arena, size_t size) {
+	struct arena_chunk *c = arena->chunks;
+	void *res;
+	size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+	if (!c || c->size - c->used < size) {
+		c = new_chunk(arena, size);
+		if (size > ARENA_CHUNK / 4 && arena->chunks) {
+			/* keep allocating from the current chunk afterwards */
+			c->next = arena->chunks->next;
+			arena->chunks->next = c;
+		} else {
+			c->next = arena->chunks;
+			arena->chunks = c;
+		}
+	}
+	res = c->data + c->used;
+	c->used += size;
+	return memset(res, 0, size);
+}
+
+char *arena_strdup(struct arena *arena, const char *str) {
+	size_t len = strlen(str) + 1;
+	return memcpy(arena_alloc(arena, len), str, len);
+}
+
+char *arena_printf(struct arena *arena, const char *format, ...) {
+	va_list va;
+	va_start(va, format);
+	size_t sz = vsnprintf(0, 0, format, va);
+	va_end(va);
+	char *res = arena_alloc(arena, sz + 1);
+	va_start(va, format);
+	vsnprintf(res, sz + 1, format, va);
+	va_end(va);
+	return res;
+}
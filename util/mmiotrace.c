@@ -0,0 +1,321 @@
+/*
+ * Copyright (C) 2026 The envytools authors.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "mmiotrace.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define READ_SIZE (1 << 20)
+
+struct mmiotrace_reader {
+	FILE *f;
+	char *buf;
+	size_t size, start, end;
+	int eof, mapped, binary;
+};
+
+/* reads more input after what's left in the buffer, returns 0 if there's no more */
+static int fill(struct mmiotrace_reader *r) {
+	size_t got;
+	if (r->eof)
+		return 0;
+	memmove(r->buf, r->buf + r->start, r->end - r->start);
+	r->end -= r->start;
+	r->start = 0;
+	if (r->end == r->size) {
+		r->size *= 2;
+		r->buf = realloc(r->buf, r->size);
+	}
+	got = fread(r->buf + r->end, 1, r->size - r->end, r->f);
+	if (!got)
+		r->eof = 1;
+	r->end += got;
+	return got != 0;
+}
+
+struct mmiotrace_reader *mmiotrace_reader_new(FILE *f) {
+	struct mmiotrace_reader *r = calloc(1, sizeof *r);
+	struct mmiotrace_bin_header *hdr;
+	struct stat st;
+	r->f = f;
+	if (!fstat(fileno(f), &st) && S_ISREG(st.st_mode) && st.st_size > 0 && ftello(f) == 0) {
+		void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+		if (map != MAP_FAILED) {
+			madvise(map, st.st_size, MADV_SEQUENTIAL);
+			r->buf = map;
+			r->size = r->end = st.st_size;
+			r->mapped = r->eof = 1;
+		}
+	}
+	if (!r->mapped) {
+		r->size = READ_SIZE;
+		r->buf = malloc(r->size);
+	}
+	while (r->end < sizeof *hdr && fill(r));
+	hdr = (void *)r->buf;
+	if (r->end >= sizeof *hdr && !memcmp(hdr->magic, MMIOTRACE_BIN_MAGIC, sizeof hdr->magic)) {
+		if (hdr->version != MMIOTRACE_BIN_VERSION || hdr->rec_size != sizeof(struct mmiotrace_bin_rec)) {
+			fprintf(stderr, "Unsupported binary mmiotrace version %u\n", hdr->version);
+			r->start = r->end;
+			r->eof = 1;
+		} else {
+			r->start = sizeof *hdr;
+		}
+		r->binary = 1;
+	}
+	return r;
+}
+
+void mmiotrace_reader_del(struct mmiotrace_reader *r) {
+	if (!r)
+		return;
+	if (r->mapped)
+		munmap(r->buf, r->size);
+	else
+		free(r->buf);
+	free(r);
+}
+
+static int next_text(struct mmiotrace_reader *r, struct mmiotrace_rec *rec) {
+	char *line, *nl;
+	size_t len;
+	while (!(nl = memchr(r->buf + r->start, '\n', r->end - r->start)) && fill(r));
+	line = r->buf + r->start;
+	len = nl ? nl + 1 - line : r->end - r->start;
+	if (!len)
+		return 0;
+	r->start += len;
+	mmiotrace_parse_line(line, len, rec);
+	return 1;
+}
+
+#define BIN_PAD(len) (((len) + 7) & ~(size_t)7)
+
+static int next_binary(struct mmiotrace_reader *r, struct mmiotrace_rec *rec) {
+	const struct mmiotrace_bin_rec *b;
+	size_t total = sizeof *b;
+	while (r->end - r->start < total && fill(r));
+	if (r->end - r->start < total)
+		return 0;
+	b = (void *)(r->buf + r->start);
+	if (b->type == MMIOTRACE_READ || b->type == MMIOTRACE_WRITE) {
+		rec->type = b->type;
+		rec->line = NULL;
+		rec->len = 0;
+		rec->width = b->width;
+		rec->map_id = b->map_id;
+		rec->ts = b->ts;
+		rec->addr = b->addr;
+		rec->value = b->value;
+	} else {
+		total += BIN_PAD(b->textlen);
+		while (r->end - r->start < total && fill(r));
+		if (r->end - r->start < total)
+			return 0;
+		b = (void *)(r->buf + r->start);
+		mmiotrace_parse_line((const char *)(b + 1), b->textlen, rec);
+	}
+	r->start += total;
+	return 1;
+}
+
+int mmiotrace_next(struct mmiotrace_reader *r, struct mmiotrace_rec *rec) {
+	if (r->binary)
+		return next_binary(r, rec);
+	return next_text(r, rec);
+}
+
+void mmiotrace_write_bin_header(FILE *out) {
+	struct mmiotrace_bin_header hdr = {
+		.magic = MMIOTRACE_BIN_MAGIC,
+		.version = MMIOTRACE_BIN_VERSION,
+		.rec_size = sizeof(struct mmiotrace_bin_rec),
+	};
+	fwrite(&hdr, sizeof hdr, 1, out);
+}
+
+void mmiotrace_write_bin(FILE *out, const struct mmiotrace_rec *rec) {
+	static const char zero[8];
+	struct mmiotrace_bin_rec b = { .type = rec->type, .ts = rec->ts };
+	if (rec->type == MMIOTRACE_READ || rec->type == MMIOTRACE_WRITE) {
+		b.width = rec->width;
+		b.map_id = rec->map_id;
+		b.addr = rec->addr;
+		b.value = rec->value;
+		fwrite(&b, sizeof b, 1, out);
+	} else {
+		b.textlen = rec->len;
+		fwrite(&b, sizeof b, 1, out);
+		fwrite(rec->line, 1, rec->len, out);
+		fwrite(zero, 1, BIN_PAD(rec->len) - rec->len, out);
+	}
+}
+
+static const char *skip_spaces(const char *p, const char *end) {
+	while (p < end && (*p == ' ' || *p == '\t'))
+		p++;
+	return p;
+}
+
+static const char *skip_token(const char *p, const char *end) {
+	p = skip_spaces(p, end);
+	while (p < end && *p != ' ' && *p != '\t' && *p != '\n')
+		p++;
+	return p;
+}
+
+static int hexval(char c) {
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+/* hex number with optional 0x prefix, like scanf's %x */
+static int parse_hex(const char **pp, const char *end, uint64_t *res) {
+	const char *p = skip_spaces(*pp, end);
+	uint64_t v = 0;
+	int d;
+	if (end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X') && hexval(p[2]) >= 0)
+		p += 2;
+	if (p == end || hexval(*p) < 0)
+		return 0;
+	while (p < end && (d = hexval(*p)) >= 0) {
+		v = v << 4 | d;
+		p++;
+	}
+	*pp = p;
+	*res = v;
+	return 1;
+}
+
+static int parse_dec(const char **pp, const char *end, uint64_t *res) {
+	const char *p = skip_spaces(*pp, end);
+	uint64_t v = 0;
+	if (p == end || *p < '0' || *p > '9')
+		return 0;
+	while (p < end && *p >= '0' && *p <= '9')
+		v = v * 10 + (*p++ - '0');
+	*pp = p;
+	*res = v;
+	return 1;
+}
+
+/* seconds with up to 9 decimal digits, converted to nanoseconds */
+static int parse_ts(const char **pp, const char *end, uint64_t *res) {
+	const char *p;
+	uint64_t sec, frac = 0;
+	int digits = 0;
+	if (!parse_dec(pp, end, &sec))
+		return 0;
+	p = *pp;
+	if (p < end && *p == '.') {
+		p++;
+		while (p < end && *p >= '0' && *p <= '9') {
+			if (digits < 9) {
+				frac = frac * 10 + (*p - '0');
+				digits++;
+			}
+			p++;
+		}
+	}
+	for (; digits < 9; digits++)
+		frac *= 10;
+	*pp = p;
+	*res = sec * 1000000000ull + frac;
+	return 1;
+}
+
+static int match(const char *p, const char *end, const char *word, size_t wlen) {
+	return (size_t)(end - p) > wlen && !memcmp(p, word, wlen) && (p[wlen] == ' ' || p[wlen] == '\t');
+}
+
+void mmiotrace_parse_line(const char *line, size_t len, struct mmiotrace_rec *rec) {
+	const char *end = line + len;
+	const char *p = line;
+	uint64_t v, w;
+	int i;
+
+	rec->line = line;
+	rec->len = len;
+	rec->type = MMIOTRACE_OTHER;
+
+	if (len > 2 && (line[0] == 'R' || line[0] == 'W') && line[1] == ' ') {
+		/* R/W width timestamp map_id addr value pc pid */
+		p += 2;
+		if (!parse_dec(&p, end, &v) || !parse_ts(&p, end, &rec->ts) || !parse_dec(&p, end, &w) ||
+				!parse_hex(&p, end, &rec->addr) || !parse_hex(&p, end, &rec->value))
+			return;
+		rec->width = v;
+		rec->map_id = w;
+		rec->type = line[0] == 'R' ? MMIOTRACE_READ : MMIOTRACE_WRITE;
+	} else if (match(p, end, "PCIDEV", 6)) {
+		/* PCIDEV devfn vendordevice irq bar*7 len*7 driver */
+		p += 6;
+		if (!parse_hex(&p, end, &v) || !parse_hex(&p, end, &w))
+			return;
+		rec->devfn = v;
+		rec->pciid = w;
+		p = skip_token(p, end);
+		for (i = 0; i < MMIOTRACE_PCI_BARS; i++)
+			if (!parse_hex(&p, end, &rec->bar[i]))
+				return;
+		for (i = 0; i < MMIOTRACE_PCI_BARS; i++)
+			if (!parse_hex(&p, end, &rec->barlen[i]))
+				return;
+		rec->type = MMIOTRACE_PCIDEV;
+	} else if (match(p, end, "MARK", 4)) {
+		/* MARK timestamp text */
+		p += 4;
+		if (!parse_ts(&p, end, &rec->ts))
+			return;
+		p = skip_spaces(p, end);
+		rec->text = p;
+		rec->textlen = end - p;
+		if (rec->textlen && p[rec->textlen - 1] == '\n')
+			rec->textlen--;
+		rec->type = MMIOTRACE_MARK;
+	} else if (match(p, end, "MAP", 3)) {
+		/* MAP timestamp map_id phys virt len pc pid */
+		p += 3;
+		if (!parse_ts(&p, end, &rec->ts) || !parse_dec(&p, end, &v) || !parse_hex(&p, end, &rec->addr) ||
+				!parse_hex(&p, end, &rec->virt) || !parse_hex(&p, end, &rec->maplen))
+			return;
+		rec->map_id = v;
+		rec->type = MMIOTRACE_MAP;
+	} else if (match(p, end, "UNMAP", 5)) {
+		/* UNMAP timestamp map_id pc pid */
+		p += 5;
+		if (!parse_ts(&p, end, &rec->ts) || !parse_dec(&p, end, &v))
+			return;
+		rec->map_id = v;
+		rec->type = MMIOTRACE_UNMAP;
+	}
+}